@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_crc.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_dfu_crc.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_DFU_CRC_H
+#define __USBH_DFU_CRC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#ifdef USE_STDPERIPH_DRIVER
+#include "usbh_conf.h"
+#endif
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_DFU_CRC
+  * @brief This file is the Header file for usbh_dfu_crc.c
+  * @{
+  */
+
+/** @defgroup USBH_DFU_CRC_Exported_Defines
+  * @{
+  */
+#define USBH_DFU_CRC32_INIT         0           //与zlib crc32()相同,初值0,返回值即最终结果
+
+#define USBH_DFU_CRC_NIBBLE         0           //4bit查表,64字节表,最慢
+#define USBH_DFU_CRC_SLICE8         1           //slice-by-8,8KB RAM表,可移植(PC上也可编译)
+#define USBH_DFU_CRC_HW             2           //STM32 CRC单元,按字计算,尾部字节用软件
+
+#ifndef USBH_DFU_CRC_MODE
+#define USBH_DFU_CRC_MODE           USBH_DFU_CRC_SLICE8
+#endif
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_CRC_Exported_FunctionsPrototype
+  * @{
+  */
+uint32_t USBH_DFU_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+/**
+  * @}
+  */
+
+#endif /* __USBH_DFU_CRC_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_delta.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_dfu_delta.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_DFU_DELTA_H
+#define __USBH_DFU_DELTA_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_DFU_DELTA
+  * @brief This file is the Header file for usbh_dfu_delta.c
+  * @{
+  */
+
+/** @defgroup USBH_DFU_DELTA_Exported_Defines
+  * @{
+  */
+#ifndef USBH_DFU_DELTA_MAX_BLOCKS
+#define USBH_DFU_DELTA_MAX_BLOCKS       256     //可比较的最大块数
+#endif
+#ifndef USBH_DFU_DELTA_MANIFEST_NAME
+#define USBH_DFU_DELTA_MANIFEST_NAME    "0:/MK5.man"
+#endif
+#define USBH_DFU_DELTA_MAGIC            0x4D554644  //"DFUM"
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_DELTA_Exported_Types
+  * @{
+  */
+/* Manifest file: this header followed by BlockNum x uint32_t CRC32 (zlib)
+   of the blocks of the image that is on a device reporting BaseVersion */
+#pragma pack(1)
+typedef struct{
+    uint32_t    Magic;          //USBH_DFU_DELTA_MAGIC
+    uint16_t    BaseVersion;    //设备描述符bcdDevice
+    uint16_t    BlockSize;      //必须与本次下载的块大小一致
+    uint32_t    BlockNum;
+}DFU_MANIFEST_ST;
+#pragma pack ()
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_DELTA_Exported_FunctionsPrototype
+  * @{
+  */
+USBH_Status USBH_DFU_Delta_Begin(uint16_t blockSize, uint16_t version);
+uint8_t    *USBH_DFU_Delta_UploadBuf(void);
+void        USBH_DFU_Delta_AddDevBlock(uint32_t index, uint16_t len);
+void        USBH_DFU_Delta_Drop(void);
+uint8_t     USBH_DFU_Delta_IsSame(uint32_t index, const uint8_t *buf, uint16_t len);
+void        USBH_DFU_Delta_Report(void);
+/**
+  * @}
+  */
+
+#endif /* __USBH_DFU_DELTA_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
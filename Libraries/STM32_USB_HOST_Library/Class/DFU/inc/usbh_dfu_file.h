@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_file.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_dfu_file.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_DFU_FILE_H
+#define __USBH_DFU_FILE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+#include "ff.h"
+#include "usbh_dfu_lz.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_DFU_FILE
+  * @brief This file is the Header file for usbh_dfu_file.c
+  * @{
+  */
+
+/** @defgroup USBH_DFU_FILE_Exported_Defines
+  * @{
+  */
+#ifndef USBH_DFU_FILE_BUF_SIZE
+#define USBH_DFU_FILE_BUF_SIZE      0x1000      //单个缓冲区大小,与DNLOAD单包长度一致
+#endif
+#define USBH_DFU_FILE_BUF_NUM       2           //双缓冲:一个正在下发,另一个预读下一包
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_FILE_Exported_Types
+  * @{
+  */
+typedef struct{
+    uint32_t    Start;      //该缓冲区数据在文件中的偏移
+    uint16_t    Len;        //有效字节数
+    uint8_t     Valid;      //1:已预读,等待下发
+}DFU_FILE_BUF_ST;
+
+typedef enum{
+    DFU_SRC_FILE = 0,           //FatFs文件
+    DFU_SRC_MEM,                //片内Flash中的数组
+}DFU_SRC_MODE;
+
+typedef struct{
+    FIL             File;
+    uint8_t         IsOpen;
+    uint8_t         Users;      //正在使用该镜像源的设备数
+    uint8_t         Mode;       //DFU_SRC_MODE
+    uint8_t         Packed;     //1:DFU_LZ容器,边读边解压
+    uint32_t        RawCrc;     //Packed时容器头中的CRC32
+    const uint8_t  *pMem;       //DFU_SRC_MEM:数据起始地址
+    uint32_t        MemPos;     //DFU_SRC_MEM:下一次读取的偏移
+    uint32_t        MemSize;    //DFU_SRC_MEM:数据长度
+    uint16_t        BlockSize;  //每次f_read的长度
+    uint32_t        ReadPos;    //下一次预读的镜像偏移(解压后)
+    uint32_t        Size;       //镜像总长度(解压后)
+    DFU_FILE_BUF_ST Buf[USBH_DFU_FILE_BUF_NUM];
+    DFU_LZ_ST       Lz;
+}DFU_FILE_ST;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_FILE_Exported_FunctionsPrototype
+  * @{
+  */
+USBH_Status USBH_DFU_File_Open(const char *path, uint16_t blockSize, uint32_t *pSize);
+USBH_Status USBH_DFU_File_OpenMem(const uint8_t *addr, uint32_t size, uint16_t blockSize, uint32_t *pSize);
+void        USBH_DFU_File_Close(void);
+void        USBH_DFU_File_Prefetch(void);
+uint8_t    *USBH_DFU_File_GetBlock(uint32_t offset, uint16_t len);
+void        USBH_DFU_File_Release(uint32_t offset);
+uint8_t     USBH_DFU_File_GetCrc(uint32_t *pCrc);
+/**
+  * @}
+  */
+
+#endif /* __USBH_DFU_FILE_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
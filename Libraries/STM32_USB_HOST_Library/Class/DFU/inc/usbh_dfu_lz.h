@@ -0,0 +1,98 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_lz.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_dfu_lz.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_DFU_LZ_H
+#define __USBH_DFU_LZ_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_DFU_LZ
+  * @brief This file is the Header file for usbh_dfu_lz.c
+  * @{
+  */
+
+/** @defgroup USBH_DFU_LZ_Exported_Defines
+  * @{
+  */
+#define DFU_LZ_MAGIC            0x5A554644  //"DFUZ"
+#define DFU_LZ_WINDOW           4096        //历史窗口,必须是2的幂,与打包工具一致
+#define DFU_LZ_MIN_MATCH        3
+#define DFU_LZ_IN_SIZE          128         //输入缓冲
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_LZ_Exported_Types
+  * @{
+  */
+/* Container: this header followed by PackSize bytes of LZSS stream.
+   Stream: a flag byte, then 8 items (LSB first), bit=1 one literal byte,
+   bit=0 a match of 2 bytes: d = distance-1 (12 bit), l = length-3 (4 bit),
+   byte0 = d[7:0], byte1 = d[11:8]<<4 | l */
+#pragma pack(1)
+typedef struct{
+    uint32_t    Magic;      //DFU_LZ_MAGIC
+    uint32_t    RawSize;    //解压后的镜像长度
+    uint32_t    RawCrc;     //解压后镜像的CRC32(zlib)
+    uint32_t    PackSize;   //压缩数据长度
+}DFU_LZ_HEAD_ST;
+#pragma pack ()
+
+typedef uint32_t (*DFU_LZ_READ)(uint8_t *buf, uint32_t len);
+
+typedef struct{
+    DFU_LZ_READ Read;       //读取压缩数据
+    uint32_t    InLeft;     //尚未读入的压缩数据
+    uint16_t    InPos;
+    uint16_t    InLen;
+    uint8_t     Flags;
+    uint8_t     FlagBits;
+    uint16_t    MatchDist;
+    uint16_t    MatchLen;   //未输出完的匹配长度
+    uint16_t    WinPos;
+    uint8_t     In[DFU_LZ_IN_SIZE];
+    uint8_t     Win[DFU_LZ_WINDOW];
+}DFU_LZ_ST;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DFU_LZ_Exported_FunctionsPrototype
+  * @{
+  */
+void     USBH_DFU_LZ_Init(DFU_LZ_ST *lz, DFU_LZ_READ read, uint32_t packSize);
+uint32_t USBH_DFU_LZ_Decode(DFU_LZ_ST *lz, uint8_t *out, uint32_t len);
+/**
+  * @}
+  */
+
+#endif /* __USBH_DFU_LZ_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -45,6 +45,11 @@
 #include "xprintf.h"
 #include 	"include_slef.H"
 #include 	"ucos_ii.h"
+#include "usbh_dfu_file.h"
+#include "usbh_dfu_crc.h"
+#if USBH_DFU_DELTA
+#include "usbh_dfu_delta.h"
+#endif
 
 #if PRINTF_DFU_CORE
 	#define DFU_core_xprintf( X)    do {xprintf X ;} while(0)
@@ -53,13 +58,12 @@
 #endif
 
 	
-void USBH_DFU_SetDelay(INT32U	Xms);
 USBH_Status USBH_DFU_DownBin(USB_OTG_CORE_HANDLE *pdev,uint8_t *pSend,uint16_t lenth);
 	
 //#ifndef	Fireware
 #if	1
 uint8_t 	*Fireware 	= (uint8_t*)0x08010000;
-uint32_t 	FirewareSize=354092;//0x0005672C 
+uint32_t 	FirewareSize=354092;//0x0005672C 压缩镜像(DFU_LZ)以容器头中的长度为准,只需不小于它
 #else
 extern	const   char	Fireware;
 extern  uint32_t 		FirewareSize;
@@ -241,75 +245,180 @@ typedef struct{
     uint8_t InitStep;   //下载初始化状态机
     uint8_t DownStep;   //下载状态机
     uint16_t LenPerPacket;   //下载单包长度  通常是最大值，最后一帧不足时小于最大值
+    uint16_t BlockSize;     //单包最大值,取自DFU功能描述符wTransferSize
     uint32_t IndexOfPacket;     //当前帧序号
     uint32_t Offset;     //连续传输时，每次相对Bin文件的偏移量
     uint32_t SizeOfBin;     //Bin的字节数
-    uint32_t OccurTime;       //收到"连续两帧包之间需要延时"时，记录发生的时间,之后判断延时时间是否已经满足
-    uint32_t DelayTick;     // 当前系统Tick时间，用来计算主动延时  主动：调试时，Host主动延时
-
-    
-        
+    uint32_t Crc;           //已下发数据的CRC32
+    uint32_t ReadCrc;       //读回数据的CRC32
+    uint32_t CrcCycles;     //计算CRC所用的CPU周期
+    uint32_t StartTick;     //开始下载的时刻
+    uint8_t  Sent;          //1:已发出长度为0的DNLOAD,设备进入Manifest
+    uint8_t  Opened;        //1:本会话占用了镜像源
+    uint8_t  Polling;       //1:正在等待bwPollTimeout
+    uint32_t PollEnd;       //bwPollTimeout到期时的DWT_CYCCNT
+
+    uint8_t *datapointer;   //USBH_DFU_DownBin
+    uint8_t *datapointer_prev;
     uint32_t remainingDataLength;
     uint32_t StallErrorCount;
     
 }DFU_ST;
 
-DFU_ST  DFU;
+#if USBH_USE_HUB
+#define DFU_SESSION_NUM     USBH_HUB_MAX_PORTS  //集线器上每个端口一个会话
+#else
+#define DFU_SESSION_NUM     1
+#endif
+
+DFU_ST  DFU_Session[DFU_SESSION_NUM];
+static DFU_ST *pDFU = &DFU_Session[0];  //当前调用所属设备的会话
+
+typedef struct{
+    uint32_t Started;       //开始下载的设备数
+    uint32_t Done;          //已完成Manifest的设备数
+    uint32_t FirstTick;     //第一台设备开始下载的时刻
+}DFU_STATION_ST;
+
+static DFU_STATION_ST DFU_Station;
 
 #define IsDelay_Busy 	0
 #define IsDelay_OK 		1
-#if 0
-int32_t USBH_DFU_IsDelay(INT32U OccurTime)//单位:Tick
+#define DFU_DEFAULT_TRANSFER_SIZE	0x1000	//描述符中无wTransferSize时使用
+
+#ifdef USB_OTG_HOSTSIM
+#define DWT_CTRL        USB_OTG_HostSim_DWT[0]
+#define DWT_CYCCNT      USB_OTG_HostSim_DWT[1]
+#else
+#define DWT_CTRL        (*(__IO uint32_t *)0xE0001000)
+#define DWT_CYCCNT      (*(__IO uint32_t *)0xE0001004)  //统计CRC耗时,各会话的bwPollTimeout计时
+#endif
+#define DFU_POLL_MAX_MS 10000   //DWT_CYCCNT在120MHz下约35s回绕
+
+#if USBH_DFU_VERIFY
+__ALIGN_BEGIN static uint8_t DFU_VerifyBuf[USBH_DFU_VERIFY_BUF_SIZE] __ALIGN_END ;
+#endif
+
+/**
+* @brief  USBH_DFU_Select
+*         Make the session of the device on phost the current one
+* @param  phost: Selected host
+* @retval None
+*/
+static void USBH_DFU_Select(USBH_HOST *phost)
 {
-    static INT32U Cnt_PrintDot = 0,CurTick;
-    INT32U num;
-	INT32U DelayTick = (Dfu_Ack.un.PollTimeOut/SYSTICK_CYC)? (Dfu_Ack.un.PollTimeOut/SYSTICK_CYC)+1 : 0;
-	
-	num = RTC_SysTickOffSet_Update(&CurTick);
-	
-	if(num){
-		if(DFU.DelayTick){
-			DFU.DelayTick--;
-			return false;
-		}
-		if((DelayTick == 0)||(RTC_SysTickOffSet(OccurTime) >= DelayTick)){
-			Cnt_PrintDot = 0;
-			//DFU_core_xprintf(("\n"));
-			return true;
-		}else{	
-			return false;
-		}
-	}
-	return false;
+    uint8_t idx = phost->HubPort ? (phost->HubPort - 1) : 0;
+
+    if(idx >= DFU_SESSION_NUM) idx = 0;
+    pDFU = &DFU_Session[idx];
 }
-#else
-int32_t USBH_DFU_IsDelay(INT32U OccurTime)//单位:Tick
+
+/**
+* @brief  USBH_DFU_PollArm
+*         Start the one-shot timer for the session whose bwPollTimeout
+*         ends first, its expiry wakes the USB task.
+* @param  None
+* @retval None
+*/
+static void USBH_DFU_PollArm(void)
 {
-    static INT32U CurTick;
-    INT32U num;
-	INT32U DelayTick = (Dfu_Ack.un.PollTimeOut/SYSTICK_CYC)? (Dfu_Ack.un.PollTimeOut/SYSTICK_CYC)+1 : 0;
-	
-	num = RTC_SysTickOffSet_Update(&CurTick);
-	
-	if(num){
-		if(DFU.DelayTick){
-			DFU.DelayTick--;
-		}
-	}
-	if(DFU.DelayTick)	return false;
-	if((DelayTick == 0)||(RTC_SysTickOffSet(OccurTime) >= DelayTick)){
-		//DFU_core_xprintf(("\n"));
-		return true;
-	}
-	return false;
+    uint8_t  i;
+    int32_t  left, min = 0x7FFFFFFF;
+    uint32_t now = DWT_CYCCNT;
+
+    for(i = 0; i < DFU_SESSION_NUM; i++){
+        if(DFU_Session[i].Polling == 0) continue;
+        left = (int32_t)(DFU_Session[i].PollEnd - now);
+        if(left < min) min = left;
+    }
+    if(min == 0x7FFFFFFF) return;
+    if(min <= 0){
+        USB_OTG_BSP_EventPost(USB_OTG_EVT_TIMER);
+        return;
+    }
+    USB_OTG_BSP_PollTimerStart((uint32_t)min / (SystemCoreClock / 1000000) + 1);
 }
 
-#endif
-void USBH_DFU_SetDelay(INT32U	Xms)
+/**
+* @brief  USBH_DFU_PollStart
+*         Count bwPollTimeout of the last GETSTATUS for the current session
+* @param  ms: bwPollTimeout
+* @retval None
+*/
+static void USBH_DFU_PollStart(uint32_t ms)
+{
+    if(ms > DFU_POLL_MAX_MS) ms = DFU_POLL_MAX_MS;//超过时提前查询,设备会再给出新的bwPollTimeout
+    pDFU->PollEnd = DWT_CYCCNT + ms * (SystemCoreClock / 1000);
+    pDFU->Polling = (ms != 0);
+    USBH_DFU_PollArm();
+}
+
+/**
+* @brief  USBH_DFU_IsDelay
+*         bwPollTimeout of the last GETSTATUS is counted per session
+*         (us resolution), the next request is only sent once it expires.
+* @param  None
+* @retval IsDelay_OK : the device can accept the next request
+*/
+int32_t USBH_DFU_IsDelay(void)
+{
+    if(pDFU->Polling == 0) return IsDelay_OK;
+    if((int32_t)(DWT_CYCCNT - pDFU->PollEnd) >= 0){
+        pDFU->Polling = 0;
+        return IsDelay_OK;
+    }
+    USBH_DFU_PollArm();//其它会话可能已改动定时器
+    return IsDelay_Busy;
+}
+
+/**
+* @brief  USBH_DFU_GetBlock
+*         Data of the current block [Offset, Offset+LenPerPacket) of the session
+* @param  None
+* @retval pointer to the data, 0 if the image source failed
+*/
+static uint8_t *USBH_DFU_GetBlock(void)
+{
+    return USBH_DFU_File_GetBlock(pDFU->Offset,pDFU->LenPerPacket);
+}
+
+/**
+* @brief  USBH_DFU_CrcBlock
+*         Add the current block to the running CRC32 of the image
+* @param  pBlock: data of the block
+* @retval None
+*/
+static void USBH_DFU_CrcBlock(const uint8_t *pBlock)
+{
+    uint32_t t = DWT_CYCCNT;
+
+    pDFU->Crc = USBH_DFU_Crc32(pDFU->Crc,pBlock,pDFU->LenPerPacket);
+    pDFU->CrcCycles += DWT_CYCCNT - t;
+}
+
+/**
+* @brief  USBH_DFU_CheckImage
+*         Compare the CRC32 of all sent blocks with the image header,
+*         called before the zero length DNLOAD starts the manifestation.
+* @param  None
+* @retval 1 : image good or no reference CRC, 0 : do not manifest
+*/
+static uint8_t USBH_DFU_CheckImage(void)
 {
-    DFU.DelayTick = (Xms/SYSTICK_CYC);
-    //DFU.DelayTick = (Xms/SYSTICK_CYC)+1;
+    uint32_t crc;
+
+    if(USBH_DFU_File_GetCrc(&crc) == 0){
+        DFU_core_xprintf(("<<:DFU: Image CRC32=[%x], no reference\n",pDFU->Crc));
+        return 1;
+    }
+    if(crc != pDFU->Crc){
+        DFU_core_xprintf(("<<:DFU: Image CRC32 Err! sent=[%x] header=[%x]\n",pDFU->Crc,crc));
+        return 0;
+    }
+    DFU_core_xprintf(("<<:DFU: Image CRC32=[%x] OK\n",pDFU->Crc));
+    return 1;
 }
+
 /**
 * @brief   
 *         The function init the DFU class.
@@ -332,33 +441,37 @@ static uint8_t TxCmd[8]={0x21,0x01,0x00,0x00,0x00,0x00,0x00,0x00};
 USBH_Status USBH_DFU_DownBin(USB_OTG_CORE_HANDLE *pdev,uint8_t *pSend,uint16_t lenth)
 {
     URB_STATE URB_Status;
-    static uint8_t *datapointer , *datapointer_prev;
-    static uint32_t remainingDataLength;
-    if(DFU.DownStep == 0){
-        datapointer = pSend;
-        remainingDataLength = lenth; 
-        DFU.DownStep++;
-        pdev->host.hc[0].toggle_out = 1; 
-    }else{
+    if(pDFU->DownStep == 0){
+        pDFU->datapointer = pSend;
+        pDFU->datapointer_prev = pSend;
+        pDFU->remainingDataLength = lenth; 
+        pDFU->DownStep++;
+    }
+    {//SETUP已完成时直接发送第一包,不再等下一次调度
       /* BOT DATA OUT stage */
       URB_Status = HCD_GetURB_State(pdev , END_POINT0_OUT);       
       if((URB_Status == URB_DONE))//||(URB_Status == URB_NOTREADY))
       {
-        DFU.StallErrorCount = 0;
+        pDFU->StallErrorCount = 0;
+        if(pDFU->DownStep == 1){
+          /* SETUP完成中断会翻转toggle_out,数据阶段从DATA1开始须在其后设置 */
+          pdev->host.hc[0].toggle_out = 1; 
+          pDFU->DownStep++;
+        }
         //USBH_MSC_BOTXferParam.BOTStateBkp = USBH_MSC_BOT_DATAOUT_STATE;  
-        if(remainingDataLength > USB_OTG_MAX_EP0_SIZE)  
+        if(pDFU->remainingDataLength > USB_OTG_MAX_EP0_SIZE)  
         {
           USBH_DFUSendData (pdev,
-                             datapointer, 
+                             pDFU->datapointer, 
                              USB_OTG_MAX_EP0_SIZE 
                              );
                                     
-          datapointer_prev = datapointer;
-          datapointer = datapointer + USB_OTG_MAX_EP0_SIZE;
+          pDFU->datapointer_prev = pDFU->datapointer;
+          pDFU->datapointer = pDFU->datapointer + USB_OTG_MAX_EP0_SIZE;
           
-          remainingDataLength = remainingDataLength - USB_OTG_MAX_EP0_SIZE;
+          pDFU->remainingDataLength = pDFU->remainingDataLength - USB_OTG_MAX_EP0_SIZE;
         }
-        else if ( remainingDataLength == 0)
+        else if ( pDFU->remainingDataLength == 0)
         {
           /* If value was 0, and successful transfer, then change the state */
           //USBH_MSC_BOTXferParam.BOTState = USBH_MSC_RECEIVE_CSW_STATE;
@@ -368,29 +481,23 @@ USBH_Status USBH_DFU_DownBin(USB_OTG_CORE_HANDLE *pdev,uint8_t *pSend,uint16_t l
         else
         {
           USBH_DFUSendData (pdev,
-	                        datapointer, 
-			                remainingDataLength 
+	                        pDFU->datapointer, 
+			                pDFU->remainingDataLength 
 			                );
           
-          remainingDataLength = 0; /* Reset this value and keep in same state */   
+          pDFU->datapointer_prev = pDFU->datapointer;
+          pDFU->datapointer = pDFU->datapointer + pDFU->remainingDataLength;
+          pDFU->remainingDataLength = 0; /* Reset this value and keep in same state */   
         }      
       }
       
-      else if(URB_Status == URB_NOTREADY)
+      else if((URB_Status == URB_NOTREADY) && (pDFU->DownStep > 1))
       //else if(URB_Status == URB_NOTYET)
       {
-        if(datapointer != datapointer_prev)
-        {
-          USBH_DFUSendData (pdev,
-                             (datapointer - USB_OTG_MAX_EP0_SIZE), 
-                             USB_OTG_MAX_EP0_SIZE );
-        }
-        else
-        {
-          USBH_DFUSendData (pdev,//
-                             datapointer,
-                             USB_OTG_MAX_EP0_SIZE );
-        }
+        /* NAK: 同一包再发一次,数据toggle不变(最后一包可能不足64字节) */
+        USBH_DFUSendData (pdev,
+                           pDFU->datapointer_prev,
+                           pDFU->datapointer - pDFU->datapointer_prev );
       }
       
       else if(URB_Status == URB_STALL)
@@ -410,46 +517,109 @@ static USBH_Status USBH_DFU_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
   USBH_HOST *pphost = phost;
     
   USBH_Status status = USBH_BUSY ;
+  USBH_Status src;
+  uint8_t step;
   
-  if(USBH_DFU_IsDelay(DFU.OccurTime) == IsDelay_Busy) return status;
+  USBH_DFU_Select(pphost);
+  step = pDFU->InitStep;
+  if(USBH_DFU_IsDelay() == IsDelay_Busy){
+	USBH_DFU_File_Prefetch();//设备编程期间预读(解压)下一包
+	return status;
+  }
 	
-	RTC_SysTickOffSet_Update(&DFU.OccurTime);
   if(pphost->device_prop.Itf_Desc[0].bInterfaceSubClass  == DEVICE_FIRMWARE_UPGRADE)//HID_BOOT_CODE
   {
     if(pphost->device_prop.Itf_Desc[0].bInterfaceProtocol == DFU_RUN_TIME)
     {
-        switch(DFU.InitStep){              
+        switch(pDFU->InitStep){              
             case 0:
-                DFU.LenPerPacket    = 0x1000;
-                DFU.IndexOfPacket   = 0;
-                DFU.Offset          = 0;
-                DFU.SizeOfBin       = FirewareSize;
+                pDFU->BlockSize       = pphost->device_prop.DFU_Desc.wTransferSize;
+                if(pDFU->BlockSize == 0){
+                    pDFU->BlockSize   = DFU_DEFAULT_TRANSFER_SIZE;
+                }
+                if(pDFU->BlockSize > USBH_DFU_FILE_BUF_SIZE){
+                    pDFU->BlockSize   = USBH_DFU_FILE_BUF_SIZE;
+                }
+                DFU_core_xprintf(("<<:DFU: wTransferSize=%d, use %d\n",pphost->device_prop.DFU_Desc.wTransferSize,pDFU->BlockSize));
+                pDFU->LenPerPacket    = pDFU->BlockSize;
+                pDFU->IndexOfPacket   = 0;
+                pDFU->Offset          = 0;
+                pDFU->Crc             = USBH_DFU_CRC32_INIT;
+                pDFU->ReadCrc         = USBH_DFU_CRC32_INIT;
+                pDFU->CrcCycles       = 0;
+                pDFU->Sent            = 0;
+                pDFU->Polling         = 0;
+                pDFU->StartTick       = RTC_SysTickGetSum();
+#ifndef USB_OTG_HOSTSIM
+                CoreDebug->DEMCR   |= CoreDebug_DEMCR_TRCENA_Msk;
+#endif
+                DWT_CTRL           |= 0x01;//CYCCNTENA
+#if USBH_DFU_USE_FILE
+                src = USBH_DFU_File_Open(USBH_DFU_FILE_NAME,pDFU->LenPerPacket,&pDFU->SizeOfBin);
+#else
+                src = USBH_DFU_File_OpenMem((const uint8_t *)Fireware,FirewareSize,pDFU->LenPerPacket,&pDFU->SizeOfBin);
+#endif
+                if(src == USBH_BUSY){
+                    break;//镜像源正被其它设备独占或U盘尚未就绪,稍后再试
+                }
+                if(src != USBH_OK){
+                    DFU_core_xprintf(("<<:DFU: No image, give up\n"));
+                    pDFU->InitStep    = 20;
+                    break;
+                }
+                pDFU->Opened          = 1;
+                if(DFU_Station.Started++ == 0){
+                    DFU_Station.FirstTick = pDFU->StartTick;
+                }
                 
-                DFU.InitStep        = 10;
+                pDFU->InitStep        = 10;
+#if USBH_DFU_DELTA
+                if((pphost->HubPort == 0)//差异下载只支持单台设备
+                    && (USBH_DFU_Delta_Begin(pDFU->BlockSize,pphost->device_prop.Dev_Desc.bcdDevice) == USBH_BUSY)){
+                    pDFU->InitStep    = 40;//先读回设备中的镜像
+                }
+#endif
                 break;
             case 10://Tx[A1 03 00 00 00 00 06 00 ]   //Rx[00 00 00 00 02 00 ]
                 if(USBH_DFU_RxPara(pdev,phost,DFU_Req_GETSTATUS,0,pdev->host.Rx_Buffer,sizeof(Dfu_Ack)) == USBH_OK){
                     USBH_DFU_Parse_ACK(&Dfu_Ack,pdev->host.Rx_Buffer);
+                    USBH_DFU_PollStart(Dfu_Ack.un.PollTimeOut);//bwPollTimeout单位ms
                     if(Dfu_Ack.ErrStatus == DFU_Err_OK){
                         switch(Dfu_Ack.un.RunState){
                             case DFU_APP_IDLE:
                             case DFU_DFU_IDLE:
+                                if(pDFU->Sent){//Manifestation Tolerant的设备编程完成后回到dfuIDLE
+#if USBH_DFU_VERIFY
+                                    if(pphost->device_prop.DFU_Desc.bmAttributes.b.bitCanUpload){
+                                        pDFU->Offset        = 0;
+                                        pDFU->IndexOfPacket = 0;
+                                        pDFU->InitStep      = 51;//读回校验
+                                        break;
+                                    }
+                                    DFU_core_xprintf(("<<:DFU: Device can't UPLOAD, no readback\n"));
+#endif
+                                    pDFU->InitStep = 20;
+                                    break;
+                                }
                             case DFU_DFU_DN_SYNC:
                             case DFU_DFU_DN_BUSY:
                                 //DFU_core_xprintf(("<<:DFU: Busy\n"));
                                 //break;
                             case DFU_DFU_DN_IDLE:
                                 //DFU_core_xprintf(("<<:DFU: No Err\n"));
-                                 DFU.InitStep++;
+                                 pDFU->InitStep++;
                                 break;
                                 
                             case DFU_DFU_MANIFEST_WAIT_RESET:
                                 DFU_core_xprintf(("<<:DFU: DFU_DFU_MANIFEST_WAIT_RESET\n"));
                                 DFU_core_xprintf(("<<:DFU: DFU Send Succesed Realy!!!!!\n"));
-								DFU.InitStep=20;
+#if USBH_DFU_VERIFY
+                                DFU_core_xprintf(("<<:DFU: Not manifestation tolerant, no readback\n"));
+#endif
+								pDFU->InitStep=20;
                                 break;
                             case DFU_DFU_ERROR:
-                                DFU.InitStep=30;
+                                pDFU->InitStep=30;
                                 break;
 							default:
 								break;
@@ -459,11 +629,11 @@ static USBH_Status USBH_DFU_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
                         switch(Dfu_Ack.ErrStatus){
                             case DFU_Err_TRGET:
                                 DFU_core_xprintf(("<<:DFU: File is not targeted for use by this device\n"));
-                                DFU.InitStep=20;
+                                pDFU->InitStep=20;
                                 break;
                             case DFU_Err_FILE:
                                 DFU_core_xprintf(("<<:DFU: File is for this device but fails some vendor-specific verification test\n"));
-                                DFU.InitStep=20;
+                                pDFU->InitStep=20;
                                 break;
                         }
                     }
@@ -475,22 +645,22 @@ static USBH_Status USBH_DFU_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
                     switch(Dfu_Ack.un.RunState){
                         case DFU_DFU_IDLE:
                             DFU_core_xprintf(("<<:DFU: DFU_DFU_IDLE\n"));
-                            DFU.InitStep++;
+                            pDFU->InitStep++;
                             break;
                         case DFU_DFU_DN_IDLE:
                             //DFU_core_xprintf(("<<:DFU: DFU_DFU_DN_IDLE\n"));
-                            DFU.InitStep++;
+                            pDFU->InitStep++;
                             break;
                         case DFU_DFU_DN_SYNC:
-                            DFU.InitStep=10; 
+                            pDFU->InitStep=10; 
                             //DFU_core_xprintf(("<<:DFU: DFU_DFU_DN_SYNC\n"));
                             break;
                         case DFU_DFU_MANIFEST_SYNC:
-                            DFU.InitStep=10; 
+                            pDFU->InitStep=10; 
                             DFU_core_xprintf(("<<:DFU: DFU_DFU_MANIFEST_SYNC\n"));
                             break;
                         case DFU_DFU_ERROR:
-                            DFU.InitStep=30; 
+                            pDFU->InitStep=30; 
                             DFU_core_xprintf(("<<:DFU: DFU_DFU_ERROR An error has occurred.Awaiting the DFU_CLRSTATUS\n"));
                             break;
                         default:
@@ -501,50 +671,160 @@ static USBH_Status USBH_DFU_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
                 }
                 break;
             case 12://Tx[21 01 00 00 00 00 XX XX ]   //LE(XXXX)  = len
+    			pDFU->LenPerPacket=((pDFU->SizeOfBin-pDFU->Offset)/pDFU->BlockSize)?pDFU->BlockSize:((pDFU->SizeOfBin-pDFU->Offset)%pDFU->BlockSize);
+#if USBH_DFU_DELTA
+				while(pDFU->LenPerPacket){//跳过与设备内容相同的块
+					uint8_t *pBlock = USBH_DFU_GetBlock();
+					if((pBlock == 0)||(USBH_DFU_Delta_IsSame(pDFU->IndexOfPacket,pBlock,pDFU->LenPerPacket) == 0)) break;
+					USBH_DFU_CrcBlock(pBlock);
+					USBH_DFU_File_Release(pDFU->Offset);
+					pDFU->Offset += pDFU->LenPerPacket;
+					pDFU->IndexOfPacket++;
+					pDFU->LenPerPacket=((pDFU->SizeOfBin-pDFU->Offset)/pDFU->BlockSize)?pDFU->BlockSize:((pDFU->SizeOfBin-pDFU->Offset)%pDFU->BlockSize);
+				}
+#endif
+				if((pDFU->LenPerPacket == 0) && (USBH_DFU_CheckImage() == 0)){
+					pDFU->InitStep=50;//镜像有误,不进入Manifest
+					break;
+				}
 				TxCmd[1] = DFU_Req_DNLOAD;
-				TxCmd[2] = DFU.IndexOfPacket&0xff;
-				TxCmd[3] = (DFU.IndexOfPacket>>8)&0xff;
+				TxCmd[2] = pDFU->IndexOfPacket&0xff;
+				TxCmd[3] = (pDFU->IndexOfPacket>>8)&0xff;
 			
-    			DFU.LenPerPacket=((DFU.SizeOfBin-DFU.Offset)/0x1000)?0x1000:((DFU.SizeOfBin-DFU.Offset)%0x1000);
-				TxCmd[6] = DFU.LenPerPacket&0xff;
-				TxCmd[7] = (DFU.LenPerPacket>>8)&0xff;
+				TxCmd[6] = pDFU->LenPerPacket&0xff;
+				TxCmd[7] = (pDFU->LenPerPacket>>8)&0xff;
 				DFU_core_xprintf(("<<:DFU: DFU_Send Cmd:[%h]",TxCmd,sizeof(TxCmd)));
-				DFU_core_xprintf(("  IndexOfPacket=%l; DFU.SizeOfBin = [%x]; DFU.Offset=[%x]\n",DFU.IndexOfPacket,DFU.SizeOfBin,DFU.Offset));
-                //if(USBH_DFU_TxPara(pdev,phost,DFU_Req_DNLOAD,DFU.IndexOfPacket,pdev->host.Rx_Buffer,DFU.LenPerPacket) == USBH_OK){
+				DFU_core_xprintf(("  IndexOfPacket=%l; DFU.SizeOfBin = [%x]; DFU.Offset=[%x]\n",pDFU->IndexOfPacket,pDFU->SizeOfBin,pDFU->Offset));
+                //if(USBH_DFU_TxPara(pdev,phost,DFU_Req_DNLOAD,pDFU->IndexOfPacket,pdev->host.Rx_Buffer,pDFU->LenPerPacket) == USBH_OK){
                 if(USBH_DFUSendSetup(pdev,TxCmd,sizeof(TxCmd))== USBH_OK){
-                    DFU.InitStep++;
-                    DFU.IndexOfPacket++;
-					DFU.DownStep = 0;
-					if(DFU.LenPerPacket == 0){
+                    pDFU->InitStep++;
+                    pDFU->IndexOfPacket++;
+					pDFU->DownStep = 0;
+					if(pDFU->LenPerPacket == 0){
+						pDFU->Sent = 1;
 						DFU_core_xprintf(("<<:DFU: DFU Send Succesed!!!!!\n"));
-						DFU.InitStep=11;//根据查询状态来退出
+						pDFU->InitStep=11;//根据查询状态来退出
 					}
-					USBH_DFU_SetDelay(2);
                 }
                 break;
             case 13://Tx[.......... ]
 				if(1){
-					//if(USBH_DFUSendData(pdev,(uint8_t*)&Fireware+DFU.Offset,USB_OTG_MAX_EP0_SIZE) == USBH_OK){
-					if(USBH_DFU_DownBin(pdev,(uint8_t*)(Fireware+DFU.Offset),DFU.LenPerPacket) == USBH_OK){
+					uint8_t *pBlock = USBH_DFU_GetBlock();
+					if(pBlock == 0){
+						pDFU->InitStep=20;
+						break;
+					}
+					//if(USBH_DFUSendData(pdev,(uint8_t*)&Fireware+pDFU->Offset,USB_OTG_MAX_EP0_SIZE) == USBH_OK){
+					if(USBH_DFU_DownBin(pdev,pBlock,pDFU->LenPerPacket) == USBH_OK){
 						//0x1000 0x1000 ... 0x0001 0    //最后为0字节长度
-    					DFU.Offset += DFU.LenPerPacket;
-						DFU.InitStep=11;
+						USBH_DFU_CrcBlock(pBlock);
+						USBH_DFU_File_Release(pDFU->Offset);
+    					pDFU->Offset += pDFU->LenPerPacket;
+						pDFU->InitStep=11;
                         DFU_core_xprintf(("<<:DFU: DFU Send one packed already**********************\n"));
 					}
 				}
                 break;
+#if USBH_DFU_DELTA
+			case 40://Tx[A1 02 XX XX 00 00 LL LL ]   //读回第XX块,计算CRC
+				pDFU->LenPerPacket=((pDFU->SizeOfBin-pDFU->Offset)/pDFU->BlockSize)?pDFU->BlockSize:((pDFU->SizeOfBin-pDFU->Offset)%pDFU->BlockSize);
+				if(1){
+					USBH_Status req = USBH_DFU_RxPara(pdev,phost,DFU_Req_UPLOAD,pDFU->IndexOfPacket,USBH_DFU_Delta_UploadBuf(),pDFU->LenPerPacket);
+					if(req == USBH_OK){
+						uint16_t len = HCD_GetXferCnt(pdev,pphost->Control.hc_num_in);
+						USBH_DFU_Delta_AddDevBlock(pDFU->IndexOfPacket,len);
+						pDFU->Offset += pDFU->LenPerPacket;
+						pDFU->IndexOfPacket++;
+						if((len < pDFU->LenPerPacket)||(pDFU->Offset >= pDFU->SizeOfBin)){
+							pDFU->InitStep=41;
+						}
+					}else if(req != USBH_BUSY){
+						DFU_core_xprintf(("<<:DFU: UPLOAD not supported, full download\n"));
+						USBH_DFU_Delta_Drop();//已读回的块不用,全部下载
+						pDFU->InitStep=30;//设备STALL后进入dfuERROR
+					}
+					if(pDFU->InitStep != 40){
+						pDFU->Offset = 0;
+						pDFU->IndexOfPacket = 0;
+					}
+				}
+				break;
+			case 41://Tx[21 06 00 00 00 00 00 00 ]   //ABORT 回到dfuIDLE
+				if(USBH_DFU_TxPara(pdev,phost,DFU_Req_ABORT,0,0,0) == USBH_OK){
+					pDFU->InitStep=10;
+				}
+				break;
+#endif
+			case 50://Tx[21 06 00 00 00 00 00 00 ]   //ABORT 放弃本次下载
+				if(USBH_DFU_TxPara(pdev,phost,DFU_Req_ABORT,0,0,0) != USBH_BUSY){
+					pDFU->InitStep=20;
+				}
+				break;
+#if USBH_DFU_VERIFY
+			case 51://Tx[A1 02 XX XX 00 00 LL LL ]   //读回并计算CRC,与下发的比较
+				pDFU->LenPerPacket=((pDFU->SizeOfBin-pDFU->Offset) > USBH_DFU_VERIFY_BUF_SIZE)?USBH_DFU_VERIFY_BUF_SIZE:(pDFU->SizeOfBin-pDFU->Offset);
+				if(1){
+					USBH_Status req = USBH_DFU_RxPara(pdev,phost,DFU_Req_UPLOAD,pDFU->IndexOfPacket,DFU_VerifyBuf,pDFU->LenPerPacket);
+					if(req == USBH_OK){
+						uint16_t len = HCD_GetXferCnt(pdev,pphost->Control.hc_num_in);
+						uint32_t t = DWT_CYCCNT;
+						pDFU->ReadCrc = USBH_DFU_Crc32(pDFU->ReadCrc,DFU_VerifyBuf,len);
+						pDFU->CrcCycles += DWT_CYCCNT - t;
+						pDFU->Offset += len;
+						pDFU->IndexOfPacket++;
+						if((len < pDFU->LenPerPacket)||(pDFU->Offset >= pDFU->SizeOfBin)){
+							if((pDFU->Offset == pDFU->SizeOfBin) && (pDFU->ReadCrc == pDFU->Crc)){
+								DFU_core_xprintf(("<<:DFU: Readback OK, CRC32=[%x]\n",pDFU->ReadCrc));
+							}else{
+								DFU_core_xprintf(("<<:DFU: Readback Err! [%x] bytes, CRC32=[%x]\n",pDFU->Offset,pDFU->ReadCrc));
+							}
+							pDFU->InitStep=50;//回到dfuIDLE
+						}
+					}else if(req != USBH_BUSY){
+						DFU_core_xprintf(("<<:DFU: UPLOAD failed, no readback\n"));
+						pDFU->InitStep=20;
+					}
+				}
+				break;
+#endif
 			case 30://Tx[21 04 00 00 00 00 01 00 ]   //Rx[02 ] DFU_DFU_ERROR:clear
-	                if(USBH_DFU_TxPara(pdev,phost,DFU_Req_CLRSTATUS,0,pdev->host.Rx_Buffer,1) == USBH_OK){
-	                    DFU.InitStep=10; 
-						break;  
+	                src = USBH_DFU_TxPara(pdev,phost,DFU_Req_CLRSTATUS,0,pdev->host.Rx_Buffer,1);
+	                if(src == USBH_OK){
+	                    pDFU->InitStep=10; 
+					}else if(src != USBH_BUSY){
+	                    DFU_core_xprintf(("<<:DFU: CLRSTATUS failed, give up\n"));
+	                    pDFU->InitStep=20;
 					}
+					break;
             case 20://OK
+				    if(pDFU->Opened){
+				        USBH_DFU_File_Close();
+				        pDFU->Opened = 0;
+				    }
+				    DFU_core_xprintf(("<<:DFU: Port %d Time %d ms, CRC %d us\n",pphost->HubPort,(RTC_SysTickGetSum() - pDFU->StartTick) * SYSTICK_CYC,
+				                        pDFU->CrcCycles / (SystemCoreClock / 1000000)));
+				    if(pDFU->Sent){
+				        uint32_t ms = (RTC_SysTickGetSum() - DFU_Station.FirstTick) * SYSTICK_CYC;
+				        DFU_Station.Done++;
+				        DFU_core_xprintf(("<<:DFU: Station %d done, %d per hour\n",DFU_Station.Done,
+				                            ms ? (uint32_t)((uint64_t)DFU_Station.Done * 3600000 / ms) : 0));
+				    }
+#if USBH_DFU_DELTA
+				    if(pphost->HubPort == 0){
+				        USBH_DFU_Delta_Report();
+				    }
+#endif
 				    status = USBH_OK;
-				    DFU.InitStep=0;
+				    pDFU->InitStep=0;
                 break;
             default:
                 break;
         }
+        if(pDFU->InitStep != step){
+            USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);//状态已切换,立即执行下一步
+        }
+        //DNLOAD的SETUP和数据不经过USBH_CtlReq,期间不能把控制通道让给集线器上的其它设备
+        pphost->CtlHold = (pDFU->InitStep == 13) || ((step == 12) && (pDFU->InitStep == 11));
     }
     start_toggle_dfu =0;
   }
@@ -571,7 +851,16 @@ static USBH_Status USBH_DFU_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
 void USBH_DFU_InterfaceDeInit ( USB_OTG_CORE_HANDLE *pdev,
                                void *phost)
 {	
-   //USBH_HOST *pphost = phost;
+  USBH_HOST *pphost = phost;
+
+  USBH_DFU_Select(pphost);
+  if(pDFU->Opened){//下载中途拔出
+    USBH_DFU_File_Close();
+    pDFU->Opened = 0;
+  }
+  pDFU->InitStep = 0;
+  pDFU->Polling  = 0;
+  pphost->CtlHold = 0;
   #if 0	//@
   if(HID_Machine.hc_num_in != 0x00)
   {   
@@ -0,0 +1,243 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_crc.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   CRC32 used to check DFU images and compare image blocks.
+  *
+  * @verbatim
+  *          Same CRC as zlib crc32() (poly 0xEDB88320, reflected), so the
+  *          values can be produced on the PC with any zlib binding:
+  *          crc = USBH_DFU_Crc32(crc, buf, len), starting from 0.
+  *
+  *          USBH_DFU_CRC_MODE selects the implementation:
+  *          - NIBBLE : 4 bit table, smallest.
+  *          - SLICE8 : 8 bytes per step, tables built in RAM on first use.
+  *                     Only needs <stdint.h>, the file builds on the PC too.
+  *          - HW     : the CRC unit of the STM32F2 (poly 0x04C11DB7, MSB
+  *                     first) fed with bit reversed words. The unit can not be
+  *                     loaded with a start value, so it is reset and fed one
+  *                     computed word that brings it to the running value.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_dfu_crc.h"
+#if (USBH_DFU_CRC_MODE == USBH_DFU_CRC_HW)
+#include "stm32f2xx.h"
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @defgroup USBH_DFU_CRC
+* @brief    This file includes the CRC32 used by the DFU class.
+* @{
+*/
+
+/** @defgroup USBH_DFU_CRC_Private_Defines
+* @{
+*/
+#define CRC32_POLY_REV      0xEDB88320  //zlib,低位在前
+#define CRC32_POLY          0x04C11DB7  //CRC单元,高位在前
+#define CRC32_HW_MIN_LEN    16          //太短时重装CRC单元不划算
+/**
+* @}
+*/
+
+/** @defgroup USBH_DFU_CRC_Private_Variables
+* @{
+*/
+#if (USBH_DFU_CRC_MODE != USBH_DFU_CRC_SLICE8)
+static const uint32_t Crc32_Nibble[16] =
+{
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+  0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+  0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+#else
+static uint32_t Crc32_Slice[8][256];
+static uint8_t  Crc32_SliceReady = 0;
+#endif
+/**
+* @}
+*/
+
+/** @defgroup USBH_DFU_CRC_Private_Functions
+* @{
+*/
+
+#if (USBH_DFU_CRC_MODE != USBH_DFU_CRC_SLICE8)
+/**
+* @brief  USBH_DFU_Crc32_Nibble
+*         Update the raw (inverted) CRC register, 4 bit table
+* @param  r: CRC register
+* @param  buf: data
+* @param  len: number of bytes
+* @retval new CRC register
+*/
+static uint32_t USBH_DFU_Crc32_Nibble(uint32_t r, const uint8_t *buf, uint32_t len)
+{
+  while(len--)
+  {
+    r ^= *buf++;
+    r = (r >> 4) ^ Crc32_Nibble[r & 0x0F];
+    r = (r >> 4) ^ Crc32_Nibble[r & 0x0F];
+  }
+  return r;
+}
+#else
+/**
+* @brief  USBH_DFU_Crc32_SliceInit
+*         Build the 8 slice tables (8 KB)
+* @param  None
+* @retval None
+*/
+static void USBH_DFU_Crc32_SliceInit(void)
+{
+  uint32_t i, j, c;
+  
+  for(i = 0; i < 256; i++)
+  {
+    c = i;
+    for(j = 0; j < 8; j++)
+    {
+      c = (c & 1) ? ((c >> 1) ^ CRC32_POLY_REV) : (c >> 1);
+    }
+    Crc32_Slice[0][i] = c;
+  }
+  for(i = 0; i < 256; i++)
+  {
+    c = Crc32_Slice[0][i];
+    for(j = 1; j < 8; j++)
+    {
+      c = Crc32_Slice[0][c & 0xFF] ^ (c >> 8);
+      Crc32_Slice[j][i] = c;
+    }
+  }
+  Crc32_SliceReady = 1;
+}
+
+/**
+* @brief  USBH_DFU_Crc32_Slice8
+*         Update the raw CRC register, 8 bytes per step
+* @param  r: CRC register
+* @param  buf: data
+* @param  len: number of bytes
+* @retval new CRC register
+*/
+static uint32_t USBH_DFU_Crc32_Slice8(uint32_t r, const uint8_t *buf, uint32_t len)
+{
+  uint32_t lo, hi;
+  
+  if(Crc32_SliceReady == 0)
+  {
+    USBH_DFU_Crc32_SliceInit();
+  }
+  while(len >= 8)
+  {
+    /* bytes are assembled one by one: no alignment or endian assumption */
+    lo = r ^ ((uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
+    hi = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) | ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+    r = Crc32_Slice[7][lo & 0xFF] ^ Crc32_Slice[6][(lo >> 8) & 0xFF]
+      ^ Crc32_Slice[5][(lo >> 16) & 0xFF] ^ Crc32_Slice[4][lo >> 24]
+      ^ Crc32_Slice[3][hi & 0xFF] ^ Crc32_Slice[2][(hi >> 8) & 0xFF]
+      ^ Crc32_Slice[1][(hi >> 16) & 0xFF] ^ Crc32_Slice[0][hi >> 24];
+    buf += 8;
+    len -= 8;
+  }
+  while(len--)
+  {
+    r = Crc32_Slice[0][(r ^ *buf++) & 0xFF] ^ (r >> 8);
+  }
+  return r;
+}
+#endif
+
+#if (USBH_DFU_CRC_MODE == USBH_DFU_CRC_HW)
+/**
+* @brief  USBH_DFU_Crc32_Hw
+*         Update the raw CRC register with the CRC unit, whole words only
+* @param  r: CRC register
+* @param  buf: data
+* @param  words: number of 32 bit words
+* @retval new CRC register
+*/
+static uint32_t USBH_DFU_Crc32_Hw(uint32_t r, const uint8_t *buf, uint32_t words)
+{
+  uint32_t s, i;
+  
+  if((RCC->AHB1ENR & RCC_AHB1ENR_CRCEN) == 0)
+  {
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+  }
+  
+  /* run the unit backwards 32 bits from the wanted state:
+     after a reset (0xFFFFFFFF) this word brings DR to __RBIT(r) */
+  s = __RBIT(r);
+  for(i = 0; i < 32; i++)
+  {
+    s = (s & 1) ? (((s ^ CRC32_POLY) >> 1) | 0x80000000) : (s >> 1);
+  }
+  CRC->CR = CRC_CR_RESET;
+  CRC->DR = s ^ 0xFFFFFFFF;
+  
+  while(words--)
+  {
+    CRC->DR = __RBIT((uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24));
+    buf += 4;
+  }
+  return __RBIT(CRC->DR);
+}
+#endif
+
+/**
+* @brief  USBH_DFU_Crc32
+*         Update a running CRC32 with len bytes
+* @param  crc: value returned by the last call, USBH_DFU_CRC32_INIT for the first
+* @param  buf: data
+* @param  len: number of bytes
+* @retval CRC32 of all data so far, equal to zlib crc32()
+*/
+uint32_t USBH_DFU_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  uint32_t r = crc ^ 0xFFFFFFFF;
+  
+#if (USBH_DFU_CRC_MODE == USBH_DFU_CRC_SLICE8)
+  r = USBH_DFU_Crc32_Slice8(r, buf, len);
+#elif (USBH_DFU_CRC_MODE == USBH_DFU_CRC_HW)
+  if(len >= CRC32_HW_MIN_LEN)
+  {
+    r = USBH_DFU_Crc32_Hw(r, buf, len >> 2);
+    buf += len & ~3UL;
+    len &= 3;
+  }
+  r = USBH_DFU_Crc32_Nibble(r, buf, len);
+#else
+  r = USBH_DFU_Crc32_Nibble(r, buf, len);
+#endif
+  return r ^ 0xFFFFFFFF;
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
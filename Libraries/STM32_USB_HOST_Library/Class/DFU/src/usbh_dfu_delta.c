@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_delta.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Delta DFU: skip the DNLOAD of blocks that the device already holds.
+  *
+  * @verbatim
+  *          The CRC32 of every block on the device is taken either from a
+  *          manifest file (when the device bcdDevice matches its BaseVersion)
+  *          or from a DFU_Req_UPLOAD read back before the download. A block of
+  *          the new image with the same CRC is not sent, the device has to
+  *          place each DNLOAD block at wBlockNum * block size.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_dfu_delta.h"
+#include "usbh_dfu_crc.h"
+#include "ff.h"
+#include "xprintf.h"
+#include 	"include_slef.H"
+
+#if PRINTF_DFU_CORE
+	#define DFU_delta_xprintf( X)    do {xprintf X ;} while(0)
+#else
+	#define DFU_delta_xprintf( X)
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @defgroup USBH_DFU_DELTA
+* @brief    This file includes the delta download for the DFU class.
+* @{
+*/
+
+/** @defgroup USBH_DFU_DELTA_Private_TypesDefinitions
+* @{
+*/
+typedef struct{
+    uint16_t BlockSize;
+    uint32_t BlockNum;      //前BlockNum块的设备端CRC已知
+    uint32_t DevCrc[USBH_DFU_DELTA_MAX_BLOCKS];
+    uint32_t SentBlocks;
+    uint32_t SkipBlocks;
+    uint32_t SkipBytes;
+    uint32_t StartTick;
+}DFU_DELTA_ST;
+/**
+* @}
+*/
+
+/** @defgroup USBH_DFU_DELTA_Private_Variables
+* @{
+*/
+#ifdef USB_OTG_HS_INTERNAL_DMA_ENABLED
+  #if defined ( __ICCARM__ ) /*!< IAR Compiler */
+    #pragma data_alignment=4
+  #endif
+#endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
+__ALIGN_BEGIN static uint8_t DFU_UploadBuf[USBH_DFU_FILE_BUF_SIZE] __ALIGN_END ;
+
+static DFU_DELTA_ST DFU_Delta;
+/**
+* @}
+*/
+
+/** @defgroup USBH_DFU_DELTA_Private_Functions
+* @{
+*/
+
+/**
+* @brief  USBH_DFU_Delta_LoadManifest
+*         Load the device block CRCs from the manifest file
+* @param  version: bcdDevice of the attached device
+* @retval 1 if the manifest matches the device and the block size
+*/
+static uint8_t USBH_DFU_Delta_LoadManifest(uint16_t version)
+{
+    FIL             file;
+    DFU_MANIFEST_ST head;
+    UINT            br;
+    uint32_t        num;
+    uint8_t         ok = 0;
+
+    if(f_open(&file, USBH_DFU_DELTA_MANIFEST_NAME, FA_OPEN_EXISTING | FA_READ) != FR_OK){
+        return 0;
+    }
+    if((f_read(&file, &head, sizeof(head), &br) == FR_OK) && (br == sizeof(head))
+        && (head.Magic == USBH_DFU_DELTA_MAGIC) && (head.BaseVersion == version)
+        && (head.BlockSize == DFU_Delta.BlockSize)){
+        num = (head.BlockNum < USBH_DFU_DELTA_MAX_BLOCKS) ? head.BlockNum : USBH_DFU_DELTA_MAX_BLOCKS;
+        if((f_read(&file, DFU_Delta.DevCrc, num * 4, &br) == FR_OK) && (br == num * 4)){
+            DFU_Delta.BlockNum = num;
+            ok = 1;
+        }
+    }
+    f_close(&file);
+    return ok;
+}
+
+/**
+* @brief  USBH_DFU_Delta_Begin
+*         Start a delta download
+* @param  blockSize: DNLOAD block size
+* @param  version: bcdDevice of the attached device
+* @retval USBH_OK: device CRCs known from the manifest, download can start
+*         USBH_BUSY: read back the device with USBH_DFU_Delta_AddDevBlock first
+*/
+USBH_Status USBH_DFU_Delta_Begin(uint16_t blockSize, uint16_t version)
+{
+    DFU_Delta.BlockSize  = blockSize;
+    DFU_Delta.BlockNum   = 0;
+    DFU_Delta.SentBlocks = 0;
+    DFU_Delta.SkipBlocks = 0;
+    DFU_Delta.SkipBytes  = 0;
+    DFU_Delta.StartTick  = RTC_SysTickGetSum();
+
+    if((blockSize == 0) || (blockSize > USBH_DFU_FILE_BUF_SIZE)){
+        return USBH_OK;//无法比较,全部下载
+    }
+    if(USBH_DFU_Delta_LoadManifest(version)){
+        DFU_delta_xprintf(("<<:DFU: Manifest for version %x, %d blocks\n",version,DFU_Delta.BlockNum));
+        return USBH_OK;
+    }
+    return USBH_BUSY;
+}
+
+/**
+* @brief  USBH_DFU_Delta_UploadBuf
+*         Buffer for the DFU_Req_UPLOAD data of one block
+* @param  None
+* @retval buffer of USBH_DFU_FILE_BUF_SIZE bytes
+*/
+uint8_t *USBH_DFU_Delta_UploadBuf(void)
+{
+    return DFU_UploadBuf;
+}
+
+/**
+* @brief  USBH_DFU_Delta_AddDevBlock
+*         Record the CRC of a block read back from the device. Blocks are
+*         added in order, a short block ends the known part of the device.
+* @param  index: block number
+* @param  len: bytes received in the upload buffer
+* @retval None
+*/
+void USBH_DFU_Delta_AddDevBlock(uint32_t index, uint16_t len)
+{
+    if((index != DFU_Delta.BlockNum) || (index >= USBH_DFU_DELTA_MAX_BLOCKS)) return;
+
+    DFU_Delta.DevCrc[index] = USBH_DFU_Crc32(USBH_DFU_CRC32_INIT, DFU_UploadBuf, len);
+    DFU_Delta.BlockNum++;
+}
+
+/**
+* @brief  USBH_DFU_Delta_Drop
+*         Forget the device blocks, every block is sent (read back failed)
+* @param  None
+* @retval None
+*/
+void USBH_DFU_Delta_Drop(void)
+{
+    DFU_Delta.BlockNum = 0;
+}
+
+/**
+* @brief  USBH_DFU_Delta_IsSame
+*         Compare a block of the new image with the device, count the result
+* @param  index: block number
+* @param  buf: block data of the new image
+* @param  len: block length
+* @retval 1: the device holds the same data, DNLOAD can be skipped
+*/
+uint8_t USBH_DFU_Delta_IsSame(uint32_t index, const uint8_t *buf, uint16_t len)
+{
+    if((index < DFU_Delta.BlockNum)
+        && (USBH_DFU_Crc32(USBH_DFU_CRC32_INIT, buf, len) == DFU_Delta.DevCrc[index])){
+        DFU_Delta.SkipBlocks++;
+        DFU_Delta.SkipBytes += len;
+        return 1;
+    }
+    DFU_Delta.SentBlocks++;
+    return 0;
+}
+
+/**
+* @brief  USBH_DFU_Delta_Report
+*         Print bytes and time saved by the delta download. The time saved is
+*         estimated from the average time of the blocks really sent.
+* @param  None
+* @retval None
+*/
+void USBH_DFU_Delta_Report(void)
+{
+    uint32_t ms = (RTC_SysTickGetSum() - DFU_Delta.StartTick) * SYSTICK_CYC;
+    uint32_t saved = DFU_Delta.SentBlocks ? (ms / DFU_Delta.SentBlocks) * DFU_Delta.SkipBlocks : 0;
+
+    DFU_delta_xprintf(("<<:DFU: Delta: sent %d blocks, skipped %d blocks (%d bytes)\n",
+        DFU_Delta.SentBlocks,DFU_Delta.SkipBlocks,DFU_Delta.SkipBytes));
+    DFU_delta_xprintf(("<<:DFU: Delta: time %d ms, about %d ms saved\n",ms,saved));
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -0,0 +1,353 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_file.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   DFU image source: reads the firmware from a FatFs file or from
+  *          an array in internal flash, raw or packed (DFU_LZ container).
+  *
+  * @verbatim
+  *          Two buffers of USBH_DFU_FILE_BUF_SIZE bytes are used. While block N
+  *          is sent to the device (DNLOAD + GETSTATUS polling), block N+1 is
+  *          read (and decompressed) into the other buffer, so this time is
+  *          hidden in the device's bwPollTimeout window instead of adding to it.
+  *          A raw image in flash needs no buffer, blocks point into the array.
+  *          Only such an image can be shared by several devices on a hub,
+  *          a file or a packed image is read as one stream by one device.
+  *          The file source does not mount the drive: the volume is the one
+  *          of the MSC application, so the stick has to be enumerated next
+  *          to the device, i.e. both behind the hub (usbh_hub.c), each host
+  *          served by its registered class (USBH_RegisterClass).
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_dfu_file.h"
+#include "string.h"
+#include "xprintf.h"
+#include 	"include_slef.H"
+
+#if PRINTF_DFU_CORE
+	#define DFU_file_xprintf( X)    do {xprintf X ;} while(0)
+#else
+	#define DFU_file_xprintf( X)
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @defgroup USBH_DFU_FILE
+* @brief    This file includes the file backed image source for the DFU class.
+* @{
+*/
+
+/** @defgroup USBH_DFU_FILE_Private_Variables
+* @{
+*/
+#ifdef USB_OTG_HS_INTERNAL_DMA_ENABLED
+  #if defined ( __ICCARM__ ) /*!< IAR Compiler */
+    #pragma data_alignment=4
+  #endif
+#endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
+__ALIGN_BEGIN static uint8_t DFU_FileBuf[USBH_DFU_FILE_BUF_NUM][USBH_DFU_FILE_BUF_SIZE] __ALIGN_END ;
+
+static DFU_FILE_ST  DFU_File;
+/**
+* @}
+*/
+
+/** @defgroup USBH_DFU_FILE_Private_Functions
+* @{
+*/
+
+/**
+* @brief  USBH_DFU_File_Read
+*         Read bytes from the source, also the input of the LZ decoder
+* @param  buf: destination
+* @param  len: bytes wanted
+* @retval bytes read, 0 on error or at the end
+*/
+static uint32_t USBH_DFU_File_Read(uint8_t *buf, uint32_t len)
+{
+    UINT br;
+
+    if(DFU_File.Mode == DFU_SRC_MEM){
+        if(len > DFU_File.MemSize - DFU_File.MemPos){
+            len = DFU_File.MemSize - DFU_File.MemPos;
+        }
+        memcpy(buf, DFU_File.pMem + DFU_File.MemPos, len);
+        DFU_File.MemPos += len;
+        return len;
+    }
+    if(f_read(&DFU_File.File, buf, len, &br) != FR_OK){
+        return 0;
+    }
+    return br;
+}
+
+/**
+* @brief  USBH_DFU_File_Start
+*         Check for a DFU_LZ container and read the first block.
+* @param  blockSize: DNLOAD block size, clipped to USBH_DFU_FILE_BUF_SIZE
+* @param  pSize: returns the image size in bytes (unpacked)
+* @retval USBH_Status : USBH_OK if the source is ready
+*/
+static USBH_Status USBH_DFU_File_Start(uint16_t blockSize, uint32_t *pSize)
+{
+    uint8_t i;
+    DFU_LZ_HEAD_ST head;
+
+    DFU_File.IsOpen    = 1;
+    DFU_File.Packed    = 0;
+    DFU_File.BlockSize = (blockSize && (blockSize < USBH_DFU_FILE_BUF_SIZE)) ? blockSize : USBH_DFU_FILE_BUF_SIZE;
+    DFU_File.ReadPos   = 0;
+    for(i = 0; i < USBH_DFU_FILE_BUF_NUM; i++){
+        DFU_File.Buf[i].Valid = 0;
+    }
+
+    if((DFU_File.Size >= sizeof(head))
+        && (USBH_DFU_File_Read((uint8_t *)&head, sizeof(head)) == sizeof(head))
+        && (head.Magic == DFU_LZ_MAGIC)){
+        if(head.PackSize > DFU_File.Size - sizeof(head)){
+            DFU_file_xprintf(("<<:DFU: Packed image truncated\n"));
+            USBH_DFU_File_Close();
+            return USBH_FAIL;
+        }
+        DFU_File.Packed = 1;
+        DFU_File.Size   = head.RawSize;
+        DFU_File.RawCrc = head.RawCrc;
+        USBH_DFU_LZ_Init(&DFU_File.Lz, USBH_DFU_File_Read, head.PackSize);
+    }else if(DFU_File.Mode == DFU_SRC_MEM){
+        DFU_File.MemPos = 0;
+    }else{
+        f_lseek(&DFU_File.File, 0);//不是压缩容器,从头读原始镜像
+    }
+    *pSize = DFU_File.Size;
+
+    USBH_DFU_File_Prefetch();//第一包同步读出,后续在设备编程期间预读
+    return USBH_OK;
+}
+
+/**
+* @brief  USBH_DFU_File_Open
+*         Open the image file and read the first block.
+* @param  path: FatFs path of the image, e.g. "0:/MK5.bin"
+* @param  blockSize: DNLOAD block size, clipped to USBH_DFU_FILE_BUF_SIZE
+* @param  pSize: returns the image size in bytes (unpacked)
+* @retval USBH_Status : USBH_OK if the file is ready,
+*                       USBH_BUSY while another device is using the source
+*                       or the drive is not mounted yet
+*/
+USBH_Status USBH_DFU_File_Open(const char *path, uint16_t blockSize, uint32_t *pSize)
+{
+    FRESULT res;
+
+    if(DFU_File.Users) return USBH_BUSY;
+    USBH_DFU_File_Close();
+
+    res = f_open(&DFU_File.File, path, FA_OPEN_EXISTING | FA_READ);
+    if((res == FR_NOT_ENABLED) || (res == FR_NOT_READY)){
+        return USBH_BUSY;//U盘尚未接入或MSC应用尚未挂载,等待,不自行挂载以免冲掉应用的工作区
+    }
+    if(res != FR_OK){
+        DFU_file_xprintf(("<<:DFU: Can't open %s, res=%d\n",path,res));
+        return USBH_FAIL;
+    }
+    DFU_File.Mode = DFU_SRC_FILE;
+    DFU_File.Size = DFU_File.File.fsize;
+    if(USBH_DFU_File_Start(blockSize, pSize) != USBH_OK){
+        return USBH_FAIL;
+    }
+    DFU_File.Users = 1;
+    DFU_file_xprintf(("<<:DFU: Open %s, Size=[%x]%s\n",path,DFU_File.Size,
+                        DFU_File.Packed ? " packed" : ""));
+    return USBH_OK;
+}
+
+/**
+* @brief  USBH_DFU_File_OpenMem
+*         Use an image linked into internal flash as the source.
+* @param  addr: start of the image (raw or DFU_LZ container)
+* @param  size: bytes at addr
+* @param  blockSize: DNLOAD block size, clipped to USBH_DFU_FILE_BUF_SIZE
+* @param  pSize: returns the image size in bytes (unpacked)
+* @retval USBH_Status : USBH_OK if the image is ready,
+*                       USBH_BUSY while another device is reading a packed image
+*/
+USBH_Status USBH_DFU_File_OpenMem(const uint8_t *addr, uint32_t size, uint16_t blockSize, uint32_t *pSize)
+{
+    if(DFU_File.Users){
+        if((DFU_File.Mode == DFU_SRC_MEM) && (DFU_File.Packed == 0) && (DFU_File.pMem == addr)){
+            DFU_File.Users++;//原始镜像按偏移直接取,可同时供多台设备使用
+            *pSize = DFU_File.Size;
+            return USBH_OK;
+        }
+        return USBH_BUSY;
+    }
+    USBH_DFU_File_Close();
+
+    DFU_File.Mode    = DFU_SRC_MEM;
+    DFU_File.pMem    = addr;
+    DFU_File.MemPos  = 0;
+    DFU_File.MemSize = size;
+    DFU_File.Size    = size;
+    if(USBH_DFU_File_Start(blockSize, pSize) != USBH_OK){
+        return USBH_FAIL;
+    }
+    DFU_File.Users = 1;
+    DFU_file_xprintf(("<<:DFU: Image at [%x], Size=[%x]%s\n",(uint32_t)(uintptr_t)addr,DFU_File.Size,
+                        DFU_File.Packed ? " packed" : ""));
+    return USBH_OK;
+}
+
+/**
+* @brief  USBH_DFU_File_Close
+*         Close the image file and drop all buffered blocks once the last
+*         device using the source has finished.
+* @param  None
+* @retval None
+*/
+void USBH_DFU_File_Close(void)
+{
+    uint8_t i;
+
+    if(DFU_File.Users > 1){
+        DFU_File.Users--;
+        return;
+    }
+    DFU_File.Users = 0;
+    if(DFU_File.IsOpen){
+        if(DFU_File.Mode == DFU_SRC_FILE){
+            f_close(&DFU_File.File);
+        }
+        DFU_File.IsOpen = 0;
+    }
+    for(i = 0; i < USBH_DFU_FILE_BUF_NUM; i++){
+        DFU_File.Buf[i].Valid = 0;
+    }
+}
+
+/**
+* @brief  USBH_DFU_File_Prefetch
+*         Read (and unpack) the next block into a free buffer. Does nothing
+*         if both buffers are in use or the whole image has been read.
+*         Call it whenever the DFU engine is waiting on the device.
+* @param  None
+* @retval None
+*/
+void USBH_DFU_File_Prefetch(void)
+{
+    uint8_t  i;
+    uint32_t len, br;
+    DFU_FILE_BUF_ST *pBuf;
+
+    if((DFU_File.IsOpen == 0) || (DFU_File.ReadPos >= DFU_File.Size)) return;
+    if((DFU_File.Mode == DFU_SRC_MEM) && (DFU_File.Packed == 0)) return;//直接使用Flash中的数据
+
+    for(i = 0; i < USBH_DFU_FILE_BUF_NUM; i++){
+        pBuf = &DFU_File.Buf[i];
+        if(pBuf->Valid) continue;
+
+        len = DFU_File.Size - DFU_File.ReadPos;
+        if(len > DFU_File.BlockSize) len = DFU_File.BlockSize;
+        if(DFU_File.Packed){
+            br = USBH_DFU_LZ_Decode(&DFU_File.Lz, DFU_FileBuf[i], len);
+        }else{
+            br = USBH_DFU_File_Read(DFU_FileBuf[i], len);
+        }
+        if(br != len){
+            DFU_file_xprintf(("<<:DFU: Read Err at [%x]\n",DFU_File.ReadPos));
+            USBH_DFU_File_Close();
+            return;
+        }
+        pBuf->Start = DFU_File.ReadPos;
+        pBuf->Len   = (uint16_t)br;
+        pBuf->Valid = 1;
+        DFU_File.ReadPos += br;
+        return;//一次只读一包,避免占用过长时间
+    }
+}
+
+/**
+* @brief  USBH_DFU_File_GetBlock
+*         Return the buffer holding [offset, offset+len) of the image.
+*         If read-ahead has not caught up yet the block is read now.
+* @param  offset: offset in the image
+* @param  len: block length
+* @retval pointer to the data, 0 on error
+*/
+uint8_t *USBH_DFU_File_GetBlock(uint32_t offset, uint16_t len)
+{
+    uint8_t i, retry;
+
+    if((DFU_File.Mode == DFU_SRC_MEM) && (DFU_File.Packed == 0)){
+        if((DFU_File.IsOpen) && (offset + len <= DFU_File.Size)){
+            return (uint8_t *)DFU_File.pMem + offset;
+        }
+        return 0;
+    }
+    for(retry = 0; retry <= USBH_DFU_FILE_BUF_NUM; retry++){
+        for(i = 0; i < USBH_DFU_FILE_BUF_NUM; i++){
+            if((DFU_File.Buf[i].Valid) && (DFU_File.Buf[i].Start == offset)
+                && (DFU_File.Buf[i].Len >= len)){
+                return DFU_FileBuf[i];
+            }
+        }
+        if(DFU_File.IsOpen == 0) break;
+        USBH_DFU_File_Prefetch();
+    }
+    DFU_file_xprintf(("<<:DFU: Block [%x] not available\n",offset));
+    return 0;
+}
+
+/**
+* @brief  USBH_DFU_File_Release
+*         Mark the block at offset as sent, the buffer can be refilled.
+* @param  offset: offset of the block in the image
+* @retval None
+*/
+void USBH_DFU_File_Release(uint32_t offset)
+{
+    uint8_t i;
+
+    for(i = 0; i < USBH_DFU_FILE_BUF_NUM; i++){
+        if((DFU_File.Buf[i].Valid) && (DFU_File.Buf[i].Start == offset)){
+            DFU_File.Buf[i].Valid = 0;
+        }
+    }
+}
+
+/**
+* @brief  USBH_DFU_File_GetCrc
+*         CRC32 of the whole image as given by the container header
+* @param  pCrc: returns the CRC32 (zlib)
+* @retval 1 if the image carries a CRC, 0 for a raw image
+*/
+uint8_t USBH_DFU_File_GetCrc(uint32_t *pCrc)
+{
+    if(DFU_File.Packed == 0) return 0;
+    *pCrc = DFU_File.RawCrc;
+    return 1;
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -0,0 +1,148 @@
+/**
+  ******************************************************************************
+  * @file    usbh_dfu_lz.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Streaming LZSS decoder for compressed DFU images.
+  *
+  * @verbatim
+  *          The decoder keeps its state between calls, so the caller can ask
+  *          for exactly one DNLOAD block at a time. RAM: 4 KB window and a
+  *          128 byte input buffer. Images are packed by Tools/dfu_pack.py.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_dfu_lz.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @defgroup USBH_DFU_LZ
+* @brief    This file includes the LZSS decoder used by the DFU class.
+* @{
+*/
+
+/** @defgroup USBH_DFU_LZ_Private_Functions
+* @{
+*/
+
+/**
+* @brief  USBH_DFU_LZ_GetByte
+*         Next byte of the packed stream
+* @param  lz: decoder
+* @retval byte, -1 at the end of the stream
+*/
+static int16_t USBH_DFU_LZ_GetByte(DFU_LZ_ST *lz)
+{
+  uint32_t n;
+  
+  if(lz->InPos >= lz->InLen)
+  {
+    if(lz->InLeft == 0) return -1;
+    n = (lz->InLeft < DFU_LZ_IN_SIZE) ? lz->InLeft : DFU_LZ_IN_SIZE;
+    n = lz->Read(lz->In, n);
+    if(n == 0) return -1;
+    lz->InLeft -= n;
+    lz->InLen = n;
+    lz->InPos = 0;
+  }
+  return lz->In[lz->InPos++];
+}
+
+/**
+* @brief  USBH_DFU_LZ_Init
+*         Start decoding a stream
+* @param  lz: decoder
+* @param  read: function reading the packed data (after the container header)
+* @param  packSize: length of the packed data
+* @retval None
+*/
+void USBH_DFU_LZ_Init(DFU_LZ_ST *lz, DFU_LZ_READ read, uint32_t packSize)
+{
+  lz->Read      = read;
+  lz->InLeft    = packSize;
+  lz->InPos     = 0;
+  lz->InLen     = 0;
+  lz->Flags     = 0;
+  lz->FlagBits  = 0;
+  lz->MatchDist = 0;
+  lz->MatchLen  = 0;
+  lz->WinPos    = 0;
+}
+
+/**
+* @brief  USBH_DFU_LZ_Decode
+*         Decode up to len bytes
+* @param  lz: decoder
+* @param  out: output buffer
+* @param  len: bytes wanted
+* @retval bytes written, less than len only at the end of the stream
+*/
+uint32_t USBH_DFU_LZ_Decode(DFU_LZ_ST *lz, uint8_t *out, uint32_t len)
+{
+  uint32_t n = 0;
+  int16_t  c, c2;
+  
+  while(n < len)
+  {
+    if(lz->MatchLen == 0)
+    {
+      if(lz->FlagBits == 0)
+      {
+        if((c = USBH_DFU_LZ_GetByte(lz)) < 0) break;
+        lz->Flags = (uint8_t)c;
+        lz->FlagBits = 8;
+      }
+      lz->FlagBits--;
+      if(lz->Flags & 0x01)
+      {
+        lz->Flags >>= 1;
+        if((c = USBH_DFU_LZ_GetByte(lz)) < 0) break;
+        lz->Win[lz->WinPos] = (uint8_t)c;
+        lz->WinPos = (lz->WinPos + 1) & (DFU_LZ_WINDOW - 1);
+        out[n++] = (uint8_t)c;
+        continue;
+      }
+      lz->Flags >>= 1;
+      c  = USBH_DFU_LZ_GetByte(lz);
+      c2 = USBH_DFU_LZ_GetByte(lz);
+      if(c2 < 0) break;
+      lz->MatchDist = (uint16_t)(c | ((c2 & 0xF0) << 4)) + 1;
+      lz->MatchLen  = (uint16_t)(c2 & 0x0F) + DFU_LZ_MIN_MATCH;
+    }
+    
+    /* copy from the window, byte by byte as the match may overlap itself */
+    while((lz->MatchLen) && (n < len))
+    {
+      c = lz->Win[(lz->WinPos - lz->MatchDist) & (DFU_LZ_WINDOW - 1)];
+      lz->Win[lz->WinPos] = (uint8_t)c;
+      lz->WinPos = (lz->WinPos + 1) & (DFU_LZ_WINDOW - 1);
+      out[n++] = (uint8_t)c;
+      lz->MatchLen--;
+    }
+  }
+  return n;
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
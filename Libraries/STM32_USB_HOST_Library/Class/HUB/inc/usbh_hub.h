@@ -0,0 +1,176 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hub.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_hub.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_HUB_H
+#define __USBH_HUB_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+#include "usbh_stdreq.h"
+#include "usb_bsp.h"
+#include "usbh_ioreq.h"
+#include "usbh_hcs.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HUB
+  * @brief This file is the Header file for usbh_hub.c
+  * @{
+  */
+
+/** @defgroup USBH_HUB_Exported_Defines
+  * @{
+  */
+#ifndef USBH_HUB_MAX_PORTS
+#define USBH_HUB_MAX_PORTS          4           //同时下载的设备数上限
+#endif
+#ifndef USBH_HUB_DEVICE_CLASS
+#define USBH_HUB_DEVICE_CLASS       USBH_DFU_cb //集线器下游设备使用的类驱动
+#endif
+
+#define USB_HUB_CLASS               0x09
+#define USB_DESC_TYPE_HUB           0x29
+#define USB_HUB_DESC_SIZE           9
+
+#define HUB_REQ_TYPE_DEV_IN         (USB_D2H | USB_REQ_TYPE_CLASS | USB_REQ_RECIPIENT_DEVICE)   //0xA0
+#define HUB_REQ_TYPE_PORT_IN        (USB_D2H | USB_REQ_TYPE_CLASS | USB_REQ_RECIPIENT_OTHER)    //0xA3
+#define HUB_REQ_TYPE_PORT_OUT       (USB_H2D | USB_REQ_TYPE_CLASS | USB_REQ_RECIPIENT_OTHER)    //0x23
+
+/* port features, USB 2.0 table 11-17 */
+#define HUB_FEAT_PORT_RESET         4
+#define HUB_FEAT_PORT_POWER         8
+#define HUB_FEAT_C_PORT_CONNECTION  16          //C_PORT_xxx = 16 + wPortChange的位号
+
+/* wPortStatus */
+#define HUB_PORT_CONNECTION         0x0001
+#define HUB_PORT_ENABLE             0x0002
+#define HUB_PORT_RESET              0x0010
+#define HUB_PORT_LOW_SPEED          0x0200
+/* wPortChange */
+#define HUB_C_PORT_RESET            0x0010
+
+#define HUB_OWNER_FREE              0           //控制通道空闲
+#define HUB_OWNER_SELF              0xFF        //集线器自身占用,其它值为端口号
+
+#define HUB_DEBOUNCE_MS             100
+#define HUB_RESET_POLL_MS           10
+/**
+  * @}
+  */
+
+/** @defgroup USBH_HUB_Exported_Types
+  * @{
+  */
+typedef enum
+{
+  HUB_INIT_DETECT = 0,
+  HUB_INIT_GET_DESC,
+  HUB_INIT_POWER,
+  HUB_INIT_POWER_WAIT,
+  HUB_INIT_DONE,
+}
+HUB_InitState;
+
+typedef enum
+{
+  HUB_SYNC = 0,
+  HUB_GET_DATA,
+  HUB_POLL,
+}
+HUB_State;
+
+typedef enum
+{
+  HUB_PORT_IDLE = 0,
+  HUB_PORT_GET_STATUS,
+  HUB_PORT_CLEAR,
+  HUB_PORT_EVAL,
+  HUB_PORT_DEBOUNCE,
+  HUB_PORT_SET_RESET,
+  HUB_PORT_RESET_WAIT,
+  HUB_PORT_RESET_STATUS,
+  HUB_PORT_RESET_CLEAR,
+  HUB_PORT_ATTACH,
+}
+HUB_PortState;
+
+typedef struct
+{
+  USBH_HOST             Host;         //该端口下设备的主机状态机
+  uint8_t               Attached;
+}
+HUB_Port_TypeDef;
+
+typedef struct
+{
+  uint8_t               IsHub;        //0:直接连接的设备,转交USBH_HUB_DEVICE_CLASS
+  HUB_InitState         InitState;
+  HUB_State             state;
+  HUB_PortState         PortState;
+  uint8_t               NbrPorts;
+  uint8_t               PwrOn2PwrGood;//单位2ms
+  uint8_t               Port;         //正在处理的端口
+  uint8_t               Owner;        //占用控制通道者,HUB_OWNER_xxx或端口号
+  uint8_t               Next;         //下一轮调度从该端口开始
+  uint8_t               hc_num_in;
+  uint8_t               ep_addr;
+  uint16_t              length;
+  uint16_t              poll;
+  uint16_t              timer;
+  uint8_t               start_toggle;
+  uint32_t              Change;       //有变化的端口,bit n:端口n
+  uint16_t              PortStatus;
+  uint16_t              PortChange;
+  uint32_t              Tick;
+  uint8_t               buff[8];
+  HUB_Port_TypeDef      Ports[USBH_HUB_MAX_PORTS];
+}
+HUB_Machine_TypeDef;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_HUB_Exported_Variables
+  * @{
+  */
+extern USBH_Class_cb_TypeDef  USBH_HUB_cb;
+extern USBH_Class_cb_TypeDef  USBH_HUB_DEVICE_CLASS;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_HUB_Exported_FunctionsPrototype
+  * @{
+  */
+uint8_t USBH_HUB_ActiveDevices(void);
+/**
+  * @}
+  */
+
+#endif /* __USBH_HUB_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
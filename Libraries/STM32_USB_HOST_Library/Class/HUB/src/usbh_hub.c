@@ -0,0 +1,671 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hub.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Hub class driver: several devices flashed in parallel.
+  *
+  * @verbatim
+  *          One external full speed hub on the root port. Each hub port has
+  *          its own USBH_HOST (enumeration, control and DFU state), the
+  *          devices are given address USBH_DEVICE_ADDRESS + port.
+  *
+  *          All devices share the two control channels of the hub. A device
+  *          owns them from the SETUP of a request until its class has taken
+  *          the answer (RequestState back to CMD_SEND, CtlHold cleared), then
+  *          the next port gets its turn. A device waiting on bwPollTimeout
+  *          does not hold the channels, so meanwhile the blocks of the other
+  *          devices are on the bus.
+  *
+  *          When the root device is not a hub, all calls are passed on to
+  *          USBH_HUB_DEVICE_CLASS, so USBH_HUB_cb can always be registered.
+  *          Low speed devices behind the hub are not supported (no PRE).
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_hub.h"
+#include "usbh_dfu_core.h"
+#include "string.h"
+#include "xprintf.h"
+#include 	"include_slef.H"
+
+#if PRINTF_USBH_HUB
+	#define HUB_xprintf( X)    do {xprintf X ;} while(0)
+#else
+	#define HUB_xprintf( X)
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HUB
+* @brief    This file includes the hub class driver.
+* @{
+*/
+
+/** @defgroup USBH_HUB_Private_Variables
+* @{
+*/
+static HUB_Machine_TypeDef  HUB_Machine;
+/**
+* @}
+*/
+
+/** @defgroup USBH_HUB_Private_FunctionPrototypes
+* @{
+*/
+static USBH_Status USBH_HUB_InterfaceInit  (USB_OTG_CORE_HANDLE *pdev ,
+                                            void *phost);
+
+static void USBH_HUB_InterfaceDeInit  (USB_OTG_CORE_HANDLE *pdev ,
+                                       void *phost);
+
+static USBH_Status USBH_HUB_ClassRequest(USB_OTG_CORE_HANDLE *pdev ,
+                                         void *phost);
+
+static USBH_Status USBH_HUB_Handle(USB_OTG_CORE_HANDLE *pdev ,
+                                   void *phost);
+
+USBH_Class_cb_TypeDef  USBH_HUB_cb =
+{
+  USBH_HUB_InterfaceInit,
+  USBH_HUB_InterfaceDeInit,
+  USBH_HUB_ClassRequest,
+  USBH_HUB_Handle
+};
+/**
+* @}
+*/
+
+/** @defgroup USBH_HUB_Private_Functions
+* @{
+*/
+
+/**
+* @brief  USBH_HUB_Req
+*         Issue a hub class request on the control pipe of the hub
+* @param  pdev: Selected device
+* @param  phost: host of the hub
+* @param  type: bmRequestType
+* @param  request: bRequest
+* @param  value: wValue
+* @param  index: wIndex (port)
+* @param  buff: data stage buffer
+* @param  length: wLength
+* @retval USBH_Status
+*/
+static USBH_Status USBH_HUB_Req(USB_OTG_CORE_HANDLE *pdev,
+                                USBH_HOST *phost,
+                                uint8_t type,
+                                uint8_t request,
+                                uint16_t value,
+                                uint16_t index,
+                                uint8_t *buff,
+                                uint16_t length)
+{
+  phost->Control.setup.b.bmRequestType = type;
+  phost->Control.setup.b.bRequest = request;
+  phost->Control.setup.b.wValue.w = value;
+  phost->Control.setup.b.wIndex.w = index;
+  phost->Control.setup.b.wLength.w = length;
+
+  return USBH_CtlReq(pdev, phost, buff, length);
+}
+
+/**
+* @brief  USBH_HUB_OpenCtl
+*         Point the shared control channels at a device
+* @param  pdev: Selected device
+* @param  hc_in: control IN channel
+* @param  hc_out: control OUT channel
+* @param  phost: host of the device taking the channels
+* @retval None
+*/
+static void USBH_HUB_OpenCtl(USB_OTG_CORE_HANDLE *pdev, uint8_t hc_in, uint8_t hc_out, USBH_HOST *phost)
+{
+  USBH_Open_Channel(pdev, hc_in, phost->device_prop.address, phost->device_prop.speed,
+                    EP_TYPE_CTRL, phost->Control.ep0size);
+  USBH_Open_Channel(pdev, hc_out, phost->device_prop.address, phost->device_prop.speed,
+                    EP_TYPE_CTRL, phost->Control.ep0size);
+}
+
+/**
+* @brief  USBH_HUB_CtlBusy
+*         The device is inside a control request and must keep the channels
+* @param  phost: host of the device
+* @retval 1 : busy
+*/
+static uint8_t USBH_HUB_CtlBusy(USBH_HOST *phost)
+{
+  return (phost->gState == HOST_CTRL_XFER) || (phost->RequestState == CMD_WAIT) || (phost->CtlHold);
+}
+
+/**
+* @brief  USBH_HUB_Take
+*         Take the control channels for the hub itself
+* @param  pdev: Selected device
+* @param  phost: host of the hub
+* @retval 1 : the hub owns the channels
+*/
+static uint8_t USBH_HUB_Take(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
+{
+  if(HUB_Machine.Owner == HUB_OWNER_SELF) return 1;
+  if(HUB_Machine.Owner != HUB_OWNER_FREE) return 0;
+
+  HUB_Machine.Owner = HUB_OWNER_SELF;
+  USBH_HUB_OpenCtl(pdev, phost->Control.hc_num_in, phost->Control.hc_num_out, phost);
+  return 1;
+}
+
+/**
+* @brief  USBH_HUB_Done
+*         End of a hub request: give the channels back, stop on errors
+* @param  status: result of the request
+* @param  next: next port state when the request succeeded
+* @retval None
+*/
+static void USBH_HUB_Done(USBH_Status status, HUB_PortState next)
+{
+  if(status == USBH_BUSY) return;
+
+  HUB_Machine.Owner = HUB_OWNER_FREE;
+  if(status == USBH_OK){
+    HUB_Machine.PortState = next;
+  }else{
+    HUB_xprintf(("<<:HUB: Port %d request Err %d\n",HUB_Machine.Port,status));
+    HUB_Machine.PortState = HUB_PORT_IDLE;
+  }
+  USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);
+}
+
+/**
+* @brief  USBH_HUB_DefaultAddr
+*         A device behind the hub still answers to the default address
+* @param  None
+* @retval 1 : another port must not be reset yet
+*/
+static uint8_t USBH_HUB_DefaultAddr(void)
+{
+  uint8_t i;
+  USBH_HOST *child;
+
+  for(i = 0; i < USBH_HUB_MAX_PORTS; i++){
+    child = &HUB_Machine.Ports[i].Host;
+    if(HUB_Machine.Ports[i].Attached && \
+       (child->device_prop.address == USBH_DEVICE_ADDRESS_DEFAULT) && \
+       ((child->gState == HOST_DEV_ATTACHED) || (child->gState == HOST_ENUMERATION))){
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+* @brief  USBH_HUB_Attach
+*         Start the enumeration of the device on HUB_Machine.Port
+* @param  pdev: Selected device
+* @param  phost: host of the hub
+* @retval None
+*/
+static void USBH_HUB_Attach(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
+{
+  HUB_Port_TypeDef *pPort = &HUB_Machine.Ports[HUB_Machine.Port - 1];
+  USBH_HOST *child = &pPort->Host;
+
+  if(HUB_Machine.PortStatus & HUB_PORT_LOW_SPEED){
+    HUB_xprintf(("<<:HUB: Port %d low speed device not supported\n",HUB_Machine.Port));
+    return;
+  }
+  child->HubPort    = HUB_Machine.Port;
+  USBH_DeInit(pdev, child);
+  child->Control.hc_num_in  = phost->Control.hc_num_in;
+  child->Control.hc_num_out = phost->Control.hc_num_out;
+  child->device_prop.speed  = HPRT0_PRTSPD_FULL_SPEED;
+  child->class_cb   = &USBH_HUB_DEVICE_CLASS;
+  child->class_default = &USBH_HUB_DEVICE_CLASS;//USBH_RegisterClass中无匹配接口时使用
+  child->usr_cb     = phost->usr_cb;
+  child->gState     = HOST_DEV_ATTACHED;
+  child->AttachTick = RTC_SysTickGetSum();
+  pPort->Attached   = 1;
+  HUB_xprintf(("<<:HUB: Port %d attached\n",HUB_Machine.Port));
+}
+
+/**
+* @brief  USBH_HUB_PortProcess
+*         Handle the status changes of one port after the other
+* @param  pdev: Selected device
+* @param  phost: host of the hub
+* @retval None
+*/
+static void USBH_HUB_PortProcess(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
+{
+  uint8_t  i;
+  uint8_t *buf = pdev->host.Rx_Buffer;
+  HUB_Port_TypeDef *pPort;
+
+  switch(HUB_Machine.PortState)
+  {
+  case HUB_PORT_IDLE:
+    for(i = 1; i <= HUB_Machine.NbrPorts; i++){
+      if(HUB_Machine.Change & (1UL << i)){
+        HUB_Machine.Change &= ~(1UL << i);
+        HUB_Machine.Port = i;
+        HUB_Machine.PortState = HUB_PORT_GET_STATUS;
+        break;
+      }
+    }
+    break;
+
+  case HUB_PORT_GET_STATUS://Tx[A3 00 00 00 PP 00 04 00 ]
+    if(USBH_HUB_Take(pdev, phost) == 0) break;
+    if(1){
+      USBH_Status status = USBH_HUB_Req(pdev, phost, HUB_REQ_TYPE_PORT_IN, USB_REQ_GET_STATUS,
+                                        0, HUB_Machine.Port, buf, 4);
+      if(status == USBH_OK){
+        HUB_Machine.PortStatus = LE16(buf);
+        HUB_Machine.PortChange = LE16(buf + 2);
+      }
+      USBH_HUB_Done(status, HUB_PORT_CLEAR);
+    }
+    break;
+
+  case HUB_PORT_CLEAR://Tx[23 01 FF 00 PP 00 00 00 ]   //逐个清除C_PORT_xxx
+    if(HUB_Machine.PortChange == 0){
+      HUB_Machine.PortState = HUB_PORT_EVAL;
+      break;
+    }
+    if(USBH_HUB_Take(pdev, phost) == 0) break;
+    for(i = 0; (HUB_Machine.PortChange & (1 << i)) == 0; i++);
+    if(1){
+      USBH_Status status = USBH_HUB_Req(pdev, phost, HUB_REQ_TYPE_PORT_OUT, USB_REQ_CLEAR_FEATURE,
+                                        HUB_FEAT_C_PORT_CONNECTION + i, HUB_Machine.Port, 0, 0);
+      if(status == USBH_OK){
+        HUB_Machine.PortChange &= ~(1 << i);
+      }
+      USBH_HUB_Done(status, HUB_PORT_CLEAR);
+    }
+    break;
+
+  case HUB_PORT_EVAL:
+    pPort = &HUB_Machine.Ports[HUB_Machine.Port - 1];
+    HUB_Machine.PortState = HUB_PORT_IDLE;
+    if((HUB_Machine.PortStatus & HUB_PORT_CONNECTION) == 0){
+      if(pPort->Attached){
+        HUB_xprintf(("<<:HUB: Port %d detached\n",HUB_Machine.Port));
+        pPort->Attached = 0;
+        pPort->Host.CtlHold = 0;
+        pPort->Host.gState = HOST_DEV_DISCONNECTED;
+        if(HUB_Machine.Owner == HUB_Machine.Port){
+          HUB_Machine.Owner = HUB_OWNER_FREE;
+        }
+      }
+    }else if(pPort->Attached == 0){
+      HUB_Machine.Tick = RTC_SysTickGetSum();
+      HUB_Machine.PortState = HUB_PORT_DEBOUNCE;
+    }
+    break;
+
+  case HUB_PORT_DEBOUNCE:
+    if((RTC_SysTickGetSum() - HUB_Machine.Tick) * SYSTICK_CYC >= HUB_DEBOUNCE_MS){
+      HUB_Machine.PortState = HUB_PORT_SET_RESET;
+    }
+    break;
+
+  case HUB_PORT_SET_RESET://Tx[23 03 04 00 PP 00 00 00 ]
+    if(USBH_HUB_DefaultAddr()) break;//复位后的设备也在地址0,等上一台SET_ADDRESS
+    if(USBH_HUB_Take(pdev, phost) == 0) break;
+    USBH_HUB_Done(USBH_HUB_Req(pdev, phost, HUB_REQ_TYPE_PORT_OUT, USB_REQ_SET_FEATURE,
+                               HUB_FEAT_PORT_RESET, HUB_Machine.Port, 0, 0), HUB_PORT_RESET_WAIT);
+    HUB_Machine.Tick = RTC_SysTickGetSum();
+    break;
+
+  case HUB_PORT_RESET_WAIT:
+    if((RTC_SysTickGetSum() - HUB_Machine.Tick) * SYSTICK_CYC >= HUB_RESET_POLL_MS){
+      HUB_Machine.PortState = HUB_PORT_RESET_STATUS;
+    }
+    break;
+
+  case HUB_PORT_RESET_STATUS:
+    if(USBH_HUB_Take(pdev, phost) == 0) break;
+    if(1){
+      USBH_Status status = USBH_HUB_Req(pdev, phost, HUB_REQ_TYPE_PORT_IN, USB_REQ_GET_STATUS,
+                                        0, HUB_Machine.Port, buf, 4);
+      HUB_PortState next = HUB_PORT_RESET_CLEAR;
+      if(status == USBH_OK){
+        HUB_Machine.PortStatus = LE16(buf);
+        HUB_Machine.PortChange = LE16(buf + 2);
+        HUB_Machine.Tick = RTC_SysTickGetSum();
+        if((HUB_Machine.PortStatus & HUB_PORT_CONNECTION) == 0){
+          next = HUB_PORT_IDLE;
+        }else if(HUB_Machine.PortStatus & HUB_PORT_RESET){
+          next = HUB_PORT_RESET_WAIT;//复位未结束
+        }
+      }
+      USBH_HUB_Done(status, next);
+    }
+    break;
+
+  case HUB_PORT_RESET_CLEAR://Tx[23 01 14 00 PP 00 00 00 ]
+    if((HUB_Machine.PortChange & HUB_C_PORT_RESET) == 0){
+      HUB_Machine.PortState = HUB_PORT_ATTACH;
+      break;
+    }
+    if(USBH_HUB_Take(pdev, phost) == 0) break;
+    if(1){
+      USBH_Status status = USBH_HUB_Req(pdev, phost, HUB_REQ_TYPE_PORT_OUT, USB_REQ_CLEAR_FEATURE,
+                                        HUB_FEAT_C_PORT_CONNECTION + 4, HUB_Machine.Port, 0, 0);
+      if(status == USBH_OK){
+        HUB_Machine.PortChange &= ~HUB_C_PORT_RESET;
+      }
+      USBH_HUB_Done(status, HUB_PORT_ATTACH);
+    }
+    break;
+
+  case HUB_PORT_ATTACH://复位后恢复时间TRSTRCY
+    if((RTC_SysTickGetSum() - HUB_Machine.Tick) * SYSTICK_CYC >= HUB_RESET_POLL_MS){
+      if(HUB_Machine.PortStatus & HUB_PORT_ENABLE){
+        USBH_HUB_Attach(pdev, phost);
+      }
+      HUB_Machine.PortState = HUB_PORT_IDLE;
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+* @brief  USBH_HUB_Schedule
+*         Run the state machines of the devices behind the hub, round robin.
+*         A device only runs while it owns the shared control channels.
+* @param  pdev: Selected device
+* @param  phost: host of the hub
+* @retval None
+*/
+static void USBH_HUB_Schedule(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
+{
+  uint8_t i, idx;
+  uint8_t first = HUB_Machine.Next;//本轮的起点,Next在循环中会改变
+  uint32_t sig;
+  USBH_HOST *child;
+
+  for(i = 0; i < HUB_Machine.NbrPorts; i++){
+    idx = (first + i) % HUB_Machine.NbrPorts;
+    child = &HUB_Machine.Ports[idx].Host;
+    if(child->gState == HOST_IDLE) continue;
+
+    if(HUB_Machine.Owner == HUB_OWNER_FREE){
+      HUB_Machine.Owner = idx + 1;
+      USBH_HUB_OpenCtl(pdev, phost->Control.hc_num_in, phost->Control.hc_num_out, child);
+    }else if(HUB_Machine.Owner != idx + 1){
+      continue;
+    }
+
+    sig = (uint32_t)child->gState | ((uint32_t)child->EnumState << 8) | \
+      ((uint32_t)child->RequestState << 16) | ((uint32_t)child->Control.state << 24);
+    USBH_Process(pdev, child);
+    if(sig != ((uint32_t)child->gState | ((uint32_t)child->EnumState << 8) | \
+      ((uint32_t)child->RequestState << 16) | ((uint32_t)child->Control.state << 24))){
+      USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);
+    }
+
+    if(USBH_HUB_CtlBusy(child) == 0){
+      HUB_Machine.Owner = HUB_OWNER_FREE;
+      HUB_Machine.Next  = idx + 1;
+    }
+  }
+}
+
+/**
+* @brief  USBH_HUB_InterfaceInit
+*         Read the hub descriptor, power the ports and open the status
+*         change pipe. Other devices are passed on to USBH_HUB_DEVICE_CLASS.
+* @param  pdev: Selected device
+* @param  phost: Selected host
+* @retval USBH_Status
+*/
+static USBH_Status USBH_HUB_InterfaceInit(USB_OTG_CORE_HANDLE *pdev,
+                                          void *phost)
+{
+  USBH_HOST *pphost = phost;
+  USBH_Status status = USBH_BUSY;
+  USBH_Status req;
+  uint8_t *buf = pdev->host.Rx_Buffer;
+  HUB_InitState step = HUB_Machine.InitState;
+
+  switch(HUB_Machine.InitState)
+  {
+  case HUB_INIT_DETECT:
+    memset(&HUB_Machine, 0, sizeof(HUB_Machine));
+    HUB_Machine.IsHub = (pphost->device_prop.Itf_Desc[0].bInterfaceClass == USB_HUB_CLASS);
+    if(HUB_Machine.IsHub == 0){
+      HUB_Machine.InitState = HUB_INIT_DONE;
+      return USBH_HUB_DEVICE_CLASS.Init(pdev, phost);//直接连接的设备
+    }
+    HUB_Machine.InitState = HUB_INIT_GET_DESC;
+    break;
+
+  case HUB_INIT_GET_DESC://Tx[A0 06 00 29 00 00 09 00 ]
+    req = USBH_HUB_Req(pdev, pphost, HUB_REQ_TYPE_DEV_IN, USB_REQ_GET_DESCRIPTOR,
+                       USB_DESC_TYPE_HUB << 8, 0, buf, USB_HUB_DESC_SIZE);
+    if(req == USBH_OK){
+      HUB_Machine.NbrPorts = buf[2];
+      HUB_Machine.PwrOn2PwrGood = buf[5];
+      HUB_xprintf(("<<:HUB: %d ports, PwrOn2PwrGood=%d ms\n",HUB_Machine.NbrPorts,HUB_Machine.PwrOn2PwrGood*2));
+      if(HUB_Machine.NbrPorts > USBH_HUB_MAX_PORTS){
+        HUB_Machine.NbrPorts = USBH_HUB_MAX_PORTS;
+      }
+      HUB_Machine.Port = 1;
+      HUB_Machine.InitState = HUB_INIT_POWER;
+    }else if(req != USBH_BUSY){
+      status = req;
+    }
+    break;
+
+  case HUB_INIT_POWER://Tx[23 03 08 00 PP 00 00 00 ]
+    req = USBH_HUB_Req(pdev, pphost, HUB_REQ_TYPE_PORT_OUT, USB_REQ_SET_FEATURE,
+                       HUB_FEAT_PORT_POWER, HUB_Machine.Port, 0, 0);
+    if(req == USBH_OK){
+      if(++HUB_Machine.Port > HUB_Machine.NbrPorts){
+        HUB_Machine.Tick = RTC_SysTickGetSum();
+        HUB_Machine.InitState = HUB_INIT_POWER_WAIT;
+      }
+    }else if(req != USBH_BUSY){
+      status = req;
+    }
+    break;
+
+  case HUB_INIT_POWER_WAIT:
+    if((RTC_SysTickGetSum() - HUB_Machine.Tick) * SYSTICK_CYC < HUB_Machine.PwrOn2PwrGood * 2){
+      break;
+    }
+    HUB_Machine.ep_addr = pphost->device_prop.Ep_Desc[0][0].bEndpointAddress;
+    HUB_Machine.length  = pphost->device_prop.Ep_Desc[0][0].wMaxPacketSize;
+    HUB_Machine.poll    = pphost->device_prop.Ep_Desc[0][0].bInterval;
+    if(HUB_Machine.length > sizeof(HUB_Machine.buff)){
+      HUB_Machine.length = sizeof(HUB_Machine.buff);
+    }
+    HUB_Machine.hc_num_in = USBH_Alloc_Channel(pdev, HUB_Machine.ep_addr);
+    USBH_Open_Channel(pdev,
+                      HUB_Machine.hc_num_in,
+                      pphost->device_prop.address,
+                      pphost->device_prop.speed,
+                      EP_TYPE_INTR,
+                      HUB_Machine.length);
+    HUB_Machine.Change = ((1UL << (HUB_Machine.NbrPorts + 1)) - 1) & ~1UL;//上电时各端口都查一遍
+    HUB_Machine.state = HUB_SYNC;
+    HUB_Machine.InitState = HUB_INIT_DONE;
+    status = USBH_OK;
+    break;
+
+  case HUB_INIT_DONE:
+  default:
+    if(HUB_Machine.IsHub == 0){
+      return USBH_HUB_DEVICE_CLASS.Init(pdev, phost);
+    }
+    status = USBH_OK;
+    break;
+  }
+  if(HUB_Machine.InitState != step){
+    USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);//状态已切换,立即执行下一步
+  }
+  return status;
+}
+
+/**
+* @brief  USBH_HUB_InterfaceDeInit
+*         Drop all devices behind the hub and free the status change pipe
+* @param  pdev: Selected device
+* @param  phost: Selected host
+* @retval None
+*/
+static void USBH_HUB_InterfaceDeInit(USB_OTG_CORE_HANDLE *pdev,
+                                     void *phost)
+{
+  uint8_t i;
+  USBH_HOST *child;
+
+  if(HUB_Machine.IsHub == 0){
+    HUB_Machine.InitState = HUB_INIT_DETECT;
+    USBH_HUB_DEVICE_CLASS.DeInit(pdev, phost);
+    return;
+  }
+  for(i = 0; i < USBH_HUB_MAX_PORTS; i++){
+    child = &HUB_Machine.Ports[i].Host;
+    if(child->gState != HOST_IDLE){
+      child->class_cb->DeInit(pdev, child);
+      USBH_DeInit(pdev, child);
+    }
+    HUB_Machine.Ports[i].Attached = 0;
+  }
+  if(HUB_Machine.hc_num_in != 0x00){
+    USB_OTG_HC_Halt(pdev, HUB_Machine.hc_num_in);
+    USBH_Free_Channel(pdev, HUB_Machine.hc_num_in);
+    HUB_Machine.hc_num_in = 0;
+  }
+  HUB_Machine.IsHub = 0;
+  HUB_Machine.InitState = HUB_INIT_DETECT;
+}
+
+/**
+* @brief  USBH_HUB_ClassRequest
+*         Nothing to do for the hub
+* @param  pdev: Selected device
+* @param  phost: Selected host
+* @retval USBH_Status
+*/
+static USBH_Status USBH_HUB_ClassRequest(USB_OTG_CORE_HANDLE *pdev,
+                                         void *phost)
+{
+  if(HUB_Machine.IsHub == 0){
+    return USBH_HUB_DEVICE_CLASS.Requests(pdev, phost);
+  }
+  return USBH_OK;
+}
+
+/**
+* @brief  USBH_HUB_Handle
+*         Poll the status change pipe, handle port changes and run the
+*         devices behind the hub
+* @param  pdev: Selected device
+* @param  phost: Selected host
+* @retval USBH_Status
+*/
+static USBH_Status USBH_HUB_Handle(USB_OTG_CORE_HANDLE *pdev,
+                                   void *phost)
+{
+  USBH_HOST *pphost = phost;
+  URB_STATE  urb;
+  uint8_t    i;
+  HUB_PortState step;
+
+  if(HUB_Machine.IsHub == 0){
+    return USBH_HUB_DEVICE_CLASS.Machine(pdev, phost);
+  }
+
+  switch(HUB_Machine.state)
+  {
+  case HUB_SYNC:
+    /* Sync with start of Even Frame */
+    if(USB_OTG_IsEvenFrame(pdev) == TRUE){
+      HUB_Machine.state = HUB_GET_DATA;
+    }
+    break;
+
+  case HUB_GET_DATA:
+    USBH_InterruptReceiveData(pdev,
+                              HUB_Machine.buff,
+                              HUB_Machine.length,
+                              HUB_Machine.hc_num_in);
+    HUB_Machine.start_toggle = 1;
+    HUB_Machine.state = HUB_POLL;
+    HUB_Machine.timer = HCD_GetCurrentFrame(pdev);
+    break;
+
+  case HUB_POLL:
+    urb = HCD_GetURB_State(pdev, HUB_Machine.hc_num_in);
+    if((HCD_GetCurrentFrame(pdev) - HUB_Machine.timer) >= HUB_Machine.poll){
+      HUB_Machine.state = HUB_GET_DATA;
+    }else if((urb == URB_DONE) && (HUB_Machine.start_toggle == 1)){
+      HUB_Machine.start_toggle = 0;
+      for(i = 0; i < HUB_Machine.length; i++){//bit0:集线器, bit n:端口n
+        HUB_Machine.Change |= (uint32_t)HUB_Machine.buff[i] << (i * 8);
+      }
+      HUB_Machine.Change &= ~1UL;//集线器自身的变化(过流等)不处理
+    }else if(urb == URB_STALL){
+      HUB_Machine.state = HUB_GET_DATA;
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  step = HUB_Machine.PortState;
+  USBH_HUB_PortProcess(pdev, pphost);
+  if(HUB_Machine.PortState != step){
+    USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);
+  }
+  USBH_HUB_Schedule(pdev, pphost);
+  return USBH_OK;
+}
+
+/**
+* @brief  USBH_HUB_ActiveDevices
+*         Number of devices enumerated or in progress behind the hub
+* @param  None
+* @retval count
+*/
+uint8_t USBH_HUB_ActiveDevices(void)
+{
+  uint8_t i, n = 0;
+
+  for(i = 0; i < USBH_HUB_MAX_PORTS; i++){
+    if(HUB_Machine.Ports[i].Attached) n++;
+  }
+  return n;
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -141,6 +141,10 @@ typedef union _USBH_CSW_Block
 #define USBH_MSC_CSW_LENGTH               13  
 #define USBH_MSC_CSW_MAX_LENGTH           63     
 
+/* Data stage: one URB of up to this many max size packets, the FIFO is
+   refilled per packet by the host channel interrupt (HCTSIZ pktcnt limit) */
+#define USBH_MSC_BOT_MAX_PACKETS          256
+
 /* CSW Status Definitions */
 #define USBH_MSC_CSW_CMD_PASSED           0x00
 #define USBH_MSC_CSW_CMD_FAILED           0x01
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    usbh_msc_cache.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_msc_cache.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_MSC_CACHE_H
+#define __USBH_MSC_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_MSC_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_MSC_CACHE
+  * @brief This file is the header file for usbh_msc_cache.c
+  * @{
+  */
+
+/** @defgroup USBH_MSC_CACHE_Exported_Defines
+  * @{
+  */
+#ifndef USBH_MSC_CACHE_NUM
+#define USBH_MSC_CACHE_NUM          8           //缓存的扇区数,0:不使用缓存
+#endif
+#ifndef USBH_MSC_CACHE_PIN_NUM
+#define USBH_MSC_CACHE_PIN_NUM      (USBH_MSC_CACHE_NUM / 2)//FAT区扇区最多占用的项数
+#endif
+#define USBH_MSC_SECTOR_SIZE        512
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_CACHE_Exported_Types
+  * @{
+  */
+typedef struct
+{
+  uint32_t  Sector;
+  uint32_t  Stamp;        //最近一次访问的序号,最小者被替换
+  uint8_t   Valid;
+  uint8_t   Dirty;        //已改写,尚未写回U盘
+  uint8_t   Pinned;       //FAT区扇区,只替换其它FAT区扇区
+}
+MSC_CACHE_ENTRY_ST;
+
+typedef struct
+{
+  uint32_t  Read;         //disk_read次数
+  uint32_t  Write;        //disk_write次数
+  uint32_t  Hit;          //单扇区访问命中
+  uint32_t  Miss;
+  uint32_t  Direct;       //多扇区访问,不经过缓存
+  uint32_t  WriteBack;    //替换或同步时写回的脏扇区
+  uint32_t  BotRead;      //READ10命令数
+  uint32_t  BotWrite;     //WRITE10命令数
+  uint32_t  Lost;         //拔出时未能写回的脏扇区
+  uint32_t  RaHit;        //由预读缓冲提供的扇区
+  uint32_t  Merged;       //合并到其它WRITE10的扇区
+}
+MSC_CACHE_STATS_ST;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_CACHE_Exported_FunctionsPrototype
+  * @{
+  */
+DRESULT USBH_MSC_Cache_Read(BYTE *buff, DWORD sector, BYTE count);
+DRESULT USBH_MSC_Cache_Write(const BYTE *buff, DWORD sector, BYTE count);
+DRESULT USBH_MSC_Cache_Flush(void);
+void    USBH_MSC_Cache_Invalidate(void);
+MSC_CACHE_STATS_ST *USBH_MSC_Cache_GetStats(void);
+void    USBH_MSC_Cache_ClearStats(void);
+/**
+  * @}
+  */
+
+#endif /* __USBH_MSC_CACHE_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -108,6 +108,7 @@ MSC_Machine_TypeDef;
 extern USBH_Class_cb_TypeDef  USBH_MSC_cb;
 extern MSC_Machine_TypeDef    MSC_Machine;
 extern uint8_t MSCErrorCount;
+extern USBH_HOST *USBH_MSC_Host;
 
 /**
   * @}
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file    usbh_msc_fatfs.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-16
+  * @brief   This file contains all the prototypes for the usbh_msc_fatfs.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_MSC_FATFS_H
+#define __USBH_MSC_FATFS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+#include "diskio.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_MSC_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_MSC_FATFS
+  * @brief This file is the header file for usbh_msc_fatfs.c
+  * @{
+  */
+
+/** @defgroup USBH_MSC_FATFS_Exported_Defines
+  * @{
+  */
+#ifndef USBH_MSC_READ_AHEAD
+#define USBH_MSC_READ_AHEAD         8           //连续读时预读的扇区数,0:不预读
+#endif
+#ifndef USBH_MSC_WRITE_MERGE
+#define USBH_MSC_WRITE_MERGE        8           //合并成一次WRITE10的扇区数,0:不合并
+#endif
+#ifndef USBH_MSC_IO_QUEUE_NUM
+#define USBH_MSC_IO_QUEUE_NUM       3           //其它任务可同时排队的磁盘请求数,每个占用一个信号量
+#endif
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_FATFS_Exported_Variables
+  * @{
+  */
+extern const DISKIO_DRV USBH_MSC_Disk;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_FATFS_Exported_FunctionsPrototype
+  * @{
+  */
+/* access of the stick below the cache, read-ahead and write coalescing */
+DRESULT USBH_MSC_DiskRead(BYTE *buff, DWORD sector, BYTE count);
+DRESULT USBH_MSC_DiskWrite(const BYTE *buff, DWORD sector, BYTE count);
+DRESULT USBH_MSC_DiskFlush(void);
+void    USBH_MSC_DiskDrop(void);
+void    USBH_MSC_SetReadAhead(BYTE window);
+
+/* disk requests of other tasks, served by the USB host task */
+void    USBH_MSC_IO_Init(void);
+void    USBH_MSC_IO_Process(void);
+uint8_t USBH_MSC_IO_IsServer(void);
+/**
+  * @}
+  */
+
+#endif /* __USBH_MSC_FATFS_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
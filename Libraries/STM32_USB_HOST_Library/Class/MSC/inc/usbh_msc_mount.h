@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file    usbh_msc_mount.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_msc_mount.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_MSC_MOUNT_H
+#define __USBH_MSC_MOUNT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+#include "ff.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_MSC_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_MSC_MOUNT
+  * @brief This file is the header file for usbh_msc_mount.c
+  * @{
+  */
+
+/** @defgroup USBH_MSC_MOUNT_Exported_Defines
+  * @{
+  */
+#ifndef USBH_MSC_MOUNT_NUM
+#define USBH_MSC_MOUNT_NUM          2           //缓存的U盘数,0:不使用
+#endif
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_MOUNT_Exported_Types
+  * @{
+  */
+typedef struct
+{
+  uint8_t   Valid;
+  uint8_t   Age;          //0:最近使用
+  uint16_t  idVendor;     //与序列号一起作为键值
+  uint16_t  idProduct;
+  uint16_t  bcdDevice;
+  uint8_t   Serial[USBH_SERIAL_STR_LEN];
+  uint32_t  MSCapacity;   //READ_CAPACITY10的结果
+  uint16_t  MSPageLength;
+#if _USE_MNTCACHE
+  MNTCACHE  Vol;          //FatFs卷信息,由chk_mounted填写
+#endif
+}
+MSC_MOUNT_ENTRY_ST;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_MSC_MOUNT_Exported_FunctionsPrototype
+  * @{
+  */
+uint8_t   USBH_MSC_Mount_Lookup(USBH_HOST *phost);
+void      USBH_MSC_Mount_Store(USBH_HOST *phost);
+#if _USE_MNTCACHE
+MNTCACHE *USBH_MSC_Mount_Vol(void);
+#endif
+/**
+  * @}
+  */
+
+#endif /* __USBH_MSC_MOUNT_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -153,6 +153,7 @@ void USBH_MSC_Init(USB_OTG_CORE_HANDLE *pdev )
 void USBH_MSC_HandleBOTXfer (USB_OTG_CORE_HANDLE *pdev ,USBH_HOST *phost)
 {
   uint8_t xferDirection, index;
+  uint32_t xferLength;
   static uint32_t remainingDataLength;
   static uint8_t *datapointer , *datapointer_prev;
   static uint8_t error_direction;
@@ -233,29 +234,27 @@ void USBH_MSC_HandleBOTXfer (USB_OTG_CORE_HANDLE *pdev ,USBH_HOST *phost)
         BOTStallErrorCount = 0;
         USBH_MSC_BOTXferParam.BOTStateBkp = USBH_MSC_BOT_DATAIN_STATE;    
         
-        if(remainingDataLength > MSC_Machine.MSBulkInEpSize)
-        {
-          USBH_BulkReceiveData (pdev,
-	                        datapointer, 
-			        MSC_Machine.MSBulkInEpSize , 
-			        MSC_Machine.hc_num_in);
-          
-          remainingDataLength -= MSC_Machine.MSBulkInEpSize;
-          datapointer = datapointer + MSC_Machine.MSBulkInEpSize;
-        }
-        else if ( remainingDataLength == 0)
+        if ( remainingDataLength == 0)
         {
           /* If value was 0, and successful transfer, then change the state */
           USBH_MSC_BOTXferParam.BOTState = USBH_MSC_RECEIVE_CSW_STATE;
         }
         else
         {       
+          /* the whole data stage in one multi-packet URB, split only at the
+             packet count limit of the channel */
+          xferLength = MSC_Machine.MSBulkInEpSize * USBH_MSC_BOT_MAX_PACKETS;
+          if(xferLength > remainingDataLength)
+          {
+            xferLength = remainingDataLength;
+          }
           USBH_BulkReceiveData (pdev,
 	                        datapointer, 
-			        remainingDataLength , 
+			        xferLength , 
 			        MSC_Machine.hc_num_in);
           
-          remainingDataLength = 0; /* Reset this value and keep in same state */
+          remainingDataLength -= xferLength;
+          datapointer = datapointer + xferLength;
         }
       }
       else if(URB_Status == URB_STALL)
@@ -288,49 +287,38 @@ void USBH_MSC_HandleBOTXfer (USB_OTG_CORE_HANDLE *pdev ,USBH_HOST *phost)
       {
         BOTStallErrorCount = 0;
         USBH_MSC_BOTXferParam.BOTStateBkp = USBH_MSC_BOT_DATAOUT_STATE;    
-        if(remainingDataLength > MSC_Machine.MSBulkOutEpSize)
-        {
-          USBH_BulkSendData (pdev,
-                             datapointer, 
-                             MSC_Machine.MSBulkOutEpSize , 
-                             MSC_Machine.hc_num_out);
-          datapointer_prev = datapointer;
-          datapointer = datapointer + MSC_Machine.MSBulkOutEpSize;
-          
-          remainingDataLength = remainingDataLength - MSC_Machine.MSBulkOutEpSize;
-        }
-        else if ( remainingDataLength == 0)
+        if ( remainingDataLength == 0)
         {
           /* If value was 0, and successful transfer, then change the state */
           USBH_MSC_BOTXferParam.BOTState = USBH_MSC_RECEIVE_CSW_STATE;
         }
         else
         {
+          xferLength = MSC_Machine.MSBulkOutEpSize * USBH_MSC_BOT_MAX_PACKETS;
+          if(xferLength > remainingDataLength)
+          {
+            xferLength = remainingDataLength;
+          }
           USBH_BulkSendData (pdev,
-	                     datapointer, 
-			     remainingDataLength , 
-			     MSC_Machine.hc_num_out);
+                             datapointer, 
+                             xferLength , 
+                             MSC_Machine.hc_num_out);
+          datapointer_prev = datapointer;
+          datapointer = datapointer + xferLength;
           
-          remainingDataLength = 0; /* Reset this value and keep in same state */   
+          remainingDataLength = remainingDataLength - xferLength;
         }      
       }
       
       else if(URB_Status == URB_NOTREADY)
       {
-        if(datapointer != datapointer_prev)
-        {
-          USBH_BulkSendData (pdev,
-                             (datapointer - MSC_Machine.MSBulkOutEpSize), 
-                             MSC_Machine.MSBulkOutEpSize , 
-                             MSC_Machine.hc_num_out);
-        }
-        else
-        {
-          USBH_BulkSendData (pdev,
-                             datapointer,
-                             MSC_Machine.MSBulkOutEpSize , 
-                             MSC_Machine.hc_num_out);
-        }
+        /* NAK in the middle of the URB: the packets acknowledged before it
+           are kept, send the rest of [datapointer_prev, datapointer) again */
+        datapointer_prev += HCD_GetXferCnt(pdev, MSC_Machine.hc_num_out);
+        USBH_BulkSendData (pdev,
+                           datapointer_prev,
+                           datapointer - datapointer_prev , 
+                           MSC_Machine.hc_num_out);
       }
       
       else if(URB_Status == URB_STALL)
@@ -456,6 +444,13 @@ USBH_Status USBH_MSC_BOT_Abort(USB_OTG_CORE_HANDLE *pdev,
   
   status = USBH_BUSY;
   
+  /* disk_read/disk_write直接调用BOT状态机, 不经过USBH_Process,
+     ClrFeature的控制传输须在这里推进 */
+  if (phost->gState == HOST_CTRL_XFER)
+  {
+    USBH_HandleControl(pdev, phost);
+  }
+  
   switch (direction)
   {
   case USBH_MSC_DIR_IN :
@@ -479,7 +474,10 @@ USBH_Status USBH_MSC_BOT_Abort(USB_OTG_CORE_HANDLE *pdev,
     break;
   }
   
-  BOTStallErrorCount++; /* Check Continous Number of times, STALL has Occured */ 
+  if (status != USBH_BUSY)
+  {
+    BOTStallErrorCount++; /* Check Continous Number of times, STALL has Occured */ 
+  }
   if (BOTStallErrorCount > MAX_BULK_STALL_COUNT_LIMIT )
   {
     status = USBH_UNRECOVERED_ERROR;
@@ -0,0 +1,396 @@
+/**
+  ******************************************************************************
+  * @file    usbh_msc_cache.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Write-back sector cache between FatFs and USBH_MSC_Read10/Write10.
+  *
+  * @verbatim
+  *          Every single sector access of ff.c (FAT, directory and partial
+  *          data sectors through move_window) is a complete BOT command
+  *          (CBW, data, CSW). These sectors are kept in USBH_MSC_CACHE_NUM
+  *          entries, the least recently used one is replaced. Writes stay in
+  *          the cache until the entry is replaced or FatFs syncs (f_sync,
+  *          f_close -> CTRL_SYNC).
+  *          The FAT region is taken from the boot sector when FatFs reads it
+  *          at mount time. Up to USBH_MSC_CACHE_PIN_NUM entries hold FAT
+  *          sectors and are only replaced by other FAT sectors, so streaming
+  *          a file does not push the FAT out of the cache.
+  *          Multi sector accesses (whole clusters of f_read/f_write) go to
+  *          the stick directly, cached copies of those sectors are written
+  *          back first (read) or updated (write).
+  *          When the stick is removed the cache is dropped, dirty sectors not
+  *          synced by FatFs are lost and counted.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_msc_cache.h"
+#include "string.h"
+#include "xprintf.h"
+#include 	"include_slef.H"
+
+#if PRINTF_USBH_MSC
+	#define MSC_cache_xprintf( X)    do {xprintf X ;} while(0)
+#else
+	#define MSC_cache_xprintf( X)
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_MSC_CLASS
+* @{
+*/
+
+/** @defgroup USBH_MSC_CACHE
+* @brief    This file includes the sector cache of the MSC FatFs glue.
+* @{
+*/
+
+/** @defgroup USBH_MSC_CACHE_Private_Variables
+* @{
+*/
+static MSC_CACHE_STATS_ST  MSC_CacheStats;
+#if USBH_MSC_CACHE_NUM
+static MSC_CACHE_ENTRY_ST  MSC_Cache[USBH_MSC_CACHE_NUM];
+static uint8_t             MSC_CacheBuf[USBH_MSC_CACHE_NUM][USBH_MSC_SECTOR_SIZE];
+static uint32_t            MSC_CacheClock;
+static uint32_t            MSC_FatStart;   //FAT区,所有FAT副本
+static uint32_t            MSC_FatEnd;     //0:尚未读到引导扇区
+#endif
+/**
+* @}
+*/
+
+/** @defgroup USBH_MSC_CACHE_Private_Functions
+* @{
+*/
+
+/**
+* @brief  MSC_Cache_RawRead
+*         Read of the stick, below the cache
+* @retval DRESULT
+*/
+static DRESULT MSC_Cache_RawRead(BYTE *buff, DWORD sector, BYTE count)
+{
+  return USBH_MSC_DiskRead(buff, sector, count);
+}
+
+/**
+* @brief  MSC_Cache_RawWrite
+*         Write of the stick, below the cache
+* @retval DRESULT
+*/
+static DRESULT MSC_Cache_RawWrite(const BYTE *buff, DWORD sector, BYTE count)
+{
+  return USBH_MSC_DiskWrite(buff, sector, count);
+}
+
+#if USBH_MSC_CACHE_NUM
+/**
+* @brief  MSC_Cache_CheckBoot
+*         Take the FAT region from a FAT boot sector
+* @param  buff: sector data
+* @param  sector: sector number of buff
+* @retval None
+*/
+static void MSC_Cache_CheckBoot(const BYTE *buff, DWORD sector)
+{
+  uint32_t rsvd, fatSize;
+
+  if((buff[510] != 0x55) || (buff[511] != 0xAA)) return;
+  if((buff[0] != 0xEB) && (buff[0] != 0xE9)) return;        //MBR没有跳转指令
+  if((buff[11] | (buff[12] << 8)) != USBH_MSC_SECTOR_SIZE) return;
+  if((buff[16] == 0) || (buff[16] > 2)) return;             //BPB_NumFATs
+
+  rsvd    = buff[14] | (buff[15] << 8);
+  fatSize = buff[22] | (buff[23] << 8);                     //BPB_FATSz16
+  if(fatSize == 0){
+    fatSize = buff[36] | (buff[37] << 8) | ((uint32_t)buff[38] << 16) | ((uint32_t)buff[39] << 24);
+  }
+  MSC_FatStart = sector + rsvd;
+  MSC_FatEnd   = MSC_FatStart + fatSize * buff[16];
+  MSC_cache_xprintf(("<<:MSC: FAT sectors %x..%x pinned\n",MSC_FatStart,MSC_FatEnd - 1));
+}
+
+/**
+* @brief  MSC_Cache_Find
+*         Entry holding a sector
+* @retval entry index, USBH_MSC_CACHE_NUM if not cached
+*/
+static uint8_t MSC_Cache_Find(DWORD sector)
+{
+  uint8_t i;
+
+  for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+    if(MSC_Cache[i].Valid && (MSC_Cache[i].Sector == sector)) break;
+  }
+  return i;
+}
+
+/**
+* @brief  MSC_Cache_Victim
+*         Entry to be replaced by a sector: a free one, else the least
+*         recently used one of the same kind (FAT / other)
+* @param  pin: 1 if the new sector belongs to the FAT region
+* @retval entry index
+*/
+static uint8_t MSC_Cache_Victim(uint8_t pin)
+{
+  uint8_t i, pinned = 0, lru = USBH_MSC_CACHE_NUM, lruPin = USBH_MSC_CACHE_NUM;
+
+  for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+    if(MSC_Cache[i].Valid == 0) return i;
+    if(MSC_Cache[i].Pinned){
+      pinned++;
+      if((lruPin == USBH_MSC_CACHE_NUM) || (MSC_Cache[i].Stamp < MSC_Cache[lruPin].Stamp)) lruPin = i;
+    }
+    else if((lru == USBH_MSC_CACHE_NUM) || (MSC_Cache[i].Stamp < MSC_Cache[lru].Stamp)){
+      lru = i;
+    }
+  }
+  if(pin && (pinned >= USBH_MSC_CACHE_PIN_NUM) && (lruPin != USBH_MSC_CACHE_NUM)) return lruPin;
+  if(lru != USBH_MSC_CACHE_NUM) return lru;
+  return lruPin;
+}
+
+/**
+* @brief  MSC_Cache_Clean
+*         Write a dirty entry back to the stick
+* @retval DRESULT
+*/
+static DRESULT MSC_Cache_Clean(uint8_t i)
+{
+  DRESULT res;
+
+  if(MSC_Cache[i].Dirty == 0) return RES_OK;
+  res = MSC_Cache_RawWrite(MSC_CacheBuf[i], MSC_Cache[i].Sector, 1);
+  if(res == RES_OK){
+    MSC_Cache[i].Dirty = 0;
+    MSC_CacheStats.WriteBack++;
+  }
+  return res;
+}
+
+/**
+* @brief  MSC_Cache_Load
+*         Get an entry for a sector, read from the stick if needed
+* @param  sector: sector number
+* @param  read: 0 when the whole sector is overwritten anyway
+* @param  pIdx: returns the entry index
+* @retval DRESULT
+*/
+static DRESULT MSC_Cache_Load(DWORD sector, uint8_t read, uint8_t *pIdx)
+{
+  uint8_t i, pin;
+  DRESULT res;
+
+  i = MSC_Cache_Find(sector);
+  if(i < USBH_MSC_CACHE_NUM){
+    MSC_CacheStats.Hit++;
+  }
+  else{
+    MSC_CacheStats.Miss++;
+    pin = (sector >= MSC_FatStart) && (sector < MSC_FatEnd);
+    i = MSC_Cache_Victim(pin);
+    res = MSC_Cache_Clean(i);
+    if(res != RES_OK) return res;
+    MSC_Cache[i].Valid = 0;
+    if(read){
+      res = MSC_Cache_RawRead(MSC_CacheBuf[i], sector, 1);
+      if(res != RES_OK) return res;
+      MSC_Cache_CheckBoot(MSC_CacheBuf[i], sector);
+    }
+    MSC_Cache[i].Sector = sector;
+    MSC_Cache[i].Valid  = 1;
+    MSC_Cache[i].Dirty  = 0;
+    MSC_Cache[i].Pinned = pin;
+  }
+  MSC_Cache[i].Stamp = ++MSC_CacheClock;
+  *pIdx = i;
+  return RES_OK;
+}
+#endif /* USBH_MSC_CACHE_NUM */
+
+/**
+* @brief  USBH_MSC_Cache_Read
+*         disk_read through the cache
+* @param  buff: data buffer
+* @param  sector: start sector
+* @param  count: sector count (1..255)
+* @retval DRESULT
+*/
+DRESULT USBH_MSC_Cache_Read(BYTE *buff, DWORD sector, BYTE count)
+{
+#if USBH_MSC_CACHE_NUM
+  uint8_t i;
+  DRESULT res;
+
+  MSC_CacheStats.Read++;
+  if(count == 1){
+    res = MSC_Cache_Load(sector, 1, &i);
+    if(res == RES_OK){
+      memcpy(buff, MSC_CacheBuf[i], USBH_MSC_SECTOR_SIZE);
+    }
+    return res;
+  }
+
+  /* the stick must have the newest data of the range */
+  MSC_CacheStats.Direct++;
+  for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+    if(MSC_Cache[i].Valid && (MSC_Cache[i].Sector >= sector) && (MSC_Cache[i].Sector - sector < count)){
+      res = MSC_Cache_Clean(i);
+      if(res != RES_OK) return res;
+    }
+  }
+#else
+  MSC_CacheStats.Read++;
+  MSC_CacheStats.Direct++;
+#endif
+  return MSC_Cache_RawRead(buff, sector, count);
+}
+
+/**
+* @brief  USBH_MSC_Cache_Write
+*         disk_write through the cache
+* @param  buff: data buffer
+* @param  sector: start sector
+* @param  count: sector count (1..255)
+* @retval DRESULT
+*/
+DRESULT USBH_MSC_Cache_Write(const BYTE *buff, DWORD sector, BYTE count)
+{
+#if USBH_MSC_CACHE_NUM
+  uint8_t i;
+  DRESULT res;
+
+  MSC_CacheStats.Write++;
+  if(count == 1){
+    res = MSC_Cache_Load(sector, 0, &i);
+    if(res == RES_OK){
+      memcpy(MSC_CacheBuf[i], buff, USBH_MSC_SECTOR_SIZE);
+      MSC_Cache[i].Dirty = 1;
+    }
+    return res;
+  }
+
+  MSC_CacheStats.Direct++;
+  res = MSC_Cache_RawWrite(buff, sector, count);
+  if(res != RES_OK) return res;
+  /* keep the cached copies of the range up to date */
+  for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+    if(MSC_Cache[i].Valid && (MSC_Cache[i].Sector >= sector) && (MSC_Cache[i].Sector - sector < count)){
+      memcpy(MSC_CacheBuf[i], buff + (MSC_Cache[i].Sector - sector) * USBH_MSC_SECTOR_SIZE, USBH_MSC_SECTOR_SIZE);
+      MSC_Cache[i].Dirty = 0;
+    }
+  }
+  return RES_OK;
+#else
+  MSC_CacheStats.Write++;
+  MSC_CacheStats.Direct++;
+  return MSC_Cache_RawWrite(buff, sector, count);
+#endif
+}
+
+/**
+* @brief  USBH_MSC_Cache_Flush
+*         Write all dirty sectors back, in ascending order (CTRL_SYNC)
+* @param  None
+* @retval DRESULT
+*/
+DRESULT USBH_MSC_Cache_Flush(void)
+{
+#if USBH_MSC_CACHE_NUM
+  uint8_t i, next;
+  DRESULT res;
+
+  while(1){
+    next = USBH_MSC_CACHE_NUM;
+    for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+      if(MSC_Cache[i].Valid && MSC_Cache[i].Dirty &&
+         ((next == USBH_MSC_CACHE_NUM) || (MSC_Cache[i].Sector < MSC_Cache[next].Sector))){
+        next = i;
+      }
+    }
+    if(next == USBH_MSC_CACHE_NUM) break;
+    res = MSC_Cache_Clean(next);
+    if(res != RES_OK) return res;
+  }
+#endif
+  return RES_OK;
+}
+
+/**
+* @brief  USBH_MSC_Cache_Invalidate
+*         Drop the cache, the stick has been removed
+* @param  None
+* @retval None
+*/
+void USBH_MSC_Cache_Invalidate(void)
+{
+#if USBH_MSC_CACHE_NUM
+  uint8_t i, lost = 0;
+
+  for(i = 0; i < USBH_MSC_CACHE_NUM; i++){
+    if(MSC_Cache[i].Valid && MSC_Cache[i].Dirty) lost++;
+    MSC_Cache[i].Valid = 0;
+    MSC_Cache[i].Dirty = 0;
+  }
+  MSC_FatStart = 0;
+  MSC_FatEnd   = 0;
+  if(lost){
+    MSC_CacheStats.Lost += lost;
+    MSC_cache_xprintf(("<<:MSC: %d dirty sectors lost\n",lost));
+  }
+#endif
+}
+
+/**
+* @brief  USBH_MSC_Cache_GetStats
+*         Counters of the cache since the last USBH_MSC_Cache_ClearStats
+* @param  None
+* @retval counters
+*/
+MSC_CACHE_STATS_ST *USBH_MSC_Cache_GetStats(void)
+{
+  return &MSC_CacheStats;
+}
+
+/**
+* @brief  USBH_MSC_Cache_ClearStats
+*         Clear the counters
+* @param  None
+* @retval None
+*/
+void USBH_MSC_Cache_ClearStats(void)
+{
+  memset(&MSC_CacheStats, 0, sizeof(MSC_CacheStats));
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
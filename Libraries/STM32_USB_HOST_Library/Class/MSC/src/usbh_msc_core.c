@@ -42,6 +42,8 @@
 #include "usbh_msc_core.h"
 #include "usbh_msc_scsi.h"
 #include "usbh_msc_bot.h"
+#include "usbh_msc_cache.h"
+#include "usbh_msc_mount.h"
 #include "usbh_core.h"
 
 
@@ -103,6 +105,7 @@ __ALIGN_BEGIN MSC_Machine_TypeDef         MSC_Machine __ALIGN_END ;
 #endif /* USB_OTG_HS_INTERNAL_DMA_ENABLED */
 __ALIGN_BEGIN USB_Setup_TypeDef           MSC_Setup __ALIGN_END ;
 uint8_t MSCErrorCount = 0;
+USBH_HOST *USBH_MSC_Host = 0;  /* host of the stick, MSC_Machine serves one device */
 
 
 /**
@@ -176,6 +179,12 @@ static USBH_Status USBH_MSC_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
   if((pphost->device_prop.Itf_Desc[0].bInterfaceClass == MSC_CLASS) && \
      (pphost->device_prop.Itf_Desc[0].bInterfaceProtocol == MSC_PROTOCOL))
   {
+    if((USBH_MSC_Host != 0) && (USBH_MSC_Host != pphost))
+    {
+      return USBH_BUSY; /* another stick is in use, wait until it is removed */
+    }
+    USBH_MSC_Host = pphost;
+    
     if(pphost->device_prop.Ep_Desc[0][0].bEndpointAddress & 0x80)
     {
       MSC_Machine.MSBulkInEp = (pphost->device_prop.Ep_Desc[0][0].bEndpointAddress);
@@ -240,6 +249,14 @@ static USBH_Status USBH_MSC_InterfaceInit ( USB_OTG_CORE_HANDLE *pdev,
 void USBH_MSC_InterfaceDeInit ( USB_OTG_CORE_HANDLE *pdev,
                                 void *phost)
 {	
+  if(USBH_MSC_Host != phost)
+  {
+    return;
+  }
+  USBH_MSC_Host = 0;
+  USBH_MSC_Cache_Invalidate();    /* 扇区缓存属于已拔出的U盘 */
+  USBH_MSC_DiskDrop();
+  
   if ( MSC_Machine.hc_num_out)
   {
     USB_OTG_HC_Halt(pdev, MSC_Machine.hc_num_out);
@@ -292,6 +309,8 @@ static USBH_Status USBH_MSC_Handle(USB_OTG_CORE_HANDLE *pdev ,
   uint8_t appliStatus = 0;
   
   static uint8_t maxLunExceed = FALSE;
+  uint8_t mscState = USBH_MSC_BOTXferParam.MSCState;
+  uint8_t botState = USBH_MSC_BOTXferParam.BOTState;
   
     
   if(HCD_IsDeviceConnected(pdev))
@@ -374,7 +393,10 @@ static USBH_Status USBH_MSC_Handle(USB_OTG_CORE_HANDLE *pdev ,
       
       if(mscStatus == USBH_MSC_OK )
       {
-        USBH_MSC_BOTXferParam.MSCState = USBH_MSC_READ_CAPACITY10;
+        /* A stick seen before: capacity from the mount cache, the write
+           protection is read again by MODE_SENSE6 */
+        USBH_MSC_BOTXferParam.MSCState = USBH_MSC_Mount_Lookup(pphost) ?
+          USBH_MSC_MODE_SENSE6 : USBH_MSC_READ_CAPACITY10;
         MSCErrorCount = 0;
         status = USBH_OK;
       }
@@ -404,6 +426,7 @@ static USBH_Status USBH_MSC_Handle(USB_OTG_CORE_HANDLE *pdev ,
       mscStatus = USBH_MSC_ModeSense6(pdev);
       if(mscStatus == USBH_MSC_OK )
       {
+        USBH_MSC_Mount_Store(pphost);
         USBH_MSC_BOTXferParam.MSCState = USBH_MSC_DEFAULT_APPLI_STATE;
         MSCErrorCount = 0;
         status = USBH_OK;
@@ -457,6 +480,13 @@ static USBH_Status USBH_MSC_Handle(USB_OTG_CORE_HANDLE *pdev ,
       break; 
       
     }
+    
+    /* State moved on without a transfer to wait for: run again at once */
+    if((mscState != USBH_MSC_BOTXferParam.MSCState) || 
+       (botState != USBH_MSC_BOTXferParam.BOTState))
+    {
+      USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);
+    }
   }
    return status;
 }
@@ -1,7 +1,13 @@
 
 #include "usb_conf.h"
+#include "ff.h"
 #include "diskio.h"
 #include "usbh_msc_core.h"
+#include "usbh_msc_cache.h"
+#include "usbh_msc_fatfs.h"
+#include "usb_bsp.h"
+#include "string.h"
+#include "ucos_ii.h"
 /*--------------------------------------------------------------------------
 
 Module Private Functions and Variables
@@ -11,21 +17,88 @@ Module Private Functions and Variables
 static volatile DSTATUS Stat = STA_NOINIT;	/* Disk status */
 
 extern USB_OTG_CORE_HANDLE          USB_OTG_Core;
-extern USBH_HOST                     USB_Host;
+
+/* The stick may sit on the root port or behind the hub: the disk is ready
+   once its host (USBH_MSC_Host) finished the MSC init sequence. */
+#define MSC_DISK_READY()  ((USBH_MSC_Host != 0) && HCD_IsDeviceConnected(&USB_OTG_Core) && \
+                           (USBH_MSC_BOTXferParam.MSCState == USBH_MSC_DEFAULT_APPLI_STATE))
+
+static DRESULT MSC_DiskRead10 (BYTE *buff, DWORD sector, BYTE count);
+static DRESULT MSC_DiskWrite10 (const BYTE *buff, DWORD sector, BYTE count);
+
+/* Read-ahead: a read that continues the previous one fetches the rest of
+   the window (aligned to RA_Window sectors, like the clusters of sticks
+   formatted with an aligned data area) in one READ10. */
+#if USBH_MSC_READ_AHEAD
+static BYTE  RA_Buf[USBH_MSC_READ_AHEAD][512];
+static DWORD RA_Start;                      /* first sector in RA_Buf */
+static BYTE  RA_Count;                      /* 0: empty */
+static BYTE  RA_Window = USBH_MSC_READ_AHEAD;
+#endif
+static DWORD RA_Next;                       /* sector after the last read */
+
+/* Write coalescing: contiguous writes are collected and sent as one
+   WRITE10 when a write does not continue them, the buffer is full, an
+   overlapping read comes or FatFs syncs. */
+#if USBH_MSC_WRITE_MERGE
+static BYTE  WM_Buf[USBH_MSC_WRITE_MERGE][512];
+static DWORD WM_Start;
+static BYTE  WM_Count;                      /* 0: empty */
+#endif
+
+/* sectors [s,s+n) and [t,t+m) overlap */
+#define MSC_OVERLAP(s, n, t, m)   (((s) < (t) + (m)) && ((t) < (s) + (n)))
+
+/* Disk requests: the USB host task owns USB_OTG_Core, the cache and the
+   BOT state machine. Its own requests (MSC application, DFU file) run in
+   place, other tasks queue them and sleep until the USB task has served
+   them in USBH_MSC_IO_Process. */
+#define MSC_IO_READ     0
+#define MSC_IO_WRITE    1
+#define MSC_IO_SYNC     2
+
+typedef struct
+{
+  OS_EVENT  *Done;          /* completion semaphore of the slot */
+  BYTE      *Buf;
+  DWORD      Sector;
+  BYTE       Count;
+  BYTE       Op;            /* MSC_IO_xxx */
+  BYTE       Busy;          /* slot used by a caller */
+  DRESULT    Res;
+}
+MSC_IO_REQ_ST;
+
+static MSC_IO_REQ_ST MSC_IO_Req[USBH_MSC_IO_QUEUE_NUM];
+static BYTE  MSC_IO_Fifo[USBH_MSC_IO_QUEUE_NUM];    /* slots in order of arrival */
+static BYTE  MSC_IO_Head, MSC_IO_Num;
+static INT8U MSC_IO_Prio = OS_PRIO_SELF;            /* USB host task, OS_PRIO_SELF: not started */
+static uint32_t MSC_IO_Evt;                         /* events taken while waiting for the BOT */
+
+/* BOT progress: unchanged after a step means the URB is still on the bus */
+#define MSC_BOT_STATE()   ((uint32_t)USBH_MSC_BOTXferParam.BOTState | \
+                           ((uint32_t)USBH_MSC_BOTXferParam.CmdStateMachine << 8) | \
+                           ((uint32_t)USBH_MSC_BOTXferParam.MSCState << 16))
+
+static void    MSC_BOT_Wait (BYTE status, uint32_t state);
+static DRESULT MSC_IO_Submit (BYTE op, BYTE *buff, DWORD sector, BYTE count);
+static BOOL    MSC_IO_GrantHook (void);
 
 /*-----------------------------------------------------------------------*/
 /* Initialize Disk Drive                                                 */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS disk_initialize (
-                         BYTE drv		/* Physical drive number (0) */
-                           )
+static DSTATUS MSC_disk_initialize (void)
 {
   
-  if(HCD_IsDeviceConnected(&USB_OTG_Core))
+  if(MSC_DISK_READY())
   {  
     Stat &= ~STA_NOINIT;
   }
+  else
+  {
+    Stat |= STA_NOINIT;
+  }
   
   return Stat;
   
@@ -38,45 +111,43 @@ DSTATUS disk_initialize (
 /* Get Disk Status                                                       */
 /*-----------------------------------------------------------------------*/
 
-DSTATUS disk_status (
-                     BYTE drv		/* Physical drive number (0) */
-                       )
+static DSTATUS MSC_disk_status (void)
 {
-  if (drv) return STA_NOINIT;		/* Supports only single drive */
   return Stat;
 }
 
 
 
 /*-----------------------------------------------------------------------*/
-/* Read Sector(s)                                                        */
+/* Read Sector(s) of the stick, one READ10                               */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
-                   BYTE drv,			/* Physical drive number (0) */
+static DRESULT MSC_DiskRead10 (
                    BYTE *buff,			/* Pointer to the data buffer to store read data */
                    DWORD sector,		/* Start sector number (LBA) */
                    BYTE count			/* Sector count (1..255) */
                      )
 {
   BYTE status = USBH_MSC_OK;
+  uint32_t state;
   
-  if (drv || !count) return RES_PARERR;
-  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  if (USBH_MSC_Host == 0) return RES_NOTRDY;
   
   
   if(HCD_IsDeviceConnected(&USB_OTG_Core))
   {  
-    
+    USBH_MSC_Cache_GetStats()->BotRead++;
     do
     {
+      state = MSC_BOT_STATE();
       status = USBH_MSC_Read10(&USB_OTG_Core, buff,sector,512 * count);
-      USBH_MSC_HandleBOTXfer(&USB_OTG_Core ,&USB_Host);
+      USBH_MSC_HandleBOTXfer(&USB_OTG_Core ,USBH_MSC_Host);
       
       if(!HCD_IsDeviceConnected(&USB_OTG_Core))
       { 
         return RES_ERROR;
       }      
+      MSC_BOT_Wait(status, state);
     }
     while(status == USBH_MSC_BUSY );
   }
@@ -89,35 +160,74 @@ DRESULT disk_read (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT MSC_disk_read (
+                   BYTE *buff,			/* Pointer to the data buffer to store read data */
+                   DWORD sector,		/* Start sector number (LBA) */
+                   BYTE count			/* Sector count (1..255) */
+                     )
+{
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  if (USBH_MSC_Host == 0) return RES_NOTRDY;
+  
+  return MSC_IO_Submit(MSC_IO_READ, buff, sector, count);
+}
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Write Sector(s)                                                       */
 /*-----------------------------------------------------------------------*/
 
 #if _READONLY == 0
-DRESULT disk_write (
-                    BYTE drv,			/* Physical drive number (0) */
+static DRESULT MSC_disk_write (
                     const BYTE *buff,	/* Pointer to the data to be written */
                     DWORD sector,		/* Start sector number (LBA) */
                     BYTE count			/* Sector count (1..255) */
                       )
 {
-  BYTE status = USBH_MSC_OK;
-  if (drv || !count) return RES_PARERR;
   if (Stat & STA_NOINIT) return RES_NOTRDY;
   if (Stat & STA_PROTECT) return RES_WRPRT;
+  if (USBH_MSC_Host == 0) return RES_NOTRDY;
+  
+  return MSC_IO_Submit(MSC_IO_WRITE, (BYTE *)buff, sector, count);
+}
+#endif /* _READONLY == 0 */
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s) of the stick, one WRITE10                             */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT MSC_DiskWrite10 (
+                    const BYTE *buff,	/* Pointer to the data to be written */
+                    DWORD sector,		/* Start sector number (LBA) */
+                    BYTE count			/* Sector count (1..255) */
+                      )
+{
+  BYTE status = USBH_MSC_OK;
+  uint32_t state;
+  if (USBH_MSC_Host == 0) return RES_NOTRDY;
   
   
   if(HCD_IsDeviceConnected(&USB_OTG_Core))
   {  
+    USBH_MSC_Cache_GetStats()->BotWrite++;
     do
     {
+      state = MSC_BOT_STATE();
       status = USBH_MSC_Write10(&USB_OTG_Core,(BYTE*)buff,sector,512 * count);
-      USBH_MSC_HandleBOTXfer(&USB_OTG_Core, &USB_Host);
+      USBH_MSC_HandleBOTXfer(&USB_OTG_Core, USBH_MSC_Host);
       
       if(!HCD_IsDeviceConnected(&USB_OTG_Core))
       { 
         return RES_ERROR;
       }
+      MSC_BOT_Wait(status, state);
     }
     
     while(status == USBH_MSC_BUSY );
@@ -128,7 +238,402 @@ DRESULT disk_write (
     return RES_OK;
   return RES_ERROR;
 }
-#endif /* _READONLY == 0 */
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Send the collected writes                                             */
+/*-----------------------------------------------------------------------*/
+
+DRESULT USBH_MSC_DiskFlush (void)
+{
+#if USBH_MSC_WRITE_MERGE
+  DRESULT res;
+  
+  if (WM_Count == 0) return RES_OK;
+  res = MSC_DiskWrite10(WM_Buf[0], WM_Start, WM_Count);
+  if (res == RES_OK) WM_Count = 0;
+  return res;
+#else
+  return RES_OK;
+#endif
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Forget buffered sectors, the stick has been removed                   */
+/*-----------------------------------------------------------------------*/
+
+void USBH_MSC_DiskDrop (void)
+{
+#if USBH_MSC_READ_AHEAD
+  RA_Count = 0;
+#endif
+#if USBH_MSC_WRITE_MERGE
+  USBH_MSC_Cache_GetStats()->Lost += WM_Count;
+  WM_Count = 0;
+#endif
+  RA_Next = 0;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Read-ahead window in sectors (0,1: off), up to USBH_MSC_READ_AHEAD    */
+/*-----------------------------------------------------------------------*/
+
+void USBH_MSC_SetReadAhead (BYTE window)
+{
+#if USBH_MSC_READ_AHEAD
+  if (window > USBH_MSC_READ_AHEAD) window = USBH_MSC_READ_AHEAD;
+  RA_Window = window;
+  RA_Count = 0;
+#endif
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s) of the stick with read-ahead (usbh_msc_cache.c)        */
+/*-----------------------------------------------------------------------*/
+
+DRESULT USBH_MSC_DiskRead (
+                   BYTE *buff,			/* Pointer to the data buffer to store read data */
+                   DWORD sector,		/* Start sector number (LBA) */
+                   BYTE count			/* Sector count (1..255) */
+                     )
+{
+  DRESULT res;
+#if USBH_MSC_READ_AHEAD
+  DWORD len;
+  BYTE seq = (sector == RA_Next);
+#endif
+  
+#if USBH_MSC_WRITE_MERGE
+  if (WM_Count && MSC_OVERLAP(sector, count, WM_Start, WM_Count))
+  {
+    res = USBH_MSC_DiskFlush();
+    if (res != RES_OK) return res;
+  }
+#endif
+  RA_Next = sector + count;
+  
+#if USBH_MSC_READ_AHEAD
+  if (RA_Count && (sector >= RA_Start) && (sector + count <= RA_Start + RA_Count))
+  {
+    memcpy(buff, RA_Buf[sector - RA_Start], 512 * count);
+    USBH_MSC_Cache_GetStats()->RaHit += count;
+    return RES_OK;
+  }
+  if (seq && (RA_Window > 1) && (count < RA_Window))
+  {
+    len = RA_Window - (sector % RA_Window);
+    if (len < count) len = count;
+    if (sector + len > USBH_MSC_Param.MSCapacity)   /* not beyond the last sector */
+      len = (USBH_MSC_Param.MSCapacity > sector + count) ? (USBH_MSC_Param.MSCapacity - sector) : count;
+#if USBH_MSC_WRITE_MERGE
+    if (WM_Count && MSC_OVERLAP(sector, len, WM_Start, WM_Count))
+    {
+      res = USBH_MSC_DiskFlush();
+      if (res != RES_OK) return res;
+    }
+#endif
+    RA_Count = 0;
+    res = MSC_DiskRead10(RA_Buf[0], sector, (BYTE)len);
+    if (res != RES_OK) return res;
+    RA_Start = sector;
+    RA_Count = (BYTE)len;
+    memcpy(buff, RA_Buf[0], 512 * count);
+    return RES_OK;
+  }
+#endif
+  return MSC_DiskRead10(buff, sector, count);
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s) of the stick, coalesced (usbh_msc_cache.c)            */
+/*-----------------------------------------------------------------------*/
+
+DRESULT USBH_MSC_DiskWrite (
+                    const BYTE *buff,	/* Pointer to the data to be written */
+                    DWORD sector,		/* Start sector number (LBA) */
+                    BYTE count			/* Sector count (1..255) */
+                      )
+{
+  DRESULT res;
+#if USBH_MSC_READ_AHEAD
+  DWORD i;
+  
+  /* keep the read-ahead copies up to date */
+  if (RA_Count && MSC_OVERLAP(sector, count, RA_Start, RA_Count))
+  {
+    for (i = sector; i < sector + count; i++)
+    {
+      if ((i >= RA_Start) && (i < RA_Start + RA_Count))
+        memcpy(RA_Buf[i - RA_Start], buff + (i - sector) * 512, 512);
+    }
+  }
+#endif
+  
+#if USBH_MSC_WRITE_MERGE
+  if (WM_Count)
+  {
+    if ((sector >= WM_Start) && (sector + count <= WM_Start + WM_Count))
+    {                                           /* rewrite of collected sectors */
+      memcpy(WM_Buf[sector - WM_Start], buff, 512 * count);
+      USBH_MSC_Cache_GetStats()->Merged += count;
+      return RES_OK;
+    }
+    if ((sector == WM_Start + WM_Count) && (WM_Count + count <= USBH_MSC_WRITE_MERGE))
+    {                                           /* continues the collected sectors */
+      memcpy(WM_Buf[WM_Count], buff, 512 * count);
+      WM_Count += count;
+      USBH_MSC_Cache_GetStats()->Merged += count;
+      return RES_OK;
+    }
+    res = USBH_MSC_DiskFlush();
+    if (res != RES_OK) return res;
+  }
+  if (count < USBH_MSC_WRITE_MERGE)
+  {
+    memcpy(WM_Buf[0], buff, 512 * count);
+    WM_Start = sector;
+    WM_Count = count;
+    return RES_OK;
+  }
+#endif
+  res = MSC_DiskWrite10(buff, sector, count);
+  return res;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Sleep until the URB of the BOT step completes instead of spinning     */
+/*-----------------------------------------------------------------------*/
+
+static void MSC_BOT_Wait (
+                   BYTE status,			/* Result of the BOT step */
+                   uint32_t state		/* MSC_BOT_STATE() before the step */
+                     )
+{
+  if ((status == USBH_MSC_BUSY) && (state == MSC_BOT_STATE()) && (MSC_IO_Prio != OS_PRIO_SELF))
+  {
+    /* 其它事件(插拔,定时)留给USBH_Process,请求完成后重新投递 */
+    MSC_IO_Evt |= USB_OTG_BSP_EventWait(1);
+  }
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Execute one disk request in the USB host task                         */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT MSC_IO_Exec (
+                   BYTE op,			/* MSC_IO_xxx */
+                   BYTE *buff,			/* Data buffer */
+                   DWORD sector,		/* Start sector number (LBA) */
+                   BYTE count			/* Sector count (1..255) */
+                     )
+{
+  DRESULT res;
+  
+  switch (op) {
+  case MSC_IO_READ :
+    res = USBH_MSC_Cache_Read(buff, sector, count);
+    break;
+    
+  case MSC_IO_WRITE :
+    res = USBH_MSC_Cache_Write(buff, sector, count);
+    break;
+    
+  case MSC_IO_SYNC :
+    res = USBH_MSC_Cache_Flush();
+    if (res == RES_OK) res = USBH_MSC_DiskFlush();
+    break;
+    
+  default:
+    res = RES_PARERR;
+  }
+  return res;
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Give back the host events collected by MSC_BOT_Wait                   */
+/*-----------------------------------------------------------------------*/
+
+static void MSC_IO_RepostEvt (void)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  uint32_t evt;
+  
+  OS_ENTER_CRITICAL();
+  evt = MSC_IO_Evt;
+  MSC_IO_Evt = 0;
+  OS_EXIT_CRITICAL();
+  if (evt) USB_OTG_BSP_EventPost(evt);
+}
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Hand a disk request to the USB host task and wait for the result      */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT MSC_IO_Submit (
+                   BYTE op,			/* MSC_IO_xxx */
+                   BYTE *buff,			/* Data buffer */
+                   DWORD sector,		/* Start sector number (LBA) */
+                   BYTE count			/* Sector count (1..255) */
+                     )
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  MSC_IO_REQ_ST *req;
+  DRESULT res;
+  INT8U err;
+  BYTE i;
+  
+  if ((MSC_IO_Prio == OS_PRIO_SELF) || (OSTCBCur->OSTCBPrio == MSC_IO_Prio))
+  {                                             /* USB任务自身的请求,直接执行 */
+    res = MSC_IO_Exec(op, buff, sector, count);
+    MSC_IO_RepostEvt();
+    return res;
+  }
+  
+  for (;;)                                      /* 申请一个空闲的请求 */
+  {
+    OS_ENTER_CRITICAL();
+    for (i = 0; i < USBH_MSC_IO_QUEUE_NUM; i++)
+    {
+      if (!MSC_IO_Req[i].Busy)
+      {
+        MSC_IO_Req[i].Busy = 1;
+        break;
+      }
+    }
+    OS_EXIT_CRITICAL();
+    if (i < USBH_MSC_IO_QUEUE_NUM) break;
+    OSTimeDly(1);
+  }
+  
+  req = &MSC_IO_Req[i];
+  req->Op = op;
+  req->Buf = buff;
+  req->Sector = sector;
+  req->Count = count;
+  req->Res = RES_ERROR;
+  
+  OS_ENTER_CRITICAL();
+  MSC_IO_Fifo[(MSC_IO_Head + MSC_IO_Num) % USBH_MSC_IO_QUEUE_NUM] = i;
+  MSC_IO_Num++;
+  OS_EXIT_CRITICAL();
+  
+  USB_OTG_BSP_EventPost(USB_OTG_EVT_CLASS);
+  OSSemPend(req->Done, 0, &err);
+  
+  res = req->Res;
+  req->Busy = 0;
+  return res;
+}
+
+
+
+/**
+  * @brief  USBH_MSC_IO_Init
+  *         Create the request queue, called by the USB host task which
+  *         then serves the disk requests of the other tasks
+  * @param  None
+  * @retval None
+  */
+void USBH_MSC_IO_Init(void)
+{
+  BYTE i;
+  
+  for (i = 0; i < USBH_MSC_IO_QUEUE_NUM; i++)
+  {
+    if (MSC_IO_Req[i].Done == (OS_EVENT *)0)
+    {
+      MSC_IO_Req[i].Done = OSSemCreate(0);
+    }
+    MSC_IO_Req[i].Busy = 0;
+  }
+  MSC_IO_Head = 0;
+  MSC_IO_Num = 0;
+  MSC_IO_Evt = 0;
+  MSC_IO_Prio = OSTCBCur->OSTCBPrio;
+  ff_grant_hook = MSC_IO_GrantHook;
+}
+
+/**
+  * @brief  USBH_MSC_IO_Process
+  *         Serve the queued disk requests, in order of arrival
+  * @param  None
+  * @retval None
+  */
+void USBH_MSC_IO_Process(void)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  MSC_IO_REQ_ST *req;
+  
+  for (;;)
+  {
+    OS_ENTER_CRITICAL();
+    if (MSC_IO_Num == 0)
+    {
+      OS_EXIT_CRITICAL();
+      break;
+    }
+    req = &MSC_IO_Req[MSC_IO_Fifo[MSC_IO_Head]];
+    MSC_IO_Head = (MSC_IO_Head + 1) % USBH_MSC_IO_QUEUE_NUM;
+    MSC_IO_Num--;
+    OS_EXIT_CRITICAL();
+    
+    req->Res = MSC_IO_Exec(req->Op, req->Buf, req->Sector, req->Count);
+    OSSemPost(req->Done);
+  }
+  MSC_IO_RepostEvt();
+}
+
+/**
+  * @brief  USBH_MSC_IO_IsServer
+  *         Check whether the calling task serves the disk requests
+  * @param  None
+  * @retval 1: USB host task
+  */
+uint8_t USBH_MSC_IO_IsServer(void)
+{
+  return (MSC_IO_Prio != OS_PRIO_SELF) && (OSTCBCur->OSTCBPrio == MSC_IO_Prio);
+}
+
+/**
+  * @brief  MSC_IO_GrantHook
+  *         ff_grant_hook of FatFs: the owner of the volume may be waiting
+  *         for the USB task, which serves its disk requests while it waits
+  *         for the grant
+  * @param  None
+  * @retval TRUE: called by the USB host task
+  */
+static BOOL MSC_IO_GrantHook (void)
+{
+  if (!USBH_MSC_IO_IsServer())
+  {
+    return FALSE;
+  }
+  USBH_MSC_IO_Process();
+  return TRUE;
+}
 
 
 
@@ -137,24 +642,19 @@ DRESULT disk_write (
 /*-----------------------------------------------------------------------*/
 
 #if _USE_IOCTL != 0
-DRESULT disk_ioctl (
-                    BYTE drv,		/* Physical drive number (0) */
+static DRESULT MSC_disk_ioctl (
                     BYTE ctrl,		/* Control code */
                     void *buff		/* Buffer to send/receive control data */
                       )
 {
-  DRESULT res = RES_OK;
-  
-  if (drv) return RES_PARERR;
-  
-  res = RES_ERROR;
+  DRESULT res = RES_ERROR;
   
   if (Stat & STA_NOINIT) return RES_NOTRDY;
   
   switch (ctrl) {
   case CTRL_SYNC :		/* Make sure that no pending write process */
     
-    res = RES_OK;
+    res = MSC_IO_Submit(MSC_IO_SYNC, 0, 0, 0);
     break;
     
   case GET_SECTOR_COUNT :	/* Get number of sectors on the disk (DWORD) */
@@ -184,3 +684,19 @@ DRESULT disk_ioctl (
   return res;
 }
 #endif /* _USE_IOCTL != 0 */
+
+
+
+/* Backend of the USB stick, attached to drive 0 (diskio.c) */
+const DISKIO_DRV USBH_MSC_Disk =
+{
+  MSC_disk_initialize,
+  MSC_disk_status,
+  MSC_disk_read,
+#if _READONLY == 0
+  MSC_disk_write,
+#endif
+#if _USE_IOCTL != 0
+  MSC_disk_ioctl,
+#endif
+};
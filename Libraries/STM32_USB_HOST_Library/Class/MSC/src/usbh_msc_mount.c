@@ -0,0 +1,227 @@
+/**
+  ******************************************************************************
+  * @file    usbh_msc_mount.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Mount cache of the sticks seen before, for a fast re-plug.
+  *
+  * @verbatim
+  *          A stick is recognised by its VID/PID, bcdDevice and serial
+  *          number string. For a known stick READ_CAPACITY10 is not sent
+  *          again. TEST_UNIT_READY still is, as it waits for the medium,
+  *          and so is MODE_SENSE6, as the write protect switch may have
+  *          moved since the last plug. The entry also holds the MNTCACHE of
+  *          the volume (FATFS.mnt): FatFs checks the boot record against the
+  *          last mount and takes the free cluster map of the last sync when
+  *          the FSInfo shows no other writer. The FAT geometry is not kept,
+  *          the partition table, boot record and FSInfo are read on every
+  *          mount.
+  *          Sticks without a serial number are not cached, a stick found
+  *          write protected is dropped from the cache. A stick whose volume
+  *          was found changed is initialised in full on the next plug.
+  *          The least recently used entry is replaced.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_msc_mount.h"
+#include "usbh_msc_scsi.h"
+#include "string.h"
+#include "xprintf.h"
+#include 	"include_slef.H"
+
+#if PRINTF_USBH_MSC
+	#define MSC_mount_xprintf( X)    do {xprintf X ;} while(0)
+#else
+	#define MSC_mount_xprintf( X)
+#endif
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_MSC_CLASS
+* @{
+*/
+
+/** @defgroup USBH_MSC_MOUNT
+* @brief    This file includes the mount cache of the sticks.
+* @{
+*/
+
+/** @defgroup USBH_MSC_MOUNT_Private_Variables
+* @{
+*/
+#if USBH_MSC_MOUNT_NUM
+static MSC_MOUNT_ENTRY_ST  MSC_Mount[USBH_MSC_MOUNT_NUM];
+static MSC_MOUNT_ENTRY_ST *MSC_MountCur;   //当前U盘的项,0:不缓存
+#endif
+/**
+* @}
+*/
+
+/** @defgroup USBH_MSC_MOUNT_Private_Functions
+* @{
+*/
+#if USBH_MSC_MOUNT_NUM
+/**
+* @brief  MSC_Mount_Match
+*         Entry of the stick on phost
+* @param  phost: Selected host
+* @retval entry, 0 if none or if the stick is not cached
+*/
+static MSC_MOUNT_ENTRY_ST *MSC_Mount_Match(USBH_HOST *phost)
+{
+  uint8_t i;
+  USBH_DevDesc_TypeDef *pDesc = &phost->device_prop.Dev_Desc;
+
+  if(phost->SerialNum[0] == 0) return 0;//没有序列号,无法区分同型号的U盘
+  for(i = 0; i < USBH_MSC_MOUNT_NUM; i++){
+    if((MSC_Mount[i].Valid)
+        && (MSC_Mount[i].idVendor == pDesc->idVendor)
+        && (MSC_Mount[i].idProduct == pDesc->idProduct)
+        && (MSC_Mount[i].bcdDevice == pDesc->bcdDevice)
+        && (strcmp((char *)MSC_Mount[i].Serial, (char *)phost->SerialNum) == 0)){
+      return &MSC_Mount[i];
+    }
+  }
+  return 0;
+}
+
+/**
+* @brief  MSC_Mount_Touch
+*         Make an entry the most recently used one
+* @param  pEntry: entry
+* @retval None
+*/
+static void MSC_Mount_Touch(MSC_MOUNT_ENTRY_ST *pEntry)
+{
+  uint8_t i;
+
+  for(i = 0; i < USBH_MSC_MOUNT_NUM; i++){
+    if(MSC_Mount[i].Age < pEntry->Age) MSC_Mount[i].Age++;
+  }
+  pEntry->Age = 0;
+}
+#endif
+
+/**
+* @brief  USBH_MSC_Mount_Lookup
+*         Look for the stick after TEST_UNIT_READY. On a hit the capacity
+*         is restored to USBH_MSC_Param, MODE_SENSE6 still follows.
+* @param  phost: Selected host
+* @retval 1: hit, READ_CAPACITY10 may be skipped, 0: miss
+*/
+uint8_t USBH_MSC_Mount_Lookup(USBH_HOST *phost)
+{
+#if USBH_MSC_MOUNT_NUM
+  MSC_MOUNT_ENTRY_ST *pEntry = MSC_Mount_Match(phost);
+
+  MSC_MountCur = 0;
+  if(pEntry == 0) return 0;
+#if _USE_MNTCACHE
+  if((pEntry->Vol.fs_type == 0) || (pEntry->Vol.fs_type == 0xFF)){
+    return 0;//上次未挂载成功或卷已改变,重新读取
+  }
+#endif
+  USBH_MSC_Param.MSCapacity     = pEntry->MSCapacity;
+  USBH_MSC_Param.MSPageLength   = pEntry->MSPageLength;
+  MSC_Mount_Touch(pEntry);
+  MSC_MountCur = pEntry;
+  MSC_mount_xprintf(("\n\r MSC: %s from mount cache", phost->SerialNum));
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/**
+* @brief  USBH_MSC_Mount_Store
+*         Keep the stick after MODE_SENSE6. On a hit of USBH_MSC_Mount_Lookup
+*         the entry and its volume are kept, after a full init the volume
+*         part is filled by FatFs on the next mount. A write protected stick
+*         is dropped.
+* @param  phost: Selected host
+* @retval None
+*/
+void USBH_MSC_Mount_Store(USBH_HOST *phost)
+{
+#if USBH_MSC_MOUNT_NUM
+  uint8_t i;
+  MSC_MOUNT_ENTRY_ST *pEntry = MSC_Mount_Match(phost);
+
+  if(USBH_MSC_Param.MSWriteProtect == DISK_WRITE_PROTECTED){
+    if(pEntry) pEntry->Valid = 0;//开关可能被拨动,写保护的U盘每次都完整检查
+    MSC_MountCur = 0;
+    return;
+  }
+  if((pEntry != 0) && (pEntry == MSC_MountCur)){
+    return;//命中,保留上次的卷信息
+  }
+  MSC_MountCur = 0;
+  if(phost->SerialNum[0] == 0){
+    return;
+  }
+  if(pEntry == 0){//空闲项优先,否则取最久未用的一项
+    for(i = 0; i < USBH_MSC_MOUNT_NUM; i++){
+      if((pEntry == 0) || (MSC_Mount[i].Valid == 0)
+          || ((pEntry->Valid) && (MSC_Mount[i].Age > pEntry->Age))){
+        pEntry = &MSC_Mount[i];
+      }
+    }
+  }
+  memset(pEntry, 0, sizeof(*pEntry));
+  pEntry->idVendor     = phost->device_prop.Dev_Desc.idVendor;
+  pEntry->idProduct    = phost->device_prop.Dev_Desc.idProduct;
+  pEntry->bcdDevice    = phost->device_prop.Dev_Desc.bcdDevice;
+  memcpy(pEntry->Serial, phost->SerialNum, sizeof(pEntry->Serial));
+  pEntry->MSCapacity   = USBH_MSC_Param.MSCapacity;
+  pEntry->MSPageLength = USBH_MSC_Param.MSPageLength;
+  pEntry->Age          = USBH_MSC_MOUNT_NUM;
+  pEntry->Valid        = 1;
+  MSC_Mount_Touch(pEntry);
+  MSC_MountCur = pEntry;
+#endif
+}
+
+#if _USE_MNTCACHE
+/**
+* @brief  USBH_MSC_Mount_Vol
+*         Volume part of the current stick, for FATFS.mnt after f_mount
+* @param  None
+* @retval MNTCACHE, 0 if the stick is not cached
+*/
+MNTCACHE *USBH_MSC_Mount_Vol(void)
+{
+#if USBH_MSC_MOUNT_NUM
+  return MSC_MountCur ? &MSC_MountCur->Vol : 0;
+#else
+  return 0;
+#endif
+}
+#endif
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -77,6 +77,11 @@
 
 
 #define USBH_MAX_ERROR_COUNT                            2
+#ifndef USBH_MAX_CLASS_NUM
+#define USBH_MAX_CLASS_NUM                              4   /* entries of USBH_RegisterClass */
+#endif
+#define USBH_CLASS_ANY                                  0xFF/* match any interface subclass */
+#define USBH_SERIAL_STR_LEN                             32  /* SerialNum keeps the first 31 chars */
 #define USBH_DEVICE_ADDRESS_DEFAULT                     0
 #define USBH_DEVICE_ADDRESS                             1
 
@@ -253,8 +258,18 @@ typedef struct _Host_TypeDef
   USBH_Device_TypeDef   device_prop; 
   
   USBH_Class_cb_TypeDef               *class_cb;  
+  USBH_Class_cb_TypeDef               *class_default; /* from USBH_Init, for unregistered interfaces */
   USBH_Usr_cb_TypeDef  	              *usr_cb;
 
+  uint8_t               HubPort;      /* 0: root port, else port of the hub, see usbh_hub.c */
+  uint8_t               CtlHold;      /* class keeps the shared control channels between stages */
+  uint8_t               AttachWait;   /* attach debounce running, USBH_FAST_ENUM */
+  uint8_t               SerialRead;   /* serial number read before the config, USBH_FAST_ENUM */
+  uint8_t               CacheHit;     /* descriptors taken from usbh_desc_cache.c */
+  uint8_t               SerialNum[USBH_SERIAL_STR_LEN]; /* serial number string, "" if none */
+  uint32_t              AttachTick;   /* RTC_SysTickGetSum() when the device was seen */
+  uint32_t              EnumTime;     /* attach to class init in ms */
+  uint32_t              PollState;    /* states seen by the last USBH_PollTimeout */
   
 } USBH_HOST, *pUSBH_HOST;
 
@@ -295,6 +310,13 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev ,
                   USBH_HOST *phost);
 void USBH_ErrorHandle(USBH_HOST *phost, 
                       USBH_Status errType);
+USBH_Status USBH_HandleControl (USB_OTG_CORE_HANDLE *pdev, 
+                                USBH_HOST *phost);
+uint32_t USBH_PollTimeout(USB_OTG_CORE_HANDLE *pdev, 
+                          USBH_HOST *phost);
+USBH_Status USBH_RegisterClass(uint8_t itfClass, 
+                               uint8_t itfSubClass, 
+                               USBH_Class_cb_TypeDef *class_cb);
 
 /**
   * @}
@@ -0,0 +1,92 @@
+/**
+  ******************************************************************************
+  * @file    usbh_desc_cache.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the usbh_desc_cache.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive  ----------------------------------------------*/
+#ifndef __USBH_DESC_CACHE_H
+#define __USBH_DESC_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_LIB_CORE
+* @{
+*/
+
+/** @defgroup USBH_DESC_CACHE
+  * @brief This file is the header file for usbh_desc_cache.c
+  * @{
+  */
+
+/** @defgroup USBH_DESC_CACHE_Exported_Defines
+  * @{
+  */
+#ifndef USBH_DESC_CACHE_NUM
+#define USBH_DESC_CACHE_NUM         4           //缓存的设备数
+#endif
+#define USBH_DESC_CACHE_STR_LEN     32          //字符串描述符只保存前31个字符
+
+#define USBH_DESC_STR_MFC           0
+#define USBH_DESC_STR_PRODUCT       1
+#define USBH_DESC_STR_SERIAL        2
+#define USBH_DESC_STR_NUM           3
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DESC_CACHE_Exported_Types
+  * @{
+  */
+typedef struct
+{
+  uint8_t                     Valid;
+  uint8_t                     Age;          //0:最近使用
+  USBH_HOST                  *Owner;        //正在填写该项的设备
+  USBH_DevDesc_TypeDef        Dev_Desc;     //与序列号一起作为键值
+  USBH_CfgDesc_TypeDef        Cfg_Desc;
+  USBH_InterfaceDesc_TypeDef  Itf_Desc[USBH_MAX_NUM_INTERFACES];
+  USBH_EpDesc_TypeDef         Ep_Desc[USBH_MAX_NUM_INTERFACES][USBH_MAX_NUM_ENDPOINTS];
+  USBH_HIDDesc_TypeDef        HID_Desc;
+  USBH_DFUDesc_TypeDef        DFU_Desc;
+  USBH_RELDesc_TypeDef        RELIGION_Desc;
+  uint8_t                     Str[USBH_DESC_STR_NUM][USBH_DESC_CACHE_STR_LEN];
+}
+USBH_DescCache_TypeDef;
+/**
+  * @}
+  */
+
+/** @defgroup USBH_DESC_CACHE_Exported_FunctionsPrototype
+  * @{
+  */
+USBH_DescCache_TypeDef *USBH_DescCache_Lookup   (USBH_HOST *phost, const uint8_t *serial);
+void                    USBH_DescCache_SetString(USBH_HOST *phost, uint8_t which, const uint8_t *str);
+void                    USBH_DescCache_Store    (USBH_HOST *phost);
+void                    USBH_DescCache_Release  (USBH_HOST *phost);
+/**
+  * @}
+  */
+
+#endif /* __USBH_DESC_CACHE_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -33,6 +33,8 @@
 #include "usbh_stdreq.h"
 #include "usbh_core.h"
 #include "usb_hcd_int.h"
+#include "usbh_desc_cache.h"
+#include "string.h"
 
 #include "xprintf.h"
 #define printf_usbh_core xprintf 
@@ -57,12 +59,14 @@
 uint8_t USBH_Disconnected (USB_OTG_CORE_HANDLE *pdev); 
 uint8_t USBH_Connected (USB_OTG_CORE_HANDLE *pdev); 
 uint8_t USBH_SOF (USB_OTG_CORE_HANDLE *pdev); 
+uint8_t USBH_URBChange (USB_OTG_CORE_HANDLE *pdev); 
 
 USBH_HCD_INT_cb_TypeDef USBH_HCD_INT_cb = 
 {
   USBH_SOF,
   USBH_Connected, 
   USBH_Disconnected,    
+  USBH_URBChange,
 };
 
 USBH_HCD_INT_cb_TypeDef  *USBH_HCD_INT_fops = &USBH_HCD_INT_cb;
@@ -90,6 +94,16 @@ USBH_HCD_INT_cb_TypeDef  *USBH_HCD_INT_fops = &USBH_HCD_INT_cb;
 /** @defgroup USBH_CORE_Private_Variables
   * @{
   */ 
+typedef struct
+{
+  uint8_t                itfClass;
+  uint8_t                itfSubClass;  /* USBH_CLASS_ANY: any subclass */
+  USBH_Class_cb_TypeDef *class_cb;
+}
+USBH_ClassEntry_TypeDef;
+
+static USBH_ClassEntry_TypeDef USBH_ClassTab[USBH_MAX_CLASS_NUM];
+static uint8_t                 USBH_ClassNum = 0;
 /**
   * @}
   */ 
@@ -99,7 +113,7 @@ USBH_HCD_INT_cb_TypeDef  *USBH_HCD_INT_fops = &USBH_HCD_INT_cb;
   * @{
   */
 static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost);
-USBH_Status USBH_HandleControl (USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost);
+static void USBH_SelectClass(USBH_HOST *phost);
 
 /**
   * @}
@@ -120,6 +134,7 @@ USBH_Status USBH_HandleControl (USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost);
 uint8_t USBH_Connected (USB_OTG_CORE_HANDLE *pdev)
 {
   pdev->host.ConnSts = 1;
+  USB_OTG_BSP_EventPost(USB_OTG_EVT_CONNECT);
   return 0;
 }
 
@@ -133,6 +148,7 @@ uint8_t USBH_Connected (USB_OTG_CORE_HANDLE *pdev)
 uint8_t USBH_Disconnected (USB_OTG_CORE_HANDLE *pdev)
 {
   pdev->host.ConnSts = 0;
+  USB_OTG_BSP_EventPost(USB_OTG_EVT_DISCONNECT);
   return 0;  
 }
 
@@ -148,6 +164,48 @@ uint8_t USBH_SOF (USB_OTG_CORE_HANDLE *pdev)
   /* This callback could be used to implement a scheduler process */
   return 0;  
 }
+
+/**
+  * @brief  USBH_URBChange
+  *         URB state change callback function from the Interrupt.
+  * @param  selected device
+  * @retval Status
+  */
+uint8_t USBH_URBChange (USB_OTG_CORE_HANDLE *pdev)
+{
+  USB_OTG_BSP_EventPost(USB_OTG_EVT_URB);
+  return 0;  
+}
+
+/**
+  * @brief  USBH_PollTimeout
+  *         Time the host task may block before the next USBH_Process call.
+  *         A state that changed in the last call is handled again at once,
+  *         otherwise the task sleeps until the next event from the ISR or
+  *         the timeout, which only guards the transfer time-outs.
+  * @param  pdev: Selected device
+  * @param  phost: Selected host
+  * @retval 0: call USBH_Process again at once, else timeout in OS ticks
+  */
+uint32_t USBH_PollTimeout(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
+{
+  uint32_t state;
+  
+  state = (uint32_t)phost->gState | ((uint32_t)phost->EnumState << 8) | \
+    ((uint32_t)phost->RequestState << 16) | ((uint32_t)phost->Control.state << 24);
+  
+  if(state != phost->PollState)
+  {
+    phost->PollState = state;
+    return 0;
+  }
+  
+  if((phost->gState == HOST_IDLE) && (HCD_IsDeviceConnected(pdev) == 0))
+  {
+    return USBH_IDLE_POLL_TICKS;
+  }
+  return USBH_BUSY_POLL_TICKS;
+}
 /**
   * @brief  USBH_Init
   *         Host hardware and stack initializations 
@@ -174,6 +232,7 @@ void USBH_Init(USB_OTG_CORE_HANDLE *pdev,
   
   /*Register class and user callbacks */
   phost->class_cb = class_cb;
+  phost->class_default = class_cb;
   phost->usr_cb = usr_cb;  
     
   /* Start the USB OTG core */     
@@ -186,6 +245,59 @@ void USBH_Init(USB_OTG_CORE_HANDLE *pdev,
   USB_OTG_BSP_EnableInterrupt(pdev);
 }
 
+/**
+  * @brief  USBH_RegisterClass
+  *         Register a class driver for an interface class/subclass. After the
+  *         enumeration each host takes the first entry matching its interface,
+  *         so a stick and a DFU device can be served at the same time.
+  * @param  itfClass: bInterfaceClass
+  * @param  itfSubClass: bInterfaceSubClass or USBH_CLASS_ANY
+  * @param  class_cb: Class callback structure address
+  * @retval status: USBH_OK or USBH_FAIL when the table is full
+  */
+USBH_Status USBH_RegisterClass(uint8_t itfClass, 
+                               uint8_t itfSubClass, 
+                               USBH_Class_cb_TypeDef *class_cb)
+{
+  if(USBH_ClassNum >= USBH_MAX_CLASS_NUM)
+  {
+    return USBH_FAIL;
+  }
+  USBH_ClassTab[USBH_ClassNum].itfClass    = itfClass;
+  USBH_ClassTab[USBH_ClassNum].itfSubClass = itfSubClass;
+  USBH_ClassTab[USBH_ClassNum].class_cb    = class_cb;
+  USBH_ClassNum++;
+  return USBH_OK;
+}
+
+/**
+  * @brief  USBH_SelectClass
+  *         Pick the class driver of the enumerated device from the interface
+  *         parsed by USBH_ParseInterfaceDesc, class_default if none matches
+  * @param  phost: host of the device
+  * @retval None
+  */
+static void USBH_SelectClass(USBH_HOST *phost)
+{
+  USBH_InterfaceDesc_TypeDef *pif = &phost->device_prop.Itf_Desc[0];
+  uint8_t i;
+  
+  phost->class_cb = phost->class_default;
+  for(i = 0; i < USBH_ClassNum; i++)
+  {
+    if((USBH_ClassTab[i].itfClass == pif->bInterfaceClass) && 
+       ((USBH_ClassTab[i].itfSubClass == USBH_CLASS_ANY) || 
+        (USBH_ClassTab[i].itfSubClass == pif->bInterfaceSubClass)))
+    {
+      phost->class_cb = USBH_ClassTab[i].class_cb;
+      break;
+    }
+  }
+  printf_usbh_core(" Port %d interface %x/%x, class driver %d\n", phost->HubPort,
+                   pif->bInterfaceClass, pif->bInterfaceSubClass, 
+                   (i < USBH_ClassNum) ? i : -1);
+}
+
 /**
   * @brief  USBH_DeInit 
   *         Re-Initialize Host
@@ -206,9 +318,21 @@ USBH_Status USBH_DeInit(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
   
   phost->device_prop.address = USBH_DEVICE_ADDRESS_DEFAULT;
   phost->device_prop.speed = HPRT0_PRTSPD_FULL_SPEED;
+  phost->CtlHold = 0;
+  phost->AttachWait = 0;
+  phost->SerialRead = 0;
+  phost->CacheHit = 0;
+  phost->SerialNum[0] = 0;
+  phost->PollState = 0xFFFFFFFF;
+#if USBH_FAST_ENUM
+  USBH_DescCache_Release(phost);
+#endif
   
-  USBH_Free_Channel  (pdev, phost->Control.hc_num_in);
-  USBH_Free_Channel  (pdev, phost->Control.hc_num_out);  
+  if(phost->HubPort == 0)/* devices behind a hub use the channels of the hub */
+  {
+    USBH_Free_Channel  (pdev, phost->Control.hc_num_in);
+    USBH_Free_Channel  (pdev, phost->Control.hc_num_out);  
+  }
   return USBH_OK;
 }
 
@@ -240,16 +364,43 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev , USBH_HOST *phost)
   
   case HOST_IDLE :
     
-    if (HCD_IsDeviceConnected(pdev))  
+    /* devices behind a hub are attached by the hub driver */
+    if ((phost->HubPort == 0) && HCD_IsDeviceConnected(pdev))  
     {
+#if USBH_FAST_ENUM
+      /* attach debounce without blocking the CPU, the host task comes back
+         every USBH_BUSY_POLL_TICKS while a device is connected */
+      if (phost->AttachWait == 0)
+      {
+        phost->AttachWait = 1;
+        phost->AttachTick = RTC_SysTickGetSum();
+      }
+      else if ((RTC_SysTickGetSum() - phost->AttachTick) * SYSTICK_CYC >= USBH_ATTACH_DEBOUNCE_MS)
+      {
+        phost->AttachWait = 0;
+        phost->gState = HOST_DEV_ATTACHED;
+      }
+#else
+      phost->AttachTick = RTC_SysTickGetSum();
       phost->gState = HOST_DEV_ATTACHED;
       USB_OTG_BSP_mDelay(100);
+#endif
+    }
+    else
+    {
+      phost->AttachWait = 0;
     }
     break;
    
   case HOST_DEV_ATTACHED :
     
     phost->usr_cb->DeviceAttached();//USBH_USR_DeviceAttached
+    if(phost->HubPort)
+    {
+      /* port already reset by the hub driver, speed set from the port status */
+      phost->gState = HOST_ENUMERATION;
+      break;
+    }
     phost->Control.hc_num_out = USBH_Alloc_Channel(pdev, 0x00);//USB_EP_DIR_OUT
     phost->Control.hc_num_in = USBH_Alloc_Channel(pdev, 0x80);  //USB_EP_DIR_IN
   
@@ -292,6 +443,7 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev , USBH_HOST *phost)
       
       /* user callback for end of device basic enumeration */
       phost->usr_cb->EnumerationDone();
+      USBH_SelectClass(phost);
       
       phost->gState  = HOST_USR_INPUT; 
     }
@@ -303,7 +455,12 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev , USBH_HOST *phost)
     {
 		phost->gState  = HOST_CLASS_INIT; 
 		printf_usbh_core(" KEY  Pressed !!!!!!!!!!!!!!!!!!!!!!!! \n\n");  
+#if USBH_FAST_ENUM == 0
 		USB_OTG_BSP_mDelay(1000);
+#endif
+		phost->EnumTime = (RTC_SysTickGetSum() - phost->AttachTick) * SYSTICK_CYC;
+		printf_usbh_core(" Attach to class %d ms%s\n", phost->EnumTime,
+		                 phost->CacheHit ? ", descriptors cached" : "");
 	}   
     break;
       
@@ -354,7 +511,8 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev , USBH_HOST *phost)
     /* Re-Initilaize Host for new Enumeration */
     USBH_DeInit(pdev, phost);
     phost->usr_cb->DeInit();
-    phost->class_cb->DeInit(pdev, &phost->device_prop);
+    phost->class_cb->DeInit(pdev, phost);
+    phost->class_cb = phost->class_default;
     break;
     
   case HOST_DEV_DISCONNECTED :
@@ -365,8 +523,12 @@ void USBH_Process(USB_OTG_CORE_HANDLE *pdev , USBH_HOST *phost)
     /* Re-Initilaize Host for new Enumeration */
     USBH_DeInit(pdev, phost);
     phost->usr_cb->DeInit();
-    phost->class_cb->DeInit(pdev, &phost->device_prop); 
-    USBH_DeAllocate_AllChannel(pdev);  
+    phost->class_cb->DeInit(pdev, phost); 
+    phost->class_cb = phost->class_default;
+    if(phost->HubPort == 0)
+    {
+      USBH_DeAllocate_AllChannel(pdev);  
+    }
     phost->gState = HOST_IDLE;
     
     break;
@@ -410,6 +572,43 @@ void USBH_ErrorHandle(USBH_HOST *phost, USBH_Status errType)
   * @retval USBH_Status
   */
 static uint8_t DFU_INIT=0;//0:分配地址;1:不分配，使用默认地址0
+
+/**
+  * @brief  USBH_EnumAfterSerial 
+  *         Next enumeration step once the serial number is known. In fast
+  *         mode it is read right after SET_ADDRESS: a device in the
+  *         descriptor cache goes on with SET_CONFIGURATION, a new one reads
+  *         its configuration and strings as usual.
+  * @param  phost: Selected host
+  * @param  serial: serial number string
+  * @retval next ENUM_State
+  */
+static ENUM_State USBH_EnumAfterSerial(USBH_HOST *phost, uint8_t *serial)
+{
+#if USBH_FAST_ENUM
+  USBH_DescCache_TypeDef *pEntry;
+  
+  if (phost->SerialRead)
+  {
+    return ENUM_SET_CONFIGURATION;
+  }
+  phost->SerialRead = 1;
+  pEntry = USBH_DescCache_Lookup(phost, serial);
+  if (pEntry == 0)
+  {
+    return ENUM_GET_CFG_DESC;
+  }
+  phost->CacheHit = 1;
+  printf_usbh_core("\n\r descriptors from cache");
+  phost->usr_cb->ConfigurationDescAvailable(&phost->device_prop.Cfg_Desc,
+                                            phost->device_prop.Itf_Desc,
+                                            phost->device_prop.Ep_Desc[0]);
+  phost->usr_cb->ManufacturerString(pEntry->Str[USBH_DESC_STR_MFC]);
+  phost->usr_cb->ProductString(pEntry->Str[USBH_DESC_STR_PRODUCT]);
+#endif
+  return ENUM_SET_CONFIGURATION;
+}
+
 static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
 {
   USBH_Status Status = USBH_BUSY;  
@@ -424,9 +623,12 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
       printf_usbh_core("\n\r USBH_Get_DevDesc  only 1st 8 bytes");
       phost->Control.ep0size = phost->device_prop.Dev_Desc.bMaxPacketSize;
         
-      printf_usbh_core("\n\r HCD_ResetPort_\n");
-      /* Issue Reset  */
-      HCD_ResetPort(pdev);
+      if(phost->HubPort == 0)
+      {
+        printf_usbh_core("\n\r HCD_ResetPort_\n");
+        /* Issue Reset  */
+        HCD_ResetPort(pdev);
+      }
       phost->EnumState = ENUM_GET_FULL_DEV_DESC;
       
       /* modify control channels configuration for MaxPacket size */
@@ -465,15 +667,20 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
 		break;
 	  }
     /* set address */
-    if ( USBH_SetAddress(pdev, phost, USBH_DEVICE_ADDRESS) == USBH_OK)
+    if ( USBH_SetAddress(pdev, phost, USBH_DEVICE_ADDRESS + phost->HubPort) == USBH_OK)
     {
       printf_usbh_core("\n\r USBH_SetAddress  OK!\n");
       USB_OTG_BSP_mDelay(2);
-      phost->device_prop.address = USBH_DEVICE_ADDRESS;
+      phost->device_prop.address = USBH_DEVICE_ADDRESS + phost->HubPort;
       
       /* user callback for device address assigned */
       phost->usr_cb->DeviceAddressAssigned();
+#if USBH_FAST_ENUM
+      /* the serial number decides if the rest is in the descriptor cache */
+      phost->EnumState = ENUM_GET_SERIALNUM_STRING_DESC;
+#else
       phost->EnumState = ENUM_GET_CFG_DESC;
+#endif
       
       /* modify control channels to update device address */
       USBH_Modify_Channel (pdev,
@@ -531,6 +738,9 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
       {
         /* User callback for Manufacturing string */
         phost->usr_cb->ManufacturerString(Local_Buffer);
+#if USBH_FAST_ENUM
+        USBH_DescCache_SetString(phost, USBH_DESC_STR_MFC, Local_Buffer);
+#endif
         phost->EnumState = ENUM_GET_PRODUCT_STRING_DESC;
         printf_usbh_core("\n\r get Manufacturer String !\n");
       }
@@ -553,6 +763,9 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
       {
         /* User callback for Product string */
         phost->usr_cb->ProductString(Local_Buffer);
+#if USBH_FAST_ENUM
+        USBH_DescCache_SetString(phost, USBH_DESC_STR_PRODUCT, Local_Buffer);
+#endif
         phost->EnumState = ENUM_GET_SERIALNUM_STRING_DESC;
         printf_usbh_core("\n\r get Product String !");
       }
@@ -562,6 +775,10 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
       phost->usr_cb->ProductString("N/A");
       phost->EnumState = ENUM_GET_SERIALNUM_STRING_DESC;
     } 
+    if ((phost->EnumState == ENUM_GET_SERIALNUM_STRING_DESC) && (phost->SerialRead))
+    {
+      phost->EnumState = ENUM_SET_CONFIGURATION;  /* already read before the config */
+    }
     break;
     
   case ENUM_GET_SERIALNUM_STRING_DESC:   
@@ -575,14 +792,16 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
       {
         /* User callback for Serial number string */
         phost->usr_cb->SerialNumString(Local_Buffer);
-        phost->EnumState = ENUM_SET_CONFIGURATION;
+        strncpy((char *)phost->SerialNum, (char *)Local_Buffer, USBH_SERIAL_STR_LEN - 1);
+        phost->SerialNum[USBH_SERIAL_STR_LEN - 1] = 0;
+        phost->EnumState = USBH_EnumAfterSerial(phost, Local_Buffer);
         printf_usbh_core("\n\r get Serial number String !");
       }
     }
     else
     {
       phost->usr_cb->SerialNumString("N/A");      
-      phost->EnumState = ENUM_SET_CONFIGURATION;
+      phost->EnumState = USBH_EnumAfterSerial(phost, (uint8_t *)"");
     }  
     break;
       
@@ -603,6 +822,11 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
     break;
 
   case ENUM_SET_RELIGION:
+    if (phost->CacheHit)
+    {
+      phost->EnumState = ENUM_DEV_CONFIGURED;  /* language ID from the cache */
+      break;
+    }
     /* set configuration  (default config) */
     //if (USBH_Get_CfgDesc(pdev, 
     //                     phost,
@@ -624,6 +848,12 @@ static USBH_Status USBH_HandleEnum(USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
     break;
     
   case ENUM_DEV_CONFIGURED:
+#if USBH_FAST_ENUM
+    if (phost->CacheHit == 0)
+    {
+      USBH_DescCache_Store(phost);
+    }
+#endif
     /* user callback for enumeration done */
     Status = USBH_OK;
     printf_usbh_core("\n\r enum ok!!!!\n\r");
@@ -737,6 +967,7 @@ USBH_Status USBH_HandleControl (USB_OTG_CORE_HANDLE *pdev, USBH_HOST *phost)
     { 
       /* In stall case, return to previous machine state*/
       phost->gState =   phost->gStateBkp;
+      phost->Control.state = CTRL_STALLED;//否则USBH_CtlReq一直停在CMD_WAIT
     }   
     else if (URB_Status == URB_ERROR)
     {
@@ -0,0 +1,223 @@
+/**
+  ******************************************************************************
+  * @file    usbh_desc_cache.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Descriptor cache for the fast enumeration (USBH_FAST_ENUM).
+  *
+  * @verbatim
+  *          A device is recognised by its device descriptor and serial
+  *          number string. For a known device the configuration, language
+  *          and manufacturer/product strings are taken from the cache, so
+  *          only the device descriptor, SET_ADDRESS, the serial number and
+  *          SET_CONFIGURATION go over the bus. The MK5 re-enumerates after
+  *          every DFU manifestation and is always found here.
+  *          Devices without a serial number string are not cached: two
+  *          sticks of the same model could not be told apart and the
+  *          configuration of one would be used for the other.
+  *          The least recently used entry is replaced on a miss.
+  *  @endverbatim
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_desc_cache.h"
+#include "string.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_LIB_CORE
+* @{
+*/
+
+/** @defgroup USBH_DESC_CACHE
+* @brief    This file includes the descriptor cache of the enumeration.
+* @{
+*/
+
+/** @defgroup USBH_DESC_CACHE_Private_Variables
+* @{
+*/
+static USBH_DescCache_TypeDef  USBH_DescCache[USBH_DESC_CACHE_NUM];
+/**
+* @}
+*/
+
+/** @defgroup USBH_DESC_CACHE_Private_Functions
+* @{
+*/
+
+/**
+* @brief  USBH_DescCache_Find
+*         Entry being filled by phost
+* @param  phost: Selected host
+* @retval entry, 0 if none
+*/
+static USBH_DescCache_TypeDef *USBH_DescCache_Find(USBH_HOST *phost)
+{
+  uint8_t i;
+
+  for(i = 0; i < USBH_DESC_CACHE_NUM; i++){
+    if(USBH_DescCache[i].Owner == phost) return &USBH_DescCache[i];
+  }
+  return 0;
+}
+
+/**
+* @brief  USBH_DescCache_Touch
+*         Make an entry the most recently used one
+* @param  pEntry: entry
+* @retval None
+*/
+static void USBH_DescCache_Touch(USBH_DescCache_TypeDef *pEntry)
+{
+  uint8_t i;
+
+  for(i = 0; i < USBH_DESC_CACHE_NUM; i++){
+    if(USBH_DescCache[i].Age < pEntry->Age) USBH_DescCache[i].Age++;
+  }
+  pEntry->Age = 0;
+}
+
+/**
+* @brief  USBH_DescCache_Copy
+*         Copy a string as far as the entry can hold it
+* @param  dst: string in the entry
+* @param  src: string from the device
+* @retval None
+*/
+static void USBH_DescCache_Copy(uint8_t *dst, const uint8_t *src)
+{
+  strncpy((char *)dst, (const char *)src, USBH_DESC_CACHE_STR_LEN - 1);
+  dst[USBH_DESC_CACHE_STR_LEN - 1] = 0;
+}
+
+/**
+* @brief  USBH_DescCache_Lookup
+*         Look for the device on phost, called once the device descriptor
+*         and the serial number are read. On a hit the descriptors are
+*         copied to phost->device_prop, on a miss an entry is reserved and
+*         filled by the rest of the enumeration.
+* @param  phost: Selected host
+* @param  serial: serial number string, "" if the device has none
+* @retval entry on a hit (for its strings), 0 on a miss or if the device
+*         has no serial number
+*/
+USBH_DescCache_TypeDef *USBH_DescCache_Lookup(USBH_HOST *phost, const uint8_t *serial)
+{
+  uint8_t i;
+  uint8_t str[USBH_DESC_CACHE_STR_LEN];
+  USBH_DescCache_TypeDef *pEntry;
+  USBH_Device_TypeDef *pDev = &phost->device_prop;
+
+  USBH_DescCache_Release(phost);
+  if(serial[0] == 0) return 0;//没有序列号无法区分同型号设备,不缓存
+  USBH_DescCache_Copy(str, serial);
+  for(i = 0; i < USBH_DESC_CACHE_NUM; i++){
+    pEntry = &USBH_DescCache[i];
+    if((pEntry->Valid)
+        && (memcmp(&pEntry->Dev_Desc, &pDev->Dev_Desc, sizeof(pDev->Dev_Desc)) == 0)
+        && (strcmp((char *)pEntry->Str[USBH_DESC_STR_SERIAL], (char *)str) == 0)){
+      memcpy(&pDev->Cfg_Desc, &pEntry->Cfg_Desc, sizeof(pDev->Cfg_Desc));
+      memcpy(pDev->Itf_Desc, pEntry->Itf_Desc, sizeof(pDev->Itf_Desc));
+      memcpy(pDev->Ep_Desc, pEntry->Ep_Desc, sizeof(pDev->Ep_Desc));
+      memcpy(&pDev->HID_Desc, &pEntry->HID_Desc, sizeof(pDev->HID_Desc));
+      memcpy(&pDev->DFU_Desc, &pEntry->DFU_Desc, sizeof(pDev->DFU_Desc));
+      memcpy(&pDev->RELIGION_Desc, &pEntry->RELIGION_Desc, sizeof(pDev->RELIGION_Desc));
+      USBH_DescCache_Touch(pEntry);
+      return pEntry;
+    }
+  }
+
+  pEntry = 0;//空闲项优先,否则取最久未用的一项
+  for(i = 0; i < USBH_DESC_CACHE_NUM; i++){
+    if(USBH_DescCache[i].Owner) continue;
+    if((pEntry == 0) || (USBH_DescCache[i].Valid == 0)
+        || ((pEntry->Valid) && (USBH_DescCache[i].Age > pEntry->Age))){
+      pEntry = &USBH_DescCache[i];
+    }
+  }
+  if(pEntry == 0) return 0;//全部正在填写
+  memset(pEntry, 0, sizeof(*pEntry));
+  pEntry->Owner = phost;
+  pEntry->Age   = USBH_DESC_CACHE_NUM;
+  USBH_DescCache_Copy(pEntry->Str[USBH_DESC_STR_MFC], (const uint8_t *)"N/A");//设备没有该字符串时
+  USBH_DescCache_Copy(pEntry->Str[USBH_DESC_STR_PRODUCT], (const uint8_t *)"N/A");
+  memcpy(pEntry->Str[USBH_DESC_STR_SERIAL], str, sizeof(str));
+  return 0;
+}
+
+/**
+* @brief  USBH_DescCache_SetString
+*         Keep a string read during the enumeration of a new device
+* @param  phost: Selected host
+* @param  which: USBH_DESC_STR_xxx
+* @param  str: string
+* @retval None
+*/
+void USBH_DescCache_SetString(USBH_HOST *phost, uint8_t which, const uint8_t *str)
+{
+  USBH_DescCache_TypeDef *pEntry = USBH_DescCache_Find(phost);
+
+  if(pEntry){
+    USBH_DescCache_Copy(pEntry->Str[which], str);
+  }
+}
+
+/**
+* @brief  USBH_DescCache_Store
+*         End of the enumeration of a new device: keep its descriptors
+* @param  phost: Selected host
+* @retval None
+*/
+void USBH_DescCache_Store(USBH_HOST *phost)
+{
+  USBH_DescCache_TypeDef *pEntry = USBH_DescCache_Find(phost);
+  USBH_Device_TypeDef *pDev = &phost->device_prop;
+
+  if(pEntry == 0) return;
+  memcpy(&pEntry->Dev_Desc, &pDev->Dev_Desc, sizeof(pDev->Dev_Desc));
+  memcpy(&pEntry->Cfg_Desc, &pDev->Cfg_Desc, sizeof(pDev->Cfg_Desc));
+  memcpy(pEntry->Itf_Desc, pDev->Itf_Desc, sizeof(pDev->Itf_Desc));
+  memcpy(pEntry->Ep_Desc, pDev->Ep_Desc, sizeof(pDev->Ep_Desc));
+  memcpy(&pEntry->HID_Desc, &pDev->HID_Desc, sizeof(pDev->HID_Desc));
+  memcpy(&pEntry->DFU_Desc, &pDev->DFU_Desc, sizeof(pDev->DFU_Desc));
+  memcpy(&pEntry->RELIGION_Desc, &pDev->RELIGION_Desc, sizeof(pDev->RELIGION_Desc));
+  pEntry->Owner = 0;
+  pEntry->Valid = 1;
+  USBH_DescCache_Touch(pEntry);
+}
+
+/**
+* @brief  USBH_DescCache_Release
+*         Drop the entry of an enumeration that did not finish
+* @param  phost: Selected host
+* @retval None
+*/
+void USBH_DescCache_Release(USBH_HOST *phost)
+{
+  USBH_DescCache_TypeDef *pEntry = USBH_DescCache_Find(phost);
+
+  if(pEntry){
+    pEntry->Owner = 0;
+    pEntry->Valid = 0;
+  }
+}
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
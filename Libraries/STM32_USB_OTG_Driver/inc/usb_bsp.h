@@ -46,6 +46,12 @@
 /** @defgroup USB_BSP_Exported_Defines
   * @{
   */ 
+/* Host events posted from the interrupts to wake up the host task */
+#define USB_OTG_EVT_CONNECT                    0x01
+#define USB_OTG_EVT_DISCONNECT                 0x02
+#define USB_OTG_EVT_URB                        0x04
+#define USB_OTG_EVT_TIMER                      0x08
+#define USB_OTG_EVT_CLASS                      0x10
 /**
   * @}
   */ 
@@ -86,6 +92,16 @@ void USB_OTG_BSP_EnableInterrupt (USB_OTG_CORE_HANDLE *pdev);
 void USB_OTG_BSP_ConfigVBUS(USB_OTG_CORE_HANDLE *pdev);
 void USB_OTG_BSP_DriveVBUS(USB_OTG_CORE_HANDLE *pdev,uint8_t state);
 #endif
+void USB_OTG_BSP_PollTimerStart(uint32_t usec);
+uint8_t USB_OTG_BSP_PollTimerExpired(void);
+void USB_OTG_BSP_EventPost(uint32_t evt);
+uint32_t USB_OTG_BSP_EventWait(uint32_t timeout);
+#ifdef USB_OTG_HOSTSIM
+/* PC model of the core and of this BSP, see
+   Utilities/STM32_EVAL/STM322xG_EVAL/host/usb_hostsim.c */
+extern __IO uint32_t USB_OTG_HostSim_DWT[2];   /* DWT_CTRL, DWT_CYCCNT */
+void USB_OTG_BSP_HostSimSpin(USB_OTG_CORE_HANDLE *pdev);
+#endif
 /**
   * @}
   */ 
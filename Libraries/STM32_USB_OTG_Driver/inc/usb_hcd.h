@@ -55,6 +55,21 @@
 /** @defgroup USB_HCD_Exported_Types
   * @{
   */ 
+#ifdef USB_OTG_HCD_STATS
+typedef struct _HCD_Stats
+{
+  uint32_t                 Submit;       /* HCD_SubmitRequest calls */
+  uint32_t                 Done;         /* URB_DONE */
+  uint32_t                 NotReady;     /* URB_NOTREADY (NAK/NYET) */
+  uint32_t                 Stall;        /* URB_STALL */
+  uint32_t                 Error;        /* URB_ERROR */
+  uint32_t                 Bytes;        /* data of the URB_DONE transfers */
+  uint32_t                 CycStart;     /* DWT cycle counter at the last submit */
+  uint32_t                 CycSum;       /* submit to URB_DONE, CPU cycles */
+  uint32_t                 CycMax;
+}
+HCD_STATS_TypeDef;
+#endif
 /**
   * @}
   */ 
@@ -90,6 +105,14 @@ uint32_t  HCD_GetCurrentFrame      (USB_OTG_CORE_HANDLE *pdev) ;
 URB_STATE HCD_GetURB_State         (USB_OTG_CORE_HANDLE *pdev,  uint8_t ch_num); 
 uint32_t  HCD_GetXferCnt           (USB_OTG_CORE_HANDLE *pdev,  uint8_t ch_num); 
 HC_STATUS HCD_GetHCState           (USB_OTG_CORE_HANDLE *pdev,  uint8_t ch_num) ;
+#ifdef USB_OTG_HCD_STATS
+void      HCD_StatsURB             (USB_OTG_CORE_HANDLE *pdev,  uint8_t ch_num);
+HCD_STATS_TypeDef *HCD_GetStats    (uint8_t ch_num);
+void      HCD_ClearStats           (void);
+#endif
+#ifdef USB_OTG_HCD_FAULT
+void      HCD_InjectFault          (uint8_t ch_num, URB_STATE state, uint16_t count);
+#endif
 /**
   * @}
   */ 
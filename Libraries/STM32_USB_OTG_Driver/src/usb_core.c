@@ -973,6 +973,7 @@ USB_OTG_STS USB_OTG_HC_StartXfer(USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num)
   USB_OTG_HPTXSTS_TypeDef  hptxsts; 
   USB_OTG_GINTMSK_TypeDef  intmsk;
   uint16_t                 len_words = 0;   
+  uint32_t                 len;
   
   uint16_t num_packets;
   uint16_t max_hc_pkt_count;
@@ -1029,6 +1030,7 @@ USB_OTG_STS USB_OTG_HC_StartXfer(USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num)
     if((pdev->host.hc[hc_num].ep_is_in == 0) && 
        (pdev->host.hc[hc_num].xfer_len > 0))
     {
+      len = pdev->host.hc[hc_num].xfer_len;
       switch(pdev->host.hc[hc_num].ep_type) 
       {
         /* Non periodic transfer */
@@ -1041,6 +1043,11 @@ USB_OTG_STS USB_OTG_HC_StartXfer(USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num)
         /* check if there is enough space in FIFO space */
         if(len_words > hnptxsts.b.nptxfspcavail)
         {
+          /* multi-packet transfer: write the whole packets that fit now,
+             the others are written in the nptxfempty interrupt */
+          len = (hnptxsts.b.nptxfspcavail * 4 / pdev->host.hc[hc_num].max_packet) * \
+                pdev->host.hc[hc_num].max_packet;
+          
           /* need to process data in nptxfempty interrupt */
           intmsk.b.nptxfempty = 1;
           USB_OTG_MODIFY_REG32( &pdev->regs.GREGS->GINTMSK, 0, intmsk.d32);  
@@ -1066,9 +1073,15 @@ USB_OTG_STS USB_OTG_HC_StartXfer(USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num)
       }
       
       /* Write packet into the Tx FIFO. */
-      USB_OTG_WritePacket(pdev, 
-                          pdev->host.hc[hc_num].xfer_buff , 
-                          hc_num, pdev->host.hc[hc_num].xfer_len);
+      if (len > 0)
+      {
+        USB_OTG_WritePacket(pdev, 
+                            pdev->host.hc[hc_num].xfer_buff , 
+                            hc_num, len);
+        pdev->host.hc[hc_num].xfer_buff  += len;
+        pdev->host.hc[hc_num].xfer_len   -= len;
+        pdev->host.hc[hc_num].xfer_count += len;
+      }
     }
   }
   return status;
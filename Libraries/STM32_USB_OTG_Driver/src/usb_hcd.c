@@ -45,6 +45,15 @@
 /** @defgroup USB_HCD_Private_Defines
   * @{
   */ 
+#ifdef USB_OTG_HCD_STATS
+#ifdef USB_OTG_HOSTSIM
+#define HCD_DWT_CTRL        USB_OTG_HostSim_DWT[0]
+#define HCD_DWT_CYCCNT      USB_OTG_HostSim_DWT[1]
+#else
+#define HCD_DWT_CTRL        (*(__IO uint32_t *)0xE0001000)
+#define HCD_DWT_CYCCNT      (*(__IO uint32_t *)0xE0001004)
+#endif
+#endif
 /**
   * @}
   */ 
@@ -70,6 +79,17 @@
 /** @defgroup USB_HCD_Private_Variables
   * @{
   */ 
+#ifdef USB_OTG_HCD_STATS
+static HCD_STATS_TypeDef HCD_Stats[USB_OTG_MAX_TX_FIFOS];
+#endif
+#ifdef USB_OTG_HCD_FAULT
+static struct
+{
+  URB_STATE                State;        /* result given instead of the transfer */
+  uint16_t                 Count;        /* URBs still to fail */
+}
+HCD_Fault[USB_OTG_MAX_TX_FIFOS];
+#endif
 /**
   * @}
   */ 
@@ -107,6 +127,14 @@ uint32_t HCD_Init(USB_OTG_CORE_HANDLE *pdev ,
   pdev->host.HC_Status[i]   = HC_IDLE;
   }
   pdev->host.hc[0].max_packet  = 8; 
+  
+#ifdef USB_OTG_HCD_STATS
+#ifndef USB_OTG_HOSTSIM
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#endif
+  HCD_DWT_CTRL |= 0x01; /* CYCCNTENA */
+  HCD_ClearStats();
+#endif
 
   USB_OTG_SelectCore(pdev, coreID);
 #ifndef DUAL_ROLE_MODE_ENABLED
@@ -190,6 +218,10 @@ uint32_t HCD_GetCurrentFrame (USB_OTG_CORE_HANDLE *pdev)
   */
 URB_STATE HCD_GetURB_State (USB_OTG_CORE_HANDLE *pdev , uint8_t ch_num) 
 {
+#ifdef USB_OTG_HOSTSIM
+  /* PC model of the core: a loop on the URB state lets the bus time run */
+  USB_OTG_BSP_HostSimSpin(pdev);
+#endif
   return pdev->host.URB_State[ch_num] ;
 }
 
@@ -240,12 +272,131 @@ uint32_t HCD_HC_Init (USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num)
   */
 uint32_t HCD_SubmitRequest (USB_OTG_CORE_HANDLE *pdev , uint8_t hc_num) 
 {
+#ifdef USB_OTG_HCD_STATS
+  HCD_Stats[hc_num].Submit++;
+  HCD_Stats[hc_num].CycStart = HCD_DWT_CYCCNT;
+#endif
+  pdev->host.XferCnt[hc_num] = 0;
+#ifdef USB_OTG_HCD_FAULT
+  if (HCD_Fault[hc_num].Count)
+  {
+    /* no bus transaction, the class sees the injected result */
+    HCD_Fault[hc_num].Count--;
+    pdev->host.hc[hc_num].xfer_len = 0;
+    pdev->host.URB_State[hc_num] = HCD_Fault[hc_num].State;
+#ifdef USB_OTG_HCD_STATS
+    HCD_StatsURB(pdev, hc_num);
+#endif
+    USB_OTG_BSP_EventPost(USB_OTG_EVT_URB);
+    return 0;
+  }
+#endif
   
   pdev->host.URB_State[hc_num] =   URB_IDLE;  
   pdev->host.hc[hc_num].xfer_count = 0 ;
   return USB_OTG_HC_StartXfer(pdev, hc_num);
 }
 
+#ifdef USB_OTG_HCD_STATS
+/**
+  * @brief  HCD_StatsURB 
+  *         Count the new URB state of a channel, called from the hc interrupt
+  * @param  pdev: Selected device
+  * @param  ch_num: Channel number 
+  * @retval None
+  */
+void HCD_StatsURB (USB_OTG_CORE_HANDLE *pdev, uint8_t ch_num) 
+{
+  HCD_STATS_TypeDef *pStats = &HCD_Stats[ch_num];
+  uint32_t cyc;
+  
+  switch (pdev->host.URB_State[ch_num])
+  {
+  case URB_DONE:
+    cyc = HCD_DWT_CYCCNT - pStats->CycStart;
+    pStats->Done++;
+    pStats->CycSum += cyc;
+    if (cyc > pStats->CycMax)
+    {
+      pStats->CycMax = cyc;
+    }
+    pStats->Bytes += pdev->host.hc[ch_num].xfer_count;
+    break;
+    
+  case URB_NOTREADY:
+    pStats->NotReady++;
+    break;
+    
+  case URB_STALL:
+    pStats->Stall++;
+    break;
+    
+  case URB_ERROR:
+    pStats->Error++;
+    break;
+    
+  default:
+    break;
+  }
+}
+
+/**
+  * @brief  HCD_GetStats 
+  *         Counters of a channel since the last HCD_ClearStats
+  * @param  ch_num: Channel number 
+  * @retval pointer to the counters
+  */
+HCD_STATS_TypeDef *HCD_GetStats (uint8_t ch_num) 
+{
+  return &HCD_Stats[ch_num];
+}
+
+/**
+  * @brief  HCD_ClearStats 
+  *         Reset the counters of all channels
+  * @param  None
+  * @retval None
+  */
+void HCD_ClearStats (void) 
+{
+  uint8_t i;
+  
+  for (i = 0; i < USB_OTG_MAX_TX_FIFOS; i++)
+  {
+    HCD_Stats[i].Submit   = 0;
+    HCD_Stats[i].Done     = 0;
+    HCD_Stats[i].NotReady = 0;
+    HCD_Stats[i].Stall    = 0;
+    HCD_Stats[i].Error    = 0;
+    HCD_Stats[i].Bytes    = 0;
+    HCD_Stats[i].CycSum   = 0;
+    HCD_Stats[i].CycMax   = 0;
+  }
+}
+#endif
+
+#ifdef USB_OTG_HCD_FAULT
+/**
+  * @brief  HCD_InjectFault 
+  *         The next count URBs submitted on the channel end with state
+  *         (URB_NOTREADY, URB_STALL or URB_ERROR) without a transfer
+  * @param  ch_num: Channel number 
+  * @param  state: injected URB state
+  * @param  count: number of URBs, 0 cancels
+  * @retval None
+  */
+void HCD_InjectFault (uint8_t ch_num, URB_STATE state, uint16_t count) 
+{
+  if (ch_num >= USB_OTG_MAX_TX_FIFOS)
+  {
+    return;
+  }
+  HCD_Fault[ch_num].Count = 0;
+  HCD_Fault[ch_num].State = state;
+  HCD_Fault[ch_num].Count = count;
+}
+#endif
+
 
 /**
 * @}
@@ -189,6 +189,8 @@ static uint32_t USB_OTG_USBH_handle_hc_ISR (USB_OTG_CORE_HANDLE *pdev)
   USB_OTG_HCCHAR_TypeDef       hcchar;
   uint32_t i = 0;
   uint32_t retval = 0;
+  uint8_t  urb_change = 0;
+  URB_STATE urb_state;
   
   /* Clear appropriate bits in HCINTn to clear the interrupt bit in
   * GINTSTS */
@@ -200,6 +202,7 @@ static uint32_t USB_OTG_USBH_handle_hc_ISR (USB_OTG_CORE_HANDLE *pdev)
     if (haint.b.chint & (1 << i))
     {
       hcchar.d32 = USB_OTG_READ_REG32(&pdev->regs.HC_REGS[i]->HCCHAR);
+      urb_state = pdev->host.URB_State[i];
       
       if (hcchar.b.epdir)
       {
@@ -209,9 +212,23 @@ static uint32_t USB_OTG_USBH_handle_hc_ISR (USB_OTG_CORE_HANDLE *pdev)
       {
         retval |=  USB_OTG_USBH_handle_hc_n_Out_ISR (pdev, i);
       }
+      
+      if (urb_state != pdev->host.URB_State[i])
+      {
+        urb_change = 1;
+#ifdef USB_OTG_HCD_STATS
+        HCD_StatsURB(pdev, i);
+#endif
+      }
     }
   }
   
+  /* Notify the upper layer once per interrupt that a transfer has completed */
+  if (urb_change)
+  {
+    USBH_HCD_INT_fops->URBChange(pdev);
+  }
+  
   return retval;
 }
 
@@ -268,35 +285,57 @@ static uint32_t USB_OTG_USBH_handle_nptxfempty_ISR (USB_OTG_CORE_HANDLE *pdev)
 {
   USB_OTG_GINTMSK_TypeDef      intmsk;
   USB_OTG_HNPTXSTS_TypeDef     hnptxsts; 
-  uint16_t                     len_words , len; 
+  USB_OTG_HCCHAR_TypeDef       hcchar; 
+  USB_OTG_HC                  *hc;
+  uint32_t                     len; 
+  uint8_t                      num;
   
   hnptxsts.d32 = USB_OTG_READ_REG32(&pdev->regs.GREGS->HNPTXSTS);
   
-  len_words = (pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len + 3) / 4;
+  /* the enabled channel with OUT data left to write; a channel being halted
+     (NAK) gets no more data, the class sends the rest of its URB again */
+  for (num = 0; num < pdev->cfg.host_channels; num++)
+  {
+    hc = &pdev->host.hc[num];
+    hcchar.d32 = USB_OTG_READ_REG32(&pdev->regs.HC_REGS[num]->HCCHAR);
+    if ((hc->ep_is_in == 0) && (hc->xfer_len != 0) && 
+        ((hc->ep_type == EP_TYPE_CTRL) || (hc->ep_type == EP_TYPE_BULK)) &&
+        (hcchar.b.chen == 1) && (hcchar.b.chdis == 0))
+    {
+      break;
+    }
+  }
+  
+  if (num >= pdev->cfg.host_channels)
+  {
+    /* nothing left to write */
+    intmsk.d32 = 0;
+    intmsk.b.nptxfempty = 1;
+    USB_OTG_MODIFY_REG32( &pdev->regs.GREGS->GINTMSK, intmsk.d32, 0);       
+    return 1;
+  }
+  hc = &pdev->host.hc[num];
   
-  while ((hnptxsts.b.nptxfspcavail > len_words)&&
-         (pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len != 0))
+  /* whole packets only, the core splits the FIFO data by max_packet */
+  while (hc->xfer_len != 0)
   {
-    
-    len = hnptxsts.b.nptxfspcavail * 4;
-    
-    if (len > pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len)
+    len = (hnptxsts.b.nptxfspcavail * 4 / hc->max_packet) * hc->max_packet;
+    if (len == 0)
     {
-      /* Last packet */
-      len = pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len;
-      
-      intmsk.d32 = 0;
-      intmsk.b.nptxfempty = 1;
-      USB_OTG_MODIFY_REG32( &pdev->regs.GREGS->GINTMSK, intmsk.d32, 0);       
+      break;
+    }
+    if (len >= hc->xfer_len)
+    {
+      /* Last packet, the interrupt is masked on the next call when no other
+         channel has data left */
+      len = hc->xfer_len;
     }
     
-    len_words = (pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len + 3) / 4;
-    
-    USB_OTG_WritePacket (pdev , pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_buff, hnptxsts.b.nptxqtop.chnum, len);
+    USB_OTG_WritePacket (pdev , hc->xfer_buff, num, len);
     
-    pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_buff  += len;
-    pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_len   -= len;
-    pdev->host.hc[hnptxsts.b.nptxqtop.chnum].xfer_count  += len; 
+    hc->xfer_buff  += len;
+    hc->xfer_len   -= len;
+    hc->xfer_count += len; 
     
     hnptxsts.d32 = USB_OTG_READ_REG32(&pdev->regs.GREGS->HNPTXSTS);
   }  
@@ -468,6 +507,8 @@ uint32_t USB_OTG_USBH_handle_hc_n_Out_ISR (USB_OTG_CORE_HANDLE *pdev , uint32_t
   USB_OTG_HCINTMSK_TypeDef  hcintmsk;
   USB_OTG_HC_REGS *hcreg;
   USB_OTG_HCCHAR_TypeDef     hcchar; 
+  USB_OTG_HCTSIZn_TypeDef    hctsiz;
+  uint32_t                   total, packets;
   
   hcreg = pdev->regs.HC_REGS[num];
   hcint.d32 = USB_OTG_READ_REG32(&hcreg->HCINT);
@@ -547,12 +588,32 @@ uint32_t USB_OTG_USBH_handle_hc_n_Out_ISR (USB_OTG_CORE_HANDLE *pdev , uint32_t
   {
     MASK_HOST_INT_CHH (num);
     
+    if (hcchar.b.eptype == EP_TYPE_BULK)
+    {
+      /* multi-packet OUT: the bytes acknowledged so far, from the packets left
+         in HCTSIZ; the core keeps the data toggle of the next packet there */
+      hctsiz.d32 = USB_OTG_READ_REG32(&hcreg->HCTSIZ);
+      total = pdev->host.hc[num].xfer_count + pdev->host.hc[num].xfer_len;
+      packets = (total + pdev->host.hc[num].max_packet - 1) / pdev->host.hc[num].max_packet;
+      if (packets == 0)
+      {
+        packets = 1;
+      }
+      packets -= hctsiz.b.pktcnt;
+      pdev->host.XferCnt[num] = packets * pdev->host.hc[num].max_packet;
+      if (pdev->host.XferCnt[num] > total)
+      {
+        pdev->host.XferCnt[num] = total;
+      }
+      pdev->host.hc[num].xfer_len = 0;   /* nothing more for the nptxfempty interrupt */
+      pdev->host.hc[num].toggle_out = (hctsiz.b.pid == HC_PID_DATA1) ? 1 : 0;
+    }
+    
     if(pdev->host.HC_Status[num] == HC_XFRC)
     {
       pdev->host.URB_State[num] = URB_DONE;  
       
-      //if (hcchar.b.eptype == EP_TYPE_BULK)
-      if ((hcchar.b.eptype == EP_TYPE_BULK)||(hcchar.b.eptype == EP_TYPE_CTRL))//@
+      if (hcchar.b.eptype == EP_TYPE_CTRL)//@
       {
         pdev->host.hc[num].toggle_out ^= 1; 
       }
@@ -671,8 +732,16 @@ uint32_t USB_OTG_USBH_handle_hc_n_In_ISR (USB_OTG_CORE_HANDLE *pdev , uint32_t n
       UNMASK_HOST_INT_CHH (num);
       USB_OTG_HC_Halt(pdev, num);
       CLEAR_HC_INT(hcreg , nak); 
-      pdev->host.hc[num].toggle_in ^= 1;
-      
+      if (hcchar.b.eptype == EP_TYPE_BULK)
+      {
+        /* multi-packet IN: the core keeps the toggle of the next packet */
+        hctsiz.d32 = USB_OTG_READ_REG32(&hcreg->HCTSIZ);
+        pdev->host.hc[num].toggle_in = (hctsiz.b.pid == HC_PID_DATA1) ? 1 : 0;
+      }
+      else
+      {
+        pdev->host.hc[num].toggle_in ^= 1;
+      }
     }
     else if(hcchar.b.eptype == EP_TYPE_INTR)
     {
@@ -27,6 +27,7 @@
 EXT_APPTASK void AppTask_USB(void *p_arg);
 EXT_APPTASK void AppTask2_Shell(void *p_arg);
 EXT_APPTASK void AppTask3_Debug(void *p_arg);
+EXT_APPTASK void AppTask4_Prefetch(void *p_arg);
 
 EXT_APPTASK void AppTaskStart(void *p_arg);
 EXT_APPTASK	void	App_TaskIdleHook	(void);
@@ -46,6 +47,7 @@ EXT_APPTASK	void	App_TaskIdleHook	(void);
 #define TASK1_PRIO                             5
 #define TASK2_PRIO                             6
 #define TASK3_PRIO                             14	//15:统计;16;idle
+#define TASK4_PRIO                             10	//低于USB任务,读盘请求由USB任务执行
 
 /*
 *********************************************************************************************************
@@ -53,9 +55,10 @@ EXT_APPTASK	void	App_TaskIdleHook	(void);
 *********************************************************************************************************
 */
 #define TASK_START_STK_SIZE                    64
-#define TASK1_STK_SIZE                         256
-#define TASK2_STK_SIZE                         256
+#define TASK1_STK_SIZE                         512
+#define TASK2_STK_SIZE                         512
 #define TASK3_STK_SIZE                         256
+#define TASK4_STK_SIZE                         512
 
 
 /* 任务堆栈变量 */
@@ -63,6 +66,7 @@ EXT_APPTASK OS_STK TaskStartStk[TASK_START_STK_SIZE];
 EXT_APPTASK OS_STK Task1_Stk[TASK1_STK_SIZE];
 EXT_APPTASK OS_STK Task2_Stk[TASK2_STK_SIZE];
 EXT_APPTASK OS_STK Task3_Stk[TASK3_STK_SIZE];
+EXT_APPTASK OS_STK Task4_Stk[TASK4_STK_SIZE];
 
 
 EXT_APPTASK    OS_EVENT        *OSSem_USBDly;
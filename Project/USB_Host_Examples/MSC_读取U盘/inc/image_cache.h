@@ -0,0 +1,66 @@
+/**
+  ******************************************************************************
+  * @file    image_cache.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the image_cache.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMAGE_CACHE_H
+#define __IMAGE_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ff.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef IMAGE_CACHE_ENABLE
+#define IMAGE_CACHE_ENABLE          1           //0:每次都解码BMP
+#endif
+#define IMAGE_CACHE_DIR             "565"       //缓存目录,建在图片目录下
+#define IMAGE_CACHE_EXT             ".565"
+#ifndef IMAGE_CACHE_BUF_SIZE
+#define IMAGE_CACHE_BUF_SIZE        4096        //每次读写的字节数,512的倍数,共两个
+#endif
+#define IMAGE_CACHE_HEAD_SIZE       512         //文件头占第一个扇区,像素从扇区边界开始
+#define IMAGE_CACHE_MAGIC           0x35363549  //"I565"
+#define IMAGE_CACHE_PATH_SIZE       48
+
+/* Exported types ------------------------------------------------------------*/
+/* 缓存文件头: 源文件的大小和时间,以及写GRAM的blit窗口 */
+typedef struct
+{
+  uint32_t  Magic;        //转换完成后最后写入
+  uint32_t  SrcSize;
+  uint16_t  SrcDate;
+  uint16_t  SrcTime;
+  uint16_t  Xpos;         //LCD_BlitBegin的参数
+  uint16_t  Ypos;
+  uint16_t  Height;
+  uint16_t  Width;
+  uint16_t  Direction;
+  uint16_t  Reserved;
+}
+IMAGE_CACHE_HEAD_ST;
+
+/* Exported macro ------------------------------------------------------------*/
+/* 窗口中的行数(BMP的行数)和每行的点数 */
+#define IMAGE_CACHE_LINES(pHead)      (((pHead)->Direction == LCD_DIR_HORIZONTAL) ? (pHead)->Height : (pHead)->Width)
+#define IMAGE_CACHE_LINE_LEN(pHead)   (((pHead)->Direction == LCD_DIR_HORIZONTAL) ? (pHead)->Width : (pHead)->Height)
+/* BMP第Row行(自底向上)在窗口中的行号: 横图旋转后自上而下 */
+#define IMAGE_CACHE_INDEX(pHead, Row) (((pHead)->Direction == LCD_DIR_HORIZONTAL) ? ((pHead)->Height - 1 - (Row)) : (Row))
+
+/* Exported functions ------------------------------------------------------- */
+FRESULT Image_Cache_Init(const char *dir);
+uint8_t Image_Cache_Path(char *path, const char *dir, const FILINFO *fno);
+void    Image_Cache_Window(IMAGE_CACHE_HEAD_ST *pHead, uint16_t PictureWidth, uint16_t PictureHeight);
+uint8_t Image_Cache_Valid(const IMAGE_CACHE_HEAD_ST *pHead, const FILINFO *fno, DWORD Size);
+uint8_t Image_Cache_Show(const char *dir, const FILINFO *fno, uint32_t Skip);
+uint8_t Image_Cache_Open(const char *dir, const FILINFO *fno, const IMAGE_CACHE_HEAD_ST *pWin);
+void    Image_Cache_Line(uint16_t Index, const uint16_t *pLine);
+void    Image_Cache_Close(uint8_t Complete);
+
+#endif /* __IMAGE_CACHE_H */
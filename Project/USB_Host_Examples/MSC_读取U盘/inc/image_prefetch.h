@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+  * @file    image_prefetch.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   This file contains all the prototypes for the image_prefetch.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __IMAGE_PREFETCH_H
+#define __IMAGE_PREFETCH_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "ff.h"
+
+/* Exported constants --------------------------------------------------------*/
+#ifndef IMAGE_PREFETCH_ENABLE
+#define IMAGE_PREFETCH_ENABLE       1           //0:按键后才读下一幅图
+#endif
+#ifndef IMAGE_PREFETCH_EXT_SRAM
+ #if defined (USE_STM322xG_EVAL)
+  #define IMAGE_PREFETCH_EXT_SRAM   1           //使用板上FSMC SRAM(Bank1 NE2),检测不到时用片内RAM
+ #else
+  #define IMAGE_PREFETCH_EXT_SRAM   0
+ #endif
+#endif
+#define IMAGE_PREFETCH_EXT_ADDR     0x64000000
+#define IMAGE_PREFETCH_EXT_SIZE     (320 * 240 * 2)     //一整屏
+#ifndef IMAGE_PREFETCH_BUF_SIZE
+#define IMAGE_PREFETCH_BUF_SIZE     16384       //片内缓冲的字节数,512的倍数,0:没有外部SRAM时不预读
+#endif
+#define IMAGE_PREFETCH_LINE_SIZE    1280        //一行BMP, 320点32bpp
+#define IMAGE_PREFETCH_CHUNK        8192        //读缓存文件时每次的字节数,其间检查取消
+
+/* Exported functions ------------------------------------------------------- */
+void     Image_Prefetch_Init(void);
+void     Image_Prefetch_Process(void);
+uint8_t  Image_Prefetch_Start(const char *dir, const FILINFO *fno);
+uint8_t  Image_Prefetch_Busy(void);
+void     Image_Prefetch_Cancel(void);
+uint8_t  Image_Prefetch_Show(const char *dir, const FILINFO *fno);
+void     Image_Prefetch_Done(void);
+uint32_t Image_Prefetch_Time(void);
+
+#endif /* __IMAGE_PREFETCH_H */
@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+  * @file    sd_diskio.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-17
+  * @brief   This file contains all the prototypes for the sd_diskio.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SD_DISKIO_H
+#define __SD_DISKIO_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "diskio.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SD_DISK_DRV                 1           //SD卡对应的FatFs驱动器号,"1:"
+#ifndef SD_DISK_BUF_SECTORS
+#define SD_DISK_BUF_SECTORS         4           //每个DMA中转缓冲的扇区数,共两个
+#endif
+#define SD_DISK_TIMEOUT             500         //等待卡写入完成的最长时间(OS ticks)
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV SD_Disk;
+
+#endif /* __SD_DISKIO_H */
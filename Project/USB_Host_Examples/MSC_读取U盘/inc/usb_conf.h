@@ -170,6 +170,14 @@
 //#define USE_DEVICE_MODE
 //#define USE_OTG_MODE
 
+/****************** USB OTG HOST DEBUG CONFIGURATION **************************/
+/* USB_OTG_HCD_STATS : per channel URB counters and submit-to-result time,
+                       shown by the shell command USBSTAT
+   USB_OTG_HCD_FAULT : shell command USBFAULT ends the next URBs of a channel
+                       with NAK, STALL or error, without a bus transaction */
+#define USB_OTG_HCD_STATS
+// #define USB_OTG_HCD_FAULT
+
 #ifndef USB_OTG_FS_CORE
  #ifndef USB_OTG_HS_CORE
     #error  "USB_OTG_HS_CORE or USB_OTG_FS_CORE should be defined"
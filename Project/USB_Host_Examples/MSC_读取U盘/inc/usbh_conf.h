@@ -44,6 +44,8 @@
   * @{
   */ 
 
+/* The options in #ifndef are also set with -D by the PC benches of the
+   host library (Utilities/STM32_EVAL/STM322xG_EVAL/host/Makefile). */
 #define USBH_MAX_NUM_ENDPOINTS                2
 #define USBH_MAX_NUM_INTERFACES               2
 #ifdef USE_USB_OTG_FS 
@@ -52,6 +54,80 @@
 #define USBH_MSC_MPS_SIZE                 0x200
 #endif
 
+/* Host task timeouts in OS ticks, the task is normally waked up by events */
+#define USBH_IDLE_POLL_TICKS                  100   /* no device connected */
+#define USBH_BUSY_POLL_TICKS                  10    /* guards transfer time-outs */
+
+/* Fast enumeration: no busy-wait delays on attach, the serial number is read
+   right after SET_ADDRESS and a device already seen takes its configuration
+   and strings from the descriptor cache (usbh_desc_cache.c). */
+#ifndef USBH_FAST_ENUM
+#define USBH_FAST_ENUM                        1
+#endif
+#define USBH_ATTACH_DEBOUNCE_MS               100   /* USB 2.0 TATTDB */
+#define USBH_DESC_CACHE_NUM                   4
+
+/* DFU image source: 1 = read from the FatFs file USBH_DFU_FILE_NAME,
+                     0 = image already programmed in internal flash at 0x08010000
+   Either may be raw or a DFU_LZ container from Tools/dfu_pack.py, detected by
+   its header and unpacked block by block while the device is programming.
+   The file is on the stick mounted by the MSC application: with one root
+   port the stick and the MK5 are attached together only through the hub
+   (USBH_USE_HUB) and the class registry, else the DFU session waits. */
+#ifndef USBH_DFU_USE_FILE
+#define USBH_DFU_USE_FILE                     1
+#endif
+#define USBH_DFU_FILE_NAME                    "0:/MK5.bin"
+#define USBH_DFU_FILE_BUF_SIZE                0x1000
+
+/* DFU image check: a running CRC32 of the sent blocks is compared with the
+   CRC in the image header before the device is told to manifest. With
+   USBH_DFU_VERIFY the image is also read back by DFU_Req_UPLOAD when the
+   device is manifestation tolerant. */
+#ifndef USBH_DFU_CRC_MODE
+#define USBH_DFU_CRC_MODE                     USBH_DFU_CRC_HW
+#endif
+#ifndef USBH_DFU_VERIFY
+#define USBH_DFU_VERIFY                       0
+#endif
+#define USBH_DFU_VERIFY_BUF_SIZE              0x400
+
+/* Delta DFU: blocks whose CRC32 matches the device (from the manifest file or
+   a DFU_Req_UPLOAD read back) are not sent again. Only for devices that place
+   each DNLOAD block at wBlockNum * block size. */
+#ifndef USBH_DFU_DELTA
+#define USBH_DFU_DELTA                        0
+#endif
+#define USBH_DFU_DELTA_MANIFEST_NAME          "0:/MK5.man"
+#define USBH_DFU_DELTA_MAX_BLOCKS             256
+
+/* Hub: with USBH_HUB_cb registered, the DFU devices on the ports of one full
+   speed hub are flashed at the same time, one DFU session per port. Only a
+   raw image in internal flash (USBH_DFU_USE_FILE 0) is shared by the
+   sessions, a file or packed image is given to one device after the other.
+   Delta DFU is used for a directly attached device only. */
+#define USBH_USE_HUB                          1
+#define USBH_HUB_MAX_PORTS                    4
+
+/* Class drivers are picked per device from the USBH_RegisterClass table by
+   the class/subclass of its interface, so a stick (MSC) and DFU devices can
+   be served at the same time behind the hub. MSC serves one stick at a time,
+   a second one waits in HOST_CLASS_INIT until the first is removed. */
+#define USBH_MAX_CLASS_NUM                    4
+
+/* U盘扇区缓存(usbh_msc_cache.c): 缓存的扇区数(0:不使用), 其中最多几项留给FAT区 */
+#ifndef USBH_MSC_CACHE_NUM
+#define USBH_MSC_CACHE_NUM                    8
+#endif
+#define USBH_MSC_CACHE_PIN_NUM                4
+/* 连续读时一次READ10预读的扇区数, 连续写合并成一次WRITE10的扇区数(0:不使用) */
+#ifndef USBH_MSC_READ_AHEAD
+#define USBH_MSC_READ_AHEAD                   8
+#endif
+#ifndef USBH_MSC_WRITE_MERGE
+#define USBH_MSC_WRITE_MERGE                  8
+#endif
+
 /**
   * @}
   */ 
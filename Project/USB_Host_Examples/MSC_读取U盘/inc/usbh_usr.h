@@ -73,6 +73,7 @@ extern  USBH_Usr_cb_TypeDef USR_cb;
 #define USH_USR_FS_READLIST   1
 #define USH_USR_FS_WRITEFILE  2
 #define USH_USR_FS_DRAW       3
+#define USH_USR_FS_IDLE       4   /* U盘作为DFU镜像盘,挂载后不再操作 */
 /**
   * @}
   */ 
@@ -117,6 +118,7 @@ void USBH_USR_DeInit(void);
 void USBH_USR_DeviceNotSupported(void);
 void USBH_USR_UnrecoveredError(void);
 int USBH_USR_MSC_Application(void);
+void USBH_USR_MSC_BenchRequest(uint32_t kb);
 
 /**
   * @}
@@ -21,18 +21,28 @@
 #include "usbh_core.h"
 #include "usbh_usr.h"
 #include "usbh_msc_core.h"
+#include "usbh_msc_fatfs.h"
+#include "sd_diskio.h"
+#include "ff.h"
+#include "image_prefetch.h"
 #include "usbh_dfu_core.h"
+#if USBH_USE_HUB
+#include "usbh_hub.h"
+#endif
 #include "include_slef.H"
 
 /* 全局变量 ------------------------------------------------------------------*/
 OS_STK TaskStartStk[TASK_START_STK_SIZE];
 OS_STK Task1_Stk[TASK1_STK_SIZE];
 OS_STK Task2_Stk[TASK2_STK_SIZE];
+FATFS  sdfs;        //SD卡的文件系统,驱动器"1:"
 
 
 typedef struct{
     INT8U App1_Cnt;
     INT8U App2_Cnt;
+    INT32U USB_EvtCnt;  //由中断事件唤醒的次数
+    INT32U USB_TmoCnt;  //超时唤醒的次数
 }APP_ST;
 
 APP_ST App;
@@ -82,39 +92,38 @@ __ALIGN_BEGIN USBH_HOST                USB_Host __ALIGN_END;
 ***************************************************/
 void AppTask_USB(void *pdata)
 {
-    uint32_t i = 1;//debug
-	INT8U err;
+	uint32_t timeout = 0;
 	pdata = pdata;
 	
+  /* 按接口类选择类驱动,U盘与DFU设备可同时接入(经集线器),镜像直接从U盘读出下载 */
+	USBH_MSC_IO_Init();//本任务执行其它任务的U盘读写请求
+	USBH_RegisterClass(MSC_CLASS, USBH_CLASS_ANY, &USBH_MSC_cb);
+	USBH_RegisterClass(APP_SPECIFIC_CLASS, DEVICE_FIRMWARE_UPGRADE, &USBH_DFU_cb);
+#if USBH_USE_HUB
+	USBH_RegisterClass(USB_HUB_CLASS, USBH_CLASS_ANY, &USBH_HUB_cb);
+#endif
+	
   /* Init Host Library */
-	if(i){
-	  USBH_Init(&USB_OTG_Core,USB_OTG_FS_CORE_ID,&USB_Host,
-				&USBH_MSC_cb, 
-				//&HID_KEYBRD_cb, 
-				//&HID_MOUSE_cb, 
-				//&USBH_DFU_cb, 
-				&USR_cb);
-	}else{
-	  USBH_Init(&USB_OTG_Core,USB_OTG_FS_CORE_ID,&USB_Host,
-			  //&USBH_MSC_cb, 
+	USBH_Init(&USB_OTG_Core,USB_OTG_FS_CORE_ID,&USB_Host,
 			  //&HID_KEYBRD_cb, 
 			  //&HID_MOUSE_cb, 
-			  &USBH_DFU_cb, 
+			  &USBH_DFU_cb, //无匹配的接口类时使用
 			  &USR_cb);
-	}
 	
     while (1) 
 	{
-        OSSemPend(OSSem_USBDly, 1, &err);
-        /* Host Task handler */
-        USBH_Process(&USB_OTG_Core, &USB_Host);
-        
-		if(err == OS_ERR_NONE){		
-			App.App1_Cnt++;
+        /* 等待中断事件(URB完成/插拔/DFU轮询定时),状态有变化时立即再处理 */
+		if(USB_OTG_BSP_EventWait(timeout)){
+			App.USB_EvtCnt++;
 		}
-		else if(err == OS_ERR_TIMEOUT){
-			App.App1_Cnt++;
+		else if(timeout){
+			App.USB_TmoCnt++;
 		}
+        /* Host Task handler */
+        USBH_Process(&USB_OTG_Core, &USB_Host);
+        USBH_MSC_IO_Process();
+        timeout = USBH_PollTimeout(&USB_OTG_Core, &USB_Host);
+		App.App1_Cnt++;
     }
 }
 
@@ -175,6 +184,24 @@ void AppTask3_Debug(void *pdata)
 }
 
 
+/**************************************************
+函数名称 ： AppTask4_Prefetch
+功    能 ： 图片浏览时预读下一幅图
+参    数 ： p_arg --- 可选参数
+返 回 值 ： 无
+作    者 ： zb
+***************************************************/
+void AppTask4_Prefetch(void *pdata)
+{
+	pdata = pdata;
+
+    while (1) 
+	{
+        Image_Prefetch_Process();   //等待预读请求
+    }
+}
+
+
 /**************************************************
 函数名称 ： OSTick_Init
 功    能 ： 操作系统滴答时钟初始化
@@ -210,6 +237,11 @@ void AppTaskStart(void *p_arg)
 	#if (OS_TASK_STAT_EN > 0)
 	OSStatInit();    //CPU使用率
 	#endif
+	/* 驱动器0:U盘,驱动器1:SD卡,SD卡在第一次访问"1:"时初始化 */
+	disk_attach(0, &USBH_MSC_Disk);
+	disk_attach(SD_DISK_DRV, &SD_Disk);
+	f_mount(SD_DISK_DRV, &sdfs);
+	Image_Prefetch_Init();	//选择预读缓冲,FSMC SRAM优先
 	/* 创建任务1 */
 	OSTaskCreateExt((void (*)(void *)) AppTask_USB,
 				  (void           *) 0,
@@ -243,6 +275,17 @@ void AppTaskStart(void *p_arg)
 				  (void           *) 0,
 				  (INT16U          )(OS_TASK_OPT_STK_CHK | OS_TASK_OPT_STK_CLR));
 
+	/* 创建任务4 */
+	OSTaskCreateExt((void (*)(void *)) AppTask4_Prefetch,
+				  (void           *) 0,
+				  (OS_STK         *)&Task4_Stk[TASK4_STK_SIZE-1],
+				  (INT8U           ) TASK4_PRIO,
+				  (INT16U          ) TASK4_PRIO,
+				  (OS_STK         *)&Task4_Stk[0],
+				  (INT32U          ) TASK4_STK_SIZE,
+				  (void           *) 0,
+				  (INT16U          )(OS_TASK_OPT_STK_CHK | OS_TASK_OPT_STK_CLR));
+
   
 	OSSem_USBDly     = OSSemCreate(0);
 	//OSSem_UCOMM      = OSSemCreate(0);
@@ -0,0 +1,403 @@
+/**
+  ******************************************************************************
+  * @file    image_cache.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   RGB565 cache of the BMP pictures on the stick.
+  *          The first view of a picture writes its pixels, already rotated
+  *          for the panel, to <dir>/565/<name>.565: a 512 byte header with
+  *          the size and time of the BMP and the blit window, then the
+  *          pixels in the order of the window. The file is preallocated as
+  *          one run of clusters and written in IMAGE_CACHE_BUF_SIZE blocks
+  *          at multiples of IMAGE_CACHE_BUF_SIZE, so no block crosses a
+  *          cluster. A later view opens one blit window and streams the
+  *          file to GRAM with multi-sector reads, the next block is read
+  *          while the DMA writes the previous one.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "lcd_log_conf.h"
+#include "image_cache.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CACHE_NO_BLOCK      0xFFFFFFFF
+
+/* 第一块要放下文件头和一行(最多320点) */
+#if (IMAGE_CACHE_BUF_SIZE % 512) || (IMAGE_CACHE_BUF_SIZE < 2048)
+#error IMAGE_CACHE_BUF_SIZE must be a multiple of 512, at least 2048
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static FIL Cache_File;
+static uint32_t Cache_Buf[2][IMAGE_CACHE_BUF_SIZE / 4];   //字对齐,供USB和LCD DMA使用
+
+/* 正在生成的缓存文件 */
+static struct
+{
+  uint8_t   Open;
+  IMAGE_CACHE_HEAD_ST Head;
+  uint32_t  LineBytes;    //一行(窗口的一行或一列)的字节数
+  uint32_t  End;          //文件大小
+  uint32_t  Block;        //Cache_Buf[0]中的块在文件中的位置
+  char      Path[IMAGE_CACHE_PATH_SIZE];
+} Cache;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Image_Cache_Path
+  *         <dir>/565/<name>.565 of a BMP of dir
+  * @param  path: result, IMAGE_CACHE_PATH_SIZE bytes
+  * @retval 0: the name is too long
+  */
+uint8_t Image_Cache_Path(char *path, const char *dir, const FILINFO *fno)
+{
+  const char *dot;
+  uint32_t len;
+
+  dot = strchr(fno->fname, '.');
+  len = dot ? (uint32_t)(dot - fno->fname) : strlen(fno->fname);
+  if(strlen(dir) + sizeof("/" IMAGE_CACHE_DIR "/" IMAGE_CACHE_EXT) + len > IMAGE_CACHE_PATH_SIZE)
+  {
+    return 0;
+  }
+  strcpy(path, dir);
+  strcat(path, "/" IMAGE_CACHE_DIR "/");
+  strncat(path, fno->fname, len);
+  strcat(path, IMAGE_CACHE_EXT);
+  return 1;
+}
+
+/**
+  * @brief  Image_Cache_Abort
+  *         Drops the cache file being written
+  * @param  None
+  * @retval None
+  */
+static void Image_Cache_Abort(void)
+{
+  f_close(&Cache_File);
+  f_unlink(Cache.Path);
+  Cache.Open = 0;
+}
+
+/**
+  * @brief  Image_Cache_Flush
+  *         Writes the block of Cache_Buf[0] to its place in the file
+  * @param  None
+  * @retval None
+  */
+static void Image_Cache_Flush(void)
+{
+  UINT len, bw;
+
+  if(Cache.Block == CACHE_NO_BLOCK)
+  {
+    return;
+  }
+  len = Cache.End - Cache.Block;
+  if(len > IMAGE_CACHE_BUF_SIZE)
+  {
+    len = IMAGE_CACHE_BUF_SIZE;
+  }
+  /* 块从扇区边界开始,整扇区由f_write直接写U盘 */
+  if((f_lseek(&Cache_File, Cache.Block) != FR_OK) ||
+     (f_write(&Cache_File, Cache_Buf[0], len, &bw) != FR_OK) || (bw != len))
+  {
+    Image_Cache_Abort();
+  }
+  Cache.Block = CACHE_NO_BLOCK;
+}
+
+/**
+  * @brief  Image_Cache_Load
+  *         Takes Cache_Buf[0] for the block at Block
+  * @param  Block: position in the file, multiple of IMAGE_CACHE_BUF_SIZE
+  * @retval None
+  */
+static void Image_Cache_Load(uint32_t Block)
+{
+  Cache.Block = Block;
+  if(Block == 0)
+  {
+    memset(Cache_Buf[0], 0, IMAGE_CACHE_HEAD_SIZE);   //文件头最后写
+  }
+}
+
+/**
+  * @brief  Image_Cache_Copy
+  *         Copies the part of [Start, End) of the file inside the block
+  * @param  pSrc: bytes of Start
+  * @retval None
+  */
+static void Image_Cache_Copy(uint32_t Start, uint32_t End, const uint8_t *pSrc)
+{
+  uint32_t s, e;
+
+  s = (Start > Cache.Block) ? Start : Cache.Block;
+  e = (End < Cache.Block + IMAGE_CACHE_BUF_SIZE) ? End : (Cache.Block + IMAGE_CACHE_BUF_SIZE);
+  if(s < e)
+  {
+    memcpy((uint8_t *)Cache_Buf[0] + (s - Cache.Block), pSrc + (s - Start), e - s);
+  }
+}
+
+/**
+  * @brief  Image_Cache_Window
+  *         Blit window of a whole picture: the line of a portrait picture
+  *         is a column of the screen, a landscape picture is turned by 90
+  *         degrees. What does not fit on the screen is cut.
+  * @param  pHead: Xpos, Ypos, Height, Width and Direction are set
+  * @param  PictureWidth, PictureHeight: size of the BMP, at most 320
+  * @retval None
+  */
+void Image_Cache_Window(IMAGE_CACHE_HEAD_ST *pHead, uint16_t PictureWidth, uint16_t PictureHeight)
+{
+  pHead->Ypos = 0;
+  if(PictureWidth < PictureHeight)
+  {
+    pHead->Xpos = 0;
+    pHead->Height = (PictureWidth > LCD_PIXEL_HEIGHT) ? LCD_PIXEL_HEIGHT : PictureWidth;
+    pHead->Width = PictureHeight;
+    pHead->Direction = LCD_DIR_VERTICAL;
+  }
+  else
+  {
+    pHead->Height = (PictureHeight > LCD_PIXEL_HEIGHT) ? LCD_PIXEL_HEIGHT : PictureHeight;
+    pHead->Width = PictureWidth;
+    pHead->Xpos = LCD_PIXEL_HEIGHT - pHead->Height;
+    pHead->Direction = LCD_DIR_HORIZONTAL;
+  }
+}
+
+/**
+  * @brief  Image_Cache_Valid
+  *         Checks a cache header against the BMP
+  * @param  pHead: header read from the cache file
+  * @param  fno: the BMP, from f_readdir
+  * @param  Size: size of the cache file
+  * @retval 1: the cache holds this version of the BMP
+  */
+uint8_t Image_Cache_Valid(const IMAGE_CACHE_HEAD_ST *pHead, const FILINFO *fno, DWORD Size)
+{
+  return (pHead->Magic == IMAGE_CACHE_MAGIC) && (pHead->SrcSize == fno->fsize) &&
+         (pHead->SrcDate == fno->fdate) && (pHead->SrcTime == fno->ftime) &&
+         pHead->Height && pHead->Width &&
+         (pHead->Xpos + pHead->Height <= LCD_PIXEL_HEIGHT) &&
+         (pHead->Ypos + pHead->Width <= LCD_PIXEL_WIDTH) &&
+         (Size == IMAGE_CACHE_HEAD_SIZE + (DWORD)pHead->Height * pHead->Width * 2);
+}
+
+/**
+  * @brief  Image_Cache_Init
+  *         Creates the cache directory of a picture directory
+  * @param  dir: picture directory, "0:/Media"
+  * @retval FR_OK if the directory is there
+  */
+FRESULT Image_Cache_Init(const char *dir)
+{
+  char path[IMAGE_CACHE_PATH_SIZE];
+  FRESULT res;
+
+  if(strlen(dir) + sizeof("/" IMAGE_CACHE_DIR) > IMAGE_CACHE_PATH_SIZE)
+  {
+    return FR_INVALID_NAME;
+  }
+  strcpy(path, dir);
+  strcat(path, "/" IMAGE_CACHE_DIR);
+  res = f_mkdir(path);
+  return (res == FR_EXIST) ? FR_OK : res;
+}
+
+/**
+  * @brief  Image_Cache_Show
+  *         Displays a picture from its cache file
+  * @param  dir: picture directory
+  * @param  fno: the BMP, from f_readdir
+  * @param  Skip: 0, or the pixel bytes already written to the blit window
+  *         opened by the caller (a prefetched start of the picture)
+  * @retval 1: displayed, 0: no valid cache, the BMP must be decoded
+  */
+uint8_t Image_Cache_Show(const char *dir, const FILINFO *fno, uint32_t Skip)
+{
+  IMAGE_CACHE_HEAD_ST *pHead;
+  char path[IMAGE_CACHE_PATH_SIZE];
+  FRESULT res;
+  UINT br, n;
+  DWORD pos;
+  uint8_t *p;
+  uint8_t i;
+
+  if(!Image_Cache_Path(path, dir, fno) ||
+     (f_open(&Cache_File, path, FA_OPEN_EXISTING | FA_READ) != FR_OK))
+  {
+    return 0;
+  }
+
+  /* 第一块: 文件头和开始的像素 */
+  res = f_read(&Cache_File, Cache_Buf[0], IMAGE_CACHE_BUF_SIZE, &br);
+  pHead = (IMAGE_CACHE_HEAD_ST *)Cache_Buf[0];
+  if((res != FR_OK) || (br <= IMAGE_CACHE_HEAD_SIZE) ||
+     !Image_Cache_Valid(pHead, fno, Cache_File.fsize) ||
+     (IMAGE_CACHE_HEAD_SIZE + Skip > Cache_File.fsize))
+  {
+    /* BMP已改变或转换未完成,重新生成 */
+    f_close(&Cache_File);
+    return 0;
+  }
+
+  if(Skip == 0)
+  {
+    LCD_BlitBegin(pHead->Xpos, pHead->Ypos, pHead->Height, pHead->Width, (uint8_t)pHead->Direction);
+  }
+  pos = IMAGE_CACHE_HEAD_SIZE + Skip;
+  if(pos < br)
+  {
+    p = (uint8_t *)Cache_Buf[0] + pos;
+    n = br - pos;
+    pos = br;
+  }
+  else
+  {
+    /* 预读的部分超出第一块 */
+    res = f_lseek(&Cache_File, pos);
+    n = 0;
+  }
+  for(i = 0; res == FR_OK; )
+  {
+    if(n)
+    {
+      LCD_BlitWrite((const uint16_t *)p, n / 2);
+    }
+    /* DMA写这一块时读下一块, 读到块边界为止 */
+    i ^= 1;
+    res = f_read(&Cache_File, Cache_Buf[i], IMAGE_CACHE_BUF_SIZE - pos % IMAGE_CACHE_BUF_SIZE, &n);
+    if(!n)
+    {
+      break;
+    }
+    p = (uint8_t *)Cache_Buf[i];
+    pos += n;
+  }
+  LCD_BlitEnd();
+  f_close(&Cache_File);
+  return (res == FR_OK);
+}
+
+/**
+  * @brief  Image_Cache_Open
+  *         Starts the cache file of a picture, its lines are then given by
+  *         Image_Cache_Line while it is decoded
+  * @param  dir: picture directory
+  * @param  fno: the BMP, from f_readdir
+  * @param  pWin: blit window of the picture, from Image_Cache_Window
+  * @retval 1: the cache file is written
+  */
+uint8_t Image_Cache_Open(const char *dir, const FILINFO *fno, const IMAGE_CACHE_HEAD_ST *pWin)
+{
+  if(Cache.Open)
+  {
+    Image_Cache_Abort();
+  }
+  if(!Image_Cache_Path(Cache.Path, dir, fno) ||
+     (f_open(&Cache_File, Cache.Path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK))
+  {
+    return 0;
+  }
+
+  memset(&Cache.Head, 0, sizeof(Cache.Head));
+  Cache.Head.SrcSize = fno->fsize;
+  Cache.Head.SrcDate = fno->fdate;
+  Cache.Head.SrcTime = fno->ftime;
+  Cache.Head.Xpos = pWin->Xpos;
+  Cache.Head.Ypos = pWin->Ypos;
+  Cache.Head.Height = pWin->Height;
+  Cache.Head.Width = pWin->Width;
+  Cache.Head.Direction = pWin->Direction;
+  Cache.LineBytes = 2 * IMAGE_CACHE_LINE_LEN(pWin);
+  Cache.End = IMAGE_CACHE_HEAD_SIZE + (uint32_t)pWin->Height * pWin->Width * 2;
+  Cache.Block = CACHE_NO_BLOCK;
+  Cache.Open = 1;
+
+#if _USE_PREALLOC
+  /* 连续的簇,读时不用查FAT; 没有足够的连续空间时照常按簇分配 */
+  f_prealloc(&Cache_File, Cache.End);
+#endif
+  return 1;
+}
+
+/**
+  * @brief  Image_Cache_Line
+  *         Puts a line of the window in the cache file. The lines may come
+  *         in increasing or decreasing order (a BMP is stored bottom-up).
+  * @param  Index: line of the window, in the blit direction
+  * @param  pLine: its pixels
+  * @retval None
+  */
+void Image_Cache_Line(uint16_t Index, const uint16_t *pLine)
+{
+  uint32_t start, end, next;
+
+  if(!Cache.Open)
+  {
+    return;
+  }
+  start = IMAGE_CACHE_HEAD_SIZE + Index * Cache.LineBytes;
+  end = start + Cache.LineBytes;
+  if(Cache.Block == CACHE_NO_BLOCK)
+  {
+    /* 第一行: 第0行在块0中, 最后一行在最后一块开始 */
+    Image_Cache_Load((end - 1) - (end - 1) % IMAGE_CACHE_BUF_SIZE);
+  }
+  /* 先写当前块中的部分, 跨块的行再换到相邻的块; 离开的块已经写满 */
+  Image_Cache_Copy(start, end, (const uint8_t *)pLine);
+  if((start < Cache.Block) || (end > Cache.Block + IMAGE_CACHE_BUF_SIZE))
+  {
+    next = (start < Cache.Block) ? (Cache.Block - IMAGE_CACHE_BUF_SIZE) : (Cache.Block + IMAGE_CACHE_BUF_SIZE);
+    Image_Cache_Flush();
+    if(!Cache.Open)
+    {
+      return;
+    }
+    Image_Cache_Load(next);
+    Image_Cache_Copy(start, end, (const uint8_t *)pLine);
+  }
+}
+
+/**
+  * @brief  Image_Cache_Close
+  *         Ends the cache file, the header makes it valid
+  * @param  Complete: 1 if every line was given, else the file is deleted
+  * @retval None
+  */
+void Image_Cache_Close(uint8_t Complete)
+{
+  UINT bw;
+
+  if(!Cache.Open)
+  {
+    return;
+  }
+  if(!Complete)
+  {
+    Image_Cache_Abort();
+    return;
+  }
+  Image_Cache_Flush();
+  if(!Cache.Open)
+  {
+    return;
+  }
+  Cache.Head.Magic = IMAGE_CACHE_MAGIC;
+  if((f_lseek(&Cache_File, 0) != FR_OK) ||
+     (f_write(&Cache_File, &Cache.Head, sizeof(Cache.Head), &bw) != FR_OK) ||
+     (bw != sizeof(Cache.Head)) || (f_close(&Cache_File) != FR_OK))
+  {
+    Image_Cache_Abort();
+    return;
+  }
+  Cache.Open = 0;
+}
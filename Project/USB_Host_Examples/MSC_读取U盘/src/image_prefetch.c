@@ -0,0 +1,407 @@
+/**
+  ******************************************************************************
+  * @file    image_prefetch.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Prefetch of the next picture of the image browser.
+  *          While a picture is shown, the prefetch task reads the next one
+  *          into a second frame buffer, in the order of its blit window:
+  *          from its RGB565 cache when valid, else the BMP is decoded. The
+  *          disk requests of the task are served by the USB host task,
+  *          which keeps serving them while it waits for the key. The next
+  *          picture is then one blit from the buffer.
+  *
+  *          The buffer is the FSMC SRAM of the board when it answers, else
+  *          IMAGE_PREFETCH_BUF_SIZE bytes of internal RAM. A cached picture
+  *          larger than the buffer is prefetched in part, the rest is read
+  *          from its cache file when shown; a BMP without cache that does
+  *          not fit is not prefetched.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ucos_ii.h"
+#include "lcd_log_conf.h"
+#include "lcd_pixconv.h"
+#include "image_cache.h"
+#include "image_prefetch.h"
+#if IMAGE_PREFETCH_EXT_SRAM
+#include "stm322xg_eval_fsmc_sram.h"
+#endif
+#include "include_slef.H"
+#include "xprintf.h"
+
+/* Private define ------------------------------------------------------------*/
+#define PF_IDLE             0
+#define PF_BUSY             1           //预读任务在读
+#define PF_READY            2           //缓冲中是Pf.Fno
+#define PF_NONE             3           //这幅图没有预读
+
+#define PF_BMP_HEAD_SIZE    54
+
+#if (IMAGE_PREFETCH_BUF_SIZE % 512)
+#error IMAGE_PREFETCH_BUF_SIZE must be a multiple of 512
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static FIL Pf_File;
+static uint32_t Pf_Line[IMAGE_PREFETCH_LINE_SIZE / 4];   //字对齐,转换时按字读
+#if IMAGE_PREFETCH_BUF_SIZE
+static uint32_t Pf_IntBuf[IMAGE_PREFETCH_BUF_SIZE / 4];
+#endif
+static uint16_t *Pf_Buf;
+static uint32_t Pf_Size;                //缓冲字节数,0:不预读
+
+static struct
+{
+  OS_EVENT *Start;                      //预读请求
+  volatile uint8_t State;               //PF_xxx
+  volatile uint8_t Cancel;
+  uint8_t   Cached;                     //1:读自缓存文件, 0:由BMP转换
+  FILINFO   Fno;
+  char      Dir[IMAGE_CACHE_PATH_SIZE];
+  IMAGE_CACHE_HEAD_ST Win;              //图的blit窗口
+  uint32_t  Bytes;                      //缓冲中的像素字节数
+  uint32_t  Ms;                         //预读用的时间
+} Pf;
+
+/* Private functions ---------------------------------------------------------*/
+
+#if IMAGE_PREFETCH_EXT_SRAM
+/**
+  * @brief  Image_Prefetch_SRAMTest
+  *         Writes and reads back a pattern over the buffer, no SRAM on the
+  *         bus reads back garbage
+  * @param  p: start of the SRAM
+  * @param  Num: halfwords
+  * @retval 1: the SRAM answers
+  */
+static uint8_t Image_Prefetch_SRAMTest(volatile uint16_t *p, uint32_t Num)
+{
+  uint32_t i;
+
+  /* 步长为奇数,每条数据线和地址线都会变化 */
+  for(i = 0; i < Num; i += 509)
+  {
+    p[i] = (uint16_t)(i * 0x9E37 + 0x5AA5);
+  }
+  p[Num - 1] = 0x55AA;
+  for(i = 0; i < Num; i += 509)
+  {
+    if(p[i] != (uint16_t)(i * 0x9E37 + 0x5AA5))
+    {
+      return 0;
+    }
+  }
+  return (p[Num - 1] == 0x55AA);
+}
+#endif
+
+/**
+  * @brief  Image_Prefetch_Same
+  * @retval 1: fno is the picture of the prefetch buffer
+  */
+static uint8_t Image_Prefetch_Same(const char *dir, const FILINFO *fno)
+{
+  return (strcmp(Pf.Dir, dir) == 0) && (strcmp(Pf.Fno.fname, fno->fname) == 0) &&
+         (Pf.Fno.fsize == fno->fsize) && (Pf.Fno.fdate == fno->fdate) && (Pf.Fno.ftime == fno->ftime);
+}
+
+#if IMAGE_CACHE_ENABLE
+/**
+  * @brief  Image_Prefetch_LoadCache
+  *         Reads the start of the cache file of the picture, as much as the
+  *         buffer holds
+  * @param  None
+  * @retval 1: read, 0: no valid cache
+  */
+static uint8_t Image_Prefetch_LoadCache(void)
+{
+  char path[IMAGE_CACHE_PATH_SIZE];
+  uint32_t total, n;
+  FRESULT res;
+  UINT br;
+
+  if(!Image_Cache_Path(path, Pf.Dir, &Pf.Fno) ||
+     (f_open(&Pf_File, path, FA_OPEN_EXISTING | FA_READ) != FR_OK))
+  {
+    return 0;
+  }
+  res = f_read(&Pf_File, &Pf.Win, sizeof(Pf.Win), &br);
+  if((res != FR_OK) || (br != sizeof(Pf.Win)) || !Image_Cache_Valid(&Pf.Win, &Pf.Fno, Pf_File.fsize))
+  {
+    f_close(&Pf_File);
+    return 0;
+  }
+
+  total = (uint32_t)Pf.Win.Height * Pf.Win.Width * 2;
+  Pf.Bytes = (total < Pf_Size) ? total : Pf_Size;
+  res = f_lseek(&Pf_File, IMAGE_CACHE_HEAD_SIZE);
+  /* 像素从扇区边界开始,整扇区直接读到缓冲; 每次读到块边界为止 */
+  for(n = 0; (n < Pf.Bytes) && (res == FR_OK) && !Pf.Cancel; n += br)
+  {
+    br = IMAGE_PREFETCH_CHUNK - (IMAGE_CACHE_HEAD_SIZE + n) % IMAGE_PREFETCH_CHUNK;
+    if(br > Pf.Bytes - n)
+    {
+      br = Pf.Bytes - n;
+    }
+    res = f_read(&Pf_File, (uint8_t *)Pf_Buf + n, br, &br);
+    if(!br)
+    {
+      break;
+    }
+  }
+  f_close(&Pf_File);
+  Pf.Cached = 1;
+  return (n == Pf.Bytes);
+}
+#endif
+
+/**
+  * @brief  Image_Prefetch_LoadBMP
+  *         Converts the whole BMP into the buffer
+  * @param  None
+  * @retval 1: converted, 0: error, or the picture does not fit
+  */
+static uint8_t Image_Prefetch_LoadBMP(void)
+{
+  char path[IMAGE_CACHE_PATH_SIZE];
+  const uint8_t *pHead = (const uint8_t *)Pf_Line;
+  uint16_t PictureWidth, PictureHeight, PictureBitsPerPixel;
+  uint16_t Row, Lines, Len, LineSize;
+  FRESULT res;
+  UINT br;
+
+  if(strlen(Pf.Dir) + 1 + strlen(Pf.Fno.fname) >= sizeof(path))
+  {
+    return 0;
+  }
+  strcpy(path, Pf.Dir);
+  strcat(path, "/");
+  strcat(path, Pf.Fno.fname);
+  if(f_open(&Pf_File, path, FA_OPEN_EXISTING | FA_READ) != FR_OK)
+  {
+    return 0;
+  }
+
+  res = f_read(&Pf_File, Pf_Line, PF_BMP_HEAD_SIZE, &br);
+  PictureWidth = (pHead[0x13] << 8) | pHead[0x12];
+  PictureHeight = (pHead[0x17] << 8) | pHead[0x16];
+  PictureBitsPerPixel = (pHead[0x1D] << 8) | pHead[0x1C];
+  if((res != FR_OK) || (br != PF_BMP_HEAD_SIZE) ||
+     (PictureWidth > 320) || (PictureHeight > 320) ||
+     ((PictureBitsPerPixel != 16) && (PictureBitsPerPixel != 24) && (PictureBitsPerPixel != 32)))
+  {
+    f_close(&Pf_File);
+    return 0;
+  }
+
+  memset(&Pf.Win, 0, sizeof(Pf.Win));
+  Image_Cache_Window(&Pf.Win, PictureWidth, PictureHeight);
+  Pf.Bytes = (uint32_t)Pf.Win.Height * Pf.Win.Width * 2;
+  if(Pf.Bytes > Pf_Size)
+  {
+    /* 放不下: 显示时照常解码 */
+    f_close(&Pf_File);
+    return 0;
+  }
+
+  Lines = IMAGE_CACHE_LINES(&Pf.Win);
+  Len = IMAGE_CACHE_LINE_LEN(&Pf.Win);
+  LineSize = (PictureWidth * (PictureBitsPerPixel / 8) + 3) & ~3;   /* BMP每行按4字节对齐 */
+  for(Row = 0; (Row < Lines) && !Pf.Cancel; Row++)
+  {
+    res = f_read(&Pf_File, Pf_Line, LineSize, &br);
+    if((res != FR_OK) || (br < Len * (PictureBitsPerPixel / 8)))
+    {
+      break;
+    }
+    LCD_PixConv_Line(Pf_Buf + (uint32_t)IMAGE_CACHE_INDEX(&Pf.Win, Row) * Len, 1,
+                     (const uint8_t *)Pf_Line, Len, PictureBitsPerPixel);
+  }
+  f_close(&Pf_File);
+  Pf.Cached = 0;
+  return (Row == Lines);
+}
+
+/**
+  * @brief  Image_Prefetch_Init
+  *         Chooses the prefetch buffer, called before the tasks start
+  * @param  None
+  * @retval None
+  */
+void Image_Prefetch_Init(void)
+{
+  Pf.State = PF_IDLE;
+  Pf.Start = OSSemCreate(0);
+  Pf_Size = 0;
+#if IMAGE_PREFETCH_EXT_SRAM
+  SRAM_Init();
+  if(Image_Prefetch_SRAMTest((volatile uint16_t *)IMAGE_PREFETCH_EXT_ADDR, IMAGE_PREFETCH_EXT_SIZE / 2))
+  {
+    Pf_Buf = (uint16_t *)IMAGE_PREFETCH_EXT_ADDR;
+    Pf_Size = IMAGE_PREFETCH_EXT_SIZE;
+  }
+#endif
+#if IMAGE_PREFETCH_BUF_SIZE
+  if(Pf_Size == 0)
+  {
+    Pf_Buf = (uint16_t *)Pf_IntBuf;
+    Pf_Size = IMAGE_PREFETCH_BUF_SIZE;
+  }
+#endif
+  DUG_PRINTF("\n Image prefetch buffer: %d KB %s\n", Pf_Size / 1024,
+             (Pf_Buf == (uint16_t *)IMAGE_PREFETCH_EXT_ADDR) ? "FSMC SRAM" : "internal");
+}
+
+/**
+  * @brief  Image_Prefetch_Process
+  *         Body of the prefetch task: waits for a request and reads the
+  *         picture into the buffer
+  * @param  None
+  * @retval None
+  */
+void Image_Prefetch_Process(void)
+{
+  uint32_t tick;
+  uint8_t ok;
+  INT8U err;
+
+  OSSemPend(Pf.Start, 0, &err);
+  if(err != OS_ERR_NONE)
+  {
+    return;
+  }
+  tick = RTC_SysTickGetSum();
+  ok = 0;
+#if IMAGE_CACHE_ENABLE
+  ok = Image_Prefetch_LoadCache();
+#endif
+  if(!ok && !Pf.Cancel)
+  {
+    ok = Image_Prefetch_LoadBMP();
+  }
+  Pf.Ms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+  Pf.State = (ok && !Pf.Cancel) ? PF_READY : PF_NONE;
+}
+
+/**
+  * @brief  Image_Prefetch_Start
+  *         Asks the prefetch task for the next picture
+  * @param  dir: picture directory
+  * @param  fno: the BMP, from f_readdir
+  * @retval 1: started, 0: no buffer or the last one is still read
+  */
+uint8_t Image_Prefetch_Start(const char *dir, const FILINFO *fno)
+{
+  if((Pf.Start == (OS_EVENT *)0) || !Pf_Size || (Pf.State == PF_BUSY) ||
+     (strlen(dir) >= sizeof(Pf.Dir)))
+  {
+    return 0;
+  }
+  strcpy(Pf.Dir, dir);
+  Pf.Fno = *fno;
+#if _USE_LFN
+  Pf.Fno.lfname = 0;
+  Pf.Fno.lfsize = 0;
+#endif
+  Pf.Cancel = 0;
+  Pf.State = PF_BUSY;
+  OSSemPost(Pf.Start);
+  return 1;
+}
+
+/**
+  * @brief  Image_Prefetch_Busy
+  * @retval 1: the prefetch task is reading
+  */
+uint8_t Image_Prefetch_Busy(void)
+{
+  return (Pf.State == PF_BUSY);
+}
+
+/**
+  * @brief  Image_Prefetch_Cancel
+  *         Asks the prefetch task to stop, it is idle once
+  *         Image_Prefetch_Busy returns 0
+  * @param  None
+  * @retval None
+  */
+void Image_Prefetch_Cancel(void)
+{
+  Pf.Cancel = 1;
+}
+
+/**
+  * @brief  Image_Prefetch_Show
+  *         Displays the picture from the prefetch buffer
+  * @param  dir: picture directory
+  * @param  fno: the BMP, from f_readdir
+  * @retval 1: displayed, 0: not prefetched
+  */
+uint8_t Image_Prefetch_Show(const char *dir, const FILINFO *fno)
+{
+  if((Pf.State != PF_READY) || !Image_Prefetch_Same(dir, fno))
+  {
+    return 0;
+  }
+
+  LCD_BlitBegin(Pf.Win.Xpos, Pf.Win.Ypos, Pf.Win.Height, Pf.Win.Width, (uint8_t)Pf.Win.Direction);
+  LCD_BlitWrite(Pf_Buf, Pf.Bytes / 2);
+  if(Pf.Bytes < (uint32_t)Pf.Win.Height * Pf.Win.Width * 2)
+  {
+#if IMAGE_CACHE_ENABLE
+    /* 缓冲只放下开始的部分, 其余从缓存文件读 */
+    if(Image_Cache_Show(dir, fno, Pf.Bytes))
+    {
+      return 1;
+    }
+#endif
+    LCD_BlitEnd();
+    Pf.State = PF_IDLE;
+    return 0;
+  }
+  LCD_BlitEnd();
+  return 1;
+}
+
+/**
+  * @brief  Image_Prefetch_Done
+  *         Frees the buffer after Image_Prefetch_Show. A picture decoded
+  *         from its BMP is first written to its RGB565 cache.
+  * @param  None
+  * @retval None
+  */
+void Image_Prefetch_Done(void)
+{
+#if IMAGE_CACHE_ENABLE
+  uint16_t Index, Lines, Len;
+
+  if((Pf.State == PF_READY) && !Pf.Cached &&
+     Image_Cache_Open(Pf.Dir, &Pf.Fno, &Pf.Win))
+  {
+    Lines = IMAGE_CACHE_LINES(&Pf.Win);
+    Len = IMAGE_CACHE_LINE_LEN(&Pf.Win);
+    for(Index = 0; Index < Lines; Index++)
+    {
+      Image_Cache_Line(Index, Pf_Buf + (uint32_t)Index * Len);
+    }
+    Image_Cache_Close(1);
+  }
+#endif
+  if(Pf.State != PF_BUSY)
+  {
+    Pf.State = PF_IDLE;
+  }
+}
+
+/**
+  * @brief  Image_Prefetch_Time
+  * @retval ms the prefetch task took for the last picture
+  */
+uint32_t Image_Prefetch_Time(void)
+{
+  return Pf.Ms;
+}
@@ -0,0 +1,280 @@
+/**
+  ******************************************************************************
+  * @file    sd_diskio.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-17
+  * @brief   FatFs backend of the SD card on SDIO (drive 1)
+  *          Multi-block transfers by DMA. The DMA needs word aligned
+  *          buffers: other buffers go through two aligned buffers, the CPU
+  *          copies one while the DMA fills or empties the other.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "stm322xg_eval_sdio_sd.h"
+#include "ucos_ii.h"
+#include "sd_diskio.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SD_SECTOR_SIZE      512
+/* 驱动以字节地址调用SD_xxxMultiBlocks,高容量卡只用前4GB */
+#define SD_MAX_SECTORS      ((DWORD)0xFFFFFFFF / SD_SECTOR_SIZE)
+
+/* Private variables ---------------------------------------------------------*/
+extern SD_CardInfo SDCardInfo;
+
+static volatile DSTATUS Stat = STA_NOINIT;
+static uint32_t SD_Buf[2][SD_DISK_BUF_SECTORS * SD_SECTOR_SIZE / 4];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  SD_NVIC_Config
+  *         SDIO and SDIO DMA interrupts, used by SD_WaitRead/WriteOperation
+  * @param  None
+  * @retval None
+  */
+static void SD_NVIC_Config(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+  
+  NVIC_InitStructure.NVIC_IRQChannel = SDIO_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+  
+  NVIC_InitStructure.NVIC_IRQChannel = SD_SDIO_DMA_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+  NVIC_Init(&NVIC_InitStructure);
+}
+
+/**
+  * @brief  SD_WaitReady
+  *         Wait until the card has finished programming
+  * @param  None
+  * @retval RES_OK or RES_ERROR on timeout
+  */
+static DRESULT SD_WaitReady(void)
+{
+  uint32_t tmr;
+  
+  for (tmr = 0; SD_GetStatus() != SD_TRANSFER_OK; tmr++)
+  {
+    if (tmr >= SD_DISK_TIMEOUT) return RES_ERROR;
+    OSTimeDly(1);
+  }
+  return RES_OK;
+}
+
+/**
+  * @brief  SD_ReadDMA
+  *         One CMD18, the DMA writes to buff
+  * @param  buff : word aligned
+  * @retval RES_OK or RES_ERROR
+  */
+static DRESULT SD_ReadDMA(BYTE *buff, DWORD sector, BYTE count)
+{
+  if (SD_ReadMultiBlocks(buff, sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, count) != SD_OK) return RES_ERROR;
+  if (SD_WaitReadOperation() != SD_OK) return RES_ERROR;
+  return SD_WaitReady();
+}
+
+/**
+  * @brief  SD_WriteDMA
+  *         One CMD25, the DMA reads from buff
+  * @param  buff : word aligned
+  * @retval RES_OK or RES_ERROR
+  */
+static DRESULT SD_WriteDMA(const BYTE *buff, DWORD sector, BYTE count)
+{
+  if (SD_WriteMultiBlocks((uint8_t *)buff, sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, count) != SD_OK) return RES_ERROR;
+  if (SD_WaitWriteOperation() != SD_OK) return RES_ERROR;
+  return SD_WaitReady();
+}
+
+/**
+  * @brief  SD_disk_initialize
+  * @param  None
+  * @retval DSTATUS
+  */
+static DSTATUS SD_disk_initialize(void)
+{
+  static uint8_t nvic = 0;
+  
+  if (!nvic)
+  {
+    SD_NVIC_Config();
+    nvic = 1;
+  }
+  
+  if (SD_Detect() != SD_PRESENT)
+  {
+    Stat = STA_NOINIT | STA_NODISK;
+  }
+  else if (SD_Init() == SD_OK)
+  {
+    Stat = 0;
+  }
+  else
+  {
+    Stat = STA_NOINIT;
+  }
+  return Stat;
+}
+
+/**
+  * @brief  SD_disk_status
+  * @param  None
+  * @retval DSTATUS
+  */
+static DSTATUS SD_disk_status(void)
+{
+  return Stat;
+}
+
+/**
+  * @brief  SD_disk_read
+  * @param  buff : data buffer
+  * @param  sector : start sector (LBA)
+  * @param  count : sector count (1..255)
+  * @retval DRESULT
+  */
+static DRESULT SD_disk_read(BYTE *buff, DWORD sector, BYTE count)
+{
+  BYTE n, next = 0, cur = 0;
+  
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  if (sector + count > SD_MAX_SECTORS) return RES_PARERR;
+  
+  if (((uint32_t)buff & 3) == 0)
+  {
+    return SD_ReadDMA(buff, sector, count);
+  }
+  
+  /* 未对齐: DMA读入一个缓冲时,拷出另一个缓冲中已读到的扇区 */
+  n = (count < SD_DISK_BUF_SECTORS) ? count : SD_DISK_BUF_SECTORS;
+  if (SD_ReadMultiBlocks((uint8_t *)SD_Buf[cur], sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, n) != SD_OK) return RES_ERROR;
+  for (;;)
+  {
+    if (SD_WaitReadOperation() != SD_OK) return RES_ERROR;
+    if (SD_WaitReady() != RES_OK) return RES_ERROR;
+    count -= n;
+    sector += n;
+    if (count)
+    {
+      next = (count < SD_DISK_BUF_SECTORS) ? count : SD_DISK_BUF_SECTORS;
+      if (SD_ReadMultiBlocks((uint8_t *)SD_Buf[cur ^ 1], sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, next) != SD_OK) return RES_ERROR;
+    }
+    memcpy(buff, SD_Buf[cur], n * SD_SECTOR_SIZE);
+    if (!count) break;
+    buff += n * SD_SECTOR_SIZE;
+    cur ^= 1;
+    n = next;
+  }
+  return RES_OK;
+}
+
+/**
+  * @brief  SD_disk_write
+  * @param  buff : data to be written
+  * @param  sector : start sector (LBA)
+  * @param  count : sector count (1..255)
+  * @retval DRESULT
+  */
+#if _READONLY == 0
+static DRESULT SD_disk_write(const BYTE *buff, DWORD sector, BYTE count)
+{
+  BYTE n, next = 0, cur = 0;
+  
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  if (sector + count > SD_MAX_SECTORS) return RES_PARERR;
+  
+  if (((uint32_t)buff & 3) == 0)
+  {
+    return SD_WriteDMA(buff, sector, count);
+  }
+  
+  /* 未对齐: DMA写出一个缓冲时,填入另一个缓冲 */
+  n = (count < SD_DISK_BUF_SECTORS) ? count : SD_DISK_BUF_SECTORS;
+  memcpy(SD_Buf[cur], buff, n * SD_SECTOR_SIZE);
+  buff += n * SD_SECTOR_SIZE;
+  if (SD_WriteMultiBlocks((uint8_t *)SD_Buf[cur], sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, n) != SD_OK) return RES_ERROR;
+  for (;;)
+  {
+    count -= n;
+    if (count)
+    {
+      next = (count < SD_DISK_BUF_SECTORS) ? count : SD_DISK_BUF_SECTORS;
+      memcpy(SD_Buf[cur ^ 1], buff, next * SD_SECTOR_SIZE);
+      buff += next * SD_SECTOR_SIZE;
+    }
+    if (SD_WaitWriteOperation() != SD_OK) return RES_ERROR;
+    if (SD_WaitReady() != RES_OK) return RES_ERROR;
+    if (!count) break;
+    sector += n;
+    cur ^= 1;
+    n = next;
+    if (SD_WriteMultiBlocks((uint8_t *)SD_Buf[cur], sector * SD_SECTOR_SIZE, SD_SECTOR_SIZE, n) != SD_OK) return RES_ERROR;
+  }
+  return RES_OK;
+}
+#endif /* _READONLY == 0 */
+
+/**
+  * @brief  SD_disk_ioctl
+  * @param  ctrl : control code
+  * @param  buff : buffer to send/receive control data
+  * @retval DRESULT
+  */
+#if _USE_IOCTL != 0
+static DRESULT SD_disk_ioctl(BYTE ctrl, void *buff)
+{
+  DRESULT res = RES_ERROR;
+  uint64_t num;
+  
+  if (Stat & STA_NOINIT) return RES_NOTRDY;
+  
+  switch (ctrl) {
+  case CTRL_SYNC :		/* 写操作在返回前已完成 */
+    res = RES_OK;
+    break;
+    
+  case GET_SECTOR_COUNT :
+    num = SDCardInfo.CardCapacity / SD_SECTOR_SIZE;
+    *(DWORD*)buff = (num > SD_MAX_SECTORS) ? SD_MAX_SECTORS : (DWORD)num;
+    res = RES_OK;
+    break;
+    
+  case GET_SECTOR_SIZE :
+    *(WORD*)buff = SD_SECTOR_SIZE;
+    res = RES_OK;
+    break;
+    
+  case GET_BLOCK_SIZE :
+    *(DWORD*)buff = 1;
+    res = RES_OK;
+    break;
+    
+  default:
+    res = RES_PARERR;
+  }
+  return res;
+}
+#endif /* _USE_IOCTL != 0 */
+
+/* Backend of the SD card, attached to drive SD_DISK_DRV (diskio.c) */
+const DISKIO_DRV SD_Disk =
+{
+  SD_disk_initialize,
+  SD_disk_status,
+  SD_disk_read,
+#if _READONLY == 0
+  SD_disk_write,
+#endif
+#if _USE_IOCTL != 0
+  SD_disk_ioctl,
+#endif
+};
@@ -30,6 +30,9 @@
 #include "usb_hcd_int.h"
 #include "usbh_core.h"
 #include "stm32fxxx_it.h"
+#include "stm322xg_eval_sdio_sd.h"
+#include "rtc.H"
+#include <ucos_ii.h>
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -41,6 +44,7 @@ extern USBH_HOST                    USB_Host;
  
 /* Private function prototypes -----------------------------------------------*/
 extern void USB_OTG_BSP_TimerIRQ (void);
+extern void USB_OTG_BSP_PollTimerIRQ (void);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -168,15 +172,44 @@ void TIM2_IRQHandler(void)
 {
   USB_OTG_BSP_TimerIRQ();
 }
+/**
+  * @brief  TIM5_IRQHandler
+  *         This function handles Timer5 Handler (DFU poll timer).
+  * @param  None
+  * @retval None
+  */
+void TIM5_IRQHandler(void)
+{
+  OSIntEnter();
+  USB_OTG_BSP_PollTimerIRQ();
+  OSIntExit();
+}
+/**
+  * @brief  SDIO_IRQHandler
+  *         This function handles SDIO global interrupt request (sd_diskio.c).
+  * @param  None
+  * @retval None
+  */
+void SDIO_IRQHandler(void)
+{
+  SD_ProcessIRQSrc();
+}
+/**
+  * @brief  SD_SDIO_DMA_IRQHANDLER
+  *         This function handles the DMA2 stream of the SDIO.
+  * @param  None
+  * @retval None
+  */
+void SD_SDIO_DMA_IRQHANDLER(void)
+{
+  SD_ProcessDMAIRQ();
+}
 /**
   * @brief  SysTick_Handler
   *         This function handles System Tick Handler.
   * @param  None
   * @retval None
   */
- 
-#include 	"rtc.H"
-#include <ucos_ii.h>
 void SysTick_Handler(void)
 {
     OSIntEnter();
@@ -202,7 +235,9 @@ void OTG_FS_IRQHandler(void)
 void OTG_HS_IRQHandler(void)
 #endif
 {
+  OSIntEnter();
   USBH_OTG_ISR_Handler(&USB_OTG_Core);
+  OSIntExit();
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
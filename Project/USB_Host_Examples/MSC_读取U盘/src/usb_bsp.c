@@ -28,6 +28,7 @@
 /* Includes ------------------------------------------------------------------*/
 
 #include "usb_bsp.h"
+#include "app_task.h"
 
 /** @addtogroup USBH_USER
 * @{
@@ -44,6 +45,10 @@
 #define USE_ACCURATE_TIME
 #define TIM_MSEC_DELAY                     0x01
 #define TIM_USEC_DELAY                     0x02
+#define USE_POLL_TIMER
+#define POLL_TIM                           TIM5
+#define POLL_TIM_IRQn                      TIM5_IRQn
+#define POLL_TIM_RCC                       RCC_APB1Periph_TIM5
 #define HOST_OVRCURR_PORT                  GPIOE
 #define HOST_OVRCURR_LINE                  GPIO_Pin_1
 #define HOST_OVRCURR_PORT_SOURCE           GPIO_PortSourceGPIOE
@@ -96,6 +101,10 @@ ErrorStatus HSEStartUpStatus;
 #ifdef USE_ACCURATE_TIME 
 __IO uint32_t BSP_delay = 0;
 #endif
+#ifdef USE_POLL_TIMER
+__IO uint8_t  BSP_PollExpired = 1;
+#endif
+__IO uint32_t BSP_Event = 0;
 /**
   * @}
   */ 
@@ -531,6 +540,138 @@ static void BSP_SetTime(uint8_t unit)
 
 #endif
 
+#ifdef USE_POLL_TIMER
+/**
+  * @brief  USB_OTG_BSP_PollTimerStart
+  *         Start a one-shot timer of usec micro seconds on TIM5 (1 MHz count).
+  *         Used by the DFU class to send GETSTATUS exactly after bwPollTimeout.
+  *         On expiry the USB task is waked up through OSSem_USBDly.
+  * @param  usec : timeout in micro sec, 0 means already expired
+  * @retval None
+  */
+void USB_OTG_BSP_PollTimerStart(uint32_t usec)
+{
+  static uint8_t init = 0;
+  TIM_TimeBaseInitTypeDef  TIM_TimeBaseStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
+  
+  TIM_Cmd(POLL_TIM, DISABLE);
+  if(usec == 0)
+  {
+    BSP_PollExpired = 1;
+    return;
+  }
+  
+  if(init == 0)
+  {
+    RCC_APB1PeriphClockCmd(POLL_TIM_RCC, ENABLE);
+    
+    NVIC_InitStructure.NVIC_IRQChannel = POLL_TIM_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    init = 1;
+  }
+  
+  BSP_PollExpired = 0;
+  
+  /* APB1 timer clock = HCLK/2 */
+  TIM_TimeBaseStructure.TIM_Prescaler = (SystemCoreClock / 2 / 1000000) - 1;
+  TIM_TimeBaseStructure.TIM_Period = usec - 1;
+  TIM_TimeBaseStructure.TIM_ClockDivision = 0;
+  TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+  TIM_TimeBaseInit(POLL_TIM, &TIM_TimeBaseStructure);
+  TIM_SelectOnePulseMode(POLL_TIM, TIM_OPMode_Single);
+  TIM_ClearITPendingBit(POLL_TIM, TIM_IT_Update);
+  TIM_ITConfig(POLL_TIM, TIM_IT_Update, ENABLE);
+  TIM_Cmd(POLL_TIM, ENABLE);
+}
+
+/**
+  * @brief  USB_OTG_BSP_PollTimerExpired
+  *         Check the one-shot poll timer
+  * @param  None
+  * @retval 1 : expired (or never started)
+  */
+uint8_t USB_OTG_BSP_PollTimerExpired(void)
+{
+  return BSP_PollExpired;
+}
+
+/**
+  * @brief  USB_OTG_BSP_PollTimerIRQ
+  *         One-shot poll timer IRQ
+  * @param  None
+  * @retval None
+  */
+void USB_OTG_BSP_PollTimerIRQ(void)
+{
+  if (TIM_GetITStatus(POLL_TIM, TIM_IT_Update) != RESET)
+  {
+    TIM_ClearITPendingBit(POLL_TIM, TIM_IT_Update);
+    TIM_ITConfig(POLL_TIM, TIM_IT_Update, DISABLE);
+    BSP_PollExpired = 1;
+    USB_OTG_BSP_EventPost(USB_OTG_EVT_TIMER);
+  }
+}
+#endif
+
+/**
+  * @brief  USB_OTG_BSP_EventPost
+  *         Record host events and wake up the host task. Called from the
+  *         interrupts, the semaphore is only posted for the first event
+  *         that the task has not collected yet.
+  * @param  evt : USB_OTG_EVT_xxx
+  * @retval None
+  */
+void USB_OTG_BSP_EventPost(uint32_t evt)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  
+  /* 与EventWait的取走在同一临界区内, 信号量计数与BSP_Event是否为0保持一致 */
+  OS_ENTER_CRITICAL();
+  if((BSP_Event == 0) && (OSSem_USBDly != (OS_EVENT *)0))
+  {
+    OSSemPost(OSSem_USBDly);
+  }
+  BSP_Event |= evt;
+  OS_EXIT_CRITICAL();
+}
+
+/**
+  * @brief  USB_OTG_BSP_EventWait
+  *         Block the host task until an event is posted or timeout elapses
+  * @param  timeout : OS ticks, 0 means do not block
+  * @retval events posted since the last call, 0 on timeout
+  */
+uint32_t USB_OTG_BSP_EventWait(uint32_t timeout)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  INT8U err;
+  uint32_t evt;
+  
+  if(timeout)
+  {
+    OSSemPend(OSSem_USBDly, timeout, &err);
+  }
+  
+  OS_ENTER_CRITICAL();
+  evt = BSP_Event;
+  if(evt != 0)
+  {
+    /* 事件已取走, 丢掉它们留下的计数, 否则下次等待会被假唤醒 */
+    (void)OSSemAccept(OSSem_USBDly);
+  }
+  BSP_Event = 0;
+  OS_EXIT_CRITICAL();
+  return evt;
+}
+
 /**
 * @}
 */ 
@@ -29,10 +29,17 @@
 #include <string.h>
 #include "usbh_usr.h"
 #include "lcd_log.h"
+#include "lcd_pixconv.h"
+#include "image_cache.h"
+#include "image_prefetch.h"
 #include "ff.h"       /* FATFS */
 #include "usbh_msc_core.h"
 #include "usbh_msc_scsi.h"
 #include "usbh_msc_bot.h"
+#include "usbh_msc_cache.h"
+#include "usbh_msc_mount.h"
+#include "usbh_msc_fatfs.h"
+#include "include_slef.H"
 
 
 #if (DUG_PRINTF == xprintf)
@@ -65,6 +72,14 @@
 * @{
 */ 
 #define IMAGE_BUFFER_SIZE    512
+#define IMAGE_LINE_SIZE      1280   /* 320 pixels of 32bpp, one BMP row */
+#define BENCH_BUFFER_SIZE    4096   /* 8 sectors, one multi-packet BOT data stage */
+#define BENCH_FILE_NAME      "0:BENCH.TMP"
+#define BENCH_SEEK_NUM       100    /* random seeks per seek mode */
+#define BENCH_LINKMAP_SIZE   64     /* cluster link map items, 31 fragments */
+#define BENCH_DIR_NAME       "0:BENCHDIR"
+#define BENCH_DIR_FILES      256    /* open latency at 16, 64 and 256 files */
+#define BENCH_OPEN_NUM       50     /* opens per directory size */
 /**
 * @}
 */ 
@@ -86,9 +101,16 @@ uint8_t USBH_USR_ApplicationState = USH_USR_FS_INIT;
 uint8_t filenameString[15]  = {0};
 
 FATFS fatfs;
+#if _USE_DIRIDX
+static DIRIDX fatfs_didx[_USE_DIRIDX];   /* U盘的目录索引,SD卡不用 */
+#endif
 FIL file;
-uint8_t Image_Buf[IMAGE_BUFFER_SIZE];
+__align(4) uint8_t Image_Buf[IMAGE_LINE_SIZE];   /* 字对齐,转换时按字读 */
 uint8_t line_idx = 0;   
+static volatile uint32_t Bench_KB = 0;   /* MSCBENCH request from the shell, KB */
+#if IMAGE_PREFETCH_ENABLE
+static uint32_t Image_Evt = 0;           /* USB events taken by Image_Wait */
+#endif
 
 /*  Points to the DEVICE_PROP structure of current device */
 /*  The purpose of this register is to speed up the execution */
@@ -157,8 +179,11 @@ const uint8_t MSG_DFU_CLASS[]        = "> DFU device connected\n";
 */
 static uint8_t Explore_Disk (char* path , uint8_t recu_level);
 static uint8_t Image_Browser (char* path);
-static void     Show_Image(void);
+static uint8_t Image_Next (DIR *dir, FILINFO *fno);
+static void    Image_Wait (INT32U ticks);
+static uint8_t  Show_Image(const char *dir, const FILINFO *fno);
 static void     Toggle_Leds(void);
+static void     MSC_Bench(uint32_t kb);
 /**
 * @}
 */ 
@@ -486,6 +511,22 @@ int USBH_USR_MSC_Application(void)
       LCD_ErrLog("> Cannot initialize File System.\n");
       return(-1);
     }
+#if _USE_MNTCACHE
+    fatfs.mnt = USBH_MSC_Mount_Vol();   //同一U盘再次插入时恢复上次的空闲簇表
+#endif
+#if _USE_DIRIDX
+    fatfs.didx = fatfs_didx;            //大目录的名字索引
+#endif
+    {
+      DIR dir;
+      
+      /* attach to the first read of the volume: mount and the root directory */
+      if(f_opendir(&dir, "0:/") == FR_OK)
+      {
+        DUG_PRINTF("\r\n attach to first read %d ms\r\n",
+                   (RTC_SysTickGetSum() - USBH_MSC_Host->AttachTick) * SYSTICK_CYC);
+      }
+    }
     LCD_UsrLog("> File System initialized.\n");
     LCD_UsrLog("> Disk capacity : %d M Bytes\n", USBH_MSC_Param.MSCapacity * \
       USBH_MSC_Param.MSPageLength/1024/1024); 
@@ -504,7 +545,13 @@ int USBH_USR_MSC_Application(void)
 	DUG_PRINTF("\r\n %s\r\n", (void *)MSG_ROOT_CONT);
     Explore_Disk("0:/", 1);
     line_idx = 0;   
+#if USBH_DFU_USE_FILE
+    /* the DFU sessions read USBH_DFU_FILE_NAME from this drive: no key
+       polling and no remount, both would stall or break the image stream */
+    USBH_USR_ApplicationState = USH_USR_FS_IDLE;
+#else
     USBH_USR_ApplicationState = USH_USR_FS_WRITEFILE;
+#endif
     
     break;
     
@@ -591,6 +638,15 @@ int USBH_USR_MSC_Application(void)
       return Image_Browser("0:/Media");
     }
     break;
+    
+  case USH_USR_FS_IDLE:
+    if(Bench_KB)
+    {
+      MSC_Bench(Bench_KB);
+      Bench_KB = 0;
+    }
+    break;
+    
   default: break;
   }
   return(0);
@@ -613,6 +669,10 @@ static uint8_t Explore_Disk (char* path , uint8_t recu_level)
   char *fn;
   char tmp[14];
   
+#if _USE_LFN
+  fno.lfname = 0;       /* 只显示短文件名 */
+  fno.lfsize = 0;
+#endif
   res = f_opendir(&dir, path);
   if (res == FR_OK) {
     while(HCD_IsDeviceConnected(&USB_OTG_Core)) 
@@ -634,6 +694,7 @@ static uint8_t Explore_Disk (char* path , uint8_t recu_level)
       if(line_idx > 9)
       {
         line_idx = 0;
+#if USBH_DFU_USE_FILE == 0 /* the DFU sessions must not wait for the key */
         LCD_SetTextColor(Green);
         LCD_DisplayStringLine( LCD_PIXEL_HEIGHT - 42, "                                              ");
         LCD_DisplayStringLine( LCD_PIXEL_HEIGHT - 30, "Press Key2 to continue...");
@@ -648,6 +709,7 @@ static uint8_t Explore_Disk (char* path , uint8_t recu_level)
           Toggle_Leds();
 			USBH_USR_OS_DlyTick(10);
         }
+#endif
       } 
       
       if(recu_level == 1)
@@ -678,55 +740,142 @@ static uint8_t Explore_Disk (char* path , uint8_t recu_level)
   return res;
 }
 
+/**
+* @brief  Image_Next
+*         Reads the picture directory up to the next BMP
+* @param  dir: opened picture directory
+* @param  fno: the BMP found
+* @retval 1: found, 0: end of the directory
+*/
+static uint8_t Image_Next (DIR *dir, FILINFO *fno)
+{
+  for (;;) {
+    if (f_readdir(dir, fno) != FR_OK || fno->fname[0] == 0) return 0;
+    if (fno->fname[0] == '.') continue;
+    if (fno->fattrib & AM_DIR) continue;
+    if((strstr(fno->fname, "bmp")) || (strstr(fno->fname, "BMP"))) return 1;
+  }
+}
+
+/**
+* @brief  Image_Wait
+*         Waits in the USB host task, the disk requests of the prefetch
+*         task are served meanwhile
+* @param  ticks: OS ticks
+* @retval None
+*/
+static void Image_Wait (INT32U ticks)
+{
+#if IMAGE_PREFETCH_ENABLE
+  /* 其它事件留给USBH_Process, 离开图片浏览时重新投递 */
+  Image_Evt |= USB_OTG_BSP_EventWait(ticks) & ~USB_OTG_EVT_CLASS;
+  USBH_MSC_IO_Process();
+#else
+  USBH_USR_OS_DlyTick(ticks);
+#endif
+}
+
 static uint8_t Image_Browser (char* path)
 {
-  FRESULT res;
   uint8_t ret = 1;
-  FILINFO fno;
+  FILINFO fno, next;
   DIR dir;
-  char *fn;
   char tmp[30];
+  uint32_t tick, ms;
+  uint8_t complete, more;
 
   
-  res = f_opendir(&dir, path);
-  if (res == FR_OK) {
+#if _USE_LFN
+  fno.lfname = 0;       /* 只显示短文件名 */
+  fno.lfsize = 0;
+  next.lfname = 0;
+  next.lfsize = 0;
+#endif
+#if IMAGE_CACHE_ENABLE
+  Image_Cache_Init(path);
+#endif
+  if (f_opendir(&dir, path) == FR_OK) {
     
-    for (;;) {
-      res = f_readdir(&dir, &fno);
-      if (res != FR_OK || fno.fname[0] == 0) break;
-      if (fno.fname[0] == '.') continue;
-
-      fn = fno.fname;
- 
-      if (fno.fattrib & AM_DIR) 
+    more = Image_Next(&dir, &fno);
+    while (more) {
+      tmp[0] = '\0';
+      strcpy(tmp, path);
+      strcat(tmp, "/");
+      strcat(tmp, fno.fname);
+      xprintf("\n\n ARMJISHU神舟STM32开发板，显示BMP图片: %s.", tmp);
+      /* 从打开文件到整屏显示完的时间 */
+      tick = RTC_SysTickGetSum();
+#if IMAGE_PREFETCH_ENABLE
+      /* 按键早于预读完成时等它读完 */
+      while(Image_Prefetch_Busy() && HCD_IsDeviceConnected(&USB_OTG_Core))
       {
-        continue;
-      } 
-      else 
+        Image_Wait(1);
+      }
+      if(Image_Prefetch_Show(path, &fno))
       {
-        if((strstr(fn, "bmp")) || (strstr(fn, "BMP")))
-        {
-          tmp[0] = '\0';
-          strcpy(tmp, path);
-          strcat(tmp, "/");
-          strcat(tmp, fn);
-          res = f_open(&file, tmp, FA_OPEN_EXISTING | FA_READ);
-          xprintf("\n\n ARMJISHU神舟STM32开发板，显示BMP图片: %s.", tmp);
-          Show_Image();
-          USB_OTG_BSP_mDelay(100);
-          ret = 0;
-          while((HCD_IsDeviceConnected(&USB_OTG_Core)) && \
-            (STM_EVAL_PBGetState (BUTTON_KEY) == SET))
-          {
-			USBH_USR_OS_DlyTick(10);
-            Toggle_Leds();
-          }
-          f_close(&file);
-          
-        }
+        ms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+        xprintf("\n Full frame from the prefetch buffer in %d ms, read ahead in %d ms.", ms, Image_Prefetch_Time());
+        Image_Prefetch_Done();
+      }
+      else
+#endif
+#if IMAGE_CACHE_ENABLE
+      if(Image_Cache_Show(path, &fno, 0))
+      {
+        ms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+        xprintf("\n Full frame from the RGB565 cache in %d ms.", ms);
+      }
+      else
+#endif
+      {
+        f_open(&file, tmp, FA_OPEN_EXISTING | FA_READ);
+        complete = Show_Image(path, &fno);
+        f_close(&file);
+        ms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+        xprintf("\n Full frame decoded from the BMP in %d ms.", ms);
+#if IMAGE_CACHE_ENABLE
+        tick = RTC_SysTickGetSum();
+        Image_Cache_Close(complete);
+        ms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+        xprintf("\n RGB565 cache %s in %d more ms.", complete ? "written" : "dropped", ms);
+#endif
       }
+      
+      /* 看这幅图时预读下一幅 */
+      more = Image_Next(&dir, &next);
+#if IMAGE_PREFETCH_ENABLE
+      if(more)
+      {
+        Image_Prefetch_Start(path, &next);
+      }
+#endif
+      tick = RTC_SysTickGetSum();
+      while((RTC_SysTickGetSum() - tick) * SYSTICK_CYC < 100)
+      {
+        Image_Wait(10);
+      }
+      ret = 0;
+      while((HCD_IsDeviceConnected(&USB_OTG_Core)) && \
+        (STM_EVAL_PBGetState (BUTTON_KEY) == SET))
+      {
+        Image_Wait(10);
+        Toggle_Leds();
+      }
+      fno = next;
     }  
   }
+#if IMAGE_PREFETCH_ENABLE
+  Image_Prefetch_Cancel();
+  while(Image_Prefetch_Busy() && HCD_IsDeviceConnected(&USB_OTG_Core))
+  {
+    Image_Wait(1);
+  }
+  if(Image_Evt)
+  {
+    USB_OTG_BSP_EventPost(Image_Evt);
+    Image_Evt = 0;
+  }
+#endif
   
   #ifdef USE_USB_OTG_HS 
   LCD_LOG_SetHeader(" USB OTG HS MSC Host");
@@ -742,23 +891,24 @@ static uint8_t Image_Browser (char* path)
 
 /**
 * @brief  Show_Image 
-*         Displays BMP image
-* @param  None
-* @retval None
+*         Displays BMP image, each BMP row is converted into a line buffer
+*         and written to GRAM by one LCD blit window. The lines also go
+*         to the RGB565 cache of the picture, closed by the caller.
+* @param  dir: picture directory
+* @param  fno: the BMP, opened as file
+* @retval 1: every line of the picture was displayed
 */
-static void Show_Image(void)
+static uint8_t Show_Image(const char *dir, const FILINFO *fno)
 {
-  
-  uint16_t i = 0;
-  uint16_t numOfReadBytes = 0;
+  static uint16_t Line_Buf[2][LCD_PIXEL_WIDTH];   /* DMA写前一行时转换下一行 */
+  UINT numOfReadBytes = 0;
   FRESULT res; 
   uint16_t PictureWidth, PictureHeight, PictureBitsPerPixel;
-  uint16_t Xpos = 0, Ypos = 0;
+  uint16_t Row, Rows, Cols, LineSize, Bpp;
+  uint16_t *pLine;
+  IMAGE_CACHE_HEAD_ST Win;
   
-  //LCD_SetDisplayWindow(239, 319, 240, 320);
-  //LCD_WriteReg(R3, 0x1008);
-  //LCD_WriteRAM_Prepare(); /* Prepare to write GRAM */
-  res = f_read(&file, Image_Buf, IMAGE_BUFFER_SIZE, (void *)&numOfReadBytes);
+  res = f_read(&file, Image_Buf, IMAGE_BUFFER_SIZE, &numOfReadBytes);
 
   xprintf("\n f_read file return is %d.", res);
 
@@ -775,89 +925,50 @@ static void Show_Image(void)
   {
     xprintf("\n Picture too Large.");
     LCD_LOG_SetHeader(" Picture too Large..");
-    return;
+    return 0;
   }
-
-  if(PictureBitsPerPixel == 24)
+  if((PictureBitsPerPixel != 16) && (PictureBitsPerPixel != 24) && (PictureBitsPerPixel != 32))
   {
-      while (HCD_IsDeviceConnected(&USB_OTG_Core))
-      {
-        res = f_read(&file, Image_Buf, 510, (void *)&numOfReadBytes);
-        if((numOfReadBytes == 0) || (res != FR_OK)) /*EOF or Error*/
-        {
-          break; 
-        }
-
-        if(PictureWidth < PictureHeight)
-        {
-          for(i = 0 ; i < numOfReadBytes; i+= 3)
-          {
-             //LCD_SetPoint(Xpos, Ypos, Image_Buf[i+1] << 8 | Image_Buf[i]);
-             LCD_SetPoint(Xpos, Ypos, (Image_Buf[i+2]& 0xF8) << 8 | (Image_Buf[i+1] & 0xFC) << 3 | Image_Buf[i]>>3);
-             Xpos++;
-             if(Xpos >= PictureWidth)
-             {
-               Xpos = 0;
-               Ypos++;
-             }
-          }
-        }
-        else
-        {
-          for(i = 0 ; i < numOfReadBytes; i+= 3)
-          {          
-             LCD_SetPoint(239-Xpos, Ypos, (Image_Buf[i+2]& 0xF8) << 8 | (Image_Buf[i+1] & 0xFC) << 3 | Image_Buf[i]>>3);
-             Ypos++;
-             if(Ypos >= PictureWidth)
-             {
-               Ypos = 0;
-               Xpos++;
-             }
-          }
-        }
-      }
-	  //xprintf("\n Xpos %d, Ypos %d.", Xpos, Ypos);
+    return 0;
   }
-  else  if(PictureBitsPerPixel == 16)
+
+  Bpp = PictureBitsPerPixel / 8;
+  LineSize = (PictureWidth * Bpp + 3) & ~3;   /* BMP每行按4字节对齐 */
+  /* 竖图的一行写到屏上的一列, 横图旋转90度; 超出屏幕的部分不显示 */
+  Image_Cache_Window(&Win, PictureWidth, PictureHeight);
+  Rows = IMAGE_CACHE_LINES(&Win);
+  Cols = IMAGE_CACHE_LINE_LEN(&Win);
+#if IMAGE_CACHE_ENABLE
+  /* 缓存文件按整幅图的窗口存放: 竖图逐列, 横图自上而下逐行 */
+  Image_Cache_Open(dir, fno, &Win);
+#endif
+
+  for(Row = 0; (Row < Rows) && HCD_IsDeviceConnected(&USB_OTG_Core); Row++)
   {
-      while (HCD_IsDeviceConnected(&USB_OTG_Core))
-      {
-        res = f_read(&file, Image_Buf, IMAGE_BUFFER_SIZE, (void *)&numOfReadBytes);
-        if((numOfReadBytes == 0) || (res != FR_OK)) /*EOF or Error*/
-        {
-          break; 
-        }
+    res = f_read(&file, Image_Buf, LineSize, &numOfReadBytes);
+    if((numOfReadBytes < Cols * Bpp) || (res != FR_OK)) /*EOF or Error*/
+    {
+      break; 
+    }
 
-        if(PictureWidth < PictureHeight)
-        {
-          for(i = 0 ; i < numOfReadBytes; i+= 2)
-          {
-             //LCD_SetPoint(Xpos, Ypos, Image_Buf[i+1] << 8 | Image_Buf[i]);
-             LCD_SetPoint(Xpos, Ypos, Image_Buf[i+1] << 8 | Image_Buf[i]);
-             Xpos++;
-             if(Xpos >= PictureWidth)
-             {
-               Xpos = 0;
-               Ypos++;
-             }
-          }
-        }
-        else
-        {
-          for(i = 0 ; i < numOfReadBytes; i+= 2)
-          {          
-             LCD_SetPoint(239-Xpos, Ypos, Image_Buf[i+1] << 8 | Image_Buf[i]);
-             Ypos++;
-             if(Ypos >= PictureWidth)
-             {
-               Ypos = 0;
-               Xpos++;
-             }
-          }
-        }
-      }
+    pLine = Line_Buf[Row & 1];
+    LCD_PixConv_Line(pLine, 1, Image_Buf, Cols, PictureBitsPerPixel);
+
+    if(Win.Direction == LCD_DIR_VERTICAL)
+    {
+      LCD_BlitBegin(0, Row, Cols, 1, LCD_DIR_VERTICAL);
+    }
+    else
+    {
+      LCD_BlitBegin(239 - Row, 0, 1, Cols, LCD_DIR_HORIZONTAL);
+    }
+    LCD_BlitWrite(pLine, Cols);
+#if IMAGE_CACHE_ENABLE
+    Image_Cache_Line(IMAGE_CACHE_INDEX(&Win, Row), pLine);
+#endif
   }
-  
+  LCD_BlitEnd();
+  return (Row == Rows);
 }
 
 /**
@@ -878,6 +989,189 @@ static void Toggle_Leds(void)
     i = 0;
   }  
 }
+/**
+* @brief  USBH_USR_MSC_BenchRequest
+*         Ask the MSC application for a throughput test, it is run from the
+*         USB host task while the stick is idle (USH_USR_FS_IDLE)
+* @param  kb: size of the test file in KB
+* @retval None
+*/
+void USBH_USR_MSC_BenchRequest(uint32_t kb)
+{
+  Bench_KB = kb;
+}
+
+/**
+* @brief  MSC_Bench
+*         Write a file of kb KB to the stick, read it back and delete it,
+*         prints the throughput of both directions. The file is then read
+*         again sector by sector for each read-ahead window, starting
+*         with an empty read-ahead buffer, and the time of
+*         random seeks is taken with and without the fast seek link map.
+*         Last the file is written again into a preallocated contiguous run
+* @param  kb: size of the test file in KB
+* @retval None
+*/
+static void MSC_Bench(uint32_t kb)
+{
+  static uint8_t Bench_Buf[BENCH_BUFFER_SIZE];
+  static FIL     Bench_File;
+  static DWORD   Bench_LinkMap[BENCH_LINKMAP_SIZE];
+  uint32_t i, n, tick, wms, rms = 0, w, ofs;
+  UINT     bw;
+  FRESULT  res;
+  
+  n = kb * 1024 / BENCH_BUFFER_SIZE;
+  if(n == 0)
+  {
+    n = 1;
+  }
+  for(i = 0; i < BENCH_BUFFER_SIZE; i++)
+  {
+    Bench_Buf[i] = (uint8_t)i;
+  }
+  
+  if(f_open(&Bench_File, BENCH_FILE_NAME, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  {
+    DUG_PRINTF("\n MSC bench: can't create %s\n", BENCH_FILE_NAME);
+    return;
+  }
+  tick = RTC_SysTickGetSum();
+  for(i = 0, res = FR_OK; (i < n) && (res == FR_OK); i++)
+  {
+    res = f_write(&Bench_File, Bench_Buf, BENCH_BUFFER_SIZE, &bw);
+  }
+  f_close(&Bench_File);
+  wms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+  
+  if((res == FR_OK) && (f_open(&Bench_File, BENCH_FILE_NAME, FA_OPEN_EXISTING | FA_READ) == FR_OK))
+  {
+    tick = RTC_SysTickGetSum();
+    for(i = 0; (i < n) && (res == FR_OK); i++)
+    {
+      res = f_read(&Bench_File, Bench_Buf, BENCH_BUFFER_SIZE, &bw);
+    }
+    f_close(&Bench_File);
+    rms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+  }
+  if(res != FR_OK)
+  {
+    f_unlink(BENCH_FILE_NAME);
+    DUG_PRINTF("\n MSC bench: failed, res=%d\n", res);
+    return;
+  }
+  
+  kb = n * BENCH_BUFFER_SIZE / 1024;
+  DUG_PRINTF("\n MSC bench %d KB: write %d ms %d KB/s, read %d ms %d KB/s\n", kb,
+             wms, wms ? (kb * 1000 / wms) : 0, rms, rms ? (kb * 1000 / rms) : 0);
+  
+  for(w = 1; (w <= USBH_MSC_READ_AHEAD) && (res == FR_OK); w <<= 1)
+  {
+    USBH_MSC_SetReadAhead((BYTE)w);
+    if(f_open(&Bench_File, BENCH_FILE_NAME, FA_OPEN_EXISTING | FA_READ) != FR_OK)
+    {
+      break;
+    }
+    tick = RTC_SysTickGetSum();
+    for(i = 0; (i < n * (BENCH_BUFFER_SIZE / IMAGE_BUFFER_SIZE)) && (res == FR_OK); i++)
+    {
+      res = f_read(&Bench_File, Bench_Buf, IMAGE_BUFFER_SIZE, &bw);
+    }
+    f_close(&Bench_File);
+    rms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+    DUG_PRINTF(" read-ahead %d sectors: read %d ms %d KB/s\n", w, rms, rms ? (kb * 1000 / rms) : 0);
+  }
+  USBH_MSC_SetReadAhead(USBH_MSC_READ_AHEAD);
+  
+  /* w = 0: FAT chain walk, w = 1: cluster link map */
+  for(w = 0; (w < 2) && (res == FR_OK); w++)
+  {
+    if(f_open(&Bench_File, BENCH_FILE_NAME, FA_OPEN_EXISTING | FA_READ) != FR_OK)
+    {
+      break;
+    }
+    if(w)
+    {
+      Bench_File.cltbl = Bench_LinkMap;
+      Bench_LinkMap[0] = BENCH_LINKMAP_SIZE;
+      tick = RTC_SysTickGetSum();
+      res = f_lseek(&Bench_File, CREATE_LINKMAP);
+      rms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+      if(res != FR_OK)
+      {
+        DUG_PRINTF(" fast seek: link map needs %d items\n", Bench_LinkMap[0]);
+        f_close(&Bench_File);
+        break;
+      }
+      DUG_PRINTF(" fast seek: %d fragments, link map %d ms\n", (Bench_LinkMap[0] - 2) / 2, rms);
+    }
+    ofs = 12345;
+    tick = RTC_SysTickGetSum();
+    for(i = 0; (i < BENCH_SEEK_NUM) && (res == FR_OK); i++)
+    {
+      ofs = ofs * 1103515245 + 12345;
+      res = f_lseek(&Bench_File, (ofs >> 8) % (kb * 1024));
+      if(res == FR_OK)
+      {
+        res = f_read(&Bench_File, Bench_Buf, 1, &bw);
+      }
+    }
+    f_close(&Bench_File);
+    rms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+    DUG_PRINTF(" %s seek: %d us per seek\n", w ? "fast" : "normal", rms * 1000 / BENCH_SEEK_NUM);
+  }
+  f_unlink(BENCH_FILE_NAME);
+  
+  if(f_open(&Bench_File, BENCH_FILE_NAME, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+  {
+    tick = RTC_SysTickGetSum();
+    res = f_prealloc(&Bench_File, n * BENCH_BUFFER_SIZE);
+    for(i = 0; (i < n) && (res == FR_OK); i++)
+    {
+      res = f_write(&Bench_File, Bench_Buf, BENCH_BUFFER_SIZE, &bw);
+    }
+    f_close(&Bench_File);
+    wms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+    if(res == FR_OK)
+    {
+      DUG_PRINTF(" prealloc write %d ms %d KB/s\n", wms, wms ? (kb * 1000 / wms) : 0);
+    }
+    f_unlink(BENCH_FILE_NAME);
+  }
+  
+  /* open latency against the number of files in the directory (long names) */
+  if(f_mkdir(BENCH_DIR_NAME) == FR_OK)
+  {
+    char name[40];
+    
+    res = FR_OK;
+    for(i = 0, n = 16; (n <= BENCH_DIR_FILES) && (res == FR_OK); n *= 4)
+    {
+      for(; (i < n) && (res == FR_OK); i++)
+      {
+        sprintf(name, BENCH_DIR_NAME "/%03d bench file.tmp", i);
+        res = f_open(&Bench_File, name, FA_CREATE_NEW | FA_WRITE);
+        f_close(&Bench_File);
+      }
+      tick = RTC_SysTickGetSum();
+      for(ofs = 0; (ofs < BENCH_OPEN_NUM) && (res == FR_OK); ofs++)
+      {
+        sprintf(name, BENCH_DIR_NAME "/%03d bench file.tmp", (ofs * 37) % n);
+        res = f_open(&Bench_File, name, FA_OPEN_EXISTING | FA_READ);
+        f_close(&Bench_File);
+      }
+      rms = (RTC_SysTickGetSum() - tick) * SYSTICK_CYC;
+      DUG_PRINTF(" dir %d files: %d us per open\n", n, rms * 1000 / BENCH_OPEN_NUM);
+    }
+    while(i--)
+    {
+      sprintf(name, BENCH_DIR_NAME "/%03d bench file.tmp", i);
+      f_unlink(name);
+    }
+    f_unlink(BENCH_DIR_NAME);
+  }
+}
+
 /**
 * @brief  USBH_USR_DeInit
 *         Deint User state and associated variables
@@ -0,0 +1,41 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Build the delta DFU manifest (MK5.man) for an image already on the devices.
+
+    python dfu_manifest.py base.bin 0x0102 MK5.man [block_size]
+
+base.bin    : image that is programmed on the devices
+0x0102      : bcdDevice those devices report
+block_size  : DNLOAD block size used by the host (wTransferSize), default 4096
+
+Layout (little endian), see DFU_MANIFEST_ST in usbh_dfu_delta.h:
+    uint32 Magic 'DFUM', uint16 BaseVersion, uint16 BlockSize, uint32 BlockNum,
+    BlockNum x uint32 zlib CRC32 of each block.
+"""
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4D554644
+
+
+def main(argv):
+    if len(argv) < 4:
+        print(__doc__)
+        return 1
+    data = open(argv[1], 'rb').read()
+    version = int(argv[2], 0)
+    block = int(argv[4], 0) if len(argv) > 4 else 0x1000
+
+    crcs = [zlib.crc32(data[i:i + block]) & 0xFFFFFFFF
+            for i in range(0, len(data), block)]
+    with open(argv[3], 'wb') as f:
+        f.write(struct.pack('<IHHI', MAGIC, version, block, len(crcs)))
+        f.write(struct.pack('<%dI' % len(crcs), *crcs))
+    print('%d blocks of %d bytes, version 0x%04X' % (len(crcs), block, version))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
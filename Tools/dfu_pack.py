@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+Pack a DFU image into the compressed container read by usbh_dfu_lz.c.
+
+    python dfu_pack.py MK5.bin MK5.dfz              -> file for the USB stick
+    python dfu_pack.py MK5.bin MK5.dfz fireware.c   -> also a C array that
+                                                        replaces usbh_fireware.c
+
+Container (little endian), see DFU_LZ_HEAD_ST in usbh_dfu_lz.h:
+    uint32 Magic 'DFUZ', uint32 RawSize, uint32 RawCrc (zlib), uint32 PackSize,
+    then the LZSS stream: one flag byte per 8 items (LSB first),
+    1 = literal byte, 0 = match (distance-1: 12 bit, length-3: 4 bit).
+"""
+import struct
+import sys
+import zlib
+
+MAGIC = 0x5A554644
+WINDOW = 4096
+MIN_MATCH = 3
+MAX_MATCH = 15 + MIN_MATCH
+MAX_CHAIN = 256
+
+
+def compress(data):
+    out = bytearray()
+    heads = {}
+    pos = 0
+    n = len(data)
+    while pos < n:
+        flag_at = len(out)
+        out.append(0)
+        flags = 0
+        for bit in range(8):
+            if pos >= n:
+                break
+            best_len, best_dist = 0, 0
+            if pos + MIN_MATCH <= n:
+                key = data[pos:pos + MIN_MATCH]
+                chain = heads.get(key, [])
+                limit = min(MAX_MATCH, n - pos)
+                for cand in reversed(chain[-MAX_CHAIN:]):
+                    dist = pos - cand
+                    if dist > WINDOW:
+                        break
+                    l = MIN_MATCH
+                    while l < limit and data[cand + l] == data[pos + l]:
+                        l += 1
+                    if l > best_len:
+                        best_len, best_dist = l, dist
+                        if l == limit:
+                            break
+            if best_len >= MIN_MATCH:
+                d = best_dist - 1
+                out.append(d & 0xFF)
+                out.append(((d >> 8) << 4) | (best_len - MIN_MATCH))
+                step = best_len
+            else:
+                flags |= 1 << bit
+                out.append(data[pos])
+                step = 1
+            for i in range(pos, pos + step):
+                if i + MIN_MATCH <= n:
+                    heads.setdefault(data[i:i + MIN_MATCH], []).append(i)
+            pos += step
+        out[flag_at] = flags
+    return bytes(out)
+
+
+def write_c(path, blob):
+    with open(path, 'w') as f:
+        f.write('//Packed by Tools/dfu_pack.py, DFU_LZ container\n')
+        f.write('const char\tFireware[] __attribute__((at(0x08010000)))={\n')
+        for i in range(0, len(blob), 16):
+            f.write('    ' + ''.join('0x%02X,' % b for b in blob[i:i + 16]) + '\n')
+        f.write('};\n\nint FirewareSize = sizeof(Fireware);\n')
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__)
+        return 1
+    raw = open(argv[1], 'rb').read()
+    packed = compress(raw)
+    head = struct.pack('<IIII', MAGIC, len(raw),
+                       zlib.crc32(raw) & 0xFFFFFFFF, len(packed))
+    blob = head + packed
+    open(argv[2], 'wb').write(blob)
+    if len(argv) > 3:
+        write_c(argv[3], blob)
+    print('%d -> %d bytes (%.1f%%)' % (len(raw), len(blob),
+                                       100.0 * len(blob) / max(len(raw), 1)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
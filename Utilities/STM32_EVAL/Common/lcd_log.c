@@ -15,6 +15,10 @@
   *          cache for display. This feature allows to dump message sequentially
   *          on the display even if the number of displayed lines is bigger than
   *          the total number of line allowed by the display.
+  *
+  *          With LCD_LOG_INCREMENTAL the text zone on screen is kept in a
+  *          shadow buffer: a new line or a scroll only redraws the glyph
+  *          rows that differ from it, by LCD blit windows.
   *      
   ******************************************************************************
   * @attention
@@ -38,6 +42,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include  "lcd_log.h"
+#include <string.h>
 #include <xprintf.h>
 
 /** @addtogroup Utilities
@@ -68,7 +73,7 @@
 /** @defgroup LCD_LOG_Private_Defines
 * @{
 */ 
-
+#define LCD_SHADOW_UNKNOWN    0xFF    /* 屏上内容未知, 必须重画 */
 /**
 * @}
 */ 
@@ -101,6 +106,15 @@ FunctionalState LCD_Lock;
 FunctionalState LCD_Scrolled;
 uint16_t LCD_ScrollBackStep;
 
+#if LCD_LOG_INCREMENTAL
+/* 屏上文本区显示的内容, LCD_ShadowFont为NULL时是清屏后的空白 */
+static LCD_LOG_line LCD_ShadowBuffer[YWINDOW_SIZE];
+static sFONT   *LCD_ShadowFont;
+static uint16_t LCD_ShadowBackColor;
+static uint16_t LCD_LinePixel[2][LCD_PIXEL_WIDTH];  /* DMA写前一点行时生成下一点行 */
+static uint8_t  LCD_LinePixelIdx;
+#endif
+
 /**
 * @}
 */ 
@@ -110,6 +124,15 @@ uint16_t LCD_ScrollBackStep;
 * @{
 */ 
 static void LCD_LOG_UpdateDisplay (void);
+#if LCD_LOG_INCREMENTAL
+static void LCD_LOG_ShadowClear (uint16_t BackColor);
+static uint8_t LCD_LOG_Ascii (uint8_t ch);
+static uint8_t LCD_LOG_CharDiff (sFONT *pFont, const LCD_LOG_line *pOld, const LCD_LOG_line *pNew,
+                                 uint16_t Col, uint16_t *pFirst, uint16_t *pLast);
+static void LCD_LOG_DrawChars (uint16_t Row, const LCD_LOG_line *pLine, uint16_t Col, uint16_t Num,
+                               uint16_t First, uint16_t Last, uint16_t BackColor);
+static void LCD_LOG_DrawLine (uint16_t Row, const LCD_LOG_line *pLine, uint16_t BackColor);
+#endif
 /**
 * @}
 */ 
@@ -132,6 +155,9 @@ void LCD_LOG_Init ( void)
   LCD_LOG_DeInit();
   /* Clear the LCD */
   LCD_Clear(Black);  
+#if LCD_LOG_INCREMENTAL
+  LCD_LOG_ShadowClear(Black);
+#endif
 }
 
 /**
@@ -177,10 +203,11 @@ void LCD_LOG_SetHeader (uint8_t *Title)
      size = 26;
   }
   
-  for (idx = 0 ; idx < 27 ; idx ++)
+  for (idx = 0 ; idx < 26 ; idx ++)
   { 
     tmp[idx] = ' '; 
   }
+  tmp[26] = 0;
 
   for (idx = 0 ; idx < size ; idx ++)
   { 
@@ -189,6 +216,9 @@ void LCD_LOG_SetHeader (uint8_t *Title)
   
   /* Clear the LCD */
   LCD_Clear(Black);
+#if LCD_LOG_INCREMENTAL
+  LCD_LOG_ShadowClear(Black);
+#endif
     
   /* Set the LCD Font */
   LCD_SetFont (&Font12x12);
@@ -203,8 +233,8 @@ void LCD_LOG_SetHeader (uint8_t *Title)
   LCD_ClearLine(2 * cFont->Height);
 
   LCD_SetTextColor(Yellow);
-  LCD_DisplayStringLine(0, "        ARMJISHU.COM   ");
-  LCD_DisplayStringLine(2 * cFont->Height, "      SZW-STM32F207ZGT ");
+  LCD_DisplayStringLine(0, (uint8_t *)"        ARMJISHU.COM   ");
+  LCD_DisplayStringLine(2 * cFont->Height, (uint8_t *)"      SZW-STM32F207ZGT ");
 
   LCD_SetBackColor(Black);
   LCD_SetFont (&Font8x12);
@@ -242,11 +272,18 @@ void LCD_LOG_ClearTextZone(void)
 {
   uint8_t i=0;
   sFONT *cFont = LCD_GetFont();
+#if LCD_LOG_INCREMENTAL
+  uint16_t TextColor, BackColor;
+#endif
   
   for (i= 0 ; i < YWINDOW_SIZE; i++)
   {
     LCD_ClearLine((i + YWINDOW_MIN) * cFont->Height);
   }
+#if LCD_LOG_INCREMENTAL
+  LCD_GetColors(&TextColor, &BackColor);
+  LCD_LOG_ShadowClear(BackColor);
+#endif
   
   LCD_LOG_DeInit();
 }
@@ -328,6 +365,248 @@ PUTCHAR_PROTOTYPE
   return ch;
 }
   
+#if LCD_LOG_INCREMENTAL
+/**
+* @brief  Update the text area display: each line of the text zone is
+*         compared with the shadow buffer, only what differs is drawn.
+* @param  None
+* @retval None
+*/
+static void LCD_LOG_UpdateDisplay (void)
+{
+  uint16_t cnt = 0, rows = 0, row;
+  uint16_t length = 0;
+  uint16_t ptr = 0, index = 0;
+  uint16_t TextColor, BackColor;
+  
+  sFONT *cFont = LCD_GetFont();
+  
+  LCD_GetColors(&TextColor, &BackColor);
+  if((cFont != LCD_ShadowFont) || (BackColor != LCD_ShadowBackColor))
+  {
+    /* 清屏后的空白与字体无关, 其它情况屏上内容都要重画 */
+    if((LCD_ShadowFont != NULL) || (BackColor != LCD_ShadowBackColor))
+    {
+      for(row = 0; row < YWINDOW_SIZE; row++)
+      {
+        memset(LCD_ShadowBuffer[row].line, LCD_SHADOW_UNKNOWN, XWINDOW_MAX);
+      }
+    }
+    LCD_ShadowFont = cFont;
+    LCD_ShadowBackColor = BackColor;
+  }
+  
+  if((LCD_CacheBuffer_yptr_bottom  < (YWINDOW_SIZE -1)) && 
+     (LCD_CacheBuffer_yptr_bottom  >= LCD_CacheBuffer_yptr_top))
+  {
+    /* 文本区未满, 最后一行之前的各行不变 */
+    rows = LCD_CacheBuffer_yptr_bottom + 1;
+  }
+  else
+  {
+    
+    if(LCD_CacheBuffer_yptr_bottom < LCD_CacheBuffer_yptr_top)
+    {
+      /* Virtual length for rolling */
+      length = LCD_CACHE_DEPTH + LCD_CacheBuffer_yptr_bottom ;
+    }
+    else
+    {
+      length = LCD_CacheBuffer_yptr_bottom;
+    }
+    
+    ptr = length - YWINDOW_SIZE + 1;
+    rows = YWINDOW_SIZE;
+  }
+  
+  for  (cnt = 0 ; cnt < rows ; cnt ++)
+  {
+    index = (cnt + ptr )% LCD_CACHE_DEPTH ;
+    LCD_LOG_DrawLine(cnt, &LCD_CacheBuffer[index], BackColor);
+  }
+  LCD_BlitEnd();
+  LCD_SetTextColor(LCD_CacheBuffer[index].color);
+}
+
+/**
+* @brief  Marks the text zone as cleared to the background color.
+* @param  BackColor: color the zone was cleared with
+* @retval None
+*/
+static void LCD_LOG_ShadowClear (uint16_t BackColor)
+{
+  uint16_t row;
+  
+  for(row = 0; row < YWINDOW_SIZE; row++)
+  {
+    memset(LCD_ShadowBuffer[row].line, ' ', XWINDOW_MAX);
+    LCD_ShadowBuffer[row].color = LCD_LOG_DEFAULT_COLOR;
+  }
+  LCD_ShadowFont = NULL;
+  LCD_ShadowBackColor = BackColor;
+}
+
+/**
+* @brief  Character of the cache as it is drawn, the font has 0x20..0x7E only.
+*/
+static uint8_t LCD_LOG_Ascii (uint8_t ch)
+{
+  return ((ch < ' ') || (ch > '~')) ? ' ' : ch;
+}
+
+/**
+* @brief  Compares a character of the line with the one on screen.
+* @param  pFont: current font
+* @param  pOld: line in the shadow buffer
+* @param  pNew: line to display
+* @param  Col: character index
+* @param  pFirst, pLast: range of glyph rows to redraw, widened by the rows
+*         of this character that differ
+* @retval 1: the character must be redrawn
+*/
+static uint8_t LCD_LOG_CharDiff (sFONT *pFont, const LCD_LOG_line *pOld, const LCD_LOG_line *pNew,
+                                 uint16_t Col, uint16_t *pFirst, uint16_t *pLast)
+{
+  const uint16_t *pOldGlyph, *pNewGlyph;
+  uint8_t  Old = pOld->line[Col];
+  uint8_t  Diff = 0;
+  uint16_t y;
+  
+  pNewGlyph = &pFont->table[(LCD_LOG_Ascii(pNew->line[Col]) - 32) * pFont->Height];
+  if((Old < ' ') || (Old > '~'))
+  {
+    *pFirst = 0;
+    *pLast = pFont->Height - 1;
+    return 1;
+  }
+  pOldGlyph = &pFont->table[(Old - 32) * pFont->Height];
+  for(y = 0; y < pFont->Height; y++)
+  {
+    /* 点行相同, 且没有前景点或前景色相同 */
+    if((pOldGlyph[y] != pNewGlyph[y]) || ((pNewGlyph[y] != 0) && (pOld->color != pNew->color)))
+    {
+      if(y < *pFirst) *pFirst = y;
+      if(y > *pLast)  *pLast = y;
+      Diff = 1;
+    }
+  }
+  return Diff;
+}
+
+/**
+* @brief  Draws glyph rows First..Last of Num characters of a line as one
+*         blit window, each glyph row is generated into a pixel line.
+* @param  Row: line of the text zone
+* @param  pLine: line to display
+* @param  Col: first character
+* @param  Num: number of characters
+* @param  First, Last: glyph rows
+* @param  BackColor: background color
+* @retval None
+*/
+static void LCD_LOG_DrawChars (uint16_t Row, const LCD_LOG_line *pLine, uint16_t Col, uint16_t Num,
+                               uint16_t First, uint16_t Last, uint16_t BackColor)
+{
+  sFONT *cFont = LCD_GetFont();
+  const uint16_t *pGlyph;
+  uint16_t *pPixel;
+  uint32_t Mask;
+  uint16_t y, k, i, Bits;
+  
+  if((BackColor == HyalineBackColor) || (LCD_BlitWindowed() == 0))
+  {
+    /* 透明背景要跳过背景点, 没有窗口的控制器逐点写更慢, 都用原来的画法 */
+    LCD_BlitEnd();
+    LCD_SetTextColor(pLine->color);
+    for(k = 0; k < Num; k++)
+    {
+      LCD_DisplayChar((YWINDOW_MIN + Row) * cFont->Height, (Col + k) * cFont->Width,
+                      LCD_LOG_Ascii(pLine->line[Col + k]));
+    }
+    return;
+  }
+  
+  /* 与LCD_DrawChar的取点方式相同 */
+  Mask = (cFont->Width > 12) ? 0x0001 : (0x80 << ((cFont->Width / 12) * 8));
+  
+  LCD_BlitBegin((YWINDOW_MIN + Row) * cFont->Height + First, Col * cFont->Width,
+                Last - First + 1, Num * cFont->Width, LCD_DIR_HORIZONTAL);
+  for(y = First; y <= Last; y++)
+  {
+    pPixel = LCD_LinePixel[LCD_LinePixelIdx];
+    for(k = 0; k < Num; k++)
+    {
+      pGlyph = &cFont->table[(LCD_LOG_Ascii(pLine->line[Col + k]) - 32) * cFont->Height];
+      Bits = pGlyph[y];
+      for(i = 0; i < cFont->Width; i++)
+      {
+        if(cFont->Width > 12)
+        {
+          *pPixel++ = (Bits & (Mask << i)) ? pLine->color : BackColor;
+        }
+        else
+        {
+          *pPixel++ = (Bits & (Mask >> i)) ? pLine->color : BackColor;
+        }
+      }
+    }
+    LCD_BlitWrite(LCD_LinePixel[LCD_LinePixelIdx], Num * cFont->Width);
+    LCD_LinePixelIdx ^= 1;
+  }
+}
+
+/**
+* @brief  Redraws the characters of a text zone line that differ from the
+*         shadow buffer, consecutive ones by one blit window.
+* @param  Row: line of the text zone
+* @param  pLine: line to display
+* @param  BackColor: background color
+* @retval None
+*/
+static void LCD_LOG_DrawLine (uint16_t Row, const LCD_LOG_line *pLine, uint16_t BackColor)
+{
+  sFONT *cFont = LCD_GetFont();
+  LCD_LOG_line *pShadow = &LCD_ShadowBuffer[Row];
+  uint16_t Cols, Col = 0, Start, First, Last;
+  
+  Cols = LCD_PIXEL_WIDTH / cFont->Width;
+  if(Cols > XWINDOW_MAX)
+  {
+    Cols = XWINDOW_MAX;
+  }
+  
+  while((Col < Cols) && (pLine->line[Col] != 0))
+  {
+    Start = Col;
+    First = cFont->Height;
+    Last = 0;
+    while((Col < Cols) && (pLine->line[Col] != 0) &&
+          LCD_LOG_CharDiff(cFont, pShadow, pLine, Col, &First, &Last))
+    {
+      Col++;
+    }
+    if(Col == Start)
+    {
+      Col++;
+      continue;
+    }
+    LCD_LOG_DrawChars(Row, pLine, Start, Col - Start, First, Last, BackColor);
+    for(; Start < Col; Start++)
+    {
+      pShadow->line[Start] = LCD_LOG_Ascii(pLine->line[Start]);
+    }
+  }
+  /* 字符串提前结束, 后面的字符没有画, 换色后不再可信 */
+  if(pShadow->color != pLine->color)
+  {
+    for(; Col < Cols; Col++)
+    {
+      pShadow->line[Col] = LCD_SHADOW_UNKNOWN;
+    }
+  }
+  pShadow->color = pLine->color;
+}
+#else
 /**
 * @brief  Update the text area display
 * @param  None
@@ -376,6 +655,7 @@ static void LCD_LOG_UpdateDisplay (void)
   }
   
 }
+#endif /* LCD_LOG_INCREMENTAL */
 
 #ifdef LCD_SCROLL_ENABLED
 /**
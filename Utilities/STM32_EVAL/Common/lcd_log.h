@@ -73,6 +73,15 @@
 #else
  #define     LCD_CACHE_DEPTH     YWINDOW_SIZE
 #endif
+
+/* 1: 只重画与屏上不同的字符点行, 需要LCD驱动的blit接口; 0: 每行都整屏重画 */
+#ifndef LCD_LOG_INCREMENTAL
+ #if defined (LCD_BLIT_DMA_MIN)
+  #define    LCD_LOG_INCREMENTAL 1
+ #else
+  #define    LCD_LOG_INCREMENTAL 0
+ #endif
+#endif
 /**
   * @}
   */ 
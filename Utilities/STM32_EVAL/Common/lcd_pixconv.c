@@ -0,0 +1,254 @@
+/**
+  ******************************************************************************
+  * @file    lcd_pixconv.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Pixel format conversion of image lines to the RGB565 of the LCD.
+  *
+  *          Sources are in BMP byte order: 24bpp B,G,R; 32bpp B,G,R,x;
+  *          16bpp RGB565 little endian. The kernels load a word at a time
+  *          (4 pixels from 3 words for 24bpp) once the source is word
+  *          aligned, and store two pixels per word when the output is
+  *          contiguous. Step is the distance in pixels between two output
+  *          pixels: 1 for a line, -1 for a mirrored line, +/-height of the
+  *          destination for a line written as a column (rotated by 90
+  *          degrees, or transposed).
+  *
+  *          The word loads assume a little endian CPU (Cortex-M, x86).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "lcd_pixconv.h"
+
+/** @addtogroup Utilities
+  * @{
+  */
+
+/** @addtogroup STM32_EVAL
+  * @{
+  */
+
+/** @addtogroup Common
+  * @{
+  */
+
+/** @defgroup LCD_PIXCONV
+  * @brief LCD pixel format conversion module
+  * @{
+  */
+
+/** @defgroup LCD_PIXCONV_Private_Macros
+  * @{
+  */
+/* 字W的低3字节(B,G,R)转RGB565 */
+#define PIX_W0(W)          ((uint16_t)((((W) >> 8) & 0xF800) | (((W) >> 5) & 0x07E0) | (((W) >> 3) & 0x001F)))
+/* 24bpp的4个点在3个字W0,W1,W2中: B0G0R0B1 G1R1B2G2 R2B3G3R3 */
+#define PIX_W1(W0, W1)     ((uint16_t)(((W1) & 0xF800) | (((W1) << 3) & 0x07E0) | ((W0) >> 27)))
+#define PIX_W2(W1, W2)     ((uint16_t)((((W2) << 8) & 0xF800) | (((W1) >> 21) & 0x07E0) | (((W1) >> 19) & 0x001F)))
+#define PIX_W3(W2)         ((uint16_t)((((W2) >> 16) & 0xF800) | (((W2) >> 13) & 0x07E0) | (((W2) >> 11) & 0x001F)))
+
+#define IS_ALIGNED(P)      ((((uintptr_t)(P)) & 3) == 0)
+/**
+  * @}
+  */
+
+/** @defgroup LCD_PIXCONV_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  Converts 24bpp BGR pixels to RGB565.
+  * @param  pDst: first output pixel
+  * @param  Step: distance of the output pixels
+  * @param  pSrc: source pixels
+  * @param  Num: number of pixels
+  * @retval None
+  */
+void LCD_PixConv_888(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num)
+{
+  const uint32_t *pWord;
+  uint32_t *pOut;
+  uint32_t w0, w1, w2;
+
+  /* 源地址对齐到字之前逐点转换,最多3点 */
+  while(Num && !IS_ALIGNED(pSrc))
+  {
+    *pDst = LCD_PIXCONV_888(pSrc[0], pSrc[1], pSrc[2]);
+    pDst += Step;
+    pSrc += 3;
+    Num--;
+  }
+
+  pWord = (const uint32_t *)pSrc;
+  if((Step == 1) && IS_ALIGNED(pDst))
+  {
+    pOut = (uint32_t *)pDst;
+    for(; Num >= 4; Num -= 4)
+    {
+      w0 = pWord[0];
+      w1 = pWord[1];
+      w2 = pWord[2];
+      pWord += 3;
+      pOut[0] = PIX_W0(w0) | ((uint32_t)PIX_W1(w0, w1) << 16);
+      pOut[1] = PIX_W2(w1, w2) | ((uint32_t)PIX_W3(w2) << 16);
+      pOut += 2;
+    }
+    pDst = (uint16_t *)pOut;
+  }
+  else
+  {
+    for(; Num >= 4; Num -= 4)
+    {
+      w0 = pWord[0];
+      w1 = pWord[1];
+      w2 = pWord[2];
+      pWord += 3;
+      pDst[0] = PIX_W0(w0);
+      pDst[Step] = PIX_W1(w0, w1);
+      pDst[2 * Step] = PIX_W2(w1, w2);
+      pDst[3 * Step] = PIX_W3(w2);
+      pDst += 4 * Step;
+    }
+  }
+
+  pSrc = (const uint8_t *)pWord;
+  while(Num--)
+  {
+    *pDst = LCD_PIXCONV_888(pSrc[0], pSrc[1], pSrc[2]);
+    pDst += Step;
+    pSrc += 3;
+  }
+}
+
+/**
+  * @brief  Converts 32bpp BGRx pixels to RGB565.
+  * @param  pDst: first output pixel
+  * @param  Step: distance of the output pixels
+  * @param  pSrc: source pixels
+  * @param  Num: number of pixels
+  * @retval None
+  */
+void LCD_PixConv_8888(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num)
+{
+  const uint32_t *pWord;
+  uint32_t *pOut;
+
+  if(!IS_ALIGNED(pSrc))
+  {
+    while(Num--)
+    {
+      *pDst = LCD_PIXCONV_888(pSrc[0], pSrc[1], pSrc[2]);
+      pDst += Step;
+      pSrc += 4;
+    }
+    return;
+  }
+
+  pWord = (const uint32_t *)pSrc;
+  if((Step == 1) && IS_ALIGNED(pDst))
+  {
+    pOut = (uint32_t *)pDst;
+    for(; Num >= 2; Num -= 2)
+    {
+      *pOut++ = PIX_W0(pWord[0]) | ((uint32_t)PIX_W0(pWord[1]) << 16);
+      pWord += 2;
+    }
+    pDst = (uint16_t *)pOut;
+  }
+  while(Num--)
+  {
+    *pDst = PIX_W0(*pWord);
+    pDst += Step;
+    pWord++;
+  }
+}
+
+/**
+  * @brief  Copies 16bpp RGB565 pixels.
+  * @param  pDst: first output pixel
+  * @param  Step: distance of the output pixels
+  * @param  pSrc: source pixels
+  * @param  Num: number of pixels
+  * @retval None
+  */
+void LCD_PixConv_565(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num)
+{
+  const uint32_t *pWord;
+  uint32_t w;
+
+  if(Step == 1)
+  {
+    memcpy(pDst, pSrc, Num * 2);
+    return;
+  }
+
+  if(IS_ALIGNED(pSrc))
+  {
+    pWord = (const uint32_t *)pSrc;
+    for(; Num >= 2; Num -= 2)
+    {
+      w = *pWord++;
+      pDst[0] = (uint16_t)w;
+      pDst[Step] = (uint16_t)(w >> 16);
+      pDst += 2 * Step;
+    }
+    pSrc = (const uint8_t *)pWord;
+  }
+  while(Num--)
+  {
+    *pDst = pSrc[0] | (pSrc[1] << 8);
+    pDst += Step;
+    pSrc += 2;
+  }
+}
+
+/**
+  * @brief  Converts a line of a BMP picture to RGB565.
+  * @param  pDst: first output pixel
+  * @param  Step: distance of the output pixels
+  * @param  pSrc: source pixels
+  * @param  Num: number of pixels
+  * @param  BitsPerPixel: 16, 24 or 32
+  * @retval 1: converted, 0: unsupported format
+  */
+uint8_t LCD_PixConv_Line(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num, uint16_t BitsPerPixel)
+{
+  switch(BitsPerPixel)
+  {
+  case 16:
+    LCD_PixConv_565(pDst, Step, pSrc, Num);
+    break;
+  case 24:
+    LCD_PixConv_888(pDst, Step, pSrc, Num);
+    break;
+  case 32:
+    LCD_PixConv_8888(pDst, Step, pSrc, Num);
+    break;
+  default:
+    return 0;
+  }
+  return 1;
+}
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file    lcd_pixconv.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   header for the lcd_pixconv.c file
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef  __LCD_PIXCONV_H__
+#define  __LCD_PIXCONV_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/** @addtogroup Utilities
+  * @{
+  */
+
+/** @addtogroup STM32_EVAL
+  * @{
+  */
+
+/** @addtogroup Common
+  * @{
+  */
+
+/** @defgroup LCD_PIXCONV
+  * @brief
+  * @{
+  */
+
+/** @defgroup LCD_PIXCONV_Exported_Macros
+  * @{
+  */
+/* 一个BGR点(BMP的字节顺序)转RGB565, 与ASSEMBLE_RGB相同 */
+#define LCD_PIXCONV_888(B, G, R)  ((uint16_t)((((R) & 0xF8) << 8) | (((G) & 0xFC) << 3) | ((B) >> 3)))
+/**
+  * @}
+  */
+
+/** @defgroup LCD_PIXCONV_Exported_FunctionsPrototype
+  * @{
+  */
+void    LCD_PixConv_888(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num);
+void    LCD_PixConv_8888(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num);
+void    LCD_PixConv_565(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num);
+uint8_t LCD_PixConv_Line(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num, uint16_t BitsPerPixel);
+/**
+  * @}
+  */
+
+#endif /* __LCD_PIXCONV_H__ */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
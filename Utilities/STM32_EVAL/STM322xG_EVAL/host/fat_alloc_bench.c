@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file    fat_alloc_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Cluster allocation of FatFs with the free cluster map
+  *          (_USE_FREEMAP) and without it (the same file built with
+  *          _USE_FREEMAP 0 as fat_alloc_bench_nomap, Makefile).
+  *          FatFs is built for the PC (FATFS_HOST) on a 256 MB FAT32 image
+  *          of 2 KB clusters, 90% full of 2 MB files with a one cluster file
+  *          after each; all sectors and FAT sectors read by ff.c are
+  *          counted below it. One write is f_open, 2 KB f_write, f_close.
+  *          - first write with an unknown FSInfo (no start point);
+  *          - first write after a remount: FSInfo holds the start point of
+  *            the last allocation; also with the start point dropped as the
+  *            sync left it before (free count unknown, FSInfo not written);
+  *          - f_getfree and the first write after it: the scan fills the
+  *            map and the start point; also with the start point dropped;
+  *          - 8 one cluster holes, the free end of the volume filled, 8
+  *            writes that wrap around into the holes;
+  *          - f_prealloc of 500 clusters into a hole of 1000 left by a
+  *            removed file;
+  *          - first write after a remount with a valid FSInfo.
+  *          Usage: fat_alloc_bench
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ff.h"
+#include "diskio.h"
+
+/* Private define ------------------------------------------------------------*/
+#ifndef IMG_PATH
+#define IMG_PATH         "build/fat_alloc.img"
+#endif
+#define IMG_SIZE         (256u * 1024 * 1024)
+#define CLUSTER          2048
+#define BIG_CLUSTERS     1000
+#define FULL_PERCENT     90
+#define HOLE_NUM         8
+#define PREALLOC         500                    //簇
+#define NAME_LEN         20                     //"0:BIGnnn.BIN", nnn最长10位
+
+/* FSInfo: 空闲簇数, 之后是下一个空闲簇 */
+#define FSI_FREE_COUNT   488
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+static int      Failed;
+static uint8_t  Buf[CLUSTER];
+static uint32_t SectorRd;
+static uint32_t FatRd;
+static uint32_t Pairs;                          //BIGnnn.BIN + SMLnnn.BIN
+static uint32_t Written;                        //NEWnnn.BIN
+
+/* Private functions ---------------------------------------------------------*/
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* 镜像文件上的驱动, 计读扇区数和其中的FAT扇区数 */
+static DSTATUS Count_Initialize(void)
+{
+  return DiskImg_Drv.initialize();
+}
+
+static DSTATUS Count_Status(void)
+{
+  return DiskImg_Drv.status();
+}
+
+static DRESULT Count_Read(BYTE *buff, DWORD sector, BYTE count)
+{
+  SectorRd += count;
+  if(Fs.fs_type && (sector >= Fs.fatbase) && (sector < Fs.fatbase + Fs.sects_fat * Fs.n_fats))
+  {
+    FatRd += count;
+  }
+  return DiskImg_Drv.read(buff, sector, count);
+}
+
+static DRESULT Count_Write(const BYTE *buff, DWORD sector, BYTE count)
+{
+  return DiskImg_Drv.write(buff, sector, count);
+}
+
+static DRESULT Count_Ioctl(BYTE ctrl, void *buff)
+{
+  return DiskImg_Drv.ioctl(ctrl, buff);
+}
+
+static const DISKIO_DRV Count_Drv =
+{
+  Count_Initialize, Count_Status, Count_Read, Count_Write, Count_Ioctl
+};
+
+static void Count_Clear(void)
+{
+  SectorRd = 0;
+  FatRd = 0;
+}
+
+static void Report(const char *name)
+{
+  printf("   %-52s %7u %7u\n", name, SectorRd, FatRd);
+}
+
+static int Mount(void)
+{
+  DIR dir;
+
+  f_mount(0, 0);
+  f_mount(0, &Fs);
+  return f_opendir(&dir, "0:") == FR_OK;
+}
+
+/* 卸载后把FSInfo的空闲簇数和起点改为未知 */
+static void Forget_FsInfo(void)
+{
+  DWORD sect = Fs.fsi_sector;
+  BYTE sec[512];
+
+  f_mount(0, 0);
+  Check((DiskImg_Drv.read(sec, sect, 1) == RES_OK), "FSInfo read");
+  memset(sec + FSI_FREE_COUNT, 0xFF, 8);
+  Check((DiskImg_Drv.write(sec, sect, 1) == RES_OK), "FSInfo write");
+}
+
+/* 长为clusters簇的文件, 只分配簇链不写数据 */
+static int Make_File(const char *name, uint32_t clusters)
+{
+  FIL fil;
+
+  return (f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+         && (f_lseek(&fil, clusters * CLUSTER) == FR_OK) && (fil.fsize == clusters * CLUSTER)
+         && (f_close(&fil) == FR_OK);
+}
+
+/* 一次写: 新文件, 2KB */
+static int Write_One(void)
+{
+  char name[NAME_LEN];
+  FIL fil;
+  UINT bw;
+
+  snprintf(name, sizeof(name), "0:NEW%03u.BIN", Written++);
+  return (f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+         && (f_write(&fil, Buf, CLUSTER, &bw) == FR_OK) && (bw == CLUSTER)
+         && (f_close(&fil) == FR_OK);
+}
+
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+  char name[NAME_LEN];
+  uint32_t used = 0;
+  int ok = 1;
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(0, &Count_Drv);
+  f_mount(0, &Fs);
+  if((f_mkfs(0, 0, CLUSTER) != FR_OK) || !Mount())
+  {
+    return 0;
+  }
+  while(ok && (used < (Fs.max_clust - 2) / 100 * FULL_PERCENT))
+  {
+    snprintf(name, sizeof(name), "0:BIG%03u.BIN", Pairs);
+    ok = Make_File(name, BIG_CLUSTERS);
+    snprintf(name, sizeof(name), "0:SML%03u.BIN", Pairs);
+    ok = ok && Make_File(name, 1);
+    used += BIG_CLUSTERS + 1;
+    Pairs++;
+  }
+  return ok;
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  char name[NAME_LEN];
+  FATFS *fs;
+  DWORD nfree;
+  uint32_t i, tail;
+  FIL fil;
+
+  setvbuf(stdout, 0, _IOLBF, 0);
+  if(!Bench_MakeImage())
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  printf("== cluster allocation, _USE_FREEMAP %d", _USE_FREEMAP);
+#if _USE_FREEMAP
+  printf(" (%u clusters a bit)", 1u << Fs.fmap_shift);
+#endif
+  printf("\n   %u MB FAT%s image, cluster %u bytes, %u clusters, %u%% in use, FAT %u sectors\n",
+         IMG_SIZE >> 20, (Fs.fs_type == FS_FAT32) ? "32" : "16", CLUSTER,
+         (unsigned)(Fs.max_clust - 2), (unsigned)(Pairs * (BIG_CLUSTERS + 1) * 100 / (Fs.max_clust - 2)),
+         (unsigned)Fs.sects_fat);
+  Check(Fs.fs_type == FS_FAT32, "FAT32 volume");
+  printf("   %-52s %7s %7s\n", "sectors read", "all", "FAT");
+
+  Forget_FsInfo();
+  Check(Mount(), "mount");
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("unknown FSInfo, first write");
+
+  Check(Mount(), "mount");
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("remount, first write");
+
+  Forget_FsInfo();
+  Check(Mount(), "mount");
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("remount, start point not kept (before 8ab021b)");
+
+  Forget_FsInfo();
+  Check(Mount(), "mount");
+  Count_Clear();
+  Check(f_getfree("0:", &nfree, &fs) == FR_OK, "f_getfree");
+  Report("unknown FSInfo, f_getfree");
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("  then first write");
+
+  Forget_FsInfo();
+  Check(Mount(), "mount");
+  Check(f_getfree("0:", &nfree, &fs) == FR_OK, "f_getfree");
+  Fs.last_clust = 0xFFFFFFFF;           //f_getfree之前不设起点
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("  then first write, no start point (before 8ab021b)");
+
+  /* 8个1簇的空洞, 填满卷尾的空闲簇, 之后的写绕回到空洞 */
+  for(i = 0; i < HOLE_NUM; i++)
+  {
+    snprintf(name, sizeof(name), "0:SML%03u.BIN", (i * 2 + 1) * Pairs / (HOLE_NUM * 2));
+    Check(f_unlink(name) == FR_OK, "f_unlink");
+  }
+  Check(f_getfree("0:", &nfree, &fs) == FR_OK, "f_getfree");
+  tail = nfree - HOLE_NUM;
+  Check(Make_File("0:TAIL.BIN", tail), "tail");
+  Count_Clear();
+  for(i = 0; i < HOLE_NUM; i++)
+  {
+    Check(Write_One(), "write");
+  }
+  Report("8 writes into holes after the wrap around");
+  Check((f_getfree("0:", &nfree, &fs) == FR_OK) && (nfree == 0), "volume full");
+
+  /* 删除一个BIG文件, 在其空洞中预分配 */
+  snprintf(name, sizeof(name), "0:BIG%03u.BIN", Pairs / 3);
+  Check(f_unlink(name) == FR_OK, "f_unlink");
+  Count_Clear();
+  Check((f_open(&fil, "0:PRE.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+        && (f_prealloc(&fil, PREALLOC * CLUSTER) == FR_OK), "f_prealloc");
+  Report("f_prealloc of 500 clusters into a hole");
+  f_close(&fil);
+
+  Check(Mount(), "mount");
+  Count_Clear();
+  Check(Write_One(), "write");
+  Report("valid FSInfo, remount, first write");
+
+  f_mount(0, 0);
+  diskimg_close();
+  unlink(IMG_PATH);
+  printf("\n%s\n", Failed ? "FAILED" : "OK");
+  return Failed;
+}
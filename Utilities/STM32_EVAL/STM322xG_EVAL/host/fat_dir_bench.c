@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    fat_dir_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Open latency of FatFs against the number of files in a
+  *          directory, long file names, with the directory index of ff.c
+  *          (_USE_DIRIDX) and without it (the same file built with
+  *          _USE_DIRIDX 0 as fat_dir_bench_noidx, Makefile).
+  *          FatFs is built for the PC (FATFS_HOST) on a FAT32 image file;
+  *          the sectors read by ff.c are counted below it. As MSC_Bench of
+  *          usbh_usr.c: BENCH_OPEN_NUM opens of "NNN bench file.tmp" in a
+  *          directory of 16, 64, 256, 500 and 600 files; the first open after
+  *          the files were created builds the index and is in the average.
+  *          FATFS.didx is set after f_mount as usbh_usr.c does; an index
+  *          holds _DIRIDX_SIZE objects, the opens of the objects after them
+  *          (600 files) search from the end of the index.
+  *          Usage: fat_dir_bench
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ff.h"
+#include "diskio.h"
+
+/* Private define ------------------------------------------------------------*/
+#ifndef IMG_PATH
+#define IMG_PATH         "build/fat_dir.img"
+#endif
+#define IMG_SIZE         (512u * 1024 * 1024)   //4KB簇时为FAT32
+#define CLUSTER          4096
+#define BENCH_DIR_NAME   "0:BENCHDIR"
+#define BENCH_OPEN_NUM   50
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t DirFiles[] = { 16, 64, 256, 500, 600 };
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static int      Failed;
+static uint32_t SectorRd;
+
+/* Private functions ---------------------------------------------------------*/
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* 镜像文件上的驱动, 计读扇区数 */
+static DSTATUS Count_Initialize(void)
+{
+  return DiskImg_Drv.initialize();
+}
+
+static DSTATUS Count_Status(void)
+{
+  return DiskImg_Drv.status();
+}
+
+static DRESULT Count_Read(BYTE *buff, DWORD sector, BYTE count)
+{
+  SectorRd += count;
+  return DiskImg_Drv.read(buff, sector, count);
+}
+
+static DRESULT Count_Write(const BYTE *buff, DWORD sector, BYTE count)
+{
+  return DiskImg_Drv.write(buff, sector, count);
+}
+
+static DRESULT Count_Ioctl(BYTE ctrl, void *buff)
+{
+  return DiskImg_Drv.ioctl(ctrl, buff);
+}
+
+static const DISKIO_DRV Count_Drv =
+{
+  Count_Initialize, Count_Status, Count_Read, Count_Write, Count_Ioctl
+};
+
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+  DIR dir;
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(0, &Count_Drv);
+  f_mount(0, &Fs);
+#if _USE_DIRIDX
+  Fs.didx = Idx;
+#endif
+  return (f_mkfs(0, 0, CLUSTER) == FR_OK) && (f_opendir(&dir, "0:") == FR_OK);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  char name[40];
+  uint32_t i, n, k, ofs, first;
+  FIL fil;
+  FRESULT res = FR_OK;
+
+  setvbuf(stdout, 0, _IOLBF, 0);
+  if(!Bench_MakeImage())
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  printf("== f_open in a directory of long named files, _USE_DIRIDX %d", _USE_DIRIDX);
+#if _USE_DIRIDX
+  printf(" (up to %d objects, %d clusters, %d bytes each on the target)", _DIRIDX_SIZE, _DIRIDX_CLST,
+         _DIRIDX_SIZE * 6 + _DIRIDX_CLST * 4 + 12);
+#endif
+  printf("\n   %u MB FAT%s image, cluster %u bytes\n", IMG_SIZE >> 20,
+         (Fs.fs_type == FS_FAT32) ? "32" : "16", CLUSTER);
+  Check(Fs.fs_type == FS_FAT32, "FAT32 volume");
+  printf("   %-8s %12s %14s %10s\n", "files", "first open", "sectors/open", "indexed");
+
+  Check(f_mkdir(BENCH_DIR_NAME) == FR_OK, "f_mkdir");
+  for(i = 0, k = 0; (k < sizeof(DirFiles) / sizeof(DirFiles[0])) && (res == FR_OK); k++)
+  {
+    n = DirFiles[k];
+    for(; (i < n) && (res == FR_OK); i++)
+    {
+      sprintf(name, BENCH_DIR_NAME "/%03u bench file.tmp", i);
+      res = f_open(&fil, name, FA_CREATE_NEW | FA_WRITE);
+      f_close(&fil);
+    }
+    SectorRd = 0;
+    first = 0;
+    for(ofs = 0; (ofs < BENCH_OPEN_NUM) && (res == FR_OK); ofs++)
+    {
+      sprintf(name, BENCH_DIR_NAME "/%03u bench file.tmp", (ofs * 37) % n);
+      res = f_open(&fil, name, FA_OPEN_EXISTING | FA_READ);
+      f_close(&fil);
+      if(ofs == 0)
+      {
+        first = SectorRd;
+      }
+    }
+    printf("   %-8u %12u %14.1f %10u\n", (unsigned)n, (unsigned)first, (double)SectorRd / BENCH_OPEN_NUM,
+#if _USE_DIRIDX
+           (unsigned)((n < _DIRIDX_SIZE) ? n : _DIRIDX_SIZE));
+#else
+           0u);
+#endif
+  }
+  Check(res == FR_OK, "f_open");
+
+  f_mount(0, 0);
+  diskimg_close();
+  unlink(IMG_PATH);
+  printf("\n%s\n", Failed ? "FAILED" : "OK");
+  return Failed;
+}
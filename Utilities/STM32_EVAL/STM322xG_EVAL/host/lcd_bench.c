@@ -0,0 +1,175 @@
+/**
+  ******************************************************************************
+  * @file    lcd_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Blit benchmark on the host framebuffer: a 24bpp picture is drawn
+  *          as Show_Image did (LCD_SetPoint per pixel) and as it does now
+  *          (one LCD_Blit window per BMP row), the two screens are compared.
+  *          Prints the FSMC accesses per pixel and the time they take on
+  *          the board (write cycle of LCD_FSMCConfig: ADDSET 1 + DATAST 2
+  *          + 1 HCLK at 120MHz), and the host Mpixel/s of the driver path.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lcd_hostfb.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_LOOPS      20
+#define NS_PER_ACCESS    (4 * 1000 / 120)   /* 4 HCLK @ 120MHz */
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t  Picture[LCD_PIXEL_WIDTH * LCD_PIXEL_WIDTH * 3];  /* BGR, 自底向上 */
+static uint16_t Line[LCD_PIXEL_WIDTH];
+static uint16_t Screen[LCD_PIXEL_HEIGHT][LCD_PIXEL_WIDTH];
+
+/* Private functions ---------------------------------------------------------*/
+static uint16_t RGB565(const uint8_t *p)
+{
+  return (p[2] & 0xF8) << 8 | (p[1] & 0xFC) << 3 | p[0] >> 3;
+}
+
+/* 原Show_Image: 每点设一次光标 */
+static void Draw_SetPoint(uint16_t Width, uint16_t Height)
+{
+  uint32_t i;
+  uint16_t Xpos = 0, Ypos = 0;
+
+  for(i = 0; i < (uint32_t)Width * Height * 3; i += 3)
+  {
+    if(Width < Height)
+    {
+      LCD_SetPoint(Xpos, Ypos, RGB565(&Picture[i]));
+      if(++Xpos >= Width) { Xpos = 0; Ypos++; }
+    }
+    else
+    {
+      LCD_SetPoint(239 - Xpos, Ypos, RGB565(&Picture[i]));
+      if(++Ypos >= Width) { Ypos = 0; Xpos++; }
+    }
+  }
+}
+
+/* 现Show_Image: 每行一个窗口 */
+static void Draw_Blit(uint16_t Width, uint16_t Height)
+{
+  uint16_t row, col;
+  const uint8_t *p = Picture;
+
+  for(row = 0; row < Height; row++)
+  {
+    for(col = 0; col < Width; col++, p += 3)
+    {
+      Line[col] = RGB565(p);
+    }
+    if(Width < Height)
+    {
+      LCD_BlitBegin(0, row, Width, 1, LCD_DIR_VERTICAL);
+    }
+    else
+    {
+      LCD_BlitBegin(239 - row, 0, 1, Width, LCD_DIR_HORIZONTAL);
+    }
+    LCD_BlitWrite(Line, Width);
+  }
+  LCD_BlitEnd();
+}
+
+static void Screen_Get(void)
+{
+  uint16_t x, y;
+
+  for(x = 0; x < LCD_PIXEL_HEIGHT; x++)
+    for(y = 0; y < LCD_PIXEL_WIDTH; y++)
+      Screen[x][y] = LCD_HostFb_GetPixel(x, y);
+}
+
+static int Screen_Same(void)
+{
+  uint16_t x, y;
+
+  for(x = 0; x < LCD_PIXEL_HEIGHT; x++)
+    for(y = 0; y < LCD_PIXEL_WIDTH; y++)
+      if(Screen[x][y] != LCD_HostFb_GetPixel(x, y)) return 0;
+  return 1;
+}
+
+static double Now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void Bench(const char *name, void (*draw)(uint16_t, uint16_t), uint16_t Width, uint16_t Height)
+{
+  LCD_HOSTFB_STATS_ST *s = LCD_HostFb_GetStats();
+  uint32_t pix = (uint32_t)Width * Height;
+  double t;
+  int i;
+
+  LCD_HostFb_ClearStats();
+  draw(Width, Height);
+  printf("   %-9s %5.2f bus/pixel, %3lu index writes/row, board %4lu ms",
+         name, (double)s->Bus / pix, (unsigned long)(s->Index / Height),
+         (unsigned long)((unsigned long long)s->Bus * NS_PER_ACCESS / 1000000));
+  t = Now();
+  for(i = 0; i < BENCH_LOOPS; i++)
+  {
+    draw(Width, Height);
+  }
+  t = Now() - t;
+  printf(", host %6.1f Mpixel/s\n", pix * BENCH_LOOPS / t / 1e6);
+}
+
+/**
+  * @brief  Main program.
+  */
+int main(int argc, char **argv)
+{
+  static const uint16_t Dev[] = {0x9325, 0x8989, 0x9320};
+  static const uint16_t Size[][2] = {{320, 240}, {240, 320}};
+  LCD_HOSTFB_STATS_ST *s = LCD_HostFb_GetStats();
+  uint32_t i;
+  int d, k, same;
+
+  for(i = 0; i < sizeof(Picture); i++)
+  {
+    Picture[i] = (uint8_t)(i * 7 + i / 960);
+  }
+
+  for(d = 0; d < 3; d++)
+  {
+    LCD_HostFb_Init(Dev[d]);
+    STM322xG_LCD_Init();
+    printf("\n LCD %04X\n", Dev[d]);
+    for(k = 0; k < 2; k++)
+    {
+      printf("  %dx%d 24bpp\n", Size[k][0], Size[k][1]);
+      LCD_Clear(LCD_COLOR_BLACK);
+      Draw_SetPoint(Size[k][0], Size[k][1]);
+      Screen_Get();
+      LCD_Clear(LCD_COLOR_BLACK);
+      Draw_Blit(Size[k][0], Size[k][1]);
+      same = Screen_Same();
+      if((argc > 1) && (k == 0))
+      {
+        LCD_HostFb_SavePPM(argv[1]);
+      }
+      Bench("SetPoint", Draw_SetPoint, Size[k][0], Size[k][1]);
+      Bench("Blit", Draw_Blit, Size[k][0], Size[k][1]);
+      printf("   screens %s\n", same ? "identical" : "DIFFER");
+    }
+    LCD_SetColors(LCD_COLOR_YELLOW, LCD_COLOR_BLUE);
+    LCD_HostFb_ClearStats();
+    LCD_DrawFullRect(100, 200, 100, 100);
+    printf("  DrawFullRect 100x100: %lu bus accesses\n", (unsigned long)s->Bus);
+  }
+  return 0;
+}
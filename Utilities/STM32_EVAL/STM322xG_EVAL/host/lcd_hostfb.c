@@ -0,0 +1,312 @@
+/**
+  ******************************************************************************
+  * @file    lcd_hostfb.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Host framebuffer backend of stm322xg_eval_lcd.c: the FSMC bus
+  *          functions of the driver on an emulated controller. The GRAM
+  *          address counter follows the window and entry mode registers
+  *          (ILI9320/ILI9325: R50h-R53h, R03h; SSD1289: R44h-R46h, R11h).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "lcd_hostfb.h"
+
+/* Private define ------------------------------------------------------------*/
+#define GRAM_REG        0x22
+
+/* Private variables ---------------------------------------------------------*/
+uint16_t LCD_HostFb_GRAM[LCD_PIXEL_HEIGHT][LCD_PIXEL_WIDTH];
+
+static uint16_t Code;             //模拟的控制器
+static uint16_t Index;            //当前寄存器索引
+static uint16_t Reg[256];
+static uint16_t AcH, AcV;         //GRAM地址计数器
+static LCD_HOSTFB_STATS_ST Stats;
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Moves one address of the counter inside [Start, End].
+  * @retval 1: wrapped
+  */
+static uint8_t Step(uint16_t *pAc, uint16_t Start, uint16_t End, uint16_t Inc)
+{
+  if(Inc)
+  {
+    if(*pAc >= End)
+    {
+      *pAc = Start;
+      return 1;
+    }
+    (*pAc)++;
+  }
+  else
+  {
+    if(*pAc <= Start)
+    {
+      *pAc = End;
+      return 1;
+    }
+    (*pAc)--;
+  }
+  return 0;
+}
+
+/**
+  * @brief  Updates the address counter after a GRAM write.
+  */
+static void GRAM_Next(void)
+{
+  uint16_t entry, hsa, hea, vsa, vea;
+
+  if(Code == 0x8989)
+  {
+    entry = Reg[0x11];
+    hsa = Reg[0x44] & 0xFF;
+    hea = Reg[0x44] >> 8;
+    vsa = Reg[0x45];
+    vea = Reg[0x46];
+  }
+  else
+  {
+    entry = Reg[0x03];
+    hsa = Reg[0x50];
+    hea = Reg[0x51];
+    vsa = Reg[0x52];
+    vea = Reg[0x53];
+  }
+  /* I/D0: 水平递增, I/D1: 垂直递增, AM: 沿垂直方向 */
+  if(entry & 0x08)
+  {
+    if(Step(&AcV, vsa, vea, entry & 0x20))
+    {
+      Step(&AcH, hsa, hea, entry & 0x10);
+    }
+  }
+  else
+  {
+    if(Step(&AcH, hsa, hea, entry & 0x10))
+    {
+      Step(&AcV, vsa, vea, entry & 0x20);
+    }
+  }
+}
+
+static void Bus_Index(uint16_t i)
+{
+  Stats.Bus++;
+  Stats.Index++;
+  Index = i & 0xFF;
+}
+
+static void Bus_Data(uint16_t d)
+{
+  Stats.Bus++;
+  if(Index == GRAM_REG)
+  {
+    if((AcH < LCD_PIXEL_HEIGHT) && (AcV < LCD_PIXEL_WIDTH))
+    {
+      LCD_HostFb_GRAM[AcH][AcV] = d;
+    }
+    Stats.Pixel++;
+    GRAM_Next();
+    return;
+  }
+  Reg[Index] = d;
+  if(Code == 0x8989)
+  {
+    if(Index == 0x4E) AcH = d & 0xFF;
+    if(Index == 0x4F) AcV = d & 0x1FF;
+  }
+  else
+  {
+    if(Index == 0x20) AcH = d & 0xFF;
+    if(Index == 0x21) AcV = d & 0x1FF;
+  }
+}
+
+static uint16_t Bus_Read(void)
+{
+  Stats.Bus++;
+  if(Index == GRAM_REG)
+  {
+    return ((AcH < LCD_PIXEL_HEIGHT) && (AcV < LCD_PIXEL_WIDTH)) ? LCD_HostFb_GRAM[AcH][AcV] : 0;
+  }
+  return (Index == 0) ? Code : Reg[Index];
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Resets the emulated controller, call STM322xG_LCD_Init next.
+  * @param  Device: 0x9320, 0x9325 or 0x8989, read back from R00h
+  */
+void LCD_HostFb_Init(uint16_t Device)
+{
+  Code = Device;
+  Index = 0;
+  AcH = 0;
+  AcV = 0;
+  memset(Reg, 0, sizeof(Reg));
+  memset(LCD_HostFb_GRAM, 0, sizeof(LCD_HostFb_GRAM));
+  /* 复位后窗口为整屏 */
+  Reg[0x44] = 0xEF00;
+  Reg[0x46] = 0x013F;
+  Reg[0x51] = 0x00EF;
+  Reg[0x53] = 0x013F;
+  LCD_HostFb_ClearStats();
+}
+
+/**
+  * @brief  Reads a pixel with the coordinates of LCD_SetPoint.
+  * @param  Xpos: line, Ypos: column
+  */
+uint16_t LCD_HostFb_GetPixel(uint16_t Xpos, uint16_t Ypos)
+{
+  uint16_t h, v;
+
+  if(Code == 0x8989)
+  {
+    h = Xpos;
+    v = Ypos;
+  }
+  else if(Code == 0x9325)
+  {
+    h = Xpos;
+    v = 0x13F - Ypos;
+  }
+  else
+  {
+    h = Ypos;
+    v = 0x13F - Xpos;
+  }
+  if((h >= LCD_PIXEL_HEIGHT) || (v >= LCD_PIXEL_WIDTH))
+  {
+    return 0;
+  }
+  return LCD_HostFb_GRAM[h][v];
+}
+
+LCD_HOSTFB_STATS_ST *LCD_HostFb_GetStats(void)
+{
+  return &Stats;
+}
+
+void LCD_HostFb_ClearStats(void)
+{
+  memset(&Stats, 0, sizeof(Stats));
+}
+
+/**
+  * @brief  Writes the screen as a binary PPM, 320 x 240.
+  * @retval 0: OK
+  */
+int LCD_HostFb_SavePPM(const char *path)
+{
+  FILE *f;
+  uint16_t x, y, c;
+
+  f = fopen(path, "wb");
+  if(!f) return -1;
+  fprintf(f, "P6\n%d %d\n255\n", LCD_PIXEL_WIDTH, LCD_PIXEL_HEIGHT);
+  for(x = 0; x < LCD_PIXEL_HEIGHT; x++)
+  {
+    for(y = 0; y < LCD_PIXEL_WIDTH; y++)
+    {
+      c = LCD_HostFb_GetPixel(x, y);
+      fputc((c >> 8) & 0xF8, f);
+      fputc((c >> 3) & 0xFC, f);
+      fputc((c << 3) & 0xF8, f);
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+/*------------------------------------------------------------------------*/
+/* Bus access of stm322xg_eval_lcd.c                                      */
+
+void LCD_WriteReg(uint8_t LCD_Reg, uint16_t LCD_RegValue)
+{
+  Bus_Index(LCD_Reg);
+  Bus_Data(LCD_RegValue);
+}
+
+uint16_t LCD_ReadReg(uint8_t LCD_Reg)
+{
+  Bus_Index(LCD_Reg);
+  return Bus_Read();
+}
+
+void LCD_WriteRAM_Prepare(void)
+{
+  Bus_Index(LCD_REG_34);
+}
+
+void LCD_WriteRAM(uint16_t RGB_Code)
+{
+  Bus_Data(RGB_Code);
+}
+
+uint16_t LCD_ReadRAM(void)
+{
+  Bus_Index(LCD_REG_34);
+  return Bus_Read();
+}
+
+void LCD_CtrlLinesConfig(void)
+{
+}
+
+void LCD_FSMCConfig(void)
+{
+}
+
+/*------------------------------------------------------------------------*/
+/* Standard peripheral library calls left in the driver                   */
+
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct)
+{
+}
+
+void GPIO_PinAFConfig(GPIO_TypeDef* GPIOx, uint16_t GPIO_PinSource, uint8_t GPIO_AF)
+{
+}
+
+void GPIO_SetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+}
+
+void GPIO_ResetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+}
+
+void RCC_AHB1PeriphClockCmd(uint32_t RCC_AHB1Periph, FunctionalState NewState)
+{
+}
+
+void RCC_AHB3PeriphClockCmd(uint32_t RCC_AHB3Periph, FunctionalState NewState)
+{
+}
+
+void FSMC_NORSRAMDeInit(uint32_t FSMC_Bank)
+{
+}
+
+void FSMC_NORSRAMCmd(uint32_t FSMC_Bank, FunctionalState NewState)
+{
+}
+
+/* DUG_PRINTF of the driver */
+void xprintf(const char *fmt, ...)
+{
+  va_list arp;
+
+  va_start(arp, fmt);
+  vprintf(fmt, arp);
+  va_end(arp);
+}
@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    lcd_hostfb.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Host framebuffer backend of stm322xg_eval_lcd.c. The driver is
+  *          built on a PC with LCD_HOSTFB defined, its bus accesses go to an
+  *          emulated ILI9320/ILI9325/SSD1289 whose GRAM is a plain array.
+  *          Not part of the firmware project:
+  *
+  *          gcc -O2 -DUSE_STDPERIPH_DRIVER -DSTM32F2XX -DLCD_HOSTFB -I. -I..
+  *              -I../../Common -I<CMSIS and StdPeriph inc> ../stm322xg_eval_lcd.c
+  *              lcd_hostfb.c lcd_bench.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __LCD_HOSTFB_H
+#define __LCD_HOSTFB_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm322xg_eval_lcd.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t  Bus;          //FSMC访问次数(写索引,写/读数据各算一次)
+  uint32_t  Index;        //其中写索引的次数
+  uint32_t  Pixel;        //写GRAM的点数
+}
+LCD_HOSTFB_STATS_ST;
+
+/* Exported variables --------------------------------------------------------*/
+extern uint16_t LCD_HostFb_GRAM[LCD_PIXEL_HEIGHT][LCD_PIXEL_WIDTH]; //[水平地址][垂直地址]
+
+/* Exported functions --------------------------------------------------------*/
+void     LCD_HostFb_Init(uint16_t Device);
+uint16_t LCD_HostFb_GetPixel(uint16_t Xpos, uint16_t Ypos);
+LCD_HOSTFB_STATS_ST *LCD_HostFb_GetStats(void);
+void     LCD_HostFb_ClearStats(void);
+int      LCD_HostFb_SavePPM(const char *path);
+
+#endif /* __LCD_HOSTFB_H */
@@ -0,0 +1,232 @@
+/**
+  ******************************************************************************
+  * @file    lcd_log_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   LCD log console benchmark on the host framebuffer: log lines are
+  *          written through the printf redirection of lcd_log.c, a short log
+  *          text and a full width dump. Prints the FSMC accesses and glyph
+  *          pixels per line, the time they take on the board (write cycle of
+  *          LCD_FSMCConfig, see lcd_bench.c), the lines/s this allows, and
+  *          the host time per line. Every few lines the text zone is checked
+  *          against the lines redrawn by LCD_DisplayStringLine. Not on the
+  *          ILI9320: its LCD_DrawChar writes the glyph rows across the GRAM
+  *          address increment, the screen depends on the drawing order.
+  *          Build it once more with -DLCD_LOG_INCREMENTAL=0 for the full
+  *          redraw of each line:
+  *
+  *          gcc -O2 -DUSE_STDPERIPH_DRIVER -DSTM32F2XX -DUSE_STM322xG_EVAL
+  *              -DLCD_HOSTFB -I. -I.. -I../../Common -I<CMSIS and StdPeriph inc>
+  *              -I<lcd_log_conf.h of the project> ../stm322xg_eval_lcd.c
+  *              ../../Common/lcd_log.c lcd_hostfb.c lcd_log_bench.c
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lcd_hostfb.h"
+#include "lcd_log.h"
+
+/* Private define ------------------------------------------------------------*/
+#define BENCH_LINES      2000
+#define CHECK_EVERY      7
+#define NS_PER_ACCESS    (4 * 1000 / 120)   /* 4 HCLK @ 120MHz */
+#define LOG_COLS         (LCD_PIXEL_WIDTH / 8)
+
+/* Private variables ---------------------------------------------------------*/
+static char     Shown[YWINDOW_SIZE][LOG_COLS + 1];    /* 文本区应显示的行 */
+static uint16_t ShownColor[YWINDOW_SIZE];
+static uint32_t ShownNum;
+static uint16_t Saved[LCD_PIXEL_HEIGHT][LCD_PIXEL_WIDTH];
+static uint32_t Seed = 1;
+static uint32_t Errors;
+
+/* Private function prototypes -----------------------------------------------*/
+PUTCHAR_PROTOTYPE;                  /* lcd_log.c的printf重定向 */
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Rand(void)
+{
+  Seed = Seed * 1103515245 + 12345;
+  return (Seed >> 16) & 0x7FFF;
+}
+
+static double Now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* USB主机和DFU调试输出那样的日志 */
+static uint16_t Text_Log(char *s, uint32_t n)
+{
+  switch(Rand() % 5)
+  {
+  case 0:
+    sprintf(s, "> MSC read LBA %lu, %u sectors", (unsigned long)(Rand() * 8), (unsigned)(Rand() % 64 + 1));
+    return LCD_LOG_DEFAULT_COLOR;
+  case 1:
+    sprintf(s, "  IMG%04u.BMP  %lu bytes", (unsigned)(n % 10000), (unsigned long)(Rand() * 5));
+    return LCD_LOG_DEFAULT_COLOR;
+  case 2:
+    sprintf(s, "DFU block %u of %u", (unsigned)(n % 512), 512u);
+    return Cyan;
+  case 3:
+    sprintf(s, "ERROR: stall on EP%u", (unsigned)(Rand() % 4));
+    return Red;
+  default:
+    sprintf(s, "> Device attached");
+    return LCD_LOG_DEFAULT_COLOR;
+  }
+}
+
+/* put_dump那样占满一行的十六进制 */
+static uint16_t Text_Dump(char *s, uint32_t n)
+{
+  uint32_t i;
+
+  sprintf(s, "%04lX:", (unsigned long)((n * 11) & 0xFFFF));
+  for(i = 0; i < 11; i++)
+  {
+    sprintf(s + 5 + i * 3, " %02X", (unsigned)(Rand() & 0xFF));
+  }
+  s[LOG_COLS] = 0;
+  return LCD_LOG_DEFAULT_COLOR;
+}
+
+static void Log_Line(const char *s, uint16_t Color)
+{
+  const char *p;
+  uint32_t r;
+
+  LCD_LineColor = Color;
+  for(p = s; *p; p++)
+  {
+    __io_putchar(*p);
+  }
+  __io_putchar('\n');
+  LCD_LineColor = LCD_LOG_DEFAULT_COLOR;
+
+  r = ShownNum % YWINDOW_SIZE;
+  memset(Shown[r], ' ', LOG_COLS);
+  memcpy(Shown[r], s, strlen(s));
+  ShownColor[r] = Color;
+  ShownNum++;
+}
+
+/* 记下的行按原来的方式重画, 屏幕不应改变 */
+static void Check(const char *name, uint32_t n)
+{
+  uint16_t TextColor, BackColor;
+  uint32_t i, first, rows;
+
+  if(LCD_BlitWindowed() == 0)
+  {
+    return;
+  }
+  memcpy(Saved, LCD_HostFb_GRAM, sizeof(Saved));
+  LCD_GetColors(&TextColor, &BackColor);
+  rows  = (ShownNum < YWINDOW_SIZE) ? ShownNum : YWINDOW_SIZE;
+  first = ShownNum - rows;
+  for(i = 0; i < rows; i++)
+  {
+    LCD_SetTextColor(ShownColor[(first + i) % YWINDOW_SIZE]);
+    LCD_DisplayStringLine((YWINDOW_MIN + i) * 12, (uint8_t *)Shown[(first + i) % YWINDOW_SIZE]);
+  }
+  if(memcmp(Saved, LCD_HostFb_GRAM, sizeof(Saved)))
+  {
+    printf("   %s: text zone DIFFERS after line %lu\n", name, (unsigned long)n);
+    Errors++;
+  }
+  memcpy(LCD_HostFb_GRAM, Saved, sizeof(Saved));
+  LCD_SetColors(TextColor, BackColor);
+}
+
+static void Bench(const char *name, uint16_t (*text)(char *, uint32_t))
+{
+  LCD_HOSTFB_STATS_ST *s = LCD_HostFb_GetStats();
+  static char Line[BENCH_LINES][LOG_COLS + 1];
+  static uint16_t Color[BENCH_LINES];
+  uint32_t n, bus, pixel;
+  double t;
+
+  for(n = 0; n < BENCH_LINES; n++)
+  {
+    Color[n] = text(Line[n], n);
+  }
+
+  /* 文本区未满时的行 */
+  LCD_LOG_ClearTextZone();
+  ShownNum = 0;
+  LCD_HostFb_ClearStats();
+  for(n = 0; n < YWINDOW_SIZE; n++)
+  {
+    Log_Line(Line[n], Color[n]);
+  }
+  printf("   %-5s fill  : %7.0f bus/line, %5.0f pixel/line\n", name,
+         (double)s->Bus / YWINDOW_SIZE, (double)s->Pixel / YWINDOW_SIZE);
+  Check(name, n);
+
+  /* 滚动 */
+  LCD_HostFb_ClearStats();
+  for(n = YWINDOW_SIZE; n < BENCH_LINES; n++)
+  {
+    Log_Line(Line[n], Color[n]);
+  }
+  bus = s->Bus;
+  pixel = s->Pixel;
+  n = BENCH_LINES - YWINDOW_SIZE;
+  printf("   %-5s scroll: %7.0f bus/line, %5.0f pixel/line, board %6.3f ms/line = %5.0f lines/s\n",
+         name, (double)bus / n, (double)pixel / n,
+         (double)bus / n * NS_PER_ACCESS / 1e6, 1e9 / ((double)bus / n * NS_PER_ACCESS));
+  Check(name, BENCH_LINES);
+
+  /* 逐行检查, 不计时 */
+  LCD_LOG_ClearTextZone();
+  ShownNum = 0;
+  for(n = 0; n < 120; n++)
+  {
+    Log_Line(Line[n], Color[n]);
+    if((n % CHECK_EVERY) == 0)
+    {
+      Check(name, n);
+    }
+  }
+
+  t = Now();
+  for(n = 0; n < BENCH_LINES; n++)
+  {
+    Log_Line(Line[n], Color[n]);
+  }
+  t = Now() - t;
+  printf("   %-5s host  : %6.2f us/line\n", name, t / BENCH_LINES * 1e6);
+}
+
+/**
+  * @brief  Main program.
+  */
+int main(void)
+{
+  static const uint16_t Dev[] = {0x9325, 0x8989, 0x9320};
+  int d;
+
+  printf(" LCD log, %s\n", LCD_LOG_INCREMENTAL ? "incremental" : "full redraw");
+  for(d = 0; d < 3; d++)
+  {
+    LCD_HostFb_Init(Dev[d]);
+    STM322xG_LCD_Init();
+    LCD_LOG_Init();
+    LCD_LOG_SetHeader((uint8_t *)" USB OTG FS MSC Host");
+    LCD_LOG_SetFooter((uint8_t *)" ARMJISHU.COM USB Host Library v2.1.0");
+    printf("\n LCD %04X%s\n", Dev[d], LCD_BlitWindowed() ? "" : ", screen not checked");
+    Bench("log", Text_Log);
+    Bench("dump", Text_Dump);
+  }
+  printf("\n %s\n", Errors ? "ERRORS" : "text zone identical to LCD_DisplayStringLine");
+  return Errors ? 1 : 0;
+}
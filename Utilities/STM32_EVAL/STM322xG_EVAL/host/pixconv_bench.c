@@ -0,0 +1,139 @@
+/**
+  ******************************************************************************
+  * @file    pixconv_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Speed of the lcd_pixconv.c kernels against the per pixel loop
+  *          Show_Image used, in Mpixel/s, for a line, a mirrored line and a
+  *          line written as a column of a 240x320 frame. Every kernel is
+  *          first checked against the per pixel result for all alignments.
+  *
+  *          gcc -O2 -I../../Common ../../Common/lcd_pixconv.c pixconv_bench.c
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lcd_pixconv.h"
+
+/* Private define ------------------------------------------------------------*/
+#define LINE_PIXELS      320
+#define FRAME_LINES      240
+#define BENCH_PIXELS     (50 * 1000 * 1000)
+
+/* Private variables ---------------------------------------------------------*/
+static uint32_t Src32[(LINE_PIXELS * 4 + 8) / 4];
+static uint16_t Frame[FRAME_LINES * LINE_PIXELS + 2];
+static uint16_t Ref[FRAME_LINES * LINE_PIXELS + 2];
+
+typedef void (*KERNEL)(uint16_t *, int32_t, const uint8_t *, uint32_t);
+
+/* Private functions ---------------------------------------------------------*/
+/* Show_Image原来的逐点转换 */
+static void Scalar(uint16_t *pDst, int32_t Step, const uint8_t *pSrc, uint32_t Num, int Bpp)
+{
+  uint32_t i;
+
+  for(i = 0; i < Num; i++, pSrc += Bpp, pDst += Step)
+  {
+    if(Bpp == 2)
+      *pDst = pSrc[1] << 8 | pSrc[0];
+    else
+      *pDst = (pSrc[2] & 0xF8) << 8 | (pSrc[1] & 0xFC) << 3 | pSrc[0] >> 3;
+  }
+}
+
+static double Now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Step对应的输出起点: 列方向写满一帧中的一列 */
+static uint16_t *Dst(uint16_t *pFrame, int32_t Step)
+{
+  if(Step < 0)
+    return pFrame + (uint32_t)(-Step) * (LINE_PIXELS - 1);
+  return pFrame;
+}
+
+static int Check(KERNEL k, int Bpp)
+{
+  static const int32_t Steps[] = {1, -1, FRAME_LINES, -FRAME_LINES};
+  const uint8_t *src = (const uint8_t *)Src32;
+  int s, so, dof, n;
+
+  for(s = 0; s < 4; s++)
+    for(so = 0; so < 4; so++)
+      for(dof = 0; dof < 2; dof++)
+        for(n = LINE_PIXELS - 5; n <= LINE_PIXELS - 1; n++)
+        {
+          memset(Frame, 0, sizeof(Frame));
+          memset(Ref, 0, sizeof(Ref));
+          k(Dst(Frame + dof, Steps[s]), Steps[s], src + so, n);
+          Scalar(Dst(Ref + dof, Steps[s]), Steps[s], src + so, n, Bpp);
+          if(memcmp(Frame, Ref, sizeof(Frame)))
+          {
+            printf("  MISMATCH step %d src+%d dst+%d n %d\n", Steps[s], so, dof, n);
+            return 0;
+          }
+        }
+  return 1;
+}
+
+static void Bench(const char *name, KERNEL k, int Bpp, int32_t Step)
+{
+  const uint8_t *src = (const uint8_t *)Src32;
+  uint32_t done;
+  double t, ts;
+
+  t = Now();
+  for(done = 0; done < BENCH_PIXELS; done += LINE_PIXELS)
+  {
+    k(Dst(Frame, Step), Step, src, LINE_PIXELS);
+  }
+  t = Now() - t;
+  ts = Now();
+  for(done = 0; done < BENCH_PIXELS; done += LINE_PIXELS)
+  {
+    Scalar(Dst(Frame, Step), Step, src, LINE_PIXELS, Bpp);
+    __asm__ volatile("" ::: "memory");
+  }
+  ts = Now() - ts;
+  printf("  %-6s step %4d: %7.1f Mpixel/s  (per pixel loop %7.1f)\n", name, (int)Step,
+         BENCH_PIXELS / t / 1e6, BENCH_PIXELS / ts / 1e6);
+}
+
+/**
+  * @brief  Main program.
+  */
+int main(void)
+{
+  static const struct { const char *name; KERNEL k; int Bpp; } K[] =
+  {
+    {"888",  LCD_PixConv_888,  3},
+    {"8888", LCD_PixConv_8888, 4},
+    {"565",  LCD_PixConv_565,  2},
+  };
+  uint8_t *p = (uint8_t *)Src32;
+  uint32_t i;
+  int j;
+
+  for(i = 0; i < sizeof(Src32); i++)
+  {
+    p[i] = (uint8_t)(i * 37 + (i >> 3));
+  }
+  for(j = 0; j < 3; j++)
+  {
+    printf(" %s: %s\n", K[j].name, Check(K[j].k, K[j].Bpp) ? "matches per pixel loop" : "WRONG");
+    Bench(K[j].name, K[j].k, K[j].Bpp, 1);
+    Bench(K[j].name, K[j].k, K[j].Bpp, -1);
+    Bench(K[j].name, K[j].k, K[j].Bpp, FRAME_LINES);
+  }
+  return 0;
+}
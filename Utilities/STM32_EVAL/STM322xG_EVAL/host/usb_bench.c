@@ -0,0 +1,336 @@
+/**
+  ******************************************************************************
+  * @file    usb_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Benchmark of the USB host library on the OTG core model: the
+  *          firmware's host task, MSC class, FatFs and DFU class run
+  *          unchanged against a stick on an image file and an MK5 DFU
+  *          target. All times are virtual (usb_hostsim.h):
+  *          - enumeration and mount of the stick;
+  *          - sequential FatFs write and read, KB/s;
+  *          - the same read with NAKs injected on bulk IN and OUT, and a
+  *            read whose data stage is STALLed once (ClearFeature, the
+  *            READ10 is sent again);
+  *          - DFU download of the MK5 image of usbh_fireware.c, with NAKs
+  *            on the EP0 data stage and a stalled GETSTATUS, compared with
+  *            the flash of the model.
+  *          Each run prints the per-stage URB table of usb_hostsim.c.
+  *          Usage: usb_bench [-v]   (-v: library debug output)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_disk.img"
+#define IMG_SIZE         (32u * 1024 * 1024)
+#define FILE_SIZE        (512u * 1024)
+#define CHUNK            4096
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV DiskImg_Drv;
+extern const DISKIO_DRV USBH_MSC_Disk;
+BOOL diskimg_open(const char *path);
+void diskimg_close(void);
+
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static uint8_t  Buf[CHUNK];
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static void Pattern(uint8_t *p, uint32_t pos, uint32_t n)
+{
+  uint32_t i;
+
+  for(i = 0; i < n; i++)
+  {
+    p[i] = (uint8_t)((pos + i) * 7 + ((pos + i) >> 9));
+  }
+}
+
+/* 在镜像文件上建FAT, 不经过USB */
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(1, &DiskImg_Drv);
+  f_mount(1, &Fs);
+  if(f_mkfs(1, 0, 4096) != FR_OK)
+  {
+    return 0;
+  }
+  f_mount(1, 0);
+  diskimg_close();
+  return 1;
+}
+
+static void Bench_Stats(SIM_DEV *msc, SIM_TIME t, uint32_t bytes, const char *name)
+{
+  SIM_MSC_STATS *m = SimDev_MscStats(msc);
+
+  printf("\n  %s: %u KB in %.1f ms, %.1f KB/s, bus busy %.0f%%\n", name, bytes / 1024,
+         Ms(t), bytes / 1024.0 / (t / 1e9), 100.0 * USB_HostSim_BusBusy() / t);
+  printf("   stick: %u commands (READ10 %u, WRITE10 %u, failed %u), CBW..CSW %.1f us, CSW..CBW %.1f us\n",
+         m->Cmd, m->Read10, m->Write10, m->Failed,
+         m->Cmd ? m->CmdSum / 1e3 / m->Cmd : 0.0, m->Gap ? m->GapSum / 1e3 / m->Gap : 0.0);
+  USB_HostSim_PrintStats();
+}
+
+static void Bench_Clear(SIM_DEV *msc)
+{
+  USB_HostSim_ClearStats();
+  memset(SimDev_MscStats(msc), 0, sizeof(SIM_MSC_STATS));
+}
+
+/* 顺序写FILE_SIZE字节 */
+static SIM_TIME Bench_Write(const char *path)
+{
+  SIM_TIME t0 = USB_HostSim_Now();
+  FIL fil;
+  UINT bw;
+  uint32_t pos;
+
+  Check(f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, "f_open write");
+  for(pos = 0; pos < FILE_SIZE; pos += CHUNK)
+  {
+    Pattern(Buf, pos, CHUNK);
+    if((f_write(&fil, Buf, CHUNK, &bw) != FR_OK) || (bw != CHUNK))
+    {
+      Check(0, "f_write");
+      break;
+    }
+  }
+  Check(f_close(&fil) == FR_OK, "f_close");
+  return USB_HostSim_Now() - t0;
+}
+
+/* 顺序读并校验 */
+static SIM_TIME Bench_Read(const char *path)
+{
+  SIM_TIME t0 = USB_HostSim_Now();
+  uint8_t ref[CHUNK];
+  FIL fil;
+  UINT br;
+  uint32_t pos;
+
+  Check(f_open(&fil, path, FA_READ) == FR_OK, "f_open read");
+  for(pos = 0; pos < FILE_SIZE; pos += CHUNK)
+  {
+    if((f_read(&fil, Buf, CHUNK, &br) != FR_OK) || (br != CHUNK))
+    {
+      Check(0, "f_read");
+      break;
+    }
+    Pattern(ref, pos, CHUNK);
+    if(memcmp(Buf, ref, CHUNK))
+    {
+      Check(0, "data compare");
+      break;
+    }
+  }
+  f_close(&fil);
+  return USB_HostSim_Now() - t0;
+}
+
+static void Bench_Msc(void)
+{
+  SIM_DEV *msc;
+  SIM_TIME t;
+  DIR dir;
+  uint8_t addr;
+
+  printf("\n== Mass storage stick, %u MB image, FatFs file of %u KB\n", IMG_SIZE >> 20, FILE_SIZE >> 10);
+  if(!Bench_MakeImage() || ((msc = SimDev_MscCreate(IMG_PATH, "SIM0001")) == 0))
+  {
+    Check(0, "image " IMG_PATH);
+    return;
+  }
+  disk_attach(0, &USBH_MSC_Disk);
+
+  t = USB_HostSim_Now();
+  USB_HostSim_Attach(msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+  addr = msc->Addr;
+  printf("  attach to MSC application: %.1f ms (address %d)\n", Ms(USB_HostSim_Now() - t), addr);
+  USB_HostSim_PrintStats();
+
+  Bench_Clear(msc);
+  t = USB_HostSim_Now();
+  /* f_mount只登记, 第一次访问时才读引导扇区和FAT */
+  Check(f_mount(0, &Fs) == FR_OK, "f_mount");
+#if _USE_DIRIDX
+  Fs.didx = Idx;                                //同usbh_usr.c
+#endif
+  Check(f_opendir(&dir, "0:") == FR_OK, "f_opendir");
+  Bench_Stats(msc, USB_HostSim_Now() - t + 1, 0, "mount");
+
+  Bench_Clear(msc);
+  t = Bench_Write("0:BENCH.BIN");
+  Bench_Stats(msc, t, FILE_SIZE, "write");
+
+  /* 读之前清掉扇区缓存 */
+  USBH_MSC_DiskDrop();
+  Bench_Clear(msc);
+  t = Bench_Read("0:BENCH.BIN");
+  Bench_Stats(msc, t, FILE_SIZE, "read");
+
+  USBH_MSC_DiskDrop();
+  Bench_Clear(msc);
+  USB_HostSim_Inject(addr, 0x81, SIM_NAK, 0, 2000);
+  USB_HostSim_Inject(addr, 0x02, SIM_NAK, 0, 50);
+  t = Bench_Read("0:BENCH.BIN");
+  USB_HostSim_Inject(addr, 0x81, SIM_NAK, 0, 0);
+  USB_HostSim_Inject(addr, 0x02, SIM_NAK, 0, 0);
+  Bench_Stats(msc, t, FILE_SIZE, "read, 2000 NAK on bulk IN, 50 on bulk OUT");
+
+  USBH_MSC_DiskDrop();
+  Bench_Clear(msc);
+  /* ClearFeature后读到失败的CSW, USBH_MSC_Read10重发该命令, f_read不报错 */
+  USB_HostSim_Inject(addr, 0x81, SIM_STALL, 100, 1);
+  t = Bench_Read("0:BENCH.BIN");
+  USB_HostSim_Inject(addr, 0x81, SIM_STALL, 0, 0);
+  Check(SimDev_MscStats(msc)->Failed == 1, "READ10 retried after STALL");
+  Bench_Stats(msc, t, FILE_SIZE, "read, data stage STALLed once");
+
+  f_mount(0, 0);
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_MscDestroy(msc);
+}
+
+/* 运行主机任务直到DFU设备完成Manifest */
+static int Bench_DfuRun(SIM_DEV *dfu, SIM_TIME timeout)
+{
+  SIM_TIME end = USB_HostSim_Now() + timeout;
+
+  while(SimDev_DfuStats(dfu)->Manifest == 0)
+  {
+    if(USB_HostSim_Now() >= end)
+    {
+      return 0;
+    }
+    USB_HostSim_TaskStep();
+  }
+  USB_HostSim_TaskRun(SIM_MS(20));
+  return 1;
+}
+
+static void Bench_DfuReport(SIM_DEV *dfu, SIM_TIME attach, const char *name)
+{
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  uint32_t size = 0;
+  uint8_t *flash = SimDev_DfuFlash(dfu, &size);
+  SIM_TIME t = d->Manifest - d->First;
+
+  if(d->Manifest == 0)
+  {
+    printf("\n  %s: no manifest, %u blocks, %u GETSTATUS, %u errors\n", name, d->Block, d->Status, d->Errors);
+    USB_HostSim_PrintStats();
+    return;
+  }
+  printf("\n  %s: %u KB in %.1f ms (attach to manifest %.1f ms), %.1f KB/s\n", name,
+         (uint32_t)(d->Bytes / 1024), Ms(t), Ms(d->Manifest - attach),
+         d->Bytes / 1024.0 / (t / 1e9));
+  printf("   %u blocks, %u GETSTATUS, %u errors; per block: data %.2f ms, programming %.2f ms,"
+         " host late %.3f ms\n", d->Block, d->Status, d->Errors,
+         d->Block ? Ms(d->DataSum) / d->Block : 0.0, d->Block ? Ms(d->ProgSum) / d->Block : 0.0,
+         d->Block ? Ms(d->LateSum) / d->Block : 0.0);
+  Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, size) == 0), "flash compare");
+  USB_HostSim_PrintStats();
+}
+
+static void Bench_Dfu(int inject)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_TIME t0;
+
+  printf("\n== DFU download of the MK5 image, %u bytes, wTransferSize %u%s\n", MK5_ImageSize,
+         DFU_XFER, inject ? ", NAK on EP0 OUT and stalled GETSTATUS" : "");
+  Fireware = (uint8_t *)MK5_Image;
+  FirewareSize = MK5_ImageSize;
+  USB_HostSim_ClearStats();
+  t0 = USB_HostSim_Now();
+  USB_HostSim_Attach(dfu);
+  if(inject)
+  {
+    /* 地址在枚举后才知道, 先等第一个块 */
+    while((SimDev_DfuStats(dfu)->Block == 0) && (USB_HostSim_Now() - t0 < SIM_MS(3000)))
+    {
+      USB_HostSim_TaskStep();
+    }
+    USB_HostSim_Inject(dfu->Addr, 0x00, SIM_NAK, 200, 40);
+    USB_HostSim_Inject(dfu->Addr, 0x80, SIM_STALL, 30, 1);
+  }
+  Check(Bench_DfuRun(dfu, SIM_MS(60000)), "DFU manifest");
+  USB_HostSim_Inject(dfu->Addr, 0x00, SIM_NAK, 0, 0);
+  USB_HostSim_Inject(dfu->Addr, 0x80, SIM_STALL, 0, 0);
+  Bench_DfuReport(dfu, t0, inject ? "download with injection" : "download");
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+
+  Bench_Msc();
+  Bench_Dfu(0);
+  Bench_Dfu(1);
+
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
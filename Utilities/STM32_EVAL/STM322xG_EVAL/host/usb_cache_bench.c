@@ -0,0 +1,367 @@
+/**
+  ******************************************************************************
+  * @file    usb_cache_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Sector cache of the MSC class (usbh_msc_cache.c, with the
+  *          read-ahead and write coalescing of usbh_msc_fatfs.c below it)
+  *          on the OTG core model and the stick model on a FAT image.
+  *          For each FatFs operation: the disk_read/disk_write calls of
+  *          ff.c, which are the BOT commands of a driver without cache, the
+  *          hits and misses of the cache, and the READ10/WRITE10 commands
+  *          the stick really got, with the virtual time of the operation.
+  *          The operations run one after the other on the mounted volume,
+  *          as an application would do them, so the cache is warm.
+  *          Usage: usb_cache_bench [-v]   (-v: library debug output)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+#include "usbh_msc_cache.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_cache.img"
+#define IMG_SIZE         (32u * 1024 * 1024)
+#define SMALL_NUM        32                     //小文件数
+#define SMALL_SIZE       100
+#define LOG_SIZE         (64u * 1024)
+#define LOG_RECORD       512
+#define LOG_SYNC         4096                   //每写这么多字节f_sync一次
+#define FILE_SIZE        (512u * 1024)
+#define CHUNK            4096
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *Name;
+  SIM_TIME    Time;
+  MSC_CACHE_STATS_ST Cache;
+  uint32_t    Read10;                           //U盘模型收到的命令
+  uint32_t    Write10;
+}
+BENCH_OP;
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV DiskImg_Drv;
+extern const DISKIO_DRV USBH_MSC_Disk;
+BOOL diskimg_open(const char *path);
+void diskimg_close(void);
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static SIM_DEV *Msc;
+static uint8_t  Buf[CHUNK];
+static int      Failed;
+static BENCH_OP Op[16];
+static int      OpNum;
+static SIM_TIME OpStart;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static void Pattern(uint8_t *p, uint32_t pos, uint32_t n)
+{
+  uint32_t i;
+
+  for(i = 0; i < n; i++)
+  {
+    p[i] = (uint8_t)((pos + i) * 7 + ((pos + i) >> 9));
+  }
+}
+
+/* 在镜像文件上建FAT, 不经过USB */
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(1, &DiskImg_Drv);
+  f_mount(1, &Fs);
+  if(f_mkfs(1, 0, 4096) != FR_OK)
+  {
+    return 0;
+  }
+  f_mount(1, 0);
+  diskimg_close();
+  return 1;
+}
+
+static void Op_Begin(const char *name)
+{
+  Op[OpNum].Name = name;
+  USBH_MSC_Cache_ClearStats();
+  memset(SimDev_MscStats(Msc), 0, sizeof(SIM_MSC_STATS));
+  OpStart = USB_HostSim_Now();
+}
+
+static void Op_End(void)
+{
+  BENCH_OP *o = &Op[OpNum++];
+  SIM_MSC_STATS *m = SimDev_MscStats(Msc);
+
+  o->Time = USB_HostSim_Now() - OpStart;
+  o->Cache = *USBH_MSC_Cache_GetStats();
+  o->Read10 = m->Read10;
+  o->Write10 = m->Write10;
+  Check((o->Cache.BotRead == m->Read10) && (o->Cache.BotWrite == m->Write10), "BOT counts of the stick");
+}
+
+/* SMALL_NUM个小文件, 建立, 列目录, 逐个读 */
+static void Bench_Small(void)
+{
+  char name[32];
+  FILINFO fno;
+  FIL fil;
+  DIR dir;
+  UINT n;
+  int i, found = 0;
+
+  Op_Begin("mkdir + create 32 files");
+  Check(f_mkdir("0:SMALL") == FR_OK, "f_mkdir");
+  for(i = 0; i < SMALL_NUM; i++)
+  {
+    snprintf(name, sizeof(name), "0:SMALL/F%03d.TXT", i);
+    Pattern(Buf, i, SMALL_SIZE);
+    if((f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+       || (f_write(&fil, Buf, SMALL_SIZE, &n) != FR_OK) || (n != SMALL_SIZE)
+       || (f_close(&fil) != FR_OK))
+    {
+      Check(0, "small file write");
+      break;
+    }
+  }
+  Op_End();
+
+  Op_Begin("list the directory");
+  fno.lfname = 0;                       //_USE_LFN: 不取长文件名
+  fno.lfsize = 0;
+  Check(f_opendir(&dir, "0:SMALL") == FR_OK, "f_opendir");
+  while((f_readdir(&dir, &fno) == FR_OK) && fno.fname[0])
+  {
+    found++;
+  }
+  Check(found == SMALL_NUM, "directory entries");
+  Op_End();
+
+  Op_Begin("open + read 32 files");
+  for(i = 0; i < SMALL_NUM; i++)
+  {
+    snprintf(name, sizeof(name), "0:SMALL/F%03d.TXT", i);
+    if((f_open(&fil, name, FA_READ) != FR_OK) || (f_read(&fil, Buf, CHUNK, &n) != FR_OK)
+       || (n != SMALL_SIZE))
+    {
+      Check(0, "small file read");
+      break;
+    }
+    f_close(&fil);
+  }
+  Op_End();
+}
+
+/* 日志: LOG_RECORD字节一条, 每LOG_SYNC字节f_sync */
+static void Bench_Log(void)
+{
+  uint32_t pos;
+  FIL fil;
+  UINT n;
+
+  Op_Begin("log 512 B records, f_sync/4 KB");
+  Check(f_open(&fil, "0:LOG.TXT", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, "f_open log");
+  for(pos = 0; pos < LOG_SIZE; pos += LOG_RECORD)
+  {
+    Pattern(Buf, pos, LOG_RECORD);
+    if((f_write(&fil, Buf, LOG_RECORD, &n) != FR_OK) || (n != LOG_RECORD))
+    {
+      Check(0, "log write");
+      break;
+    }
+    if(((pos + LOG_RECORD) % LOG_SYNC) == 0)
+    {
+      Check(f_sync(&fil) == FR_OK, "f_sync");
+    }
+  }
+  Check(f_close(&fil) == FR_OK, "f_close log");
+  Op_End();
+}
+
+/* 顺序写, 顺序读 */
+static void Bench_Stream(void)
+{
+  uint8_t ref[CHUNK];
+  uint32_t pos;
+  FIL fil;
+  UINT n;
+
+  Op_Begin("write 512 KB, 4 KB f_write");
+  Check(f_open(&fil, "0:BENCH.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, "f_open write");
+  for(pos = 0; pos < FILE_SIZE; pos += CHUNK)
+  {
+    Pattern(Buf, pos, CHUNK);
+    if((f_write(&fil, Buf, CHUNK, &n) != FR_OK) || (n != CHUNK))
+    {
+      Check(0, "f_write");
+      break;
+    }
+  }
+  Check(f_close(&fil) == FR_OK, "f_close");
+  Op_End();
+
+  Op_Begin("read 512 KB, 4 KB f_read");
+  Check(f_open(&fil, "0:BENCH.BIN", FA_READ) == FR_OK, "f_open read");
+  for(pos = 0; pos < FILE_SIZE; pos += CHUNK)
+  {
+    Pattern(ref, pos, CHUNK);
+    if((f_read(&fil, Buf, CHUNK, &n) != FR_OK) || (n != CHUNK) || memcmp(Buf, ref, CHUNK))
+    {
+      Check(0, "f_read");
+      break;
+    }
+  }
+  f_close(&fil);
+  Op_End();
+
+  Op_Begin("read 512 KB, 512 B f_read");
+  Check(f_open(&fil, "0:BENCH.BIN", FA_READ) == FR_OK, "f_open read");
+  for(pos = 0; pos < FILE_SIZE; pos += 512)
+  {
+    Pattern(ref, pos, 512);
+    if((f_read(&fil, Buf, 512, &n) != FR_OK) || (n != 512) || memcmp(Buf, ref, 512))
+    {
+      Check(0, "f_read");
+      break;
+    }
+  }
+  f_close(&fil);
+  Op_End();
+}
+
+/* 删除全部文件 */
+static void Bench_Remove(void)
+{
+  char name[32];
+  int i;
+
+  Op_Begin("delete everything");
+  for(i = 0; i < SMALL_NUM; i++)
+  {
+    snprintf(name, sizeof(name), "0:SMALL/F%03d.TXT", i);
+    Check(f_unlink(name) == FR_OK, "f_unlink");
+  }
+  Check((f_unlink("0:SMALL") == FR_OK) && (f_unlink("0:LOG.TXT") == FR_OK)
+        && (f_unlink("0:BENCH.BIN") == FR_OK), "f_unlink");
+  Op_End();
+}
+
+static void Bench_Report(void)
+{
+  MSC_CACHE_STATS_ST *c;
+  uint32_t plain, sent, sum[2] = { 0, 0 };
+  char hit[16];
+  int i;
+
+  printf("\n   %-32s %8s %6s %6s %6s %6s %7s %6s %6s %6s %6s\n", "operation", "time",
+         "disk", "disk", "hit", "miss", "hit", "READ", "WRITE", "RA", "saved");
+  printf("   %-32s %8s %6s %6s %6s %6s %7s %6s %6s %6s %6s\n", "", "ms", "read", "write",
+         "", "", "ratio", "10", "10", "sect.", "cmds");
+  for(i = 0; i < OpNum; i++)
+  {
+    c = &Op[i].Cache;
+    plain = c->Read + c->Write;
+    sent = Op[i].Read10 + Op[i].Write10;
+    sum[0] += plain;
+    sum[1] += sent;
+    if(c->Hit + c->Miss)
+    {
+      snprintf(hit, sizeof(hit), "%.1f%%", 100.0 * c->Hit / (c->Hit + c->Miss));
+    }
+    else
+    {
+      snprintf(hit, sizeof(hit), "-");
+    }
+    printf("   %-32s %8.1f %6u %6u %6u %6u %7s %6u %6u %6u %5.0f%%\n", Op[i].Name, Ms(Op[i].Time),
+           c->Read, c->Write, c->Hit, c->Miss, hit, Op[i].Read10, Op[i].Write10, c->RaHit,
+           plain ? 100.0 * ((double)plain - sent) / plain : 0.0);
+  }
+  printf("\n   BOT commands: %u without the cache (one per disk_read/disk_write), %u sent, %.0f%% saved\n",
+         sum[0], sum[1], sum[0] ? 100.0 * ((double)sum[0] - sum[1]) / sum[0] : 0.0);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  DIR dir;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_MakeImage() || ((Msc = SimDev_MscCreate(IMG_PATH, "SIM0001")) == 0))
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  printf("== MSC sector cache: %d sectors (%d for the FAT), read-ahead %d, write merge %d sectors\n",
+         USBH_MSC_CACHE_NUM, USBH_MSC_CACHE_PIN_NUM, USBH_MSC_READ_AHEAD, USBH_MSC_WRITE_MERGE);
+  printf("   stick on a %u MB image, FatFs cluster 4 KB\n", IMG_SIZE >> 20);
+  disk_attach(0, &USBH_MSC_Disk);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  USB_HostSim_Attach(Msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+
+  /* f_mount只登记, 第一次访问时才读引导扇区和FAT */
+  Op_Begin("mount + open the root");
+  Check(f_mount(0, &Fs) == FR_OK, "f_mount");
+#if _USE_DIRIDX
+  Fs.didx = Idx;                                //同usbh_usr.c
+#endif
+  Check(f_opendir(&dir, "0:") == FR_OK, "f_opendir");
+  Op_End();
+  Bench_Small();
+  Bench_Log();
+  Bench_Stream();
+  Bench_Remove();
+  Bench_Report();
+
+  f_mount(0, 0);
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_MscDestroy(Msc);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
@@ -0,0 +1,257 @@
+/**
+  ******************************************************************************
+  * @file    usb_crc_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   CRC32 of the DFU class (usbh_dfu_crc.c).
+  *          - slice-by-8 (USBH_DFU_CRC_SLICE8) and the nibble table
+  *            (USBH_DFU_CRC_NIBBLE, the same file built as Nibble_Crc32,
+  *            Makefile) against zlib crc32(): lengths 0..300 at every
+  *            alignment, the MK5 image in one piece and in pieces;
+  *          - throughput of both on the PC for 64 byte, 1 KB and 4 KB
+  *            blocks and for the MK5 image;
+  *          - the running CRC during the DFU download of the MK5 image on
+  *            the OTG core model: USBH_DFU_Crc32 is linked with --wrap and
+  *            costs a number of cycles of the 120 MHz core per byte in
+  *            virtual time, the download time is set against the run
+  *            without cost.
+  *          Usage: usb_crc_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "usbh_dfu_crc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+#define CPU_MHZ          120
+#define SPEED_BYTES      (64u * 1024 * 1024)   //每项测速处理的字节数
+
+/* Private typedef -----------------------------------------------------------*/
+typedef uint32_t (*CRC_FUNC)(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static int      Failed;
+static uint32_t CrcCycles;              //每字节的CPU周期, 0: 不计时间
+static uint64_t CrcBytes;
+static SIM_TIME CrcSum;
+
+/* Private functions ---------------------------------------------------------*/
+uint32_t Nibble_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+uint32_t __real_USBH_DFU_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* usbh_dfu_core.c中的CRC, 按CrcCycles计入主机任务的时间 */
+uint32_t __wrap_USBH_DFU_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  SIM_TIME t = (SIM_TIME)len * CrcCycles * 1000 / CPU_MHZ;
+
+  if(CrcCycles)
+  {
+    CrcBytes += len;
+    CrcSum += t;
+    USB_HostSim_Cpu(t);
+  }
+  return __real_USBH_DFU_Crc32(crc, buf, len);
+}
+
+/* zlib的参数为uLong */
+static uint32_t Zlib_Crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  return (uint32_t)crc32(crc, buf, len);
+}
+
+/* 与zlib比较 */
+static void Bench_Check(const char *name, CRC_FUNC f)
+{
+  static uint8_t buf[512];
+  const uint8_t *img = (const uint8_t *)MK5_Image;
+  uint32_t len, align, pos, n, crc, ref;
+  int bad = 0;
+
+  for(len = 0; len < sizeof(buf); len++)
+  {
+    buf[len] = (uint8_t)(len * 131 + 7);
+  }
+  for(len = 0; len <= 300; len++)
+  {
+    for(align = 0; align < 8; align++)
+    {
+      if(f(0, buf + align, len) != (uint32_t)crc32(0, buf + align, len))
+      {
+        bad++;
+      }
+    }
+  }
+  ref = crc32(0, img, MK5_ImageSize);
+  if(f(0, img, MK5_ImageSize) != ref)
+  {
+    bad++;
+  }
+  /* 分段: 与DNLOAD块和UPLOAD块一样续算 */
+  for(n = 1; n <= 4099; n = n * 3 + 1)
+  {
+    crc = USBH_DFU_CRC32_INIT;
+    for(pos = 0; pos < (uint32_t)MK5_ImageSize; pos += len)
+    {
+      len = ((uint32_t)MK5_ImageSize - pos < n) ? (uint32_t)MK5_ImageSize - pos : n;
+      crc = f(crc, img + pos, len);
+    }
+    if(crc != ref)
+    {
+      bad++;
+    }
+  }
+  printf("   %-12s %s zlib crc32()\n", name, bad ? "differs from" : "equal to");
+  Check(bad == 0, name);
+}
+
+/* PC上的吞吐量, MB/s */
+static double Bench_Speed(CRC_FUNC f, const uint8_t *buf, uint32_t len)
+{
+  struct timespec t0, t1;
+  uint32_t i, n = SPEED_BYTES / len;
+  volatile uint32_t crc = 0;
+  double ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(i = 0; i < n; i++)
+  {
+    crc = f(crc, buf, len);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+  return (double)n * len / ns * 1e3;
+}
+
+/* 下载MK5镜像, 返回第一个DNLOAD到Manifest的时间 */
+static SIM_TIME Bench_Dfu(const char *name, uint32_t cycles, SIM_TIME base)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  SIM_TIME t0, end, t = 0;
+  uint32_t size = 0;
+  uint8_t *flash;
+  char added[16] = "";
+
+  CrcCycles = cycles;
+  CrcBytes = 0;
+  CrcSum = 0;
+  USB_HostSim_ClearStats();
+  t0 = USB_HostSim_Now();
+  end = t0 + SIM_MS(60000);
+  USB_HostSim_Attach(dfu);
+  while((d->Manifest == 0) && (USB_HostSim_Now() < end))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(d->Manifest != 0, "DFU manifest");
+  USB_HostSim_TaskRun(SIM_MS(20));
+
+  if(d->Manifest)
+  {
+    t = d->Manifest - d->First;
+    if(base)
+    {
+      snprintf(added, sizeof(added), "%.2f%%", 100.0 * ((double)t - base) / base);
+    }
+    printf("   %-26s %10.1f %9.2f %8.1f %7.3f %8s\n", name, Ms(t), Ms(CrcSum),
+           CrcBytes / 1024.0, d->Block ? Ms(d->LateSum) / d->Block : 0.0, added);
+  }
+  flash = SimDev_DfuFlash(dfu, &size);
+  Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, size) == 0), "flash compare");
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+  return t;
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  static const uint32_t Len[] = { 64, 1024, DFU_XFER };
+  const uint8_t *img = (const uint8_t *)MK5_Image;
+  SIM_TIME base;
+  int i;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+  Fireware = (uint8_t *)MK5_Image;
+  FirewareSize = MK5_ImageSize;
+
+  printf("== CRC32 against zlib\n");
+  Bench_Check("slice-by-8", __real_USBH_DFU_Crc32);
+  Bench_Check("nibble", Nibble_Crc32);
+
+  printf("\n== throughput on this PC, MB/s\n");
+  printf("   %-12s %9s %9s %9s %9s\n", "", "64 B", "1 KB", "4 KB", "MK5");
+  printf("   %-12s", "slice-by-8");
+  for(i = 0; i < 3; i++)
+  {
+    printf(" %9.0f", Bench_Speed(__real_USBH_DFU_Crc32, img, Len[i]));
+  }
+  printf(" %9.0f\n", Bench_Speed(__real_USBH_DFU_Crc32, img, MK5_ImageSize));
+  printf("   %-12s", "nibble");
+  for(i = 0; i < 3; i++)
+  {
+    printf(" %9.0f", Bench_Speed(Nibble_Crc32, img, Len[i]));
+  }
+  printf(" %9.0f\n", Bench_Speed(Nibble_Crc32, img, MK5_ImageSize));
+  printf("   %-12s", "zlib");
+  for(i = 0; i < 3; i++)
+  {
+    printf(" %9.0f", Bench_Speed(Zlib_Crc32, img, Len[i]));
+  }
+  printf(" %9.0f\n", Bench_Speed(Zlib_Crc32, img, MK5_ImageSize));
+
+  printf("\n== running CRC in the DFU download of the MK5 image (%u bytes), %d MHz core\n",
+         MK5_ImageSize, CPU_MHZ);
+  printf("   %-26s %10s %9s %8s %7s %8s\n", "CRC cost", "download", "CRC", "CRC", "late",
+         "added");
+  printf("   %-26s %10s %9s %8s %7s %8s\n", "", "ms", "ms", "KB", "ms/blk", "");
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  base = Bench_Dfu("none", 0, 0);
+  Bench_Dfu("CRC unit, 1 cycle/byte", 1, base);
+  Bench_Dfu("slice-by-8, 4 cycles/byte", 4, base);
+  Bench_Dfu("nibble, 16 cycles/byte", 16, base);
+  Bench_Dfu("bitwise, 60 cycles/byte", 60, base);
+
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
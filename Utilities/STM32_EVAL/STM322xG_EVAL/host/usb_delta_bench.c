@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    usb_delta_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Delta DFU (USBH_DFU_DELTA, usbh_dfu_delta.c) on the OTG core
+  *          model. The DFU target model holds the MK5 image of
+  *          usbh_fireware.c, the new image differs from it in a few blocks.
+  *          Four downloads of the new image, each compared with the flash
+  *          of the device afterwards:
+  *          - empty device: the read back ends at once, full download;
+  *          - device with the base image, no manifest: DFU_Req_UPLOAD read
+  *            back of every block, then only the changed blocks;
+  *          - the same with 0:/MK5.man (image file as FatFs drive 0) for
+  *            the bcdDevice of the device: no read back;
+  *          - device with the base image that stalls DFU_Req_UPLOAD: the
+  *            read back fails, CLRSTATUS and full download.
+  *          Usage: usb_delta_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_dfu_crc.h"
+#include "usbh_dfu_delta.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_delta.img"
+#define IMG_SIZE         (1024u * 1024)
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+static int      Failed;
+static uint8_t *NewImage;
+static const uint32_t Changed[] = { 10, 40, 41, 80 };  //新镜像中改动的块
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* 基础镜像的清单文件, 格式同Tools/dfu_manifest.py */
+static int Bench_WriteManifest(uint16_t version)
+{
+  DFU_MANIFEST_ST head;
+  uint32_t crc, pos, len;
+  FIL fil;
+  UINT bw;
+  int ok;
+
+  head.Magic = USBH_DFU_DELTA_MAGIC;
+  head.BaseVersion = version;
+  head.BlockSize = DFU_XFER;
+  head.BlockNum = (MK5_ImageSize + DFU_XFER - 1) / DFU_XFER;
+  if(f_open(&fil, USBH_DFU_DELTA_MANIFEST_NAME, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  {
+    return 0;
+  }
+  ok = (f_write(&fil, &head, sizeof(head), &bw) == FR_OK) && (bw == sizeof(head));
+  for(pos = 0; ok && (pos < (uint32_t)MK5_ImageSize); pos += len)
+  {
+    len = ((uint32_t)MK5_ImageSize - pos < DFU_XFER) ? (uint32_t)MK5_ImageSize - pos : DFU_XFER;
+    crc = USBH_DFU_Crc32(USBH_DFU_CRC32_INIT, (const uint8_t *)MK5_Image + pos, len);
+    ok = (f_write(&fil, &crc, 4, &bw) == FR_OK) && (bw == 4);
+  }
+  return (f_close(&fil) == FR_OK) && ok;
+}
+
+/* 下载NewImage, 返回插入到Manifest的时间 */
+static SIM_TIME Bench_Dfu(int preload, int manifest, int stall, const char *name, SIM_TIME full)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  SIM_TIME t0, t = 0;
+  uint32_t size = 0;
+  uint8_t *flash;
+
+  printf("\n== %s\n", name);
+  SimDev_DfuNoUpload(dfu, stall);
+  if(preload)
+  {
+    size = MK5_ImageSize;
+    memcpy(SimDev_DfuFlash(dfu, &size), MK5_Image, size);
+  }
+  f_unlink(USBH_DFU_DELTA_MANIFEST_NAME);
+  if(manifest)
+  {
+    Check(Bench_WriteManifest(dfu->DevDesc[12] | (dfu->DevDesc[13] << 8)), "manifest");
+  }
+
+  USB_HostSim_ClearStats();
+  t0 = USB_HostSim_Now();
+  USB_HostSim_Attach(dfu);
+  while((d->Manifest == 0) && (USB_HostSim_Now() < t0 + SIM_MS(60000)))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(d->Manifest != 0, "DFU manifest");
+  if(stall)
+  {
+    Check((d->Upload == 0) && (d->Block == (MK5_ImageSize + DFU_XFER - 1) / DFU_XFER), "full download");
+  }
+  USB_HostSim_TaskRun(SIM_MS(20));
+
+  if(d->Manifest)
+  {
+    t = d->Manifest - t0;
+    printf("  attach to manifest %.1f ms: %u blocks read back, %u blocks sent (%u KB)",
+           Ms(t), d->Upload, d->Block, (uint32_t)(d->Bytes / 1024));
+    if(full)
+    {
+      printf(", saved %u KB and %.1f ms (%.0f%%)", (uint32_t)((MK5_ImageSize - d->Bytes) / 1024),
+             Ms(full - t), 100.0 * (full - (double)t) / full);
+    }
+    printf("\n");
+  }
+  size = 0;
+  flash = SimDev_DfuFlash(dfu, &size);
+  Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, NewImage, size) == 0), "flash compare");
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+  return t;
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  FILE *f;
+  SIM_TIME full;
+  uint32_t i;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  /* 清单文件所在的盘 */
+  f = fopen(IMG_PATH, "wb");
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE) || (fclose(f) != 0) || !diskimg_open(IMG_PATH))
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  disk_attach(0, &DiskImg_Drv);
+  f_mount(0, &Fs);
+  if(f_mkfs(0, 0, 4096) != FR_OK)
+  {
+    printf("FAILED: f_mkfs\n");
+    return 1;
+  }
+
+  NewImage = malloc(MK5_ImageSize);
+  memcpy(NewImage, MK5_Image, MK5_ImageSize);
+  for(i = 0; i < sizeof(Changed) / sizeof(Changed[0]); i++)
+  {
+    NewImage[Changed[i] * DFU_XFER + 100] ^= 0x5A;
+  }
+  Fireware = NewImage;
+  FirewareSize = MK5_ImageSize;
+  printf("MK5 image %u bytes, %u blocks of %u, %u blocks changed\n", MK5_ImageSize,
+         (MK5_ImageSize + DFU_XFER - 1) / DFU_XFER, DFU_XFER, (uint32_t)(sizeof(Changed) / sizeof(Changed[0])));
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+
+  full = Bench_Dfu(0, 0, 0, "empty device: full download", 0);
+  Bench_Dfu(1, 0, 0, "device with the base image: UPLOAD read back", full);
+  Bench_Dfu(1, 1, 0, "device with the base image: manifest " USBH_DFU_DELTA_MANIFEST_NAME, full);
+  Bench_Dfu(1, 0, 1, "device with the base image: UPLOAD stalled, full download", full);
+
+  f_mount(0, 0);
+  diskimg_close();
+  free(NewImage);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
@@ -0,0 +1,215 @@
+/**
+  ******************************************************************************
+  * @file    usb_file_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   DFU download from a file (USBH_DFU_USE_FILE, usbh_dfu_file.c) on
+  *          the OTG core model. The FatFs drive 0 is an image file holding
+  *          0:/MK5.bin; its reads cost the time of the READ10 of a stick
+  *          (usb_bench), during which the host task does nothing else.
+  *          The MK5 image of usbh_fireware.c is downloaded to the DFU target
+  *          model, compared with its flash, and the time of f_read is set
+  *          against the download:
+  *          - MK5 timing: the read of block N+1 is hidden in the programming
+  *            of block N (bwPollTimeout);
+  *          - a device programming faster than the stick reads: the reads
+  *            show up as host late.
+  *          Usage: usb_file_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_file.img"
+#define IMG_SIZE         (8u * 1024 * 1024)
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+
+/* READ10 of the stick in usb_bench: 3.85 ms CBW..CSW for 8 sectors */
+#define STICK_CMD        SIM_US(300)
+#define STICK_SECTOR     SIM_US(444)
+
+/* Exported variables --------------------------------------------------------*/
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+static int      Failed;
+static uint8_t  Timed;                  //1: 读扇区计入虚拟时间
+static uint32_t ReadNum;
+static SIM_TIME ReadSum;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* 镜像文件上的驱动, 读扇区时主机任务等待U盘 */
+static DSTATUS Stick_Initialize(void)
+{
+  return DiskImg_Drv.initialize();
+}
+
+static DSTATUS Stick_Status(void)
+{
+  return DiskImg_Drv.status();
+}
+
+static DRESULT Stick_Read(BYTE *buff, DWORD sector, BYTE count)
+{
+  SIM_TIME t;
+
+  if(Timed)
+  {
+    t = STICK_CMD + STICK_SECTOR * count;
+    ReadNum++;
+    ReadSum += t;
+    USB_HostSim_Cpu(t);
+  }
+  return DiskImg_Drv.read(buff, sector, count);
+}
+
+static DRESULT Stick_Write(const BYTE *buff, DWORD sector, BYTE count)
+{
+  return DiskImg_Drv.write(buff, sector, count);
+}
+
+static DRESULT Stick_Ioctl(BYTE ctrl, void *buff)
+{
+  return DiskImg_Drv.ioctl(ctrl, buff);
+}
+
+static const DISKIO_DRV Stick_Drv =
+{
+  Stick_Initialize, Stick_Status, Stick_Read, Stick_Write, Stick_Ioctl
+};
+
+/* 在镜像文件上建FAT并写入0:/MK5.bin, 不计时间 */
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+  FIL fil;
+  UINT bw;
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(0, &Stick_Drv);
+  f_mount(0, &Fs);
+  if((f_mkfs(0, 0, 4096) != FR_OK)
+     || (f_open(&fil, "0:/MK5.bin", FA_CREATE_ALWAYS | FA_WRITE) != FR_OK))
+  {
+    return 0;
+  }
+  if((f_write(&fil, MK5_Image, MK5_ImageSize, &bw) != FR_OK) || (bw != (UINT)MK5_ImageSize))
+  {
+    f_close(&fil);
+    return 0;
+  }
+  return f_close(&fil) == FR_OK;
+}
+
+static void Bench_Dfu(SIM_TIME per_kb, const char *name)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  SIM_TIME t0, end, t;
+  uint32_t size = 0;
+  uint8_t *flash;
+
+  printf("\n== %s\n", name);
+  if(per_kb)
+  {
+    SimDev_DfuTiming(dfu, SIM_MS(2), per_kb, SIM_MS(100));
+  }
+  USB_HostSim_ClearStats();
+  ReadNum = 0;
+  ReadSum = 0;
+  t0 = USB_HostSim_Now();
+  end = t0 + SIM_MS(60000);
+  USB_HostSim_Attach(dfu);
+  while((d->Manifest == 0) && (USB_HostSim_Now() < end))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(d->Manifest != 0, "DFU manifest");
+  USB_HostSim_TaskRun(SIM_MS(20));
+
+  if(d->Manifest)
+  {
+    t = d->Manifest - d->First;
+    printf("  download: %u KB in %.1f ms (attach to manifest %.1f ms), %.1f KB/s\n",
+           (uint32_t)(d->Bytes / 1024), Ms(t), Ms(d->Manifest - t0), d->Bytes / 1024.0 / (t / 1e9));
+    printf("   %u blocks; per block: data %.2f ms, programming %.2f ms, host late %.3f ms\n",
+           d->Block, d->Block ? Ms(d->DataSum) / d->Block : 0.0,
+           d->Block ? Ms(d->ProgSum) / d->Block : 0.0, d->Block ? Ms(d->LateSum) / d->Block : 0.0);
+    printf("   stick: %u reads, %.1f ms (%.2f ms per block); the device waited for the host %.1f ms\n",
+           ReadNum, Ms(ReadSum), d->Block ? Ms(ReadSum) / d->Block : 0.0, Ms(d->LateSum));
+  }
+  flash = SimDev_DfuFlash(dfu, &size);
+  Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, size) == 0), "flash compare");
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_MakeImage())
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  printf("DFU from 0:/MK5.bin, %u bytes, wTransferSize %u; stick read %.0f us + %.0f us/sector\n",
+         MK5_ImageSize, DFU_XFER, STICK_CMD / 1e3, STICK_SECTOR / 1e3);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  Timed = 1;
+
+  Bench_Dfu(0, "MK5 timing: programming 2 ms + 5 ms/KB");
+  Bench_Dfu(SIM_US(100), "device programming 2 ms + 0.1 ms/KB, faster than the stick reads");
+
+  f_mount(0, 0);
+  diskimg_close();
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
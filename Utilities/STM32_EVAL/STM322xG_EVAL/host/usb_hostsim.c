@@ -0,0 +1,1042 @@
+/**
+  ******************************************************************************
+  * @file    usb_hostsim.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   PC model of the OTG FS host core and of usb_bsp.c. It replaces
+  *          usb_core.c, usb_hcd_int.c and the BSP below usb_hcd.c:
+  *          - the host channels run the transfers of HCD_SubmitRequest one
+  *            packet at a time on a shared full speed bus with 1 ms frames
+  *            (SOF, interrupt transfers once per frame, no packet across
+  *            the end of a frame);
+  *          - the end of each packet does what the channel interrupts of
+  *            usb_hcd_int.c do: URB_State, HC_Status, ErrCnt, XferCnt, the
+  *            toggles, HCD_StatsURB and one URBChange per interrupt;
+  *          - IN NAKs of control and bulk channels are retried by the core,
+  *            OUT NAKs halt the channel (URB_NOTREADY);
+  *          - usb_bsp.c: EventPost/EventWait, the DFU poll timer, mDelay.
+  *          Virtual time only runs in the waits of the host task (OS, delays,
+  *          HCD_GetURB_State) and in USB_HostSim_Cpu.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "usb_hcd.h"
+#include "usb_hcd_int.h"
+#include "usb_bsp.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Full speed bit times: 12Mb/s */
+#define SIM_BITS(b)             ((SIM_TIME)(b) * 1000 / 12)
+#define BITS_TOKEN              35          //SYNC PID ADDR ENDP CRC5 EOP
+#define BITS_DATA(n)            (35 + (n) * 8 * 51 / 50)   //含约2%的位填充
+#define BITS_HS                 19
+#define BITS_GAP                8           //总线转向, 包间隔
+#define BITS_TIMEOUT            18          //设备无应答
+#define BITS_EOF                40          //帧尾保护
+
+#define SIM_CH_NUM              8
+#define SIM_INJECT_NUM          8
+#define SIM_CPU_HZ              120000000
+
+enum
+{
+  CH_IDLE = 0,
+  CH_WAIT,                /* 等待总线, Time为最早开始时间 */
+  CH_BUSY,                /* 事务在总线上, Time为结束时间 */
+};
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t   State;
+  SIM_TIME  Time;
+  uint16_t  Packets;      //HCTSIZ.PKTCNT
+  uint8_t   Pid;          //HCTSIZ.PID, HC_PID_xxx
+  uint8_t  *Buf;          //OUT: URB的数据
+  uint32_t  Len;
+  uint32_t  Pos;
+  SIM_STAGE Stage;
+  SIM_TIME  Submit;
+  /* 总线上的事务 */
+  SIM_DEV  *Dev;
+  SIM_HS    Hs;
+  uint16_t  N;
+  uint8_t   InPid;
+  uint8_t   Data[USB_OTG_MAX_EP0_SIZE];
+}
+SIM_CH;
+
+typedef struct
+{
+  uint8_t   Addr;
+  uint8_t   Ep;           //bit7: IN
+  SIM_HS    Hs;
+  uint32_t  Skip;
+  uint32_t  Count;
+}
+SIM_INJECT;
+
+/* Exported variables --------------------------------------------------------*/
+__IO uint32_t        USB_OTG_HostSim_DWT[2];
+uint32_t             SystemCoreClock = SIM_CPU_HZ;
+uint8_t              USB_HostSim_Verbose;
+
+/* Private variables ---------------------------------------------------------*/
+static SIM_TIME         SimNow;
+static SIM_TIME         SimLimit;
+static SIM_TIME         NextMs;           //下一帧(SOF)和OS tick
+static SIM_TIME         BusFree;
+static SIM_TIME         BusBusy;
+static SIM_TIME         CpuBusy;          //USB_HostSim_Cpu的总和
+static SIM_TIME         PollAt;
+static uint8_t          PollExpired = 1;
+static __IO uint32_t    BSP_Event;
+static SIM_DEV         *Root;
+static uint8_t          LastCh;
+
+static SIM_CH           Ch[SIM_CH_NUM];
+static SIM_INJECT       Inject[SIM_INJECT_NUM];
+static SIM_STAGE_STATS  Stats[SIM_STAGE_NUM];
+static SIM_TIME         LastEnd[128];     //各地址上一个URB结束的时间
+
+static USB_OTG_GREGS    SimGRegs;
+static USB_OTG_HREGS    SimHRegs;
+static USB_OTG_HC_REGS  SimHcRegs[SIM_CH_NUM];
+static __IO uint32_t    SimHPRT0;
+
+static const char * const StageName[SIM_STAGE_NUM] =
+{
+  "SETUP", "CTL IN", "CTL OUT", "BULK IN", "BULK OUT", "INTR IN"
+};
+
+/* Private functions ---------------------------------------------------------*/
+static void Sim_SetNow(SIM_TIME t)
+{
+  SimNow = t;
+  USB_OTG_HostSim_DWT[1] = (uint32_t)(t * (SIM_CPU_HZ / 1000000) / 1000);
+  if(SimLimit && (t > SimLimit))
+  {
+    printf("\n usb_hostsim: no progress at %.3f s, stopped\n", t / 1e9);
+    USB_HostSim_PrintStats();
+    exit(2);
+  }
+}
+
+static uint8_t Sim_Toggle(uint8_t pid)
+{
+  return (pid == HC_PID_DATA0) ? HC_PID_DATA1 : HC_PID_DATA0;
+}
+
+/* 一个事务最长的总线时间 */
+static SIM_TIME Sim_MaxTime(USB_OTG_HC *hc)
+{
+  return SIM_BITS(BITS_TOKEN + BITS_GAP + BITS_DATA(hc->max_packet) + BITS_GAP + BITS_HS);
+}
+
+/* 注入的应答, SIM_ACK表示没有 */
+static SIM_HS Sim_Injected(SIM_DEV *dev, USB_OTG_HC *hc)
+{
+  uint8_t ep = hc->ep_num | (hc->ep_is_in ? 0x80 : 0);
+  SIM_INJECT *p;
+  int i;
+
+  for(i = 0; i < SIM_INJECT_NUM; i++)
+  {
+    p = &Inject[i];
+    if((p->Count == 0) || (p->Addr != hc->dev_addr) || (p->Ep != ep))
+    {
+      continue;
+    }
+    if(p->Skip)
+    {
+      p->Skip--;
+      return SIM_ACK;
+    }
+    p->Count--;
+    if((p->Hs == SIM_STALL) && dev)
+    {
+      SimDev_Halt(dev, ep);
+    }
+    return p->Hs;
+  }
+  return SIM_ACK;
+}
+
+/* 通道的事务开始: 设备的应答和总线时间 */
+static void Sim_Start(uint8_t n)
+{
+  USB_OTG_HC *hc = &USB_OTG_Core.host.hc[n];
+  SIM_CH *ch = &Ch[n];
+  SIM_DEV *dev = 0;
+  uint32_t bits;
+  uint16_t len;
+
+  if(SimHPRT0 & 0x04)         //prtena
+  {
+    dev = SimDev_Route(Root, hc->dev_addr);
+  }
+  ch->Dev = dev;
+  ch->N = 0;
+
+  if(ch->Pid == HC_PID_SETUP)
+  {
+    ch->Hs = dev ? SimDev_Setup(dev, ch->Buf) : SIM_NORESP;
+    ch->N = 8;
+    bits = BITS_TOKEN + BITS_GAP + BITS_DATA(8);
+  }
+  else if(hc->ep_is_in)
+  {
+    ch->Hs = Sim_Injected(dev, hc);
+    if(ch->Hs == SIM_ACK)
+    {
+      len = hc->max_packet;
+      ch->Hs = dev ? SimDev_In(dev, hc->ep_num, ch->Data, &len, &ch->InPid) : SIM_NORESP;
+      ch->N = (ch->Hs == SIM_ACK) ? len : 0;
+    }
+    bits = BITS_TOKEN + BITS_GAP + ((ch->Hs == SIM_ACK) ? BITS_DATA(ch->N) : 0);
+  }
+  else
+  {
+    len = ch->Len - ch->Pos;
+    if(len > hc->max_packet)
+    {
+      len = hc->max_packet;
+    }
+    ch->N = len;
+    ch->Hs = Sim_Injected(dev, hc);
+    if(ch->Hs == SIM_ACK)
+    {
+      ch->Hs = dev ? SimDev_Out(dev, hc->ep_num, ch->Buf + ch->Pos, len,
+                                (ch->Pid == HC_PID_DATA1)) : SIM_NORESP;
+    }
+    bits = BITS_TOKEN + BITS_GAP + BITS_DATA(len);
+  }
+  bits += (ch->Hs == SIM_NORESP) ? BITS_TIMEOUT : (BITS_GAP + BITS_HS);
+
+  ch->State = CH_BUSY;
+  ch->Time  = SimNow + SIM_BITS(bits);
+  BusFree   = ch->Time;
+  BusBusy  += SIM_BITS(bits);
+  Stats[ch->Stage].Packet++;
+  if(ch->Hs == SIM_NAK)
+  {
+    Stats[ch->Stage].Nak++;
+  }
+}
+
+/* 通道停止后(chhltd)的URB状态, 同usb_hcd_int.c */
+static void Sim_OutHalted(uint8_t n)
+{
+  USB_OTG_CORE_HANDLE *pdev = &USB_OTG_Core;
+  USB_OTG_HC *hc = &pdev->host.hc[n];
+  uint32_t total, packets;
+
+  if(hc->ep_type == EP_TYPE_BULK)
+  {
+    total = hc->xfer_count + hc->xfer_len;
+    packets = (total + hc->max_packet - 1) / hc->max_packet;
+    if(packets == 0)
+    {
+      packets = 1;
+    }
+    packets -= Ch[n].Packets;
+    pdev->host.XferCnt[n] = packets * hc->max_packet;
+    if(pdev->host.XferCnt[n] > total)
+    {
+      pdev->host.XferCnt[n] = total;
+    }
+    hc->xfer_len = 0;
+    hc->toggle_out = (Ch[n].Pid == HC_PID_DATA1) ? 1 : 0;
+  }
+
+  switch(pdev->host.HC_Status[n])
+  {
+  case HC_XFRC:
+    pdev->host.URB_State[n] = URB_DONE;
+    if(hc->ep_type == EP_TYPE_CTRL)
+    {
+      hc->toggle_out ^= 1;
+    }
+    break;
+  case HC_NAK:
+    pdev->host.URB_State[n] = URB_NOTREADY;
+    break;
+  case HC_STALL:
+    pdev->host.URB_State[n] = URB_STALL;
+    break;
+  case HC_XACTERR:
+    if(pdev->host.ErrCnt[n] == 3)
+    {
+      pdev->host.URB_State[n] = URB_ERROR;
+      pdev->host.ErrCnt[n] = 0;
+    }
+    break;
+  default:
+    break;
+  }
+  Ch[n].State = CH_IDLE;
+}
+
+/* 事务结束: 通道中断 */
+static void Sim_End(uint8_t n)
+{
+  USB_OTG_CORE_HANDLE *pdev = &USB_OTG_Core;
+  USB_OTG_HC *hc = &pdev->host.hc[n];
+  SIM_CH *ch = &Ch[n];
+  SIM_STAGE_STATS *s = &Stats[ch->Stage];
+  uint32_t room;
+  SIM_TIME nak;
+
+  ch->State = CH_WAIT;
+  ch->Time = SimNow;
+
+  if((hc->ep_is_in == 0) || (ch->Pid == HC_PID_SETUP))
+  {
+    switch(ch->Hs)
+    {
+    case SIM_ACK:
+      ch->Pos += ch->N;
+      s->Bytes += ch->N;
+      ch->Pid = (ch->Pid == HC_PID_SETUP) ? HC_PID_DATA1 : Sim_Toggle(ch->Pid);
+      if(--ch->Packets)
+      {
+        return;
+      }
+      pdev->host.ErrCnt[n] = 0;
+      pdev->host.HC_Status[n] = HC_XFRC;
+      break;
+    case SIM_NAK:
+      pdev->host.ErrCnt[n] = 0;
+      pdev->host.HC_Status[n] = HC_NAK;
+      break;
+    case SIM_STALL:
+      pdev->host.HC_Status[n] = HC_STALL;
+      break;
+    default:
+      pdev->host.ErrCnt[n]++;
+      pdev->host.HC_Status[n] = HC_XACTERR;
+      break;
+    }
+    Sim_OutHalted(n);
+    return;
+  }
+
+  switch(ch->Hs)
+  {
+  case SIM_ACK:
+    if(ch->InPid != (ch->Pid == HC_PID_DATA1))
+    {
+      pdev->host.HC_Status[n] = HC_DATATGLERR;
+      pdev->host.ErrCnt[n] = 0;
+      pdev->host.URB_State[n] = URB_ERROR;
+      ch->State = CH_IDLE;
+      return;
+    }
+    /* rx_qlvl */
+    if(ch->N && hc->xfer_buff)
+    {
+      room = hc->xfer_len - hc->xfer_count;
+      memcpy(hc->xfer_buff, ch->Data, (ch->N < room) ? ch->N : room);
+      hc->xfer_buff  += ch->N;
+      hc->xfer_count += ch->N;
+      pdev->host.XferCnt[n] = hc->xfer_count;
+    }
+    s->Bytes += ch->N;
+    ch->Pid = Sim_Toggle(ch->Pid);
+    if((--ch->Packets) && (ch->N == hc->max_packet))
+    {
+      ch->Time = SimNow + SIM_COST_RX_PACKET;
+      return;
+    }
+    /* xfercompl */
+    pdev->host.HC_Status[n] = HC_XFRC;
+    pdev->host.ErrCnt[n] = 0;
+    if(hc->ep_type == EP_TYPE_BULK)
+    {
+      hc->toggle_in = (ch->Pid == HC_PID_DATA1) ? 1 : 0;
+    }
+    else if(hc->ep_type == EP_TYPE_CTRL)
+    {
+      hc->toggle_in ^= 1;
+    }
+    pdev->host.URB_State[n] = URB_DONE;
+    break;
+
+  case SIM_NAK:
+    pdev->host.HC_Status[n] = HC_NAK;
+    if(hc->ep_type == EP_TYPE_INTR)
+    {
+      hc->toggle_in ^= 1;
+      break;
+    }
+    /* 核重新使能通道; 设备给出的忙碌时间内的NAK只计数, 不逐个模拟 */
+    if(ch->Dev && (ch->Dev->NakUntil > SimNow))
+    {
+      nak = SIM_BITS(BITS_TOKEN + BITS_GAP + BITS_HS + BITS_GAP);
+      s->Nak    += (ch->Dev->NakUntil - SimNow) / nak;
+      s->Packet += (ch->Dev->NakUntil - SimNow) / nak;
+      ch->Time = ch->Dev->NakUntil;
+    }
+    return;
+
+  case SIM_STALL:
+    pdev->host.HC_Status[n] = HC_STALL;
+    pdev->host.URB_State[n] = URB_STALL;
+    break;
+
+  default:
+    pdev->host.HC_Status[n] = HC_XACTERR;
+    pdev->host.ErrCnt[n] = 0;
+    pdev->host.URB_State[n] = URB_ERROR;
+    break;
+  }
+  ch->State = CH_IDLE;
+}
+
+/* 统计URB的结束 */
+static void Sim_UrbDone(uint8_t n)
+{
+  USB_OTG_CORE_HANDLE *pdev = &USB_OTG_Core;
+  SIM_STAGE_STATS *s = &Stats[Ch[n].Stage];
+  SIM_TIME t = SimNow - Ch[n].Submit;
+
+  switch(pdev->host.URB_State[n])
+  {
+  case URB_DONE:     s->Done++;     break;
+  case URB_NOTREADY: s->NotReady++; break;
+  case URB_STALL:    s->Stall++;    break;
+  case URB_ERROR:    s->Error++;    break;
+  default:           return;
+  }
+  s->BusSum += t;
+  if(t > s->BusMax)
+  {
+    s->BusMax = t;
+  }
+  LastEnd[pdev->host.hc[n].dev_addr & 0x7F] = SimNow;
+}
+
+/* 帧开始: SOF和OS tick */
+static void Sim_Frame(void)
+{
+  SimHRegs.HFNUM = (SimHRegs.HFNUM + 1) & 0x3FFF;
+  NextMs += SIM_MS(1);
+  if(SimHPRT0 & 0x04)
+  {
+    if(BusFree < SimNow + SIM_BITS(BITS_TOKEN + BITS_GAP))
+    {
+      BusFree = SimNow + SIM_BITS(BITS_TOKEN + BITS_GAP);
+    }
+    USBH_HCD_INT_fops->SOF(&USB_OTG_Core);
+  }
+  USB_HostSim_OsTick();
+}
+
+/* 总线空闲时开始下一个事务: 先interrupt通道, 其余轮流 */
+static void Sim_Schedule(void)
+{
+  SIM_TIME end;
+  int i, n, best;
+
+  for(;;)
+  {
+    best = -1;
+    for(i = 1; i <= SIM_CH_NUM; i++)
+    {
+      n = (LastCh + i) % SIM_CH_NUM;
+      if((Ch[n].State != CH_WAIT) || (Ch[n].Time > SimNow))
+      {
+        continue;
+      }
+      if(BusFree > SimNow)
+      {
+        Ch[n].Time = BusFree;
+        continue;
+      }
+      if((best < 0) || ((USB_OTG_Core.host.hc[n].ep_type == EP_TYPE_INTR) &&
+                        (USB_OTG_Core.host.hc[best].ep_type != EP_TYPE_INTR)))
+      {
+        best = n;
+      }
+    }
+    if(best < 0)
+    {
+      return;
+    }
+    end = SimNow + Sim_MaxTime(&USB_OTG_Core.host.hc[best]);
+    if(end > NextMs - SIM_BITS(BITS_EOF))
+    {
+      /* 本帧放不下, 所有等待的通道推到下一帧 */
+      for(n = 0; n < SIM_CH_NUM; n++)
+      {
+        if((Ch[n].State == CH_WAIT) && (Ch[n].Time <= SimNow))
+        {
+          Ch[n].Time = NextMs;
+        }
+      }
+      return;
+    }
+    LastCh = best;
+    Sim_Start(best);
+  }
+}
+
+/* 处理时间t的事件 */
+static void Sim_Step(SIM_TIME t)
+{
+  USB_OTG_CORE_HANDLE *pdev = &USB_OTG_Core;
+  URB_STATE urb;
+  uint8_t change = 0;
+  int n;
+
+  if(t > SimNow)
+  {
+    Sim_SetNow(t);
+  }
+  for(n = 0; n < SIM_CH_NUM; n++)
+  {
+    if((Ch[n].State == CH_BUSY) && (Ch[n].Time <= SimNow))
+    {
+      urb = pdev->host.URB_State[n];
+      Sim_End(n);
+      if(urb != pdev->host.URB_State[n])
+      {
+        change = 1;
+        Sim_UrbDone(n);
+        HCD_StatsURB(pdev, n);
+      }
+    }
+  }
+  if(change)
+  {
+    USBH_HCD_INT_fops->URBChange(pdev);
+  }
+  if(SimNow >= NextMs)
+  {
+    Sim_Frame();
+  }
+  if(PollAt && (SimNow >= PollAt))
+  {
+    PollAt = 0;
+    PollExpired = 1;
+    USB_OTG_BSP_EventPost(USB_OTG_EVT_TIMER);
+  }
+  Sim_Schedule();
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  USB_HostSim_Reset
+  *         Start of the model: time 0, no device, no injection
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_Reset(void)
+{
+  memset(Ch, 0, sizeof(Ch));
+  memset(Inject, 0, sizeof(Inject));
+  memset(LastEnd, 0, sizeof(LastEnd));
+  USB_HostSim_ClearStats();
+  Root = 0;
+  SimHPRT0 = 0;
+  BSP_Event = 0;
+  PollAt = 0;
+  PollExpired = 1;
+  SimLimit = 0;
+  BusFree = 0;
+  Sim_SetNow(0);
+  NextMs = SIM_MS(1);
+}
+
+/**
+  * @brief  USB_HostSim_Now
+  * @param  None
+  * @retval virtual time, ns
+  */
+SIM_TIME USB_HostSim_Now(void)
+{
+  return SimNow;
+}
+
+/**
+  * @brief  USB_HostSim_NextEvent
+  *         Time of the next bus, frame or timer event
+  * @param  None
+  * @retval time, ns
+  */
+SIM_TIME USB_HostSim_NextEvent(void)
+{
+  SIM_TIME t = NextMs;
+  int n;
+
+  if(PollAt && (PollAt < t))
+  {
+    t = PollAt;
+  }
+  for(n = 0; n < SIM_CH_NUM; n++)
+  {
+    if((Ch[n].State != CH_IDLE) && (Ch[n].Time < t))
+    {
+      t = Ch[n].Time;
+    }
+  }
+  return (t < SimNow) ? SimNow : t;
+}
+
+/**
+  * @brief  USB_HostSim_RunUntil
+  *         Let the bus and the timers run until t, the task does nothing
+  * @param  t: time, ns
+  * @retval None
+  */
+void USB_HostSim_RunUntil(SIM_TIME t)
+{
+  SIM_TIME e;
+
+  while((e = USB_HostSim_NextEvent()) <= t)
+  {
+    Sim_Step(e);
+  }
+  if(t > SimNow)
+  {
+    Sim_SetNow(t);
+  }
+}
+
+/**
+  * @brief  USB_HostSim_Cpu
+  *         The host task runs for t, the interrupts meanwhile
+  * @param  t: time, ns
+  * @retval None
+  */
+void USB_HostSim_Cpu(SIM_TIME t)
+{
+  CpuBusy += t;
+  USB_HostSim_RunUntil(SimNow + t);
+}
+
+/**
+  * @brief  USB_HostSim_SetLimit
+  *         Stop the program when the virtual time passes t (deadlock)
+  * @param  t: time, ns, 0: no limit
+  * @retval None
+  */
+void USB_HostSim_SetLimit(SIM_TIME t)
+{
+  SimLimit = t;
+}
+
+/**
+  * @brief  USB_HostSim_Attach
+  *         Connect a device to the root port, full speed
+  * @param  dev: device model
+  * @retval None
+  */
+void USB_HostSim_Attach(SIM_DEV *dev)
+{
+  USB_OTG_HPRT0_TypeDef hprt0;
+
+  Root = dev;
+  SimDev_Reset(dev);
+  hprt0.d32 = 0;
+  hprt0.b.prtconnsts = 1;
+  hprt0.b.prtena = 1;
+  hprt0.b.prtspd = HPRT0_PRTSPD_FULL_SPEED;
+  SimHPRT0 = hprt0.d32;
+  USBH_HCD_INT_fops->DevConnected(&USB_OTG_Core);
+}
+
+/**
+  * @brief  USB_HostSim_Detach
+  *         Disconnect the device of the root port
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_Detach(void)
+{
+  int n;
+
+  Root = 0;
+  SimHPRT0 = 0;
+  for(n = 0; n < SIM_CH_NUM; n++)
+  {
+    Ch[n].State = CH_IDLE;
+  }
+  USBH_HCD_INT_fops->DevDisconnected(&USB_OTG_Core);
+}
+
+/**
+  * @brief  USB_HostSim_Inject
+  *         Answer tokens of an endpoint with hs instead of the device. SETUP
+  *         packets are never touched. A STALL also halts the endpoint of the
+  *         device model (EP0: the control transfer in progress).
+  * @param  addr: device address
+  * @param  ep: endpoint address, bit 7 for IN
+  * @param  hs: SIM_NAK, SIM_STALL or SIM_NORESP
+  * @param  skip: tokens passed to the device first
+  * @param  count: tokens answered with hs, 0 cancels
+  * @retval None
+  */
+void USB_HostSim_Inject(uint8_t addr, uint8_t ep, SIM_HS hs, uint32_t skip, uint32_t count)
+{
+  int i, free = -1;
+
+  for(i = 0; i < SIM_INJECT_NUM; i++)
+  {
+    if((Inject[i].Addr == addr) && (Inject[i].Ep == ep))
+    {
+      break;
+    }
+    if((free < 0) && (Inject[i].Count == 0))
+    {
+      free = i;
+    }
+  }
+  if(i == SIM_INJECT_NUM)
+  {
+    if(free < 0)
+    {
+      return;
+    }
+    i = free;
+  }
+  Inject[i].Addr  = addr;
+  Inject[i].Ep    = ep;
+  Inject[i].Hs    = hs;
+  Inject[i].Skip  = skip;
+  Inject[i].Count = count;
+}
+
+/**
+  * @brief  USB_HostSim_GetStats
+  * @param  stage: transfer kind
+  * @retval counters since the last USB_HostSim_ClearStats
+  */
+SIM_STAGE_STATS *USB_HostSim_GetStats(SIM_STAGE stage)
+{
+  return &Stats[stage];
+}
+
+/**
+  * @brief  USB_HostSim_ClearStats
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_ClearStats(void)
+{
+  memset(Stats, 0, sizeof(Stats));
+  BusBusy = 0;
+  CpuBusy = 0;
+}
+
+/**
+  * @brief  USB_HostSim_BusBusy
+  * @param  None
+  * @retval bus time used by packets since the last USB_HostSim_ClearStats
+  */
+SIM_TIME USB_HostSim_BusBusy(void)
+{
+  return BusBusy;
+}
+
+/**
+  * @brief  USB_HostSim_CpuBusy
+  * @param  None
+  * @retval CPU time of the host task (USB_HostSim_Cpu) since the last
+  *         USB_HostSim_ClearStats
+  */
+SIM_TIME USB_HostSim_CpuBusy(void)
+{
+  return CpuBusy;
+}
+
+/**
+  * @brief  USB_HostSim_PrintStats
+  *         Per stage: URBs and their result, packets, NAKs, bytes, time from
+  *         the submit to the end of the URB and the host turnaround (end of
+  *         the previous URB of the device to the submit)
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_PrintStats(void)
+{
+  SIM_STAGE_STATS *s;
+  int i;
+
+  printf("   %-8s %7s %7s %6s %5s %5s %8s %7s %9s %8s %8s %9s %8s\n",
+         "stage", "URB", "done", "nak", "stall", "err", "packets", "NAKs", "KB",
+         "urb us", "max", "turn us", "max");
+  for(i = 0; i < SIM_STAGE_NUM; i++)
+  {
+    s = &Stats[i];
+    if(s->Urb == 0)
+    {
+      continue;
+    }
+    printf("   %-8s %7u %7u %6u %5u %5u %8u %7u %9.1f %8.1f %8.1f %9.1f %8.1f\n",
+           StageName[i], s->Urb, s->Done, s->NotReady, s->Stall, s->Error,
+           s->Packet, s->Nak, s->Bytes / 1024.0,
+           (s->Done + s->NotReady + s->Stall + s->Error) ?
+             s->BusSum / 1e3 / (s->Done + s->NotReady + s->Stall + s->Error) : 0.0,
+           s->BusMax / 1e3, s->Turn ? s->TurnSum / 1e3 / s->Turn : 0.0,
+           s->TurnMax / 1e3);
+  }
+}
+
+/*******************************************************************************
+* OTG core (usb_core.c)
+*******************************************************************************/
+USB_OTG_STS USB_OTG_SelectCore(USB_OTG_CORE_HANDLE *pdev, USB_OTG_CORE_ID_TypeDef coreID)
+{
+  int i;
+
+  pdev->cfg.host_channels = SIM_CH_NUM;
+  pdev->cfg.dev_endpoints = 4;
+  pdev->cfg.speed         = USB_OTG_SPEED_FULL;
+  pdev->cfg.dma_enable    = 0;
+  pdev->cfg.mps           = USB_OTG_FS_MAX_PACKET_SIZE;
+  pdev->cfg.TotalFifoSize = 320;
+  pdev->cfg.phy_itface   = USB_OTG_EMBEDDED_PHY;
+  pdev->cfg.coreID        = coreID;
+  pdev->regs.GREGS = &SimGRegs;
+  pdev->regs.HREGS = &SimHRegs;
+  pdev->regs.HPRT0 = &SimHPRT0;
+  for(i = 0; i < SIM_CH_NUM; i++)
+  {
+    pdev->regs.HC_REGS[i] = &SimHcRegs[i];
+  }
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_CoreInit(USB_OTG_CORE_HANDLE *pdev)
+{
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_CoreInitHost(USB_OTG_CORE_HANDLE *pdev)
+{
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_SetCurrentMode(USB_OTG_CORE_HANDLE *pdev, uint8_t mode)
+{
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_EnableGlobalInt(USB_OTG_CORE_HANDLE *pdev)
+{
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_DisableGlobalInt(USB_OTG_CORE_HANDLE *pdev)
+{
+  return USB_OTG_OK;
+}
+
+uint8_t USB_OTG_IsEvenFrame(USB_OTG_CORE_HANDLE *pdev)
+{
+  return !(USB_OTG_READ_REG32(&pdev->regs.HREGS->HFNUM) & 0x1);
+}
+
+uint32_t USB_OTG_ResetPort(USB_OTG_CORE_HANDLE *pdev)
+{
+  int n;
+
+  for(n = 0; n < SIM_CH_NUM; n++)
+  {
+    Ch[n].State = CH_IDLE;
+  }
+  SimHPRT0 |= 0x100;          //prtrst
+  USB_OTG_BSP_mDelay(10);
+  SimHPRT0 &= ~0x100;
+  if(Root)
+  {
+    SimDev_Reset(Root);
+  }
+  USB_OTG_BSP_mDelay(20);
+  return 1;
+}
+
+USB_OTG_STS USB_OTG_HC_Init(USB_OTG_CORE_HANDLE *pdev, uint8_t hc_num)
+{
+  Ch[hc_num].State = CH_IDLE;
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_HC_Halt(USB_OTG_CORE_HANDLE *pdev, uint8_t hc_num)
+{
+  Ch[hc_num].State = CH_IDLE;
+  return USB_OTG_OK;
+}
+
+USB_OTG_STS USB_OTG_HC_StartXfer(USB_OTG_CORE_HANDLE *pdev, uint8_t hc_num)
+{
+  USB_OTG_HC *hc = &pdev->host.hc[hc_num];
+  SIM_CH *ch = &Ch[hc_num];
+  SIM_STAGE_STATS *s;
+  uint16_t num_packets = 1;
+  uint8_t addr = hc->dev_addr & 0x7F;
+
+  if(hc->xfer_len > 0)
+  {
+    num_packets = (hc->xfer_len + hc->max_packet - 1) / hc->max_packet;
+    if(num_packets > 256)
+    {
+      num_packets = 256;
+      hc->xfer_len = num_packets * hc->max_packet;
+    }
+  }
+  ch->Buf = hc->xfer_buff;
+  ch->Len = hc->xfer_len;
+  ch->Pos = 0;
+  ch->Packets = num_packets;
+  ch->Pid = hc->data_pid;
+  if(hc->ep_is_in)
+  {
+    hc->xfer_len = num_packets * hc->max_packet;
+  }
+  else
+  {
+    /* 数据都写进了FIFO */
+    hc->xfer_buff  += hc->xfer_len;
+    hc->xfer_count += hc->xfer_len;
+    hc->xfer_len    = 0;
+  }
+
+  if(hc->data_pid == HC_PID_SETUP)
+  {
+    ch->Stage = SIM_STAGE_SETUP;
+  }
+  else if(hc->ep_type == EP_TYPE_CTRL)
+  {
+    ch->Stage = hc->ep_is_in ? SIM_STAGE_CTL_IN : SIM_STAGE_CTL_OUT;
+  }
+  else if(hc->ep_type == EP_TYPE_INTR)
+  {
+    ch->Stage = SIM_STAGE_INTR_IN;
+  }
+  else
+  {
+    ch->Stage = hc->ep_is_in ? SIM_STAGE_BULK_IN : SIM_STAGE_BULK_OUT;
+  }
+  s = &Stats[ch->Stage];
+  s->Urb++;
+  if(LastEnd[addr])
+  {
+    s->Turn++;
+    s->TurnSum += SimNow - LastEnd[addr];
+    if(SimNow - LastEnd[addr] > s->TurnMax)
+    {
+      s->TurnMax = SimNow - LastEnd[addr];
+    }
+    LastEnd[addr] = 0;
+  }
+
+  ch->Submit = SimNow;
+  ch->State = CH_WAIT;
+  /* interrupt传输在下一帧 */
+  ch->Time = (hc->ep_type == EP_TYPE_INTR) ? NextMs : SimNow;
+  return USB_OTG_OK;
+}
+
+/*******************************************************************************
+* BSP (usb_bsp.c)
+*******************************************************************************/
+void USB_OTG_BSP_Init(USB_OTG_CORE_HANDLE *pdev)
+{
+}
+
+void USB_OTG_BSP_EnableInterrupt(USB_OTG_CORE_HANDLE *pdev)
+{
+}
+
+void USB_OTG_BSP_ConfigVBUS(USB_OTG_CORE_HANDLE *pdev)
+{
+}
+
+void USB_OTG_BSP_DriveVBUS(USB_OTG_CORE_HANDLE *pdev, uint8_t state)
+{
+}
+
+void USB_OTG_BSP_uDelay(const uint32_t usec)
+{
+  USB_HostSim_Cpu(SIM_US(usec));
+}
+
+void USB_OTG_BSP_mDelay(const uint32_t msec)
+{
+  USB_HostSim_Cpu(SIM_MS(msec));
+}
+
+void USB_OTG_BSP_PollTimerStart(uint32_t usec)
+{
+  PollAt = 0;
+  PollExpired = (usec == 0);
+  if(usec)
+  {
+    PollAt = SimNow + SIM_US(usec);
+  }
+}
+
+uint8_t USB_OTG_BSP_PollTimerExpired(void)
+{
+  return PollExpired;
+}
+
+void USB_OTG_BSP_EventPost(uint32_t evt)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+
+  OS_ENTER_CRITICAL();
+  if((BSP_Event == 0) && (OSSem_USBDly != (OS_EVENT *)0))
+  {
+    OSSemPost(OSSem_USBDly);
+  }
+  BSP_Event |= evt;
+  OS_EXIT_CRITICAL();
+}
+
+uint32_t USB_OTG_BSP_EventWait(uint32_t timeout)
+{
+#if OS_CRITICAL_METHOD == 3u
+  OS_CPU_SR  cpu_sr = 0u;
+#endif
+  INT8U err;
+  uint32_t evt;
+
+  if(timeout)
+  {
+    OSSemPend(OSSem_USBDly, timeout, &err);
+  }
+
+  OS_ENTER_CRITICAL();
+  evt = BSP_Event;
+  if(evt != 0)
+  {
+    (void)OSSemAccept(OSSem_USBDly);
+  }
+  BSP_Event = 0;
+  OS_EXIT_CRITICAL();
+  return evt;
+}
+
+/**
+  * @brief  USB_OTG_BSP_HostSimSpin
+  *         Called by HCD_GetURB_State: the polling loops of the classes let
+  *         the bus run
+  * @param  pdev: Selected device
+  * @retval None
+  */
+void USB_OTG_BSP_HostSimSpin(USB_OTG_CORE_HANDLE *pdev)
+{
+  USB_HostSim_Cpu(SIM_COST_URB_POLL);
+}
@@ -0,0 +1,120 @@
+/**
+  ******************************************************************************
+  * @file    usb_hostsim.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   PC model of the OTG FS host core behind USB_OTG_CORE_HANDLE, of
+  *          usb_bsp.c and of the uC/OS-II services of the USB host task. The
+  *          host library (usbh_*.c, usb_hcd.c, FatFs) is built unchanged with
+  *          USB_OTG_HOSTSIM and runs on a virtual clock: 1 ms frames, full
+  *          speed packet times, NAK retries of the core, the OS tick and the
+  *          DFU poll timer. The devices are models (usb_simdev.h), tokens
+  *          can be answered with an injected NAK or STALL. The CPU time of
+  *          the library itself is not modelled, only the fixed costs below.
+  *          Build: see Makefile.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_HOSTSIM_H
+#define __USB_HOSTSIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_core.h"
+#include "usbh_core.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef uint64_t SIM_TIME;                  //虚拟时间, ns
+
+/* Answer of a device to a token */
+typedef enum
+{
+  SIM_ACK = 0,
+  SIM_NAK,
+  SIM_STALL,
+  SIM_NORESP,                               //无应答(设备不存在),主机记为XACTERR
+}
+SIM_HS;
+
+/* Transfer kinds of the statistics, from the channel of the URB */
+typedef enum
+{
+  SIM_STAGE_SETUP = 0,
+  SIM_STAGE_CTL_IN,
+  SIM_STAGE_CTL_OUT,
+  SIM_STAGE_BULK_IN,
+  SIM_STAGE_BULK_OUT,
+  SIM_STAGE_INTR_IN,
+  SIM_STAGE_NUM
+}
+SIM_STAGE;
+
+typedef struct
+{
+  uint32_t  Urb;          //提交的URB数
+  uint32_t  Done;         //URB_DONE
+  uint32_t  NotReady;     //URB_NOTREADY
+  uint32_t  Stall;        //URB_STALL
+  uint32_t  Error;        //URB_ERROR
+  uint32_t  Packet;       //总线上的事务,含NAK
+  uint32_t  Nak;
+  uint64_t  Bytes;
+  SIM_TIME  BusSum;       //提交到URB状态改变
+  SIM_TIME  BusMax;
+  uint32_t  Turn;         //TurnSum的次数
+  SIM_TIME  TurnSum;      //同一设备上一个URB结束到本次提交: 主机任务的反应时间
+  SIM_TIME  TurnMax;
+}
+SIM_STAGE_STATS;
+
+typedef struct _SIM_DEV SIM_DEV;            //usb_simdev.h
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_US(us)              ((SIM_TIME)(us) * 1000)
+#define SIM_MS(ms)              ((SIM_TIME)(ms) * 1000000)
+
+/* Fixed CPU costs of the host task (120MHz Cortex-M3, estimated) */
+#define SIM_COST_PROCESS        SIM_US(4)   //一轮USBH_Process+USBH_PollTimeout
+#define SIM_COST_URB_POLL       300         //一次HCD_GetURB_State, ns
+#define SIM_COST_WAKE           SIM_US(6)   //中断投递事件到任务运行(ISR+任务切换)
+#define SIM_COST_RX_PACKET      SIM_US(1)   //rx_qlvl中断读出一个IN包并重新使能通道
+
+/* The host task of app_task.c */
+#define SIM_TASK_EVENT          0           //USB_OTG_BSP_EventWait, 同AppTask_USB
+#define SIM_TASK_POLL           1           //每个OS tick执行一轮(OSTimeDly(1))
+
+/* Exported variables --------------------------------------------------------*/
+extern USB_OTG_CORE_HANDLE  USB_OTG_Core;
+extern USBH_HOST            USB_Host;
+extern uint8_t              USB_HostSim_Verbose;    //库的xprintf输出到stdout
+extern volatile uint8_t     USB_HostSim_MscReady;   //U盘已进入MSC应用状态
+extern OS_EVENT            *OSSem_USBDly;           //app_task.h
+
+/* Exported functions ------------------------------------------------------- */
+/* usb_hostsim.c: core, bus and BSP */
+void      USB_HostSim_Reset(void);
+SIM_TIME  USB_HostSim_Now(void);
+void      USB_HostSim_Cpu(SIM_TIME t);
+void      USB_HostSim_RunUntil(SIM_TIME t);
+SIM_TIME  USB_HostSim_NextEvent(void);
+void      USB_HostSim_SetLimit(SIM_TIME t);
+void      USB_HostSim_Attach(SIM_DEV *dev);
+void      USB_HostSim_Detach(void);
+void      USB_HostSim_Inject(uint8_t addr, uint8_t ep, SIM_HS hs, uint32_t skip, uint32_t count);
+SIM_STAGE_STATS *USB_HostSim_GetStats(SIM_STAGE stage);
+void      USB_HostSim_ClearStats(void);
+void      USB_HostSim_PrintStats(void);
+SIM_TIME  USB_HostSim_BusBusy(void);
+SIM_TIME  USB_HostSim_CpuBusy(void);
+
+/* usb_hostsim_os.c: uC/OS-II services and the USB host task */
+void      USB_HostSim_OsTick(void);
+void      USB_HostSim_TaskInit(uint8_t mode);
+void      USB_HostSim_TaskMode(uint8_t mode);
+void      USB_HostSim_TaskStep(void);
+uint32_t  USB_HostSim_TaskWake(void);
+void      USB_HostSim_TaskRun(SIM_TIME t);
+int       USB_HostSim_TaskUntil(volatile uint8_t *flag, SIM_TIME timeout);
+
+#endif /* __USB_HOSTSIM_H */
@@ -0,0 +1,459 @@
+/**
+  ******************************************************************************
+  * @file    usb_hostsim_os.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   uC/OS-II services used by the host library, for a single task on
+  *          the virtual clock of usb_hostsim.c, and the USB host task of
+  *          app_task.c (AppTask_USB) with its USR_cb. A pend that has to wait
+  *          lets the bus, the frames and the timers run until the post or the
+  *          timeout; the ISR and the task switch cost SIM_COST_WAKE.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "usb_hostsim.h"
+#include "usb_bsp.h"
+#include "usbh_usr.h"
+#include "usbh_msc_core.h"
+#include "usbh_msc_fatfs.h"
+#include "usbh_dfu_core.h"
+#if USBH_USE_HUB
+#include "usbh_hub.h"
+#endif
+#include "rtc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SIM_SEM_NUM             16
+#define SIM_TASK_PRIO           5
+
+/* Exported variables --------------------------------------------------------*/
+OS_TCB              *OSTCBCur;
+volatile INT32U      OSTime;
+OS_EVENT            *OSSem_USBDly;
+volatile uint8_t     USB_HostSim_MscReady;
+__ALIGN_BEGIN USB_OTG_CORE_HANDLE  USB_OTG_Core __ALIGN_END;
+__ALIGN_BEGIN USBH_HOST            USB_Host __ALIGN_END;
+
+/* Private variables ---------------------------------------------------------*/
+static OS_TCB        SimTcb;
+static OS_EVENT      SimSem[SIM_SEM_NUM];
+static uint8_t       SimSemUsed[SIM_SEM_NUM];
+static uint8_t       TaskMode;
+static uint32_t      TaskTimeout;
+static uint32_t      TaskRounds;
+
+/*******************************************************************************
+* uC/OS-II
+*******************************************************************************/
+OS_CPU_SR OS_CPU_SR_Save(void)
+{
+  return 0;
+}
+
+void OS_CPU_SR_Restore(OS_CPU_SR cpu_sr)
+{
+}
+
+OS_EVENT *OSSemCreate(INT16U cnt)
+{
+  int i;
+
+  for(i = 0; i < SIM_SEM_NUM; i++)
+  {
+    if(SimSemUsed[i] == 0)
+    {
+      SimSemUsed[i] = 1;
+      memset(&SimSem[i], 0, sizeof(OS_EVENT));
+      SimSem[i].OSEventType = OS_EVENT_TYPE_SEM;
+      SimSem[i].OSEventCnt = cnt;
+      return &SimSem[i];
+    }
+  }
+  return (OS_EVENT *)0;
+}
+
+OS_EVENT *OSSemDel(OS_EVENT *pevent, INT8U opt, INT8U *perr)
+{
+  if(pevent)
+  {
+    SimSemUsed[pevent - SimSem] = 0;
+  }
+  *perr = OS_ERR_NONE;
+  return (OS_EVENT *)0;
+}
+
+INT16U OSSemAccept(OS_EVENT *pevent)
+{
+  INT16U cnt;
+
+  if(pevent == (OS_EVENT *)0)
+  {
+    return 0;
+  }
+  cnt = pevent->OSEventCnt;
+  if(cnt)
+  {
+    pevent->OSEventCnt--;
+  }
+  return cnt;
+}
+
+INT8U OSSemPost(OS_EVENT *pevent)
+{
+  if(pevent == (OS_EVENT *)0)
+  {
+    return OS_ERR_PEVENT_NULL;
+  }
+  if(pevent->OSEventCnt == 65535u)
+  {
+    return OS_ERR_SEM_OVF;
+  }
+  pevent->OSEventCnt++;
+  return OS_ERR_NONE;
+}
+
+void OSSemPend(OS_EVENT *pevent, INT32U timeout, INT8U *perr)
+{
+  INT32U start = OSTime;
+
+  if(pevent == (OS_EVENT *)0)
+  {
+    *perr = OS_ERR_PEVENT_NULL;
+    return;
+  }
+  if(pevent->OSEventCnt)
+  {
+    pevent->OSEventCnt--;
+    *perr = OS_ERR_NONE;
+    return;
+  }
+  /* 只有一个任务: 等待期间只有中断(总线, 帧, 定时器)在运行 */
+  while(pevent->OSEventCnt == 0)
+  {
+    if(timeout && (OSTime - start >= timeout))
+    {
+      *perr = OS_ERR_TIMEOUT;
+      return;
+    }
+    USB_HostSim_RunUntil(USB_HostSim_NextEvent());
+  }
+  pevent->OSEventCnt--;
+  USB_HostSim_Cpu(SIM_COST_WAKE);
+  *perr = OS_ERR_NONE;
+}
+
+void OSTimeDly(INT32U ticks)
+{
+  INT32U start = OSTime;
+
+  while(OSTime - start < ticks)
+  {
+    USB_HostSim_RunUntil(USB_HostSim_NextEvent());
+  }
+  USB_HostSim_Cpu(SIM_COST_WAKE);
+}
+
+INT32U OSTimeGet(void)
+{
+  return OSTime;
+}
+
+/**
+  * @brief  USB_HostSim_OsTick
+  *         SysTick of the board, called at each 1 ms frame
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_OsTick(void)
+{
+  OSTime++;
+  RTC_SysTickCount();
+}
+
+/*******************************************************************************
+* xprintf: output of the library, only with USB_HostSim_Verbose. Same format
+* as ChaN's xprintf: flags 0 and -, width, l, types s c b o d u x; long is 32
+* bit as on the target.
+*******************************************************************************/
+void xprintf(const char *fmt, ...)
+{
+  va_list arp;
+  char s[16], c, d, f, *p;
+  unsigned int r, i, j, w;
+  unsigned long v;
+
+  if(USB_HostSim_Verbose == 0)
+  {
+    return;
+  }
+  va_start(arp, fmt);
+  for(;;)
+  {
+    c = *fmt++;
+    if(!c)
+    {
+      break;
+    }
+    if(c != '%')
+    {
+      putchar(c);
+      continue;
+    }
+    f = 0;
+    c = *fmt++;
+    if(c == '0')
+    {
+      f = 1; c = *fmt++;
+    }
+    else if(c == '-')
+    {
+      f = 2; c = *fmt++;
+    }
+    for(w = 0; c >= '0' && c <= '9'; c = *fmt++)
+    {
+      w = w * 10 + c - '0';
+    }
+    if(c == 'l' || c == 'L')
+    {
+      f |= 4; c = *fmt++;
+    }
+    if(!c)
+    {
+      break;
+    }
+    d = c;
+    if(d >= 'a')
+    {
+      d -= 0x20;
+    }
+    switch(d)
+    {
+    case 'S':
+      p = va_arg(arp, char*);
+      for(j = 0; p[j]; j++) ;
+      while(!(f & 2) && j++ < w) putchar(' ');
+      fputs(p, stdout);
+      while(j++ < w) putchar(' ');
+      continue;
+    case 'C':
+      putchar((char)va_arg(arp, int));
+      continue;
+    case 'B':
+      r = 2; break;
+    case 'O':
+      r = 8; break;
+    case 'D':
+    case 'U':
+      r = 10; break;
+    case 'X':
+      r = 16; break;
+    default:
+      putchar(c);
+      continue;
+    }
+    /* long和int都是32位 */
+    v = (d == 'D') ? (unsigned long)(long)va_arg(arp, int) : (unsigned long)va_arg(arp, unsigned int);
+    if(d == 'D' && (v & 0x80000000UL))
+    {
+      v = 0 - (v | 0xFFFFFFFF00000000UL);
+      f |= 8;
+    }
+    v &= 0xFFFFFFFFUL;
+    i = 0;
+    do
+    {
+      d = (char)(v % r); v /= r;
+      if(d > 9) d += (c == 'x') ? 0x27 : 0x07;
+      s[i++] = d + '0';
+    } while(v && i < sizeof(s));
+    if(f & 8) s[i++] = '-';
+    j = i; d = (f & 1) ? '0' : ' ';
+    while(!(f & 2) && j++ < w) putchar(d);
+    do putchar(s[--i]); while(i);
+    while(j++ < w) putchar(' ');
+  }
+  va_end(arp);
+}
+
+/*******************************************************************************
+* USR_cb of the simulated board: no LCD, no key
+*******************************************************************************/
+static void Usr_Nop(void)
+{
+}
+
+static void Usr_Lost(void)
+{
+  USB_HostSim_MscReady = 0;
+}
+
+static void Usr_Speed(uint8_t speed)
+{
+}
+
+static void Usr_Desc(void *desc)
+{
+}
+
+static void Usr_Cfg(USBH_CfgDesc_TypeDef *cfg, USBH_InterfaceDesc_TypeDef *itf,
+                    USBH_EpDesc_TypeDef *ep)
+{
+}
+
+static USBH_USR_Status Usr_Input(void)
+{
+  return USBH_USR_RESP_OK;
+}
+
+/* 停在MSC应用状态, 读写由FatFs经USBH_MSC_IO进行 */
+static int Usr_App(void)
+{
+  USB_HostSim_MscReady = 1;
+  return 0;
+}
+
+static USBH_Usr_cb_TypeDef Sim_USR_cb =
+{
+  Usr_Nop,              //Init
+  Usr_Lost,             //DeInit
+  Usr_Nop,              //DeviceAttached
+  Usr_Nop,              //ResetDevice
+  Usr_Lost,             //DeviceDisconnected
+  Usr_Nop,              //OverCurrentDetected
+  Usr_Speed,            //DeviceSpeedDetected
+  Usr_Desc,             //DeviceDescAvailable
+  Usr_Nop,              //DeviceAddressAssigned
+  Usr_Cfg,              //ConfigurationDescAvailable
+  Usr_Desc,             //ManufacturerString
+  Usr_Desc,             //ProductString
+  Usr_Desc,             //SerialNumString
+  Usr_Nop,              //EnumerationDone
+  Usr_Input,            //UserInput
+  Usr_App,              //UserApplication
+  Usr_Nop,              //DeviceNotSupported
+  Usr_Nop               //UnrecoveredError
+};
+
+/*******************************************************************************
+* AppTask_USB
+*******************************************************************************/
+/**
+  * @brief  USB_HostSim_TaskInit
+  *         Start of AppTask_USB: the classes and USBH_Init
+  * @param  mode: SIM_TASK_EVENT or SIM_TASK_POLL
+  * @retval None
+  */
+void USB_HostSim_TaskInit(uint8_t mode)
+{
+  SimTcb.OSTCBPrio = SIM_TASK_PRIO;
+  OSTCBCur = &SimTcb;
+  TaskMode = mode;
+  TaskTimeout = 0;
+  TaskRounds = 0;
+  if(OSSem_USBDly == (OS_EVENT *)0)
+  {
+    OSSem_USBDly = OSSemCreate(0);
+  }
+
+  USBH_MSC_IO_Init();
+  USBH_RegisterClass(MSC_CLASS, USBH_CLASS_ANY, &USBH_MSC_cb);
+  USBH_RegisterClass(APP_SPECIFIC_CLASS, DEVICE_FIRMWARE_UPGRADE, &USBH_DFU_cb);
+#if USBH_USE_HUB
+  USBH_RegisterClass(USB_HUB_CLASS, USBH_CLASS_ANY, &USBH_HUB_cb);
+#endif
+  USBH_Init(&USB_OTG_Core, USB_OTG_FS_CORE_ID, &USB_Host,
+            &USBH_DFU_cb, &Sim_USR_cb);
+}
+
+/**
+  * @brief  USB_HostSim_TaskMode
+  *         Switch the loop of the host task, the host keeps its state
+  * @param  mode: SIM_TASK_EVENT or SIM_TASK_POLL
+  * @retval None
+  */
+void USB_HostSim_TaskMode(uint8_t mode)
+{
+  TaskMode = mode;
+  TaskTimeout = 0;
+}
+
+/**
+  * @brief  USB_HostSim_TaskStep
+  *         One round of the loop of AppTask_USB. SIM_TASK_POLL: the loop of
+  *         the old firmware, one round per OS tick.
+  * @param  None
+  * @retval None
+  */
+void USB_HostSim_TaskStep(void)
+{
+  if(TaskMode == SIM_TASK_POLL)
+  {
+    OSTimeDly(1);
+    (void)USB_OTG_BSP_EventWait(0);
+  }
+  else
+  {
+    (void)USB_OTG_BSP_EventWait(TaskTimeout);
+  }
+  TaskRounds++;
+  USBH_Process(&USB_OTG_Core, &USB_Host);
+  USBH_MSC_IO_Process();
+  TaskTimeout = USBH_PollTimeout(&USB_OTG_Core, &USB_Host);
+  USB_HostSim_Cpu(SIM_COST_PROCESS);
+}
+
+/**
+  * @brief  USB_HostSim_TaskWake
+  * @param  None
+  * @retval rounds of the task since the last call
+  */
+uint32_t USB_HostSim_TaskWake(void)
+{
+  uint32_t n = TaskRounds;
+
+  TaskRounds = 0;
+  return n;
+}
+
+/**
+  * @brief  USB_HostSim_TaskRun
+  *         Run the host task for t
+  * @param  t: time, ns
+  * @retval None
+  */
+void USB_HostSim_TaskRun(SIM_TIME t)
+{
+  SIM_TIME end = USB_HostSim_Now() + t;
+
+  while(USB_HostSim_Now() < end)
+  {
+    USB_HostSim_TaskStep();
+  }
+}
+
+/**
+  * @brief  USB_HostSim_TaskUntil
+  *         Run the host task until *flag is set
+  * @param  flag: set by the library or a callback
+  * @param  timeout: time, ns
+  * @retval 1: flag set, 0: timeout
+  */
+int USB_HostSim_TaskUntil(volatile uint8_t *flag, SIM_TIME timeout)
+{
+  SIM_TIME end = USB_HostSim_Now() + timeout;
+
+  while(*flag == 0)
+  {
+    if(USB_HostSim_Now() >= end)
+    {
+      return 0;
+    }
+    USB_HostSim_TaskStep();
+  }
+  return 1;
+}
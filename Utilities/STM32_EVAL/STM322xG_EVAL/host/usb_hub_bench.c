@@ -0,0 +1,226 @@
+/**
+  ******************************************************************************
+  * @file    usb_hub_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Parallel DFU behind a hub (USBH_USE_HUB, usbh_hub.c) on the OTG
+  *          core model. N MK5 DFU target models are plugged into a 4 port
+  *          hub model on the root port; all get the MK5 image of
+  *          usbh_fireware.c at once and their flash is compared afterwards.
+  *          For N = 1, 2, 4, and for one device on the root port without
+  *          the hub: time from the plug in to the last manifest, per device
+  *          enumeration and download, bus load, and the units per hour of
+  *          the station when the devices are swapped in batches of N.
+  *          Usage: usb_hub_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HUB_PORTS        4
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t     Num;          //设备数, 0: 不经集线器的一台设备
+  double      Total;        //插入到最后一台Manifest, ms
+  double      Enum;         //插入到第一个DNLOAD, 各设备平均, ms
+  double      Down;         //第一个DNLOAD到Manifest, 各设备平均, ms
+  double      Late;         //各设备每块等待主机的时间, ms
+  double      Bus;          //总线占用, %
+  double      PerHour;
+  uint32_t    Collision;
+}
+BENCH_RESULT;
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static int Bench_AllDone(SIM_DEV **dfu, int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+  {
+    if(SimDev_DfuStats(dfu[i])->Manifest == 0)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* num台设备同时下载, num为0时设备直接接在根端口上 */
+static void Bench_Station(uint8_t num, BENCH_RESULT *r)
+{
+  SIM_DEV *dfu[HUB_PORTS];
+  SIM_DEV *hub = 0;
+  SIM_DFU_STATS *d;
+  SIM_TIME t0, end, last = 0;
+  uint32_t size, block = 0;
+  uint8_t *flash;
+  char serial[16];
+  int i, n = num ? num : 1;
+
+  memset(r, 0, sizeof(*r));
+  r->Num = num;
+  if(num)
+  {
+    printf("\n== %d device%s behind the hub\n", num, (num > 1) ? "s" : "");
+  }
+  else
+  {
+    printf("\n== one device on the root port\n");
+  }
+  for(i = 0; i < n; i++)
+  {
+    snprintf(serial, sizeof(serial), "MK5SIM%02d", i + 1);
+    dfu[i] = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, serial);
+  }
+
+  USB_HostSim_ClearStats();
+  t0 = USB_HostSim_Now();
+  end = t0 + SIM_MS(120000);
+  if(num)
+  {
+    hub = SimDev_HubCreate(HUB_PORTS);
+    for(i = 0; i < n; i++)
+    {
+      SimDev_HubAttach(hub, i + 1, dfu[i]);
+    }
+    USB_HostSim_Attach(hub);
+  }
+  else
+  {
+    USB_HostSim_Attach(dfu[0]);
+  }
+  while(!Bench_AllDone(dfu, n) && (USB_HostSim_Now() < end))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(Bench_AllDone(dfu, n), "DFU manifest");
+
+  for(i = 0; i < n; i++)
+  {
+    d = SimDev_DfuStats(dfu[i]);
+    if(d->Manifest)
+    {
+      printf("   device %d: enumeration %.1f ms, download %.1f ms, %u blocks, host late %.2f ms/block\n",
+             i + 1, Ms(d->First - t0), Ms(d->Manifest - d->First), d->Block,
+             d->Block ? Ms(d->LateSum) / d->Block : 0.0);
+      r->Enum += Ms(d->First - t0) / n;
+      r->Down += Ms(d->Manifest - d->First) / n;
+      r->Late += Ms(d->LateSum);
+      block += d->Block;
+      if(d->Manifest > last)
+      {
+        last = d->Manifest;
+      }
+    }
+    size = 0;
+    flash = SimDev_DfuFlash(dfu[i], &size);
+    Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, size) == 0), "flash compare");
+  }
+  if(last)
+  {
+    r->Total = Ms(last - t0);
+    r->Late = block ? r->Late / block : 0.0;
+    r->Bus = 100.0 * USB_HostSim_BusBusy() / (last - t0);
+    r->PerHour = n * 3600e3 / r->Total;
+  }
+  if(hub)
+  {
+    r->Collision = SimDev_HubStats(hub)->Collision;
+    Check(r->Collision == 0, "two devices at one address");
+  }
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  for(i = 0; i < n; i++)
+  {
+    SimDev_DfuDestroy(dfu[i]);
+  }
+  if(hub)
+  {
+    SimDev_HubDestroy(hub);
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  static const uint8_t Num[] = { 0, 1, 2, 4 };
+  BENCH_RESULT r[sizeof(Num)];
+  char name[16];
+  int i;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+  Fireware = (uint8_t *)MK5_Image;
+  FirewareSize = MK5_ImageSize;
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(900000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  for(i = 0; i < (int)sizeof(Num); i++)
+  {
+    Bench_Station(Num[i], &r[i]);
+  }
+
+  printf("\n== DFU station: MK5 image %u bytes, wTransferSize %u, %d port hub\n\n",
+         MK5_ImageSize, DFU_XFER, HUB_PORTS);
+  printf("   %-10s %10s %9s %10s %9s %7s %9s\n", "devices", "total", "enum", "download",
+         "late", "bus", "units/h");
+  printf("   %-10s %10s %9s %10s %9s %7s %9s\n", "", "ms", "ms", "ms", "ms/blk", "%", "");
+  for(i = 0; i < (int)sizeof(Num); i++)
+  {
+    if(r[i].Num)
+    {
+      snprintf(name, sizeof(name), "%u, hub", r[i].Num);
+    }
+    else
+    {
+      snprintf(name, sizeof(name), "1, root");
+    }
+    printf("   %-10s %10.1f %9.1f %10.1f %9.3f %7.1f %9.0f\n", name, r[i].Total, r[i].Enum,
+           r[i].Down, r[i].Late, r[i].Bus, r[i].PerHour);
+  }
+
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
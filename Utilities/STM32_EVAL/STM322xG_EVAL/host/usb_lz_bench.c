@@ -0,0 +1,244 @@
+/**
+  ******************************************************************************
+  * @file    usb_lz_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Packed DFU image (usbh_dfu_lz.c) against the raw one. The MK5
+  *          image of usbh_fireware.c is packed by Tools/dfu_pack.py into
+  *          build/mk5.dfz (Makefile).
+  *          - flash bytes of the raw and of the packed image;
+  *          - decoder on the PC: whole image, checked against the raw one
+  *            and the CRC32 of the container head;
+  *          - DFU download to the MK5 target model from the array in flash,
+  *            raw and packed, on the OTG core model. USBH_DFU_LZ_Decode is
+  *            linked with --wrap and costs LZ cycles per output byte of the
+  *            120 MHz core in virtual time; the EP0 rate of the data stages
+  *            is set against the decoder rate.
+  *          Usage: usb_lz_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "usbh_dfu_lz.h"
+#include "usbh_dfu_crc.h"
+
+/* Private define ------------------------------------------------------------*/
+#define DFZ_PATH         "build/mk5.dfz"
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+#define CPU_MHZ          120
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static int      Failed;
+static uint8_t *Packed;
+static uint32_t PackedSize;
+static uint32_t PackedPos;
+static uint32_t LzCycles;               //每输出字节的CPU周期, 0: 不计时间
+static uint32_t LzCalls;
+static SIM_TIME LzSum;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+/* usbh_dfu_file.c调用的解码器, 按LzCycles计入主机任务的时间 */
+uint32_t __real_USBH_DFU_LZ_Decode(DFU_LZ_ST *lz, uint8_t *out, uint32_t len);
+
+uint32_t __wrap_USBH_DFU_LZ_Decode(DFU_LZ_ST *lz, uint8_t *out, uint32_t len)
+{
+  uint32_t n = __real_USBH_DFU_LZ_Decode(lz, out, len);
+  SIM_TIME t = (SIM_TIME)n * LzCycles * 1000 / CPU_MHZ;
+
+  if(LzCycles)
+  {
+    LzCalls++;
+    LzSum += t;
+    USB_HostSim_Cpu(t);
+  }
+  return n;
+}
+
+static uint32_t Bench_Read(uint8_t *buf, uint32_t len)
+{
+  if(len > PackedSize - PackedPos)
+  {
+    len = PackedSize - PackedPos;
+  }
+  memcpy(buf, Packed + PackedPos, len);
+  PackedPos += len;
+  return len;
+}
+
+static int Bench_Load(void)
+{
+  FILE *f = fopen(DFZ_PATH, "rb");
+  long n;
+
+  if(f == 0)
+  {
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  Packed = malloc(n);
+  PackedSize = (uint32_t)n;
+  n = (long)fread(Packed, 1, n, f);
+  fclose(f);
+  return (n == (long)PackedSize) && (PackedSize > sizeof(DFU_LZ_HEAD_ST));
+}
+
+/* 在PC上解出整个镜像, 每次一块 */
+static void Bench_Decode(void)
+{
+  static DFU_LZ_ST lz;
+  DFU_LZ_HEAD_ST head;
+  struct timespec t0, t1;
+  uint8_t *out = malloc(MK5_ImageSize);
+  uint32_t pos, n, crc;
+  double ns = 0;
+  int round;
+
+  memcpy(&head, Packed, sizeof(head));
+  Check((head.Magic == DFU_LZ_MAGIC) && (head.RawSize == (uint32_t)MK5_ImageSize), "container head");
+  for(round = 0; round < 20; round++)
+  {
+    PackedPos = sizeof(head);
+    memset(out, 0, MK5_ImageSize);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    USBH_DFU_LZ_Init(&lz, Bench_Read, head.PackSize);
+    for(pos = 0; pos < (uint32_t)MK5_ImageSize; pos += n)
+    {
+      n = ((uint32_t)MK5_ImageSize - pos < DFU_XFER) ? (uint32_t)MK5_ImageSize - pos : DFU_XFER;
+      if(__real_USBH_DFU_LZ_Decode(&lz, out + pos, n) != n)
+      {
+        break;
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+  }
+  crc = USBH_DFU_Crc32(USBH_DFU_CRC32_INIT, out, MK5_ImageSize);
+  Check((pos == (uint32_t)MK5_ImageSize) && (memcmp(out, MK5_Image, MK5_ImageSize) == 0), "decode");
+  Check(crc == head.RawCrc, "CRC32 of the container head");
+  printf("   decoder on this PC: %.1f MB/s, %.2f ns per byte\n",
+         MK5_ImageSize / (ns / round / 1e9) / 1e6, ns / round / MK5_ImageSize);
+  free(out);
+}
+
+/* 从片内Flash的镜像下载到MK5模型 */
+static void Bench_Dfu(const char *name, uint8_t *image, uint32_t size, uint32_t cycles, SIM_TIME per_kb)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  SIM_TIME t0, end, t;
+  uint32_t fsize = 0;
+  uint8_t *flash;
+  double ep0, lz;
+
+  printf("\n== %s\n", name);
+  Fireware = image;
+  FirewareSize = size;
+  LzCycles = cycles;
+  LzCalls = 0;
+  LzSum = 0;
+  if(per_kb)
+  {
+    SimDev_DfuTiming(dfu, SIM_MS(2), per_kb, SIM_MS(100));
+  }
+  USB_HostSim_ClearStats();
+  t0 = USB_HostSim_Now();
+  end = t0 + SIM_MS(60000);
+  USB_HostSim_Attach(dfu);
+  while((d->Manifest == 0) && (USB_HostSim_Now() < end))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(d->Manifest != 0, "DFU manifest");
+  USB_HostSim_TaskRun(SIM_MS(20));
+
+  if(d->Manifest)
+  {
+    t = d->Manifest - d->First;
+    printf("   flash %u bytes; attach to manifest %.1f ms, download %.1f ms, %.1f KB/s\n",
+           size, Ms(d->Manifest - t0), Ms(t), d->Bytes / 1024.0 / (t / 1e9));
+    printf("   per block: data %.2f ms, programming %.2f ms, host late %.3f ms\n",
+           d->Block ? Ms(d->DataSum) / d->Block : 0.0, d->Block ? Ms(d->ProgSum) / d->Block : 0.0,
+           d->Block ? Ms(d->LateSum) / d->Block : 0.0);
+    if(cycles && LzCalls)
+    {
+      ep0 = d->Bytes / 1024.0 / (d->DataSum / 1e9);
+      lz = CPU_MHZ * 1e6 / cycles / 1024.0;
+      printf("   decoder %u cycles/byte: %.2f ms per block, %.0f KB/s against EP0 %.0f KB/s (x%.1f)\n",
+             cycles, Ms(LzSum) / LzCalls, lz, ep0, lz / ep0);
+    }
+  }
+  flash = SimDev_DfuFlash(dfu, &fsize);
+  Check((fsize == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, fsize) == 0), "flash compare");
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_Load())
+  {
+    printf("FAILED: %s, made by Tools/dfu_pack.py (make)\n", DFZ_PATH);
+    return 1;
+  }
+  printf("== MK5 image: raw %u bytes, packed %u bytes (%.1f%%), saves %u bytes of flash\n",
+         MK5_ImageSize, PackedSize, 100.0 * PackedSize / MK5_ImageSize, MK5_ImageSize - PackedSize);
+  printf("   decoder RAM %u bytes (DFU_LZ_ST)\n", (uint32_t)sizeof(DFU_LZ_ST));
+  Bench_Decode();
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+
+  Bench_Dfu("raw image", (uint8_t *)MK5_Image, MK5_ImageSize, 0, 0);
+  Bench_Dfu("packed image, decoder 30 cycles/byte", Packed, PackedSize, 30, 0);
+  Bench_Dfu("packed image, decoder 120 cycles/byte (flash wait states)", Packed, PackedSize, 120, 0);
+  Bench_Dfu("raw image, device programming 2 ms + 0.1 ms/KB", (uint8_t *)MK5_Image, MK5_ImageSize, 0,
+            SIM_US(100));
+  Bench_Dfu("packed image, 120 cycles/byte, device programming 2 ms + 0.1 ms/KB", Packed, PackedSize,
+            120, SIM_US(100));
+
+  free(Packed);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
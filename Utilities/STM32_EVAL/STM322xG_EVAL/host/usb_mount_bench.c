@@ -0,0 +1,265 @@
+/**
+  ******************************************************************************
+  * @file    usb_mount_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Mount cache of usbh_msc_mount.c (USBH_MSC_MOUNT_NUM, FatFs
+  *          _USE_MNTCACHE) on the OTG core model and the stick model on a
+  *          256 MB FAT32 image. As USBH_USR_MSC_Application, FATFS.mnt is
+  *          set after f_mount and the root directory is opened; attach to
+  *          the root directory open is timed, BOT commands counted.
+  *          - first plug: full MSC init, the stick is stored;
+  *          - replug: READ_CAPACITY10 skipped, MODE_SENSE6 still sent; the
+  *            free cluster map of the last sync restored. The FAT geometry
+  *            is read from the disk as on the first plug;
+  *          - another writer: the image is written without this host, the
+  *            stick is still known but the map is dropped;
+  *          - reformat: a new FAT on the image, the new volume is mounted
+  *            and the cache marked changed, the next plug is a full init;
+  *          - write protect switch turned on: seen by MODE_SENSE6 on the
+  *            replug, the stick is dropped from the cache.
+  *          Usage: usb_mount_bench [-v]   (-v: library debug output)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+#include "usbh_msc_mount.h"
+#include "usbh_msc_scsi.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_mount.img"
+#define IMG_SIZE         (256u * 1024 * 1024)   //2KB簇时为FAT32
+#define CLUSTER          2048
+#define SERIAL           "SIM0001"
+#define OTHER_SIZE       (1024u * 1024)         //另一个写者的文件
+
+/* FSInfo */
+#define FSI_FREE_COUNT   488
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV DiskImg_Drv;
+extern const DISKIO_DRV USBH_MSC_Disk;
+BOOL diskimg_open(const char *path);
+void diskimg_close(void);
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static FATFS    FsOff;                          //不经过USB的写者
+static SIM_DEV *Msc;
+static uint8_t  Map[_USE_FREEMAP];              //上次同步时的空闲簇表
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static int Map_Empty(const uint8_t *map)
+{
+  uint32_t i;
+
+  for(i = 0; i < _USE_FREEMAP; i++)
+  {
+    if(map[i])
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* 不经过USB: 在镜像文件上建FAT, 或写一个文件 */
+static int Offline(int mkfs, uint32_t cluster)
+{
+  BYTE sec[512];
+  DWORD fsi;
+  FIL fil;
+  int ok;
+
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(1, &DiskImg_Drv);
+  f_mount(1, &FsOff);
+  ok = !mkfs || (f_mkfs(1, 0, cluster) == FR_OK);
+  ok = ok && (f_open(&fil, "1:OTHER.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+       && (f_lseek(&fil, OTHER_SIZE) == FR_OK) && (f_close(&fil) == FR_OK);
+  fsi = FsOff.fsi_sector;
+  f_mount(1, 0);
+  if(ok && mkfs)
+  {
+    /* 空闲簇数未知, 第一次插入时f_getfree扫描FAT并填写空闲簇表 */
+    ok = (DiskImg_Drv.read(sec, fsi, 1) == RES_OK);
+    memset(sec + FSI_FREE_COUNT, 0xFF, 4);
+    ok = ok && (DiskImg_Drv.write(sec, fsi, 1) == RES_OK);
+  }
+  diskimg_close();
+  return ok;
+}
+
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  return Offline(1, CLUSTER);
+}
+
+/* 插入到打开根目录, 同USBH_USR_MSC_Application */
+static void Plug(const char *name)
+{
+  SIM_MSC_STATS *m;
+  SIM_TIME t0, ready;
+  DIR dir;
+
+  if(Msc == 0)
+  {
+    Msc = SimDev_MscCreate(IMG_PATH, SERIAL);
+  }
+  m = SimDev_MscStats(Msc);
+  memset(m, 0, sizeof(SIM_MSC_STATS));
+  t0 = USB_HostSim_Now();
+  USB_HostSim_Attach(Msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+  ready = USB_HostSim_Now() - t0;
+  Check(f_mount(0, &Fs) == FR_OK, "f_mount");
+  Fs.mnt = USBH_MSC_Mount_Vol();
+#if _USE_DIRIDX
+  Fs.didx = Idx;
+#endif
+  Check(f_opendir(&dir, "0:") == FR_OK, "f_opendir");
+  printf("   %-16s %10.2f %10.2f %8u %8u %8s %8s\n", name, Ms(ready), Ms(USB_HostSim_Now() - t0),
+         m->Cmd, (uint32_t)m->SectorRd, Fs.mnt ? "yes" : "no",
+         Map_Empty(Fs.fmap) ? "empty" : "kept");
+}
+
+/* 写一个文件并同步, 卷信息留在缓存中 */
+static void Write_File(void)
+{
+  FIL fil;
+  UINT bw;
+
+  Check((f_open(&fil, "0:BENCH.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+        && (f_write(&fil, Map, sizeof(Map), &bw) == FR_OK) && (f_close(&fil) == FR_OK), "f_write");
+}
+
+static void Unplug(int destroy)
+{
+  f_mount(0, 0);
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  if(destroy)
+  {
+    SimDev_MscDestroy(Msc);                     //镜像文件交给另一个写者
+    Msc = 0;
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  FATFS *fs;
+  DWORD nfree;
+  uint32_t cmd_full, cmd_hit;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_MakeImage())
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  disk_attach(0, &USBH_MSC_Disk);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+
+  printf("== mount cache, %d sticks, %u MB FAT32 image, cluster %u bytes\n", USBH_MSC_MOUNT_NUM,
+         IMG_SIZE >> 20, CLUSTER);
+  printf("   %-16s %10s %10s %8s %8s %8s %8s\n", "plug", "MSC ready", "root open", "BOT", "sectors",
+         "cached", "free map");
+  printf("   %-16s %10s %10s %8s %8s %8s %8s\n", "", "ms", "ms", "commands", "read", "", "");
+
+  /* 第一次插入: 完整初始化, f_getfree填满空闲簇表 */
+  Plug("first plug");
+  cmd_full = SimDev_MscStats(Msc)->Cmd;
+  Check(Fs.mnt != 0, "stick stored");
+  Check(f_getfree("0:", &nfree, &fs) == FR_OK, "f_getfree");
+  Write_File();
+  memcpy(Map, Fs.fmap, sizeof(Map));
+  Check(!Map_Empty(Map), "free map filled");
+  Unplug(0);
+
+  /* 再次插入: 跳过READ_CAPACITY10, 恢复空闲簇表 */
+  Plug("replug");
+  cmd_hit = SimDev_MscStats(Msc)->Cmd;
+  Check(cmd_hit + 1 == cmd_full, "READ_CAPACITY10 skipped");
+  Check(memcmp(Fs.fmap, Map, sizeof(Map)) == 0, "free map restored");
+  Unplug(1);
+
+  /* 另一个写者改变了FSInfo: U盘仍在缓存中, 空闲簇表不用 */
+  Check(Offline(0, 0), "other writer");
+  Plug("another writer");
+  Check(SimDev_MscStats(Msc)->Cmd == cmd_hit, "stick from the cache");
+  Check(Map_Empty(Fs.fmap), "free map dropped");
+  Unplug(1);
+
+  /* 重新格式化: 挂载新卷, 缓存标记为已改变, 下次完整初始化 */
+  Check(Offline(1, CLUSTER / 2), "reformat");
+  Plug("reformat");
+  Check(Fs.csize == CLUSTER / 2 / 512, "new volume mounted");
+  Check(Fs.mnt && (Fs.mnt->fs_type == 0xFF), "cache marked changed");
+  Check(Map_Empty(Fs.fmap), "no free map of the old volume");
+  Unplug(0);
+  Plug("next plug");
+  Check(SimDev_MscStats(Msc)->Cmd == cmd_full, "full init");
+  Unplug(0);
+
+  /* 写保护开关: MODE_SENSE6照常发送, 写保护的U盘不缓存 */
+  SimDev_MscWriteProtect(Msc, 1);
+  Plug("write protected");
+  Check(SimDev_MscStats(Msc)->Cmd == cmd_hit, "stick from the cache");
+  Check(USBH_MSC_Param.MSWriteProtect == DISK_WRITE_PROTECTED, "write protection seen");
+  Check(Fs.mnt == 0, "stick dropped");
+  Unplug(0);
+  SimDev_MscWriteProtect(Msc, 0);
+  Plug("unprotected");
+  Check(SimDev_MscStats(Msc)->Cmd == cmd_full, "full init");
+  Check((USBH_MSC_Param.MSWriteProtect == 0) && (Fs.mnt != 0), "stick stored");
+  Unplug(1);
+
+  unlink(IMG_PATH);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
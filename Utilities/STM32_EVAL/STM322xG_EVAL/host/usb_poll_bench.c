@@ -0,0 +1,217 @@
+/**
+  ******************************************************************************
+  * @file    usb_poll_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Latency of the USB host task on the OTG core model: the loop of
+  *          the old AppTask_USB, one USBH_Process per OS tick (SIM_TASK_POLL),
+  *          against the task that waits for the events of the OTG interrupt
+  *          with the timeout of USBH_PollTimeout (SIM_TASK_EVENT).
+  *          For each loop, in virtual time:
+  *          - enumeration of the MK5 DFU target and of a stick;
+  *          - DFU download of the MK5 image, per-stage reaction time of the
+  *            task (end of an URB to the next URB on the same device);
+  *          - one second idle with the stick attached: wakeups of the task
+  *            and its CPU time.
+  *          Usage: usb_poll_bench [-v]   (-v: per-stage URB tables)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_poll.img"
+#define IMG_SIZE         (1024u * 1024)
+#define DFU_FLASH        (1024u * 1024)
+#define DFU_XFER         0x1000
+#define IDLE_TIME        SIM_MS(1000)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *Name;
+  double      DfuEnum;      //插入到第一个DNLOAD, ms
+  double      DfuDown;      //第一个DNLOAD到Manifest, ms
+  double      DfuKBs;
+  uint32_t    Status;       //GETSTATUS数
+  double      Turn[2];      //CTL IN, CTL OUT前主机任务的平均反应时间, us
+  double      TurnMax;
+  uint32_t    DfuRounds;    //下载期间任务执行的轮数
+  double      MscEnum;      //插入到MSC应用, ms
+  uint32_t    IdleRounds;   //空闲1s任务执行的轮数
+  double      IdleCpu;      //空闲时任务的CPU占用, %
+}
+BENCH_RESULT;
+
+/* Exported variables --------------------------------------------------------*/
+extern uint8_t  *Fireware;              //usbh_dfu_core.c
+extern uint32_t  FirewareSize;
+extern const char MK5_Image[];          //usbh_fireware.c, Makefile
+extern int        MK5_ImageSize;
+
+/* Private variables ---------------------------------------------------------*/
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static double Bench_Turn(SIM_STAGE stage)
+{
+  SIM_STAGE_STATS *s = USB_HostSim_GetStats(stage);
+
+  return s->Turn ? s->TurnSum / 1e3 / s->Turn : 0.0;
+}
+
+/* 下载MK5镜像 */
+static void Bench_Dfu(BENCH_RESULT *r)
+{
+  SIM_DEV *dfu = SimDev_DfuCreate(DFU_FLASH, DFU_XFER, 1, "MK5SIM01");
+  SIM_DFU_STATS *d = SimDev_DfuStats(dfu);
+  SIM_TIME t0, end;
+  uint32_t size = 0;
+  uint8_t *flash;
+  int n;
+
+  USB_HostSim_ClearStats();
+  USB_HostSim_TaskWake();
+  t0 = USB_HostSim_Now();
+  end = t0 + SIM_MS(60000);
+  USB_HostSim_Attach(dfu);
+  while((d->Manifest == 0) && (USB_HostSim_Now() < end))
+  {
+    USB_HostSim_TaskStep();
+  }
+  Check(d->Manifest != 0, "DFU manifest");
+  r->DfuRounds = USB_HostSim_TaskWake();
+  if(d->Manifest)
+  {
+    r->DfuEnum = Ms(d->First - t0);
+    r->DfuDown = Ms(d->Manifest - d->First);
+    r->DfuKBs  = d->Bytes / 1024.0 / ((d->Manifest - d->First) / 1e9);
+  }
+  /* SETUP之前的等待含bwPollTimeout和Manifest, 不计 */
+  r->Status  = d->Status;
+  r->Turn[0] = Bench_Turn(SIM_STAGE_CTL_IN);
+  r->Turn[1] = Bench_Turn(SIM_STAGE_CTL_OUT);
+  r->TurnMax = 0;
+  for(n = SIM_STAGE_CTL_IN; n <= SIM_STAGE_CTL_OUT; n++)
+  {
+    if(USB_HostSim_GetStats((SIM_STAGE)n)->TurnMax / 1e3 > r->TurnMax)
+    {
+      r->TurnMax = USB_HostSim_GetStats((SIM_STAGE)n)->TurnMax / 1e3;
+    }
+  }
+  flash = SimDev_DfuFlash(dfu, &size);
+  Check((size == (uint32_t)MK5_ImageSize) && (memcmp(flash, MK5_Image, size) == 0), "flash compare");
+  if(USB_HostSim_Verbose)
+  {
+    USB_HostSim_PrintStats();
+  }
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_DfuDestroy(dfu);
+}
+
+/* 插入U盘, 然后空闲IDLE_TIME */
+static void Bench_Msc(BENCH_RESULT *r)
+{
+  SIM_DEV *msc = SimDev_MscCreate(IMG_PATH, "SIM0001");
+  SIM_TIME t0;
+
+  if(msc == 0)
+  {
+    Check(0, "image " IMG_PATH);
+    return;
+  }
+  t0 = USB_HostSim_Now();
+  USB_HostSim_Attach(msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+  r->MscEnum = Ms(USB_HostSim_Now() - t0);
+
+  USB_HostSim_TaskRun(SIM_MS(100));
+  USB_HostSim_ClearStats();
+  USB_HostSim_TaskWake();
+  USB_HostSim_TaskRun(IDLE_TIME);
+  r->IdleRounds = USB_HostSim_TaskWake();
+  r->IdleCpu = 100.0 * USB_HostSim_CpuBusy() / IDLE_TIME;
+
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_MscDestroy(msc);
+}
+
+static void Bench_Mode(uint8_t mode, BENCH_RESULT *r)
+{
+  memset(r, 0, sizeof(*r));
+  r->Name = (mode == SIM_TASK_POLL) ? "poll, 1 tick" : "event";
+  USB_HostSim_TaskMode(mode);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  Bench_Dfu(r);
+  Bench_Msc(r);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  BENCH_RESULT r[2];
+  FILE *f;
+  int i;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  f = fopen(IMG_PATH, "wb");
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  fclose(f);
+  Fireware = (uint8_t *)MK5_Image;
+  FirewareSize = MK5_ImageSize;
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  Bench_Mode(SIM_TASK_POLL, &r[0]);
+  Bench_Mode(SIM_TASK_EVENT, &r[1]);
+
+  printf("\n== USB host task: USBH_Process every OS tick against event driven\n");
+  printf("   MK5 image %u bytes, wTransferSize %u; stick idle %.0f ms\n\n",
+         MK5_ImageSize, DFU_XFER, Ms(IDLE_TIME));
+  printf("   %-13s %9s %10s %7s %8s %9s %8s %8s %8s %9s %8s %7s\n", "task", "DFU enum",
+         "download", "KB/s", "rounds", "GETSTATUS", "CTL IN", "CTL OUT", "max", "MSC enum",
+         "idle wk", "CPU");
+  printf("   %-13s %9s %10s %7s %8s %9s %8s %8s %8s %9s %8s %7s\n", "", "ms", "ms", "",
+         "", "", "us", "us", "us", "ms", "/s", "%");
+  for(i = 0; i < 2; i++)
+  {
+    printf("   %-13s %9.1f %10.1f %7.1f %8u %9u %8.1f %8.1f %8.1f %9.1f %8u %7.2f\n",
+           r[i].Name, r[i].DfuEnum, r[i].DfuDown, r[i].DfuKBs, r[i].DfuRounds, r[i].Status,
+           r[i].Turn[0], r[i].Turn[1], r[i].TurnMax, r[i].MscEnum,
+           (uint32_t)(r[i].IdleRounds * 1e9 / IDLE_TIME), r[i].IdleCpu);
+  }
+
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
@@ -0,0 +1,239 @@
+/**
+  ******************************************************************************
+  * @file    usb_readahead_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Read-ahead and write coalescing of usbh_msc_fatfs.c on the OTG
+  *          core model and the stick model on a FAT image.
+  *          - cold read curve: a file is read from its start in 512 byte
+  *            and 1 KB f_read calls (BMP and firmware files) for read-ahead
+  *            windows 1 (off), 2, 4 .. USBH_MSC_READ_AHEAD sectors, with
+  *            the stick's default flash time and with a slow stick;
+  *          - 512 byte f_write calls with USBH_MSC_WRITE_MERGE: WRITE10
+  *            commands against sectors written.
+  *          Usage: usb_readahead_bench [-v]   (-v: library debug output)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+#include "usbh_msc_cache.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_readahead.img"
+#define IMG_SIZE         (32u * 1024 * 1024)
+#define FILE_SIZE        (256u * 1024)
+#define CHUNK            4096
+
+/* flash time of the stick: usb_simdev_msc.c, and a slow one */
+#define STICK_READ       SIM_US(300)
+#define STICK_WRITE      SIM_US(800)
+#define SLOW_READ        SIM_MS(1)
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV DiskImg_Drv;
+extern const DISKIO_DRV USBH_MSC_Disk;
+BOOL diskimg_open(const char *path);
+void diskimg_close(void);
+
+/* Private variables ---------------------------------------------------------*/
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static SIM_DEV *Msc;
+static uint8_t  Buf[CHUNK];
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static void Pattern(uint8_t *p, uint32_t pos, uint32_t n)
+{
+  uint32_t i;
+
+  for(i = 0; i < n; i++)
+  {
+    p[i] = (uint8_t)((pos + i) * 7 + ((pos + i) >> 9));
+  }
+}
+
+/* 在镜像文件上建FAT, 不经过USB */
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(1, &DiskImg_Drv);
+  f_mount(1, &Fs);
+  if(f_mkfs(1, 0, 4096) != FR_OK)
+  {
+    return 0;
+  }
+  f_mount(1, 0);
+  diskimg_close();
+  return 1;
+}
+
+static void Bench_Clear(void)
+{
+  USBH_MSC_Cache_ClearStats();
+  memset(SimDev_MscStats(Msc), 0, sizeof(SIM_MSC_STATS));
+}
+
+/* 512字节一次写入FILE_SIZE, 写合并 */
+static void Bench_Write(void)
+{
+  SIM_MSC_STATS *m = SimDev_MscStats(Msc);
+  MSC_CACHE_STATS_ST *c = USBH_MSC_Cache_GetStats();
+  SIM_TIME t;
+  uint32_t pos;
+  FIL fil;
+  UINT n;
+
+  Bench_Clear();
+  t = USB_HostSim_Now();
+  Check(f_open(&fil, "0:BENCH.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, "f_open write");
+  for(pos = 0; pos < FILE_SIZE; pos += 512)
+  {
+    Pattern(Buf, pos, 512);
+    if((f_write(&fil, Buf, 512, &n) != FR_OK) || (n != 512))
+    {
+      Check(0, "f_write");
+      break;
+    }
+  }
+  Check(f_close(&fil) == FR_OK, "f_close");
+  t = USB_HostSim_Now() - t;
+  printf("\n== %u KB written in 512 B f_write, write merge %d sectors\n", FILE_SIZE >> 10,
+         USBH_MSC_WRITE_MERGE);
+  printf("   %.1f ms, %.1f KB/s: %u WRITE10 for %u sectors, %u sectors merged into another WRITE10\n",
+         Ms(t), FILE_SIZE / 1024.0 / (t / 1e9), m->Write10, (uint32_t)m->SectorWr, c->Merged);
+}
+
+/* 从文件头按size字节读到结尾, 预读缓冲为空 */
+static SIM_TIME Bench_Read(uint8_t window, uint32_t size, uint32_t *cmd)
+{
+  uint8_t ref[CHUNK];
+  SIM_TIME t;
+  uint32_t pos;
+  FIL fil;
+  UINT n;
+
+  USBH_MSC_SetReadAhead(window);
+  Bench_Clear();
+  t = USB_HostSim_Now();
+  Check(f_open(&fil, "0:BENCH.BIN", FA_READ) == FR_OK, "f_open read");
+  for(pos = 0; pos < FILE_SIZE; pos += size)
+  {
+    Pattern(ref, pos, size);
+    if((f_read(&fil, Buf, size, &n) != FR_OK) || (n != size) || memcmp(Buf, ref, size))
+    {
+      Check(0, "f_read");
+      break;
+    }
+  }
+  f_close(&fil);
+  *cmd = SimDev_MscStats(Msc)->Read10;
+  return USB_HostSim_Now() - t;
+}
+
+static void Bench_Curve(SIM_TIME flash, const char *name)
+{
+  static const uint32_t Size[] = { 512, 1024 };
+  SIM_TIME t[2], base[2] = { 0, 0 };
+  uint32_t cmd[2];
+  uint8_t w;
+  int i;
+
+  SimDev_MscTiming(Msc, flash, STICK_WRITE);
+  printf("\n== cold read of %u KB, %s (READ10 to data %.0f us)\n", FILE_SIZE >> 10, name, flash / 1e3);
+  printf("   %-10s %10s %8s %8s %10s %8s %8s\n", "read-ahead", "512 B", "READ10", "", "1 KB",
+         "READ10", "");
+  printf("   %-10s %10s %8s %8s %10s %8s %8s\n", "sectors", "KB/s", "", "speedup", "KB/s", "",
+         "speedup");
+  for(w = 1; w <= USBH_MSC_READ_AHEAD; w <<= 1)
+  {
+    for(i = 0; i < 2; i++)
+    {
+      t[i] = Bench_Read(w, Size[i], &cmd[i]);
+      if(w == 1)
+      {
+        base[i] = t[i];
+      }
+    }
+    printf("   %-10u %10.1f %8u %7.2fx %10.1f %8u %7.2fx\n", w,
+           FILE_SIZE / 1024.0 / (t[0] / 1e9), cmd[0], (double)base[0] / t[0],
+           FILE_SIZE / 1024.0 / (t[1] / 1e9), cmd[1], (double)base[1] / t[1]);
+  }
+  USBH_MSC_SetReadAhead(USBH_MSC_READ_AHEAD);
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  DIR dir;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_MakeImage() || ((Msc = SimDev_MscCreate(IMG_PATH, "SIM0001")) == 0))
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  disk_attach(0, &USBH_MSC_Disk);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  USB_HostSim_Attach(Msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+  Check(f_mount(0, &Fs) == FR_OK, "f_mount");
+#if _USE_DIRIDX
+  Fs.didx = Idx;                                //同usbh_usr.c
+#endif
+  Check(f_opendir(&dir, "0:") == FR_OK, "f_opendir");
+
+  Bench_Write();
+  Bench_Curve(STICK_READ, "stick model");
+  Bench_Curve(SLOW_READ, "slow stick");
+  f_unlink("0:BENCH.BIN");
+
+  f_mount(0, 0);
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_MscDestroy(Msc);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
@@ -0,0 +1,323 @@
+/**
+  ******************************************************************************
+  * @file    usb_seek_bench.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Fast seek of FatFs (_USE_FASTSEEK, cluster link map) on the OTG
+  *          core model and the stick model. The files are written to the
+  *          FAT image directly (4 KB clusters, FAT16: 256 links per FAT
+  *          sector); contiguous files of 256 KB .. 16 MB and a 1 MB file
+  *          whose clusters alternate with another file (256 fragments).
+  *          For each file, SEEK_NUM random f_lseek + 1 byte f_read with the
+  *          FAT chain walk and with the link map: time per seek, FAT and
+  *          data sectors asked by ff.c and READ10 sent per seek, and the
+  *          time to build the link map. get_fat and clmt_clust are static
+  *          in ff.c, the bench counts the links f_lseek walks (from the
+  *          current cluster forward, else from the first one) and the link
+  *          map items it scans, and charges LINK_CYCLES and ITEM_CYCLES of
+  *          the 120 MHz core for them in virtual time.
+  *          Usage: usb_seek_bench [-v]   (-v: library debug output)
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "usb_hostsim.h"
+#include "usb_simdev.h"
+#include "ff.h"
+#include "diskio.h"
+#include "usbh_msc_fatfs.h"
+#include "usbh_msc_cache.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IMG_PATH         "build/usb_seek.img"
+#define IMG_SIZE         (64u * 1024 * 1024)
+#define CLUSTER          4096
+#define FRAG_SIZE        (1024u * 1024)
+#define SEEK_NUM         200
+#define LINKMAP_SIZE     1024                   //DWORD, 511个碎片
+#define CPU_MHZ          120
+#define LINK_CYCLES      40                     //get_fat, FAT扇区已在窗口中(估计)
+#define ITEM_CYCLES      8                      //clmt_clust的一个碎片(估计)
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  SIM_TIME    Time;                             //每次seek
+  double      Links;                            //CPU走过的簇链或映射项
+  double      Disk;                             //ff.c的disk_read
+  double      Read10;
+  SIM_TIME    Map;                              //建立链表映射
+  uint32_t    Items;
+}
+BENCH_SEEK;
+
+/* Exported variables --------------------------------------------------------*/
+extern const DISKIO_DRV DiskImg_Drv;
+extern const DISKIO_DRV USBH_MSC_Disk;
+BOOL diskimg_open(const char *path);
+void diskimg_close(void);
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t FileKB[] = { 256, 1024, 4096, 16384 };
+static FATFS    Fs;
+#if _USE_DIRIDX
+static DIRIDX   Idx[_USE_DIRIDX];
+#endif
+static SIM_DEV *Msc;
+static uint8_t  Buf[CLUSTER];
+static DWORD    LinkMap[LINKMAP_SIZE];
+static int      Failed;
+
+/* Private functions ---------------------------------------------------------*/
+static double Us(SIM_TIME t)
+{
+  return t / 1e3;
+}
+
+static double Ms(SIM_TIME t)
+{
+  return t / 1e6;
+}
+
+static void Check(int ok, const char *what)
+{
+  if(!ok)
+  {
+    printf("   FAILED: %s\n", what);
+    Failed = 1;
+  }
+}
+
+static void Cpu(uint32_t n, uint32_t cycles)
+{
+  USB_HostSim_Cpu((SIM_TIME)n * cycles * 1000 / CPU_MHZ);
+}
+
+/* clmt_clust: 找到簇cl所在的碎片要看的映射项数 */
+static uint32_t Map_Items(uint32_t cl)
+{
+  DWORD *tbl = LinkMap + 1;
+  uint32_t n = 1;
+
+  while(tbl[0] && (cl >= tbl[0]))
+  {
+    cl -= tbl[0];
+    tbl += 2;
+    n++;
+  }
+  return n;
+}
+
+static uint8_t Pattern(uint32_t pos)
+{
+  return (uint8_t)(pos * 7 + (pos >> 9));
+}
+
+static void Fill(uint32_t pos)
+{
+  uint32_t i;
+
+  for(i = 0; i < CLUSTER; i++)
+  {
+    Buf[i] = Pattern(pos + i);
+  }
+}
+
+static int Bench_Append(FIL *fil, uint32_t pos)
+{
+  UINT bw;
+
+  Fill(pos);
+  return (f_write(fil, Buf, CLUSTER, &bw) == FR_OK) && (bw == CLUSTER);
+}
+
+/* 在镜像文件上建FAT和测试文件, 不经过USB */
+static int Bench_MakeImage(void)
+{
+  FILE *f = fopen(IMG_PATH, "wb");
+  FIL fil, other;
+  char name[16];
+  uint32_t i, pos;
+  int ok = 1;
+
+  if((f == 0) || ftruncate(fileno(f), IMG_SIZE))
+  {
+    return 0;
+  }
+  fclose(f);
+  if(!diskimg_open(IMG_PATH))
+  {
+    return 0;
+  }
+  disk_attach(1, &DiskImg_Drv);
+  f_mount(1, &Fs);
+  if(f_mkfs(1, 0, CLUSTER) != FR_OK)
+  {
+    return 0;
+  }
+  for(i = 0; ok && (i < sizeof(FileKB) / sizeof(FileKB[0])); i++)
+  {
+    snprintf(name, sizeof(name), "1:S%u.BIN", FileKB[i]);
+    ok = (f_open(&fil, name, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    for(pos = 0; ok && (pos < FileKB[i] * 1024); pos += CLUSTER)
+    {
+      ok = Bench_Append(&fil, pos);
+    }
+    ok = (f_close(&fil) == FR_OK) && ok;
+  }
+  /* FRAG.BIN与FILL.BIN的簇交替 */
+  if(ok && (f_open(&fil, "1:FRAG.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)
+     && (f_open(&other, "1:FILL.BIN", FA_CREATE_ALWAYS | FA_WRITE) == FR_OK))
+  {
+    for(pos = 0; ok && (pos < FRAG_SIZE); pos += CLUSTER)
+    {
+      ok = Bench_Append(&fil, pos) && (f_sync(&fil) == FR_OK)
+           && Bench_Append(&other, pos) && (f_sync(&other) == FR_OK);
+    }
+    ok = (f_close(&fil) == FR_OK) && (f_close(&other) == FR_OK) && ok;
+  }
+  else
+  {
+    ok = 0;
+  }
+  f_mount(1, 0);
+  diskimg_close();
+  return ok;
+}
+
+/* SEEK_NUM次随机定位并读1字节, fast: 先建立链表映射 */
+static void Bench_Seek(const char *path, uint32_t size, int fast, BENCH_SEEK *r)
+{
+  SIM_MSC_STATS *m = SimDev_MscStats(Msc);
+  MSC_CACHE_STATS_ST *c = USBH_MSC_Cache_GetStats();
+  uint32_t i, ofs = 12345, pos, cl, cur = 0, n;
+  uint64_t links = 0;
+  SIM_TIME t;
+  FIL fil;
+  UINT br;
+  uint8_t b;
+
+  memset(r, 0, sizeof(*r));
+  if(f_open(&fil, path, FA_READ) != FR_OK)
+  {
+    Check(0, "f_open");
+    return;
+  }
+  if(fast)
+  {
+    fil.cltbl = LinkMap;
+    LinkMap[0] = LINKMAP_SIZE;
+    t = USB_HostSim_Now();
+    if(f_lseek(&fil, CREATE_LINKMAP) != FR_OK)
+    {
+      Check(0, "link map");
+      f_close(&fil);
+      return;
+    }
+    Cpu(size / CLUSTER, LINK_CYCLES);
+    r->Map = USB_HostSim_Now() - t;
+    r->Items = LinkMap[0];
+  }
+
+  USBH_MSC_Cache_ClearStats();
+  memset(m, 0, sizeof(*m));
+  t = USB_HostSim_Now();
+  for(i = 0; i < SEEK_NUM; i++)
+  {
+    ofs = ofs * 1103515245 + 12345;
+    pos = (ofs >> 8) % size;
+    /* f_lseek找pos - 1字节所在的簇, 读完1字节后文件指针为pos + 1 */
+    cl = pos ? (pos - 1) / CLUSTER : 0;
+    if(fast)
+    {
+      n = pos ? Map_Items(cl) : 0;
+      Cpu(n, ITEM_CYCLES);
+    }
+    else
+    {
+      n = (cur && (cl >= (cur - 1) / CLUSTER)) ? cl - (cur - 1) / CLUSTER : cl;
+      Cpu(n, LINK_CYCLES);
+    }
+    links += n;
+    cur = pos + 1;
+    if((f_lseek(&fil, pos) != FR_OK) || (f_read(&fil, &b, 1, &br) != FR_OK) || (br != 1)
+       || (b != Pattern(pos)))
+    {
+      Check(0, "seek and read");
+      break;
+    }
+  }
+  r->Time = (USB_HostSim_Now() - t) / SEEK_NUM;
+  r->Links = (double)links / SEEK_NUM;
+  r->Disk = (double)c->Read / SEEK_NUM;
+  r->Read10 = (double)m->Read10 / SEEK_NUM;
+  f_close(&fil);
+}
+
+static void Bench_File(const char *path, uint32_t size, const char *name)
+{
+  BENCH_SEEK r[2];
+
+  Bench_Seek(path, size, 0, &r[0]);
+  Bench_Seek(path, size, 1, &r[1]);
+  printf("   %-18s %8.0f %6.0f %5.1f %6.1f %8.0f %6.1f %5.1f %6.1f %7.1fx %5u %8.1f\n", name,
+         Us(r[0].Time), r[0].Links, r[0].Disk, r[0].Read10, Us(r[1].Time), r[1].Links, r[1].Disk, r[1].Read10,
+         r[1].Time ? (double)r[0].Time / r[1].Time : 0.0, (r[1].Items - 2) / 2, Ms(r[1].Map));
+}
+
+/* Exported functions --------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+  char path[16], name[24];
+  uint32_t i;
+  DIR dir;
+
+  USB_HostSim_Verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+  setvbuf(stdout, 0, _IOLBF, 0);
+
+  if(!Bench_MakeImage() || ((Msc = SimDev_MscCreate(IMG_PATH, "SIM0001")) == 0))
+  {
+    printf("FAILED: image %s\n", IMG_PATH);
+    return 1;
+  }
+  disk_attach(0, &USBH_MSC_Disk);
+
+  USB_HostSim_Reset();
+  USB_HostSim_SetLimit(SIM_MS(600000));
+  USB_HostSim_TaskInit(SIM_TASK_EVENT);
+  USB_HostSim_TaskRun(SIM_MS(10));
+  USB_HostSim_Attach(Msc);
+  Check(USB_HostSim_TaskUntil(&USB_HostSim_MscReady, SIM_MS(3000)), "enumeration");
+  Check(f_mount(0, &Fs) == FR_OK, "f_mount");
+#if _USE_DIRIDX
+  Fs.didx = Idx;                                //同usbh_usr.c
+#endif
+  Check(f_opendir(&dir, "0:") == FR_OK, "f_opendir");
+
+  printf("== %d random f_lseek + 1 byte f_read, %u MB stick image, cluster %u bytes, MSC cache %d sectors\n",
+         SEEK_NUM, IMG_SIZE >> 20, CLUSTER, USBH_MSC_CACHE_NUM);
+  printf("   CPU: %d cycles per cluster link, %d per link map item, %d MHz\n", LINK_CYCLES, ITEM_CYCLES,
+         CPU_MHZ);
+  printf("   %-18s %28s %28s %8s %14s\n", "", "FAT chain walk", "link map", "", "link map");
+  printf("   %-18s %8s %6s %5s %6s %8s %6s %5s %6s %8s %5s %8s\n", "file", "us/seek", "links", "disk",
+         "READ10", "us/seek", "items", "disk", "READ10", "speedup", "frag", "build ms");
+  for(i = 0; i < sizeof(FileKB) / sizeof(FileKB[0]); i++)
+  {
+    snprintf(path, sizeof(path), "0:S%u.BIN", FileKB[i]);
+    snprintf(name, sizeof(name), "%u KB", FileKB[i]);
+    Bench_File(path, FileKB[i] * 1024, name);
+  }
+  Bench_File("0:FRAG.BIN", FRAG_SIZE, "1024 KB, fragmented");
+
+  f_mount(0, 0);
+  USB_HostSim_Detach();
+  USB_HostSim_TaskRun(SIM_MS(50));
+  SimDev_MscDestroy(Msc);
+  printf("\n%s, virtual time %.3f s\n", Failed ? "FAILED" : "OK", USB_HostSim_Now() / 1e9);
+  return Failed;
+}
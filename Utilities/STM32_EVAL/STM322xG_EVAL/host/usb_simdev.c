@@ -0,0 +1,436 @@
+/**
+  ******************************************************************************
+  * @file    usb_simdev.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Part of the device models common to all devices: address, control
+  *          pipe with the standard requests, endpoint halt and data toggles.
+  *          The bus of usb_hostsim.c gives it one token at a time; the class
+  *          requests and the other endpoints go to the SIM_DEV_OPS of the
+  *          model. As on a real device a data packet with the wrong toggle
+  *          is acknowledged and dropped, the SET_ADDRESS takes effect after
+  *          its status stage and a STALL lasts until the next SETUP (EP0) or
+  *          CLEAR_FEATURE(ENDPOINT_HALT).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+enum
+{
+  CTL_IDLE = 0,
+  CTL_DATA_IN,
+  CTL_DATA_OUT,
+  CTL_STATUS_IN,          //主机IN零长度包
+  CTL_STATUS_OUT,         //主机OUT零长度包
+  CTL_STALL,
+};
+
+#define REQ_TYPE_MASK           0x60
+#define REQ_TYPE_STANDARD       0x00
+#define REQ_RECIPIENT_MASK      0x1F
+#define REQ_RECIPIENT_EP        0x02
+
+#define SETUP_LEN(s)            ((uint16_t)((s)[6] | ((s)[7] << 8)))
+#define SETUP_VALUE(s)          ((uint16_t)((s)[2] | ((s)[3] << 8)))
+#define SETUP_INDEX(s)          ((uint16_t)((s)[4] | ((s)[5] << 8)))
+
+/* Private functions ---------------------------------------------------------*/
+/* 字符串描述符, index 0为语言ID */
+static SIM_HS SimDev_String(SIM_DEV *dev, uint8_t index, uint8_t *data, uint16_t *len)
+{
+  const char *s;
+  uint16_t n;
+
+  if(index == 0)
+  {
+    data[0] = 4;
+    data[1] = 3;
+    data[2] = 0x09;
+    data[3] = 0x04;
+    *len = 4;
+    return SIM_ACK;
+  }
+  if((index > dev->StrNum) || (dev->Str[index - 1] == 0))
+  {
+    return SIM_STALL;
+  }
+  s = dev->Str[index - 1];
+  for(n = 0; s[n] && (n < 126); n++)
+  {
+    data[2 + n * 2] = s[n];
+    data[3 + n * 2] = 0;
+  }
+  data[0] = 2 + n * 2;
+  data[1] = 3;
+  *len = data[0];
+  return SIM_ACK;
+}
+
+/* 标准请求, IN的数据放在data, 长度为*len */
+static SIM_HS SimDev_Standard(SIM_DEV *dev, const uint8_t *setup, uint8_t *data, uint16_t *len)
+{
+  uint8_t ep = SETUP_INDEX(setup) & 0x0F;
+  uint8_t dir = (SETUP_INDEX(setup) & 0x80) ? 1 : 0;
+  uint8_t ep_req = (setup[0] & REQ_RECIPIENT_MASK) == REQ_RECIPIENT_EP;
+
+  *len = 0;
+  if(ep_req && (ep >= SIM_EP_NUM))
+  {
+    return SIM_STALL;
+  }
+  switch(setup[1])
+  {
+  case 0x00:              //GET_STATUS
+    data[0] = ep_req ? dev->Halted[dir][ep] : 0;
+    data[1] = 0;
+    *len = 2;
+    return SIM_ACK;
+
+  case 0x01:              //CLEAR_FEATURE
+  case 0x03:              //SET_FEATURE
+    if(ep_req && (SETUP_VALUE(setup) == 0))
+    {
+      dev->Halted[dir][ep] = (setup[1] == 0x03);
+      dev->Toggle[dir][ep] = 0;
+    }
+    return SIM_ACK;
+
+  case 0x05:              //SET_ADDRESS
+    dev->NewAddr = SETUP_VALUE(setup) & 0x7F;
+    return SIM_ACK;
+
+  case 0x06:              //GET_DESCRIPTOR
+    switch(setup[3])
+    {
+    case 1:
+      memcpy(data, dev->DevDesc, 18);
+      *len = 18;
+      return SIM_ACK;
+    case 2:
+      *len = dev->CfgDesc[2] | (dev->CfgDesc[3] << 8);
+      memcpy(data, dev->CfgDesc, *len);
+      return SIM_ACK;
+    case 3:
+      return SimDev_String(dev, setup[2], data, len);
+    default:
+      return SIM_STALL;
+    }
+
+  case 0x08:              //GET_CONFIGURATION
+    data[0] = dev->Config;
+    *len = 1;
+    return SIM_ACK;
+
+  case 0x09:              //SET_CONFIGURATION
+    dev->Config = SETUP_VALUE(setup) & 0xFF;
+    memset(&dev->Halted[0][1], 0, SIM_EP_NUM - 1);
+    memset(&dev->Halted[1][1], 0, SIM_EP_NUM - 1);
+    memset(&dev->Toggle[0][1], 0, SIM_EP_NUM - 1);
+    memset(&dev->Toggle[1][1], 0, SIM_EP_NUM - 1);
+    return SIM_ACK;
+
+  case 0x0A:              //GET_INTERFACE
+    data[0] = 0;
+    *len = 1;
+    return SIM_ACK;
+
+  case 0x0B:              //SET_INTERFACE
+    return SIM_ACK;
+
+  default:
+    return SIM_STALL;
+  }
+}
+
+/* 无数据阶段或OUT数据收齐后执行请求 */
+static void SimDev_CtlOut(SIM_DEV *dev)
+{
+  uint16_t len = dev->CtlLen;
+  SIM_HS hs;
+
+  if((dev->Setup[0] & REQ_TYPE_MASK) == REQ_TYPE_STANDARD)
+  {
+    hs = (len == 0) ? SimDev_Standard(dev, dev->Setup, dev->Ctl, &len) : SIM_STALL;
+  }
+  else
+  {
+    hs = dev->Ops->Request ? dev->Ops->Request(dev, dev->Setup, dev->Ctl, &len) : SIM_STALL;
+  }
+  dev->CtlStage = (hs == SIM_ACK) ? CTL_STATUS_IN : CTL_STALL;
+}
+
+/**
+  * @brief  SimDev_Reset
+  *         USB reset of the device: default address, not configured
+  * @param  dev: device
+  * @retval None
+  */
+void SimDev_Reset(SIM_DEV *dev)
+{
+  dev->Addr     = 0;
+  dev->NewAddr  = 0;
+  dev->Config   = 0;
+  dev->CtlStage = CTL_IDLE;
+  dev->NakUntil = 0;
+  memset(dev->Halted, 0, sizeof(dev->Halted));
+  memset(dev->Toggle, 0, sizeof(dev->Toggle));
+  if(dev->Ops->Reset)
+  {
+    dev->Ops->Reset(dev);
+  }
+}
+
+/**
+  * @brief  SimDev_Setup
+  *         SETUP packet on EP0, always acknowledged; aborts the control
+  *         transfer in progress. IN data is produced here.
+  * @param  dev: device
+  * @param  setup: the 8 bytes
+  * @retval SIM_ACK
+  */
+SIM_HS SimDev_Setup(SIM_DEV *dev, const uint8_t *setup)
+{
+  uint16_t wLength = SETUP_LEN(setup);
+  uint16_t len;
+  SIM_HS hs;
+
+  memcpy(dev->Setup, setup, 8);
+  dev->Halted[0][0] = 0;
+  dev->Halted[1][0] = 0;
+  dev->Toggle[0][0] = 1;
+  dev->Toggle[1][0] = 1;
+  dev->CtlPos = 0;
+  dev->CtlLen = 0;
+
+  if(setup[0] & 0x80)
+  {
+    len = (wLength < SIM_CTL_BUF_SIZE) ? wLength : SIM_CTL_BUF_SIZE;
+    if((setup[0] & REQ_TYPE_MASK) == REQ_TYPE_STANDARD)
+    {
+      hs = SimDev_Standard(dev, setup, dev->Ctl, &len);
+    }
+    else
+    {
+      hs = dev->Ops->Request ? dev->Ops->Request(dev, setup, dev->Ctl, &len) : SIM_STALL;
+    }
+    dev->CtlLen = (len < wLength) ? len : wLength;
+    dev->CtlStage = (hs != SIM_ACK) ? CTL_STALL : (wLength ? CTL_DATA_IN : CTL_STATUS_OUT);
+  }
+  else if(wLength > SIM_CTL_BUF_SIZE)
+  {
+    dev->CtlStage = CTL_STALL;
+  }
+  else if(wLength)
+  {
+    dev->CtlLen = wLength;
+    dev->CtlStage = CTL_DATA_OUT;
+  }
+  else
+  {
+    SimDev_CtlOut(dev);
+  }
+  return SIM_ACK;
+}
+
+/**
+  * @brief  SimDev_In
+  *         IN token
+  * @param  dev: device
+  * @param  ep: endpoint number
+  * @param  data: packet
+  * @param  len: in max packet size, out bytes of the packet
+  * @param  pid: out, DATA0/1 of the packet (0/1)
+  * @retval SIM_ACK (data), SIM_NAK or SIM_STALL
+  */
+SIM_HS SimDev_In(SIM_DEV *dev, uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *pid)
+{
+  uint16_t mps = *len;
+  uint16_t n;
+  SIM_HS hs;
+
+  *len = 0;
+  if(ep == 0)
+  {
+    switch(dev->CtlStage)
+    {
+    case CTL_DATA_IN:
+      n = dev->CtlLen - dev->CtlPos;
+      if(n > mps)
+      {
+        n = mps;
+      }
+      memcpy(data, dev->Ctl + dev->CtlPos, n);
+      *len = n;
+      *pid = dev->Toggle[1][0];
+      dev->Toggle[1][0] ^= 1;
+      dev->CtlPos += n;
+      /* 短包或已到wLength时结束, 否则下一次给零长度包 */
+      if((dev->CtlPos == dev->CtlLen) && ((n < mps) || (dev->CtlLen == SETUP_LEN(dev->Setup))))
+      {
+        dev->CtlStage = CTL_STATUS_OUT;
+      }
+      return SIM_ACK;
+
+    case CTL_STATUS_IN:
+      *pid = 1;
+      dev->CtlStage = CTL_IDLE;
+      if(dev->Setup[1] == 0x05 && ((dev->Setup[0] & REQ_TYPE_MASK) == REQ_TYPE_STANDARD))
+      {
+        dev->Addr = dev->NewAddr;
+      }
+      return SIM_ACK;
+
+    default:
+      return SIM_STALL;
+    }
+  }
+
+  if((ep >= SIM_EP_NUM) || dev->Halted[1][ep])
+  {
+    return SIM_STALL;
+  }
+  if(USB_HostSim_Now() < dev->NakUntil)
+  {
+    return SIM_NAK;
+  }
+  if(dev->Ops->In == 0)
+  {
+    return SIM_STALL;
+  }
+  *len = mps;
+  hs = dev->Ops->In(dev, ep, data, len);
+  if(hs == SIM_ACK)
+  {
+    *pid = dev->Toggle[1][ep];
+    dev->Toggle[1][ep] ^= 1;
+  }
+  else
+  {
+    *len = 0;
+  }
+  return hs;
+}
+
+/**
+  * @brief  SimDev_Out
+  *         OUT token with its data packet
+  * @param  dev: device
+  * @param  ep: endpoint number
+  * @param  data: packet
+  * @param  len: bytes of the packet
+  * @param  pid: DATA0/1 of the packet (0/1)
+  * @retval SIM_ACK, SIM_NAK or SIM_STALL
+  */
+SIM_HS SimDev_Out(SIM_DEV *dev, uint8_t ep, const uint8_t *data, uint16_t len, uint8_t pid)
+{
+  SIM_HS hs;
+
+  if(ep == 0)
+  {
+    switch(dev->CtlStage)
+    {
+    case CTL_DATA_OUT:
+      if(pid != dev->Toggle[0][0])
+      {
+        dev->ToggleErr++;             //重发的包, 应答后丢弃
+        return SIM_ACK;
+      }
+      if(dev->CtlPos + len > dev->CtlLen)
+      {
+        dev->CtlStage = CTL_STALL;
+        return SIM_STALL;
+      }
+      memcpy(dev->Ctl + dev->CtlPos, data, len);
+      dev->CtlPos += len;
+      dev->Toggle[0][0] ^= 1;
+      if(dev->CtlPos == dev->CtlLen)
+      {
+        SimDev_CtlOut(dev);
+      }
+      return SIM_ACK;
+
+    case CTL_STATUS_OUT:
+      dev->CtlStage = CTL_IDLE;
+      return SIM_ACK;
+
+    default:
+      return SIM_STALL;
+    }
+  }
+
+  if((ep >= SIM_EP_NUM) || dev->Halted[0][ep])
+  {
+    return SIM_STALL;
+  }
+  if(USB_HostSim_Now() < dev->NakUntil)
+  {
+    return SIM_NAK;
+  }
+  if(pid != dev->Toggle[0][ep])
+  {
+    dev->ToggleErr++;
+    return SIM_ACK;
+  }
+  if(dev->Ops->Out == 0)
+  {
+    return SIM_STALL;
+  }
+  hs = dev->Ops->Out(dev, ep, data, len);
+  if(hs == SIM_ACK)
+  {
+    dev->Toggle[0][ep] ^= 1;
+  }
+  return hs;
+}
+
+/**
+  * @brief  SimDev_Halt
+  *         STALL injected on an endpoint: EP0 refuses the control transfer
+  *         in progress, the others stay halted until CLEAR_FEATURE
+  * @param  dev: device
+  * @param  ep: endpoint address (bit 7: IN)
+  * @retval None
+  */
+void SimDev_Halt(SIM_DEV *dev, uint8_t ep)
+{
+  uint8_t n = ep & 0x0F;
+
+  if(n == 0)
+  {
+    dev->CtlStage = CTL_STALL;
+    return;
+  }
+  if(n < SIM_EP_NUM)
+  {
+    dev->Halted[(ep & 0x80) ? 1 : 0][n] = 1;
+    if(dev->Ops->Halt)
+    {
+      dev->Ops->Halt(dev, ep);
+    }
+  }
+}
+
+/**
+  * @brief  SimDev_Route
+  *         Device answering to addr: dev itself or one behind it (hub)
+  * @param  dev: device on the port
+  * @param  addr: address of the token
+  * @retval device, 0 if none
+  */
+SIM_DEV *SimDev_Route(SIM_DEV *dev, uint8_t addr)
+{
+  if(dev == 0)
+  {
+    return 0;
+  }
+  if(dev->Addr == addr)
+  {
+    return dev;
+  }
+  return dev->Ops->Route ? dev->Ops->Route(dev, addr) : 0;
+}
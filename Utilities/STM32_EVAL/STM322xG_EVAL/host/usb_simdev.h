@@ -0,0 +1,141 @@
+/**
+  ******************************************************************************
+  * @file    usb_simdev.h
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Device models on the bus of usb_hostsim.c. usb_simdev.c is the
+  *          part common to all devices: address, control pipe, standard
+  *          requests, endpoint halt and data toggles. A model gives its
+  *          descriptors and SIM_DEV_OPS for the class requests and the other
+  *          endpoints: a mass storage stick on an image file
+  *          (usb_simdev_msc.c), an MK5-like DFU target (usb_simdev_dfu.c)
+  *          and a full speed hub with devices on its ports (usb_simdev_hub.c).
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USB_SIMDEV_H
+#define __USB_SIMDEV_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usb_hostsim.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_EP_NUM              4           //端点号0..3
+#define SIM_CTL_BUF_SIZE        (0x1000 + 64)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  /* bus reset */
+  void     (*Reset)(SIM_DEV *dev);
+  /* class or vendor request. IN: the data (at most wLength) into data, *len.
+     OUT: data stage in data, length *len, called once all of it is
+     received, or at the SETUP when wLength is 0. SIM_STALL refuses the request. */
+  SIM_HS   (*Request)(SIM_DEV *dev, const uint8_t *setup, uint8_t *data, uint16_t *len);
+  /* one packet on endpoint ep (1..), *len: max packet in, bytes out */
+  SIM_HS   (*In)(SIM_DEV *dev, uint8_t ep, uint8_t *data, uint16_t *len);
+  SIM_HS   (*Out)(SIM_DEV *dev, uint8_t ep, const uint8_t *data, uint16_t len);
+  /* the endpoint (with direction bit) was halted by an injected STALL */
+  void     (*Halt)(SIM_DEV *dev, uint8_t ep);
+  /* hub: downstream device that has address addr, 0 if none */
+  SIM_DEV *(*Route)(SIM_DEV *dev, uint8_t addr);
+}
+SIM_DEV_OPS;
+
+struct _SIM_DEV
+{
+  const char          *Name;
+  const SIM_DEV_OPS   *Ops;
+  void                *Priv;                    //模型自己的数据
+  const uint8_t       *DevDesc;                 //18字节
+  const uint8_t       *CfgDesc;                 //按wTotalLength
+  const char * const  *Str;                     //字符串描述符1..StrNum
+  uint8_t              StrNum;
+
+  /* usb_simdev.c */
+  uint8_t              Addr;
+  uint8_t              NewAddr;                 //SET_ADDRESS在状态阶段后生效
+  uint8_t              Config;
+  uint8_t              Halted[2][SIM_EP_NUM];   //[0]:OUT [1]:IN
+  uint8_t              Toggle[2][SIM_EP_NUM];   //下一个数据包的DATA0/1
+  uint8_t              Setup[8];
+  uint8_t              CtlStage;
+  SIM_HS               CtlResult;               //状态阶段的应答
+  uint16_t             CtlLen;
+  uint16_t             CtlPos;
+  uint8_t              Ctl[SIM_CTL_BUF_SIZE];
+  SIM_TIME             NakUntil;                //设备忙,此前的数据令牌都NAK
+  uint32_t             ToggleErr;               //丢弃的重复包
+};
+
+/* Exported functions ------------------------------------------------------- */
+/* usb_simdev.c, called by the bus of usb_hostsim.c */
+void     SimDev_Reset(SIM_DEV *dev);
+SIM_HS   SimDev_Setup(SIM_DEV *dev, const uint8_t *setup);
+SIM_HS   SimDev_In(SIM_DEV *dev, uint8_t ep, uint8_t *data, uint16_t *len, uint8_t *pid);
+SIM_HS   SimDev_Out(SIM_DEV *dev, uint8_t ep, const uint8_t *data, uint16_t len, uint8_t pid);
+void     SimDev_Halt(SIM_DEV *dev, uint8_t ep);
+SIM_DEV *SimDev_Route(SIM_DEV *dev, uint8_t addr);
+
+/* usb_simdev_msc.c */
+typedef struct
+{
+  uint32_t  Cmd;          //CBW数
+  uint32_t  Read10;
+  uint32_t  Write10;
+  uint32_t  Failed;       //CSW状态不为0
+  uint64_t  SectorRd;
+  uint64_t  SectorWr;
+  SIM_TIME  CmdSum;       //CBW到CSW: 命令在总线和设备上的时间
+  SIM_TIME  GapSum;       //CSW到下一个CBW: 主机的时间
+  uint32_t  Gap;
+}
+SIM_MSC_STATS;
+
+SIM_DEV  *SimDev_MscCreate(const char *image, const char *serial);
+void      SimDev_MscDestroy(SIM_DEV *dev);
+SIM_MSC_STATS *SimDev_MscStats(SIM_DEV *dev);
+void      SimDev_MscTiming(SIM_DEV *dev, SIM_TIME read, SIM_TIME write);
+void      SimDev_MscWriteProtect(SIM_DEV *dev, uint8_t on);
+
+/* usb_simdev_dfu.c */
+typedef struct
+{
+  uint32_t  Block;        //DNLOAD块数
+  uint64_t  Bytes;
+  uint32_t  Upload;       //UPLOAD块数
+  uint32_t  Status;       //GETSTATUS数
+  uint32_t  Errors;       //进入dfuERROR的次数
+  SIM_TIME  First;        //第一个DNLOAD的SETUP
+  SIM_TIME  Manifest;     //Manifest完成
+  SIM_TIME  DataSum;      //DNLOAD的SETUP到数据收齐
+  SIM_TIME  ProgSum;      //设备编程(bwPollTimeout)
+  SIM_TIME  LateSum;      //编程结束到主机的下一个请求
+}
+SIM_DFU_STATS;
+
+SIM_DEV  *SimDev_DfuCreate(uint32_t flash, uint16_t xfer, uint8_t tolerant, const char *serial);
+void      SimDev_DfuDestroy(SIM_DEV *dev);
+SIM_DFU_STATS *SimDev_DfuStats(SIM_DEV *dev);
+uint8_t  *SimDev_DfuFlash(SIM_DEV *dev, uint32_t *size);
+void      SimDev_DfuTiming(SIM_DEV *dev, SIM_TIME base, SIM_TIME per_kb, SIM_TIME manifest);
+void      SimDev_DfuNoUpload(SIM_DEV *dev, uint8_t on);
+
+/* usb_simdev_hub.c */
+typedef struct
+{
+  uint32_t  Request;      //端口请求数
+  uint32_t  Reset;        //端口复位数
+  uint32_t  Collision;    //多个设备应答同一地址的令牌
+}
+SIM_HUB_STATS;
+
+SIM_DEV  *SimDev_HubCreate(uint8_t ports);
+void      SimDev_HubDestroy(SIM_DEV *dev);
+SIM_HUB_STATS *SimDev_HubStats(SIM_DEV *dev);
+void      SimDev_HubAttach(SIM_DEV *dev, uint8_t port, SIM_DEV *child);
+void      SimDev_HubDetach(SIM_DEV *dev, uint8_t port);
+
+#endif /* __USB_SIMDEV_H */
@@ -0,0 +1,430 @@
+/**
+  ******************************************************************************
+  * @file    usb_simdev_dfu.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   DFU target model after the MK5: interface FE/01/01 with its DFU
+  *          functional descriptor, starts in dfuIDLE. A DNLOAD block is
+  *          stored at wBlockNum * wTransferSize; the GETSTATUS that follows
+  *          starts the programming (dfuDNBUSY) and gives its time as
+  *          bwPollTimeout, any request before it has passed is stalled and
+  *          the device goes to dfuERROR as a real one does. The zero length
+  *          DNLOAD manifests; a manifestation tolerant device goes back to
+  *          dfuIDLE, the others wait for a reset. UPLOAD reads the flash
+  *          sequentially from 0 up to the end of the written image, or is
+  *          stalled (SimDev_DfuNoUpload) although bitCanUpload is set.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+enum
+{
+  DFU_IDLE          = 2,
+  DFU_DN_SYNC       = 3,
+  DFU_DN_BUSY       = 4,
+  DFU_DN_IDLE       = 5,
+  DFU_MANIFEST_SYNC = 6,
+  DFU_MANIFEST      = 7,
+  DFU_WAIT_RESET    = 8,
+  DFU_UP_IDLE       = 9,
+  DFU_ERROR         = 10,
+};
+
+#define DFU_ERR_WRITE           0x03
+#define DFU_ERR_ADDRESS         0x08
+#define DFU_ERR_NOTDONE         0x09
+#define DFU_ERR_STALLEDPKT      0x0F
+
+#define DFU_ATTR_DNLOAD         0x01
+#define DFU_ATTR_UPLOAD         0x02
+#define DFU_ATTR_TOLERANT       0x04
+
+#define DFU_BCD_DEVICE          0x0100
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  SIM_DEV       Dev;
+  uint8_t       State;
+  uint8_t       Status;         //bStatus
+  uint8_t       Tolerant;
+  uint8_t       NoUpload;       //UPLOAD被STALL(声明了bitCanUpload)
+  uint8_t      *Flash;
+  uint32_t      FlashSize;
+  uint32_t      Size;           //已写入镜像的末尾
+  uint32_t      UpPos;
+  uint16_t      Xfer;           //wTransferSize
+  uint16_t      Pending;        //DN_SYNC: 等待编程的块长度
+  SIM_TIME      BusyUntil;
+  SIM_TIME      Base;
+  SIM_TIME      PerKb;
+  SIM_TIME      ManifestTime;
+  SIM_TIME      LastStatus;     //上一个GETSTATUS
+  uint8_t       DevDesc[18];
+  uint8_t       CfgDesc[27];
+  char          Serial[32];
+  const char   *Str[3];
+  SIM_DFU_STATS Stats;
+}
+SIM_DFU;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t DfuDevDesc[18] =
+{
+  18, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 64,
+  0x83, 0x04, 0x11, 0xDF,       //0483:DF11
+  DFU_BCD_DEVICE & 0xFF, DFU_BCD_DEVICE >> 8, 1, 2, 3, 1
+};
+
+static const uint8_t DfuCfgDesc[27] =
+{
+  9, 0x02, 27, 0, 1, 1, 0, 0x80, 50,
+  9, 0x04, 0, 0, 0, 0xFE, 0x01, 0x01, 0,
+  9, 0x21, 0, 0xFF, 0x00, 0x00, 0x10, 0x10, 0x01      //bmAttributes, wDetachTimeOut, wTransferSize, bcdDFU
+};
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Dfu_Ms(SIM_TIME t)
+{
+  return (uint32_t)((t + SIM_MS(1) - 1) / SIM_MS(1));
+}
+
+static SIM_HS Dfu_Error(SIM_DFU *d, uint8_t status)
+{
+  d->State = DFU_ERROR;
+  d->Status = status;
+  d->Stats.Errors++;
+  return SIM_STALL;
+}
+
+/* 编程或Manifest期间时间到了之后的状态 */
+static void Dfu_Update(SIM_DFU *d, SIM_TIME now)
+{
+  if(now < d->BusyUntil)
+  {
+    return;
+  }
+  if(d->State == DFU_DN_BUSY)
+  {
+    d->State = DFU_DN_SYNC;
+  }
+  else if(d->State == DFU_MANIFEST)
+  {
+    d->Stats.Manifest = d->BusyUntil;
+    d->State = d->Tolerant ? DFU_MANIFEST_SYNC : DFU_WAIT_RESET;
+  }
+}
+
+static SIM_HS Dfu_GetStatus(SIM_DFU *d, SIM_TIME now, uint8_t *data, uint16_t *len)
+{
+  SIM_TIME busy = 0;
+
+  d->Stats.Status++;
+  switch(d->State)
+  {
+  case DFU_DN_SYNC:
+    if(d->Pending)
+    {
+      busy = d->Base + d->PerKb * d->Pending / 1024;
+      d->Stats.ProgSum += busy;
+      d->Pending = 0;
+      d->State = DFU_DN_BUSY;
+    }
+    else
+    {
+      d->State = DFU_DN_IDLE;
+    }
+    break;
+  case DFU_MANIFEST_SYNC:
+    if(d->BusyUntil == 0)
+    {
+      busy = d->ManifestTime;
+      d->State = DFU_MANIFEST;
+    }
+    else
+    {
+      d->State = DFU_IDLE;
+    }
+    break;
+  default:
+    break;
+  }
+  d->BusyUntil = busy ? (now + busy) : 0;
+  d->LastStatus = now;
+
+  data[0] = d->Status;
+  data[1] = Dfu_Ms(busy);
+  data[2] = Dfu_Ms(busy) >> 8;
+  data[3] = Dfu_Ms(busy) >> 16;
+  data[4] = d->State;
+  data[5] = 0;
+  *len = 6;
+  return SIM_ACK;
+}
+
+static SIM_HS Dfu_Dnload(SIM_DFU *d, uint16_t block, const uint8_t *data, uint16_t len)
+{
+  uint32_t addr = (uint32_t)block * d->Xfer;
+  SIM_TIME now = USB_HostSim_Now();
+
+  if((d->State != DFU_IDLE) && (d->State != DFU_DN_IDLE))
+  {
+    return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+  }
+  if(len == 0)
+  {
+    if(d->State != DFU_DN_IDLE)
+    {
+      return Dfu_Error(d, DFU_ERR_NOTDONE);
+    }
+    d->BusyUntil = 0;
+    d->State = DFU_MANIFEST_SYNC;
+    return SIM_ACK;
+  }
+  if(addr + len > d->FlashSize)
+  {
+    return Dfu_Error(d, DFU_ERR_ADDRESS);
+  }
+  if(d->Stats.Block == 0)
+  {
+    d->Stats.First = now;
+  }
+  d->Stats.Block++;
+  d->Stats.Bytes += len;
+  d->Stats.DataSum += now - d->LastStatus;
+  memcpy(d->Flash + addr, data, len);
+  if(addr + len > d->Size)
+  {
+    d->Size = addr + len;
+  }
+  d->Pending = len;
+  d->State = DFU_DN_SYNC;
+  return SIM_ACK;
+}
+
+static SIM_HS Dfu_Upload(SIM_DFU *d, uint8_t *data, uint16_t *len)
+{
+  uint32_t n;
+
+  if(d->NoUpload || ((d->State != DFU_IDLE) && (d->State != DFU_UP_IDLE)))
+  {
+    return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+  }
+  if(d->State == DFU_IDLE)
+  {
+    d->UpPos = 0;
+  }
+  n = d->Size - d->UpPos;
+  if(n > *len)
+  {
+    n = *len;
+  }
+  memcpy(data, d->Flash + d->UpPos, n);
+  d->UpPos += n;
+  d->Stats.Upload++;
+  /* 短块结束上传 */
+  d->State = (n < *len) ? DFU_IDLE : DFU_UP_IDLE;
+  *len = n;
+  return SIM_ACK;
+}
+
+static void Dfu_Reset(SIM_DEV *dev)
+{
+  SIM_DFU *d = dev->Priv;
+
+  /* 复位后运行新固件, 再次枚举时仍为DFU模式 */
+  d->State = DFU_IDLE;
+  d->Status = 0;
+  d->Pending = 0;
+  d->BusyUntil = 0;
+  d->UpPos = 0;
+}
+
+static SIM_HS Dfu_Request(SIM_DEV *dev, const uint8_t *setup, uint8_t *data, uint16_t *len)
+{
+  SIM_DFU *d = dev->Priv;
+  SIM_TIME now = USB_HostSim_Now();
+  uint16_t value = setup[2] | (setup[3] << 8);
+
+  if((setup[0] & 0x7F) != 0x21)
+  {
+    return SIM_STALL;
+  }
+  if((d->State == DFU_DN_BUSY) || (d->State == DFU_MANIFEST))
+  {
+    if(now < d->BusyUntil)
+    {
+      /* bwPollTimeout未到 */
+      return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+    }
+    d->Stats.LateSum += now - d->BusyUntil;
+    Dfu_Update(d, now);
+  }
+
+  switch(setup[1])
+  {
+  case 1:                       //DNLOAD
+    return Dfu_Dnload(d, value, data, *len);
+  case 2:                       //UPLOAD
+    return Dfu_Upload(d, data, len);
+  case 3:                       //GETSTATUS
+    return Dfu_GetStatus(d, now, data, len);
+  case 4:                       //CLRSTATUS
+    if(d->State != DFU_ERROR)
+    {
+      return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+    }
+    d->State = DFU_IDLE;
+    d->Status = 0;
+    return SIM_ACK;
+  case 5:                       //GETSTATE
+    data[0] = d->State;
+    *len = 1;
+    return SIM_ACK;
+  case 6:                       //ABORT
+    if((d->State == DFU_IDLE) || (d->State == DFU_DN_SYNC) || (d->State == DFU_DN_IDLE) ||
+       (d->State == DFU_MANIFEST_SYNC) || (d->State == DFU_UP_IDLE))
+    {
+      d->State = DFU_IDLE;
+      d->Pending = 0;
+      return SIM_ACK;
+    }
+    return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+  default:
+    return Dfu_Error(d, DFU_ERR_STALLEDPKT);
+  }
+}
+
+static const SIM_DEV_OPS DfuOps =
+{
+  Dfu_Reset, Dfu_Request, 0, 0, 0, 0
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  SimDev_DfuCreate
+  * @param  flash: bytes of flash, erased (0xFF)
+  * @param  xfer: wTransferSize
+  * @param  tolerant: bitManifestationTolerant
+  * @param  serial: serial number string, 0: none
+  * @retval device
+  */
+SIM_DEV *SimDev_DfuCreate(uint32_t flash, uint16_t xfer, uint8_t tolerant, const char *serial)
+{
+  SIM_DFU *d = calloc(1, sizeof(SIM_DFU));
+
+  d->Flash = malloc(flash);
+  memset(d->Flash, 0xFF, flash);
+  d->FlashSize = flash;
+  d->Xfer = xfer;
+  d->Tolerant = tolerant;
+
+  memcpy(d->DevDesc, DfuDevDesc, sizeof(d->DevDesc));
+  memcpy(d->CfgDesc, DfuCfgDesc, sizeof(d->CfgDesc));
+  d->CfgDesc[20] = DFU_ATTR_DNLOAD | DFU_ATTR_UPLOAD | (tolerant ? DFU_ATTR_TOLERANT : 0);
+  d->CfgDesc[23] = xfer & 0xFF;
+  d->CfgDesc[24] = xfer >> 8;
+  d->Str[0] = "SIM";
+  d->Str[1] = "MK5 DFU";
+  d->Str[2] = d->Serial;
+  if(serial)
+  {
+    snprintf(d->Serial, sizeof(d->Serial), "%s", serial);
+  }
+  else
+  {
+    d->DevDesc[16] = 0;
+  }
+
+  d->Dev.Name    = "dfu";
+  d->Dev.Ops     = &DfuOps;
+  d->Dev.Priv    = d;
+  d->Dev.DevDesc = d->DevDesc;
+  d->Dev.CfgDesc = d->CfgDesc;
+  d->Dev.Str     = d->Str;
+  d->Dev.StrNum  = serial ? 3 : 2;
+  SimDev_DfuTiming(&d->Dev, SIM_MS(2), SIM_MS(5), SIM_MS(100));
+  Dfu_Reset(&d->Dev);
+  return &d->Dev;
+}
+
+/**
+  * @brief  SimDev_DfuDestroy
+  * @param  dev: device of SimDev_DfuCreate
+  * @retval None
+  */
+void SimDev_DfuDestroy(SIM_DEV *dev)
+{
+  SIM_DFU *d = dev->Priv;
+
+  free(d->Flash);
+  free(d);
+}
+
+/**
+  * @brief  SimDev_DfuStats
+  * @param  dev: device of SimDev_DfuCreate
+  * @retval counters of the device
+  */
+SIM_DFU_STATS *SimDev_DfuStats(SIM_DEV *dev)
+{
+  return &((SIM_DFU *)dev->Priv)->Stats;
+}
+
+/**
+  * @brief  SimDev_DfuFlash
+  *         Flash of the device, may be written before the download (image
+  *         already on the device); *size then gives the end of that image.
+  * @param  dev: device of SimDev_DfuCreate
+  * @param  size: in/out, end of the image in the flash, 0: do not change
+  * @retval flash
+  */
+uint8_t *SimDev_DfuFlash(SIM_DEV *dev, uint32_t *size)
+{
+  SIM_DFU *d = dev->Priv;
+
+  if(*size && (*size <= d->FlashSize))
+  {
+    d->Size = *size;
+  }
+  *size = d->Size;
+  return d->Flash;
+}
+
+/**
+  * @brief  SimDev_DfuTiming
+  *         Programming time of a block: base + per_kb for each KB, given to
+  *         the host as bwPollTimeout (rounded up to ms)
+  * @param  dev: device of SimDev_DfuCreate
+  * @param  base: per block
+  * @param  per_kb: per KB of the block
+  * @param  manifest: manifestation
+  * @retval None
+  */
+void SimDev_DfuTiming(SIM_DEV *dev, SIM_TIME base, SIM_TIME per_kb, SIM_TIME manifest)
+{
+  SIM_DFU *d = dev->Priv;
+
+  d->Base = base;
+  d->PerKb = per_kb;
+  d->ManifestTime = manifest;
+}
+
+/**
+  * @brief  SimDev_DfuNoUpload
+  *         Stall every UPLOAD (dfuERROR), bitCanUpload stays set
+  * @param  dev: device of SimDev_DfuCreate
+  * @param  on: 1: stall, 0: UPLOAD reads the flash
+  * @retval None
+  */
+void SimDev_DfuNoUpload(SIM_DEV *dev, uint8_t on)
+{
+  ((SIM_DFU *)dev->Priv)->NoUpload = on;
+}
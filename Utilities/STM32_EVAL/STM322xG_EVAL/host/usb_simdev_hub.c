@@ -0,0 +1,373 @@
+/**
+  ******************************************************************************
+  * @file    usb_simdev_hub.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Full speed hub model for usbh_hub.c: hub descriptor, per port
+  *          power, connection, reset and enable with their change bits, and
+  *          the status change endpoint 0x81 (NAK while nothing changed).
+  *          A port reset lasts HUB_RESET_TIME and resets the device behind
+  *          it. Tokens for another address go to the devices on the enabled
+  *          ports; two devices answering to the same address (both still at
+  *          address 0) collide and nobody answers, as on a real bus.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HUB_PORT_MAX            7           //状态变化位图为1字节
+#define HUB_RESET_TIME          SIM_MS(10)
+#define HUB_PWR_GOOD            50          //bPwrOn2PwrGood, 2ms单位
+#define HUB_INTERVAL            255         //状态变化端点的bInterval, ms
+
+/* wPortStatus */
+#define PORT_CONNECTION         0x0001
+#define PORT_ENABLE             0x0002
+#define PORT_RESET              0x0010
+#define PORT_POWER              0x0100
+/* wPortChange */
+#define C_PORT_CONNECTION       0x0001
+#define C_PORT_ENABLE           0x0002
+#define C_PORT_RESET            0x0010
+
+/* port features */
+#define FEAT_PORT_ENABLE        1
+#define FEAT_PORT_RESET         4
+#define FEAT_PORT_POWER         8
+#define FEAT_C_PORT_CONNECTION  16
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  SIM_DEV      *Dev;
+  uint16_t      Status;
+  uint16_t      Change;
+  SIM_TIME      ResetEnd;
+}
+SIM_HUB_PORT;
+
+typedef struct
+{
+  SIM_DEV       Dev;
+  uint8_t       Ports;
+  SIM_HUB_PORT  Port[HUB_PORT_MAX];
+  uint8_t       CfgDesc[25];
+  SIM_HUB_STATS Stats;
+}
+SIM_HUB;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t HubDevDesc[18] =
+{
+  18, 0x01, 0x10, 0x01, 0x09, 0x00, 0x00, 64,
+  0xE3, 0x05, 0x08, 0x06,       //05E3:0608
+  0x00, 0x01, 1, 2, 0, 1
+};
+
+static const uint8_t HubCfgDesc[25] =
+{
+  9, 0x02, 25, 0, 1, 1, 0, 0xE0, 50,
+  9, 0x04, 0, 0, 1, 0x09, 0x00, 0x00, 0,
+  7, 0x05, 0x81, 0x03, 1, 0, HUB_INTERVAL
+};
+
+static const char * const HubStr[2] = { "SIM", "SIM USB Hub" };
+
+/* Private functions ---------------------------------------------------------*/
+/* 复位时间到了之后的端口状态 */
+static void Hub_Update(SIM_HUB *h, SIM_TIME now)
+{
+  SIM_HUB_PORT *p;
+  int i;
+
+  for(i = 0; i < h->Ports; i++)
+  {
+    p = &h->Port[i];
+    if((p->Status & PORT_RESET) && (now >= p->ResetEnd))
+    {
+      p->Status &= ~PORT_RESET;
+      p->Change |= C_PORT_RESET;
+      if(p->Status & PORT_CONNECTION)
+      {
+        SimDev_Reset(p->Dev);
+        p->Status |= PORT_ENABLE;
+      }
+    }
+  }
+}
+
+static void Hub_Reset(SIM_DEV *dev)
+{
+  SIM_HUB *h = dev->Priv;
+  int i;
+
+  /* 复位后端口断电, 设备在上电后重新报告连接 */
+  for(i = 0; i < h->Ports; i++)
+  {
+    h->Port[i].Status = 0;
+    h->Port[i].Change = 0;
+  }
+}
+
+static SIM_HS Hub_Request(SIM_DEV *dev, const uint8_t *setup, uint8_t *data, uint16_t *len)
+{
+  SIM_HUB *h = dev->Priv;
+  uint16_t value = setup[2] | (setup[3] << 8);
+  uint16_t index = setup[4] | (setup[5] << 8);
+  SIM_HUB_PORT *p;
+
+  Hub_Update(h, USB_HostSim_Now());
+  if(setup[0] == 0xA0)          //集线器
+  {
+    if((setup[1] == 0x06) && (setup[3] == 0x29))
+    {
+      data[0] = 9;
+      data[1] = 0x29;
+      data[2] = h->Ports;
+      data[3] = 0x09;           //单独供电, 单独过流保护
+      data[4] = 0;
+      data[5] = HUB_PWR_GOOD;
+      data[6] = 100;
+      data[7] = 0;
+      data[8] = 0xFF;
+      *len = 9;
+      return SIM_ACK;
+    }
+    if(setup[1] == 0x00)        //GET_STATUS
+    {
+      memset(data, 0, 4);
+      *len = 4;
+      return SIM_ACK;
+    }
+    return SIM_STALL;
+  }
+  if(((setup[0] & 0x7F) != 0x23) || (index == 0) || (index > h->Ports))
+  {
+    return SIM_STALL;
+  }
+  p = &h->Port[index - 1];
+  h->Stats.Request++;
+
+  switch(setup[1])
+  {
+  case 0x00:                    //GET_STATUS
+    data[0] = p->Status & 0xFF;
+    data[1] = p->Status >> 8;
+    data[2] = p->Change & 0xFF;
+    data[3] = p->Change >> 8;
+    *len = 4;
+    return SIM_ACK;
+
+  case 0x03:                    //SET_FEATURE
+    if(value == FEAT_PORT_POWER)
+    {
+      if(((p->Status & PORT_POWER) == 0) && p->Dev)
+      {
+        p->Status |= PORT_CONNECTION;
+        p->Change |= C_PORT_CONNECTION;
+      }
+      p->Status |= PORT_POWER;
+      return SIM_ACK;
+    }
+    if(value == FEAT_PORT_RESET)
+    {
+      if((p->Status & PORT_CONNECTION) == 0)
+      {
+        return SIM_ACK;
+      }
+      p->Status = (p->Status & ~PORT_ENABLE) | PORT_RESET;
+      p->ResetEnd = USB_HostSim_Now() + HUB_RESET_TIME;
+      h->Stats.Reset++;
+      return SIM_ACK;
+    }
+    return SIM_STALL;
+
+  case 0x01:                    //CLEAR_FEATURE
+    if(value == FEAT_PORT_ENABLE)
+    {
+      p->Status &= ~PORT_ENABLE;
+      return SIM_ACK;
+    }
+    if(value == FEAT_PORT_POWER)
+    {
+      p->Status = 0;
+      return SIM_ACK;
+    }
+    if((value >= FEAT_C_PORT_CONNECTION) && (value <= FEAT_C_PORT_CONNECTION + 4))
+    {
+      p->Change &= ~(1 << (value - FEAT_C_PORT_CONNECTION));
+      return SIM_ACK;
+    }
+    return SIM_STALL;
+
+  default:
+    return SIM_STALL;
+  }
+}
+
+/* 状态变化端点: bit n为端口n */
+static SIM_HS Hub_In(SIM_DEV *dev, uint8_t ep, uint8_t *data, uint16_t *len)
+{
+  SIM_HUB *h = dev->Priv;
+  uint8_t map = 0;
+  int i;
+
+  if(ep != 1)
+  {
+    return SIM_STALL;
+  }
+  Hub_Update(h, USB_HostSim_Now());
+  for(i = 0; i < h->Ports; i++)
+  {
+    if(h->Port[i].Change)
+    {
+      map |= 1 << (i + 1);
+    }
+  }
+  if(map == 0)
+  {
+    return SIM_NAK;
+  }
+  data[0] = map;
+  *len = 1;
+  return SIM_ACK;
+}
+
+static SIM_DEV *Hub_Route(SIM_DEV *dev, uint8_t addr)
+{
+  SIM_HUB *h = dev->Priv;
+  SIM_DEV *found = 0, *d;
+  int i;
+
+  Hub_Update(h, USB_HostSim_Now());
+  for(i = 0; i < h->Ports; i++)
+  {
+    if((h->Port[i].Status & PORT_ENABLE) == 0)
+    {
+      continue;
+    }
+    d = SimDev_Route(h->Port[i].Dev, addr);
+    if(d == 0)
+    {
+      continue;
+    }
+    if(found)
+    {
+      h->Stats.Collision++;
+      return 0;
+    }
+    found = d;
+  }
+  return found;
+}
+
+static const SIM_DEV_OPS HubOps =
+{
+  Hub_Reset, Hub_Request, Hub_In, 0, 0, Hub_Route
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  SimDev_HubCreate
+  * @param  ports: number of downstream ports, 1..7
+  * @retval device
+  */
+SIM_DEV *SimDev_HubCreate(uint8_t ports)
+{
+  SIM_HUB *h = calloc(1, sizeof(SIM_HUB));
+
+  h->Ports = (ports > HUB_PORT_MAX) ? HUB_PORT_MAX : ports;
+  memcpy(h->CfgDesc, HubCfgDesc, sizeof(h->CfgDesc));
+
+  h->Dev.Name    = "hub";
+  h->Dev.Ops     = &HubOps;
+  h->Dev.Priv    = h;
+  h->Dev.DevDesc = HubDevDesc;
+  h->Dev.CfgDesc = h->CfgDesc;
+  h->Dev.Str     = HubStr;
+  h->Dev.StrNum  = 2;
+  return &h->Dev;
+}
+
+/**
+  * @brief  SimDev_HubDestroy
+  *         The devices on the ports are not destroyed
+  * @param  dev: device of SimDev_HubCreate
+  * @retval None
+  */
+void SimDev_HubDestroy(SIM_DEV *dev)
+{
+  free(dev->Priv);
+}
+
+/**
+  * @brief  SimDev_HubStats
+  * @param  dev: device of SimDev_HubCreate
+  * @retval counters of the hub
+  */
+SIM_HUB_STATS *SimDev_HubStats(SIM_DEV *dev)
+{
+  return &((SIM_HUB *)dev->Priv)->Stats;
+}
+
+/**
+  * @brief  SimDev_HubAttach
+  *         Plug a device into a port (C_PORT_CONNECTION once powered)
+  * @param  dev: device of SimDev_HubCreate
+  * @param  port: 1..ports
+  * @param  child: device model
+  * @retval None
+  */
+void SimDev_HubAttach(SIM_DEV *dev, uint8_t port, SIM_DEV *child)
+{
+  SIM_HUB *h = dev->Priv;
+  SIM_HUB_PORT *p;
+
+  if((port == 0) || (port > h->Ports))
+  {
+    return;
+  }
+  p = &h->Port[port - 1];
+  p->Dev = child;
+  SimDev_Reset(child);
+  if(p->Status & PORT_POWER)
+  {
+    p->Status |= PORT_CONNECTION;
+    p->Change |= C_PORT_CONNECTION;
+  }
+}
+
+/**
+  * @brief  SimDev_HubDetach
+  *         Unplug the device of a port
+  * @param  dev: device of SimDev_HubCreate
+  * @param  port: 1..ports
+  * @retval None
+  */
+void SimDev_HubDetach(SIM_DEV *dev, uint8_t port)
+{
+  SIM_HUB *h = dev->Priv;
+  SIM_HUB_PORT *p;
+
+  if((port == 0) || (port > h->Ports))
+  {
+    return;
+  }
+  p = &h->Port[port - 1];
+  p->Dev = 0;
+  if(p->Status & PORT_CONNECTION)
+  {
+    p->Change |= C_PORT_CONNECTION;
+    if(p->Status & PORT_ENABLE)
+    {
+      p->Change |= C_PORT_ENABLE;
+    }
+  }
+  p->Status &= ~(PORT_CONNECTION | PORT_ENABLE | PORT_RESET);
+}
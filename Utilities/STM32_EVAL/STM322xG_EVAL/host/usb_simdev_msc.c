@@ -0,0 +1,501 @@
+/**
+  ******************************************************************************
+  * @file    usb_simdev_msc.c
+  * @author  zb
+  * @version V1.1.0
+  * @date    2015-9-14
+  * @brief   Mass storage stick model on an image file: bulk only transport,
+  *          SCSI TEST UNIT READY, REQUEST SENSE, INQUIRY, MODE SENSE(6), READ
+  *          CAPACITY(10), READ(10), WRITE(10), PREVENT ALLOW MEDIUM REMOVAL.
+  *          Other commands fail with ILLEGAL REQUEST. The flash of the stick
+  *          is a fixed time per command: before the data of a READ(10) and
+  *          between the data and the CSW of a WRITE(10), the bulk endpoints
+  *          NAK meanwhile. A STALL injected in the data stage fails the
+  *          command (CSW status 1).
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "usb_simdev.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MSC_EP_IN               1
+#define MSC_EP_OUT              2
+#define MSC_SECTOR              512
+#define MSC_SECTOR_MAX          64          //一个命令最多的扇区, 足够USBH_MSC_IO
+
+enum
+{
+  BOT_CBW = 0,
+  BOT_DATA_IN,
+  BOT_DATA_OUT,
+  BOT_CSW,
+};
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  SIM_DEV       Dev;
+  FILE         *Img;
+  uint32_t      Sectors;
+  uint8_t       Protect;        //写保护开关, 只由MODE SENSE报告
+  uint8_t       State;
+  uint8_t       Cbw[31];
+  uint8_t       Status;         //CSW
+  uint32_t      Residue;
+  uint8_t       Sense[3];       //key, ASC, ASCQ
+  uint8_t       Op;
+  uint32_t      Lba;
+  uint32_t      Len;            //数据阶段字节数
+  uint32_t      Pos;
+  uint8_t       Buf[MSC_SECTOR * MSC_SECTOR_MAX];
+  SIM_TIME      ReadTime;
+  SIM_TIME      WriteTime;
+  SIM_TIME      CbwAt;
+  SIM_TIME      CswAt;
+  char          Serial[32];
+  const char   *Str[3];
+  SIM_MSC_STATS Stats;
+}
+SIM_MSC;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t MscDevDesc[18] =
+{
+  18, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 64,
+  0x83, 0x04, 0x20, 0x57,       //0483:5720
+  0x00, 0x01, 1, 2, 3, 1
+};
+
+static const uint8_t MscCfgDesc[32] =
+{
+  9, 0x02, 32, 0, 1, 1, 0, 0x80, 50,
+  9, 0x04, 0, 0, 2, 0x08, 0x06, 0x50, 0,
+  7, 0x05, 0x80 | MSC_EP_IN, 0x02, 64, 0, 0,
+  7, 0x05, MSC_EP_OUT, 0x02, 64, 0, 0
+};
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Msc_Be32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void Msc_PutBe32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void Msc_Sense(SIM_MSC *m, uint8_t key, uint8_t asc)
+{
+  m->Sense[0] = key;
+  m->Sense[1] = asc;
+  m->Sense[2] = 0;
+}
+
+/* 命令失败: 有数据阶段时停止数据端点, 主机清除后读CSW */
+static void Msc_Fail(SIM_MSC *m, uint32_t length, uint8_t in)
+{
+  Msc_Sense(m, 0x05, 0x20);     //ILLEGAL REQUEST, INVALID COMMAND
+  m->Status = 1;
+  m->Residue = length;
+  m->State = BOT_CSW;
+  if(length)
+  {
+    m->Dev.Halted[in][in ? MSC_EP_IN : MSC_EP_OUT] = 1;
+  }
+}
+
+static uint32_t Msc_Le32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void Msc_Csw(SIM_MSC *m)
+{
+  m->Residue = Msc_Le32(&m->Cbw[8]) - m->Pos;
+  m->State = BOT_CSW;
+}
+
+static int Msc_Io(SIM_MSC *m, uint32_t lba, uint32_t count, int write)
+{
+  off_t off = (off_t)lba * MSC_SECTOR;
+
+  if(fseeko(m->Img, off, SEEK_SET))
+  {
+    return -1;
+  }
+  if(write)
+  {
+    return (fwrite(m->Buf, MSC_SECTOR, count, m->Img) == count) ? 0 : -1;
+  }
+  return (fread(m->Buf, MSC_SECTOR, count, m->Img) == count) ? 0 : -1;
+}
+
+/* CBW: 命令和数据阶段 */
+static SIM_HS Msc_Command(SIM_MSC *m)
+{
+  uint32_t length = Msc_Le32(&m->Cbw[8]);
+  uint8_t in = (m->Cbw[12] & 0x80) ? 1 : 0;
+  const uint8_t *cb = &m->Cbw[15];
+  uint32_t n = 0, count;
+  SIM_TIME now = USB_HostSim_Now();
+
+  m->Stats.Cmd++;
+  if(m->Stats.Cmd > 1)
+  {
+    m->Stats.GapSum += now - m->CswAt;
+    m->Stats.Gap++;
+  }
+  m->CbwAt = now;
+  m->Op = cb[0];
+  m->Status = 0;
+  m->Pos = 0;
+  memset(m->Buf, 0, 64);
+
+  switch(cb[0])
+  {
+  case 0x00:                    //TEST UNIT READY
+  case 0x1E:                    //PREVENT ALLOW MEDIUM REMOVAL
+    break;
+
+  case 0x03:                    //REQUEST SENSE
+    m->Buf[0] = 0x70;
+    m->Buf[2] = m->Sense[0];
+    m->Buf[7] = 10;
+    m->Buf[12] = m->Sense[1];
+    m->Buf[13] = m->Sense[2];
+    Msc_Sense(m, 0, 0);
+    n = 18;
+    break;
+
+  case 0x12:                    //INQUIRY
+    m->Buf[1] = 0x80;
+    m->Buf[2] = 0x02;
+    m->Buf[3] = 0x02;
+    m->Buf[4] = 31;
+    memcpy(&m->Buf[8], "SIM     USB DISK        1.00", 28);
+    n = 36;
+    break;
+
+  case 0x1A:                    //MODE SENSE(6)
+    m->Buf[0] = 3;
+    m->Buf[2] = m->Protect ? 0x80 : 0x00;   //WP
+    n = 4;
+    break;
+
+  case 0x25:                    //READ CAPACITY(10)
+    Msc_PutBe32(&m->Buf[0], m->Sectors - 1);
+    Msc_PutBe32(&m->Buf[4], MSC_SECTOR);
+    n = 8;
+    break;
+
+  case 0x28:                    //READ(10)
+  case 0x2A:                    //WRITE(10)
+    m->Lba = Msc_Be32(&cb[2]);
+    count = (cb[7] << 8) | cb[8];
+    if((count > MSC_SECTOR_MAX) || (m->Lba + count > m->Sectors) ||
+       (length != count * MSC_SECTOR) || (in != (cb[0] == 0x28)))
+    {
+      Msc_Fail(m, length, in);
+      return SIM_ACK;
+    }
+    m->Len = length;
+    if(cb[0] == 0x28)
+    {
+      m->Stats.Read10++;
+      m->Stats.SectorRd += count;
+      if(Msc_Io(m, m->Lba, count, 0))
+      {
+        memset(m->Buf, 0xFF, length);
+      }
+      m->Dev.NakUntil = now + m->ReadTime;
+      m->State = BOT_DATA_IN;
+    }
+    else
+    {
+      m->Stats.Write10++;
+      m->Stats.SectorWr += count;
+      m->State = BOT_DATA_OUT;
+    }
+    if(length == 0)
+    {
+      Msc_Csw(m);
+    }
+    return SIM_ACK;
+
+  default:
+    Msc_Fail(m, length, in);
+    return SIM_ACK;
+  }
+
+  /* 短数据的命令 */
+  if(length && in)
+  {
+    m->Len = (n < length) ? n : length;
+    m->State = BOT_DATA_IN;
+  }
+  else if(length)
+  {
+    Msc_Fail(m, length, 0);
+  }
+  else
+  {
+    Msc_Csw(m);
+  }
+  return SIM_ACK;
+}
+
+static void Msc_Reset(SIM_DEV *dev)
+{
+  SIM_MSC *m = dev->Priv;
+
+  m->State = BOT_CBW;
+  if(m->Img)
+  {
+    fflush(m->Img);
+  }
+}
+
+static SIM_HS Msc_Request(SIM_DEV *dev, const uint8_t *setup, uint8_t *data, uint16_t *len)
+{
+  SIM_MSC *m = dev->Priv;
+
+  if((setup[0] == 0x21) && (setup[1] == 0xFF))        //Bulk-Only Mass Storage Reset
+  {
+    m->State = BOT_CBW;
+    return SIM_ACK;
+  }
+  if((setup[0] == 0xA1) && (setup[1] == 0xFE))        //Get Max LUN
+  {
+    data[0] = 0;
+    *len = 1;
+    return SIM_ACK;
+  }
+  return SIM_STALL;
+}
+
+static SIM_HS Msc_In(SIM_DEV *dev, uint8_t ep, uint8_t *data, uint16_t *len)
+{
+  SIM_MSC *m = dev->Priv;
+  uint32_t n;
+
+  if(ep != MSC_EP_IN)
+  {
+    return SIM_STALL;
+  }
+  switch(m->State)
+  {
+  case BOT_DATA_IN:
+    n = m->Len - m->Pos;
+    if(n > *len)
+    {
+      n = *len;
+    }
+    memcpy(data, m->Buf + m->Pos, n);
+    m->Pos += n;
+    *len = n;
+    if(m->Pos == m->Len)
+    {
+      Msc_Csw(m);
+    }
+    return SIM_ACK;
+
+  case BOT_CSW:
+    memcpy(data, "USBS", 4);
+    memcpy(&data[4], &m->Cbw[4], 4);
+    data[8]  = m->Residue;
+    data[9]  = m->Residue >> 8;
+    data[10] = m->Residue >> 16;
+    data[11] = m->Residue >> 24;
+    data[12] = m->Status;
+    *len = 13;
+    m->State = BOT_CBW;
+    m->CswAt = USB_HostSim_Now();
+    m->Stats.CmdSum += m->CswAt - m->CbwAt;
+    if(m->Status)
+    {
+      m->Stats.Failed++;
+    }
+    return SIM_ACK;
+
+  default:
+    return SIM_NAK;
+  }
+}
+
+static SIM_HS Msc_Out(SIM_DEV *dev, uint8_t ep, const uint8_t *data, uint16_t len)
+{
+  SIM_MSC *m = dev->Priv;
+  uint32_t n;
+
+  if(ep != MSC_EP_OUT)
+  {
+    return SIM_STALL;
+  }
+  switch(m->State)
+  {
+  case BOT_CBW:
+    if((len != 31) || memcmp(data, "USBC", 4))
+    {
+      /* 无效的CBW: 停止两个端点, 等待复位 */
+      dev->Halted[0][MSC_EP_OUT] = 1;
+      dev->Halted[1][MSC_EP_IN] = 1;
+      return SIM_STALL;
+    }
+    memcpy(m->Cbw, data, 31);
+    return Msc_Command(m);
+
+  case BOT_DATA_OUT:
+    n = m->Len - m->Pos;
+    if(len < n)
+    {
+      n = len;
+    }
+    memcpy(m->Buf + m->Pos, data, n);
+    m->Pos += n;
+    if(m->Pos == m->Len)
+    {
+      if(Msc_Io(m, m->Lba, m->Len / MSC_SECTOR, 1))
+      {
+        m->Status = 1;
+        Msc_Sense(m, 0x03, 0x0C);       //MEDIUM ERROR, WRITE ERROR
+      }
+      /* 编程期间CSW NAK */
+      m->Dev.NakUntil = USB_HostSim_Now() + m->WriteTime;
+      Msc_Csw(m);
+    }
+    return SIM_ACK;
+
+  default:
+    return SIM_NAK;
+  }
+}
+
+/* 注入的STALL: 命令失败, 主机清除后读CSW */
+static void Msc_Halt(SIM_DEV *dev, uint8_t ep)
+{
+  SIM_MSC *m = dev->Priv;
+
+  if((m->State == BOT_DATA_IN) || (m->State == BOT_DATA_OUT))
+  {
+    m->Status = 1;
+    Msc_Sense(m, 0x04, 0x00);         //HARDWARE ERROR
+    Msc_Csw(m);
+  }
+}
+
+static const SIM_DEV_OPS MscOps =
+{
+  Msc_Reset, Msc_Request, Msc_In, Msc_Out, Msc_Halt, 0
+};
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  SimDev_MscCreate
+  *         Stick on an image file, the size gives the capacity
+  * @param  image: path of the image, opened read/write
+  * @param  serial: serial number string, 0: none (iSerialNumber 0)
+  * @retval device, 0 if the image can not be opened
+  */
+SIM_DEV *SimDev_MscCreate(const char *image, const char *serial)
+{
+  SIM_MSC *m = calloc(1, sizeof(SIM_MSC));
+  static uint8_t desc_noserial[18];
+
+  if(m == 0)
+  {
+    return 0;
+  }
+  m->Img = fopen(image, "r+b");
+  if(m->Img == 0)
+  {
+    free(m);
+    return 0;
+  }
+  fseeko(m->Img, 0, SEEK_END);
+  m->Sectors = (uint32_t)(ftello(m->Img) / MSC_SECTOR);
+
+  m->Str[0] = "SIM";
+  m->Str[1] = "USB DISK";
+  m->Str[2] = m->Serial;
+  m->Dev.Name    = "msc";
+  m->Dev.Ops     = &MscOps;
+  m->Dev.Priv    = m;
+  m->Dev.DevDesc = MscDevDesc;
+  m->Dev.CfgDesc = MscCfgDesc;
+  m->Dev.Str     = m->Str;
+  m->Dev.StrNum  = 3;
+  if(serial)
+  {
+    snprintf(m->Serial, sizeof(m->Serial), "%s", serial);
+  }
+  else
+  {
+    memcpy(desc_noserial, MscDevDesc, 18);
+    desc_noserial[16] = 0;
+    m->Dev.DevDesc = desc_noserial;
+    m->Dev.StrNum  = 2;
+  }
+  SimDev_MscTiming(&m->Dev, SIM_US(300), SIM_US(800));
+  return &m->Dev;
+}
+
+/**
+  * @brief  SimDev_MscDestroy
+  * @param  dev: device of SimDev_MscCreate
+  * @retval None
+  */
+void SimDev_MscDestroy(SIM_DEV *dev)
+{
+  SIM_MSC *m = dev->Priv;
+
+  fclose(m->Img);
+  free(m);
+}
+
+/**
+  * @brief  SimDev_MscStats
+  * @param  dev: device of SimDev_MscCreate
+  * @retval counters of the stick
+  */
+SIM_MSC_STATS *SimDev_MscStats(SIM_DEV *dev)
+{
+  return &((SIM_MSC *)dev->Priv)->Stats;
+}
+
+/**
+  * @brief  SimDev_MscTiming
+  *         Flash time of a command
+  * @param  dev: device of SimDev_MscCreate
+  * @param  read: CBW of a READ(10) to its first data packet
+  * @param  write: last data packet of a WRITE(10) to the CSW
+  * @retval None
+  */
+void SimDev_MscTiming(SIM_DEV *dev, SIM_TIME read, SIM_TIME write)
+{
+  SIM_MSC *m = dev->Priv;
+
+  m->ReadTime = read;
+  m->WriteTime = write;
+}
+
+/**
+  * @brief  SimDev_MscWriteProtect
+  *         Write protect switch, reported in the MODE SENSE(6) header only
+  * @param  dev: device of SimDev_MscCreate
+  * @param  on: 1: protected
+  * @retval None
+  */
+void SimDev_MscWriteProtect(SIM_DEV *dev, uint8_t on)
+{
+  ((SIM_MSC *)dev->Priv)->Protect = on;
+}
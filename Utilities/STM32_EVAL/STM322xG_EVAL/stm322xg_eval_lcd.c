@@ -79,6 +79,14 @@ typedef struct
 /* Note: LCD /CS is NE4 - Bank 3 of NOR/SRAM Bank 1~4 */
 #define LCD_BASE           ((uint32_t)(0x60000000 | 0x0C000000))
 #define LCD                ((LCD_TypeDef *) LCD_BASE)
+#ifndef LCD_HOSTFB
+ #define LCD_RAM_PUT(RGB)  (LCD->LCD_RAM = (RGB))
+#else
+ /* 在PC上编译(host/lcd_hostfb.c)时,总线访问由模拟的控制器完成 */
+ #define LCD_RAM_PUT(RGB)  LCD_WriteRAM(RGB)
+ #undef  LCD_BLIT_DMA
+ #define LCD_BLIT_DMA      0
+#endif
 #define MAX_POLY_CORNERS   200
 #define POLY_Y(Z)          ((int32_t)((Points + Z)->X))
 #define POLY_X(Z)          ((int32_t)((Points + Z)->Y))
@@ -101,6 +109,19 @@ static sFONT *LCD_Currentfonts;
 
   /* Global variables to set the written text color */
 static __IO uint16_t TextColor = 0x0000, BackColor = 0xFFFF;
+
+  /* State of the blit opened by LCD_BlitBegin */
+static struct
+{
+  uint16_t Xpos, Ypos, Height, Width;   /* 窗口 */
+  uint16_t Row, Col;                    /* 逐点写时的当前位置 */
+  uint8_t  Direction;
+  uint8_t  Window;                      /* 1: 控制器窗口方式, 0: 逐点LCD_SetPoint */
+} Blit;
+#if LCD_BLIT_DMA
+static uint16_t BlitColor;              /* LCD_BlitFill的DMA源 */
+static uint8_t  BlitDMABusy;
+#endif
   
 /**
   * @}
@@ -115,6 +136,11 @@ static void delay(__IO uint32_t nCount);
 #endif /* USE_Delay*/
 static void PutPixel(int16_t x, int16_t y);
 static void LCD_PolyLineRelativeClosed(pPoint Points, uint16_t PointCount, uint16_t Closed);
+static void LCD_BlitPoint(uint16_t Color);
+static void LCD_BlitWait(void);
+#if LCD_BLIT_DMA
+static void LCD_BlitDMA(const uint16_t *pSrc, uint32_t Num, uint32_t SrcInc);
+#endif
 
 
 /**
@@ -764,7 +790,7 @@ void LCD_Clear(uint16_t Color)
   LCD_WriteRAM_Prepare(); /* Prepare to write GRAM */
   for(index = 0; index < 76800; index++)//240*320
   {
-    LCD->LCD_RAM = Color;
+    LCD_RAM_PUT(Color);
   }  
 }
 
@@ -903,6 +929,15 @@ void LCD_DisplayStringLine(uint16_t Line, uint8_t *ptr)
   */
 void LCD_SetDisplayWindow(uint16_t Xpos, uint16_t Ypos, uint8_t Height, uint16_t Width)
 {
+  if(DeviceCode==0x8989)
+  {
+    /* SSD1289: R44 = HEA << 8 | HSA, R45 = VSA, R46 = VEA */
+    LCD_WriteReg(0x0044, (Xpos << 8) | ((Xpos >= Height) ? (Xpos - Height + 1) : 0));
+    LCD_WriteReg(0x0045, (Ypos >= Width) ? (Ypos - Width + 1) : 0);
+    LCD_WriteReg(0x0046, Ypos);
+    LCD_SetCursor(Xpos, Ypos);
+    return;
+  }
   /* Horizontal GRAM Start Address */
   if(Xpos >= Height)
   {
@@ -936,7 +971,181 @@ void LCD_SetDisplayWindow(uint16_t Xpos, uint16_t Ypos, uint8_t Height, uint16_t
 void LCD_WindowModeDisable(void)
 {
   LCD_SetDisplayWindow(239, 0x13F, 240, 320);
-  LCD_WriteReg(LCD_REG_3, 0x1018);    
+  /* 恢复STM322xG_LCD_Init设置的写GRAM方向 */
+  if(DeviceCode==0x8989)
+  {
+    LCD_WriteReg(0x0011, 0x6078);
+  }
+  else if(DeviceCode==0x9325)
+  {
+    LCD_WriteReg(LCD_REG_3, 0x1008);
+  }
+  else
+  {
+    LCD_WriteReg(LCD_REG_3, 0x1018);    
+  }
+}
+
+/**
+  * @brief  Opens a blit: the Height x Width rectangle is then written by
+  *         LCD_BlitWrite/LCD_BlitFill as one burst, the controller moves the
+  *         GRAM address inside the window so the cursor is set only once.
+  *         It may be called again for the next rectangle before LCD_BlitEnd.
+  * @param  Xpos: first line of the rectangle.
+  * @param  Ypos: first column of the rectangle.
+  * @param  Height: number of lines.
+  * @param  Width: number of columns.
+  * @param  Direction: order of the pixels.
+  *   This parameter can be one of the following values:
+  *     @arg LCD_DIR_HORIZONTAL: along the line (Ypos++), then the next line
+  *     @arg LCD_DIR_VERTICAL: along the column (Xpos++), then the next column
+  * @retval None
+  */
+void LCD_BlitBegin(uint16_t Xpos, uint16_t Ypos, uint16_t Height, uint16_t Width, uint8_t Direction)
+{
+  LCD_BlitWait();
+
+  Blit.Xpos = Xpos;
+  Blit.Ypos = Ypos;
+  Blit.Height = Height;
+  Blit.Width = Width;
+  Blit.Direction = Direction;
+  Blit.Row = 0;
+  Blit.Col = 0;
+
+  if(DeviceCode==0x8989)
+  {
+    /* 窗口以结束处的GRAM地址给出, SSD1289的列地址即Ypos */
+    LCD_SetDisplayWindow(Xpos + Height - 1, Ypos + Width - 1, Height, Width);
+    /* ID=11; AM=1: 沿行写, AM=0: 沿列写 */
+    LCD_WriteReg(0x0011, (Direction == LCD_DIR_HORIZONTAL) ? 0x6078 : 0x6070);
+  }
+  else if(DeviceCode==0x9325)
+  {
+    /* ILI9325的列地址为0x13F-Ypos */
+    LCD_SetDisplayWindow(Xpos + Height - 1, 0x13F - Ypos, Height, Width);
+    /* I/D=01(水平递增,垂直递减); AM=1: 沿行写, AM=0: 沿列写 */
+    LCD_WriteReg(LCD_REG_3, (Direction == LCD_DIR_HORIZONTAL) ? 0x1018 : 0x1010);
+  }
+  else
+  {
+    /* 其它控制器逐点写 */
+    Blit.Window = 0;
+    return;
+  }
+  Blit.Window = 1;
+  LCD_SetCursor(Xpos, Ypos);
+  LCD_WriteRAM_Prepare(); /* Prepare to write GRAM */
+}
+
+/**
+  * @brief  Writes pixels of the opened blit.
+  * @param  pPixel: pixels in RGB 5-6-5. With LCD_BLIT_DMA the transfer may
+  *         still run on return, the buffer must be kept until the next
+  *         LCD_Blit call.
+  * @param  Num: number of pixels.
+  * @retval None
+  */
+void LCD_BlitWrite(const uint16_t *pPixel, uint32_t Num)
+{
+  if(Blit.Window == 0)
+  {
+    while(Num--)
+    {
+      LCD_BlitPoint(*pPixel++);
+    }
+    return;
+  }
+#if LCD_BLIT_DMA
+  if(Num >= LCD_BLIT_DMA_MIN)
+  {
+    LCD_BlitDMA(pPixel, Num, DMA_PeripheralInc_Enable);
+    return;
+  }
+#endif
+  LCD_BlitWait();
+  while(Num--)
+  {
+    LCD_RAM_PUT(*pPixel++);
+  }
+}
+
+/**
+  * @brief  Writes pixels of one color to the opened blit.
+  * @param  Color: the color in RGB 5-6-5.
+  * @param  Num: number of pixels.
+  * @retval None
+  */
+void LCD_BlitFill(uint16_t Color, uint32_t Num)
+{
+  if(Blit.Window == 0)
+  {
+    while(Num--)
+    {
+      LCD_BlitPoint(Color);
+    }
+    return;
+  }
+  LCD_BlitWait();
+#if LCD_BLIT_DMA
+  if(Num >= LCD_BLIT_DMA_MIN)
+  {
+    BlitColor = Color;
+    LCD_BlitDMA(&BlitColor, Num, DMA_PeripheralInc_Disable);
+    return;
+  }
+#endif
+  while(Num--)
+  {
+    LCD_RAM_PUT(Color);
+  }
+}
+
+/**
+  * @brief  Closes the blit, restores the full screen window.
+  * @param  None
+  * @retval None
+  */
+void LCD_BlitEnd(void)
+{
+  LCD_BlitWait();
+  if(Blit.Window)
+  {
+    LCD_WindowModeDisable();
+    Blit.Window = 0;
+  }
+}
+
+/**
+  * @brief  Tells whether a blit is written through the GRAM window of the
+  *         controller, otherwise it goes pixel by pixel with LCD_SetPoint.
+  * @param  None
+  * @retval 1: window, 0: LCD_SetPoint
+  */
+uint8_t LCD_BlitWindowed(void)
+{
+  return (DeviceCode == 0x8989) || (DeviceCode == 0x9325);
+}
+
+/**
+  * @brief  Displays a rectangle of pixels.
+  * @param  Xpos: first line of the rectangle.
+  * @param  Ypos: first column of the rectangle.
+  * @param  Height: number of lines.
+  * @param  Width: number of columns.
+  * @param  Direction: order of the pixels, see LCD_BlitBegin.
+  * @param  pPixel: Height * Width pixels in RGB 5-6-5.
+  * @retval None
+  */
+void LCD_BlitRect(uint16_t Xpos, uint16_t Ypos, uint16_t Height, uint16_t Width, uint8_t Direction, const uint16_t *pPixel)
+{
+  if((Height == 0) || (Width == 0))
+  {
+    return;
+  }
+  LCD_BlitBegin(Xpos, Ypos, Height, Width, Direction);
+  LCD_BlitWrite(pPixel, (uint32_t)Height * Width);
+  LCD_BlitEnd();
 }
 
 /**
@@ -1121,22 +1330,23 @@ void LCD_DrawFullRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Hei
 
   LCD_DrawLine(Xpos, Ypos, Width, LCD_DIR_HORIZONTAL);
   LCD_DrawLine((Xpos + Height), Ypos, Width, LCD_DIR_HORIZONTAL);
-  
-  LCD_DrawLine(Xpos, Ypos, Height, LCD_DIR_VERTICAL);
-  LCD_DrawLine(Xpos, (Ypos - Width + 1), Height, LCD_DIR_VERTICAL);
-
-  Width -= 2;
-  Height--;
-  Ypos--;
-
-  LCD_SetTextColor(BackColor);
 
-  while(Height--)
+  if(Height == 0)
   {
-    LCD_DrawLine(++Xpos, Ypos, Width, LCD_DIR_HORIZONTAL);    
+    return;
   }
+  /* 两条竖边和内部各一次块写,不再逐点设光标 */
+  LCD_BlitBegin(Xpos, Ypos, Height, 1, LCD_DIR_VERTICAL);
+  LCD_BlitFill(TextColor, Height);
+  LCD_BlitBegin(Xpos, (Ypos - Width + 1), Height, 1, LCD_DIR_VERTICAL);
+  LCD_BlitFill(TextColor, Height);
 
-  LCD_SetTextColor(TextColor);
+  if((Width > 2) && (Height > 1))
+  {
+    LCD_BlitBegin(Xpos + 1, Ypos - 1, Height - 1, Width - 2, LCD_DIR_HORIZONTAL);
+    LCD_BlitFill(BackColor, (uint32_t)(Height - 1) * (Width - 2));
+  }
+  LCD_BlitEnd();
 }
 
 /**
@@ -1462,6 +1672,8 @@ void LCD_FillPolyLine(pPoint Points, uint16_t PointCount)
   LCD_SetTextColor(TextColor);
 }
 
+#ifndef LCD_HOSTFB
+/* The bus access and the FSMC setup come from host/lcd_hostfb.c on a PC */
 /**
   * @brief  Writes to the selected LCD register.
   * @param  LCD_Reg: address of the selected register.
@@ -1522,6 +1734,7 @@ uint16_t LCD_ReadRAM(void)
   /* Read 16-bit Reg */
   return LCD->LCD_RAM;
 }
+#endif /* LCD_HOSTFB */
 
 /**
   * @brief  Power on the LCD.
@@ -1569,6 +1782,7 @@ void LCD_DisplayOff(void)
   LCD_WriteReg(LCD_REG_7, 0x0); 
 }
 
+#ifndef LCD_HOSTFB
 /**
   * @brief  Configures LCD Control lines (FSMC Pins) in alternate function mode.
   * @param  None
@@ -1705,6 +1919,7 @@ void LCD_FSMCConfig(void)
   /* BANK 4 (of NOR/SRAM Bank 1~4) is enabled */
   FSMC_NORSRAMCmd(FSMC_Bank1_NORSRAM4, ENABLE);
 }
+#endif /* LCD_HOSTFB */
 
 /**
   * @brief  Displays a pixel.
@@ -1721,6 +1936,112 @@ static void PutPixel(int16_t x, int16_t y)
   LCD_DrawLine(x, y, 1, LCD_DIR_HORIZONTAL);
 }
 
+/**
+  * @brief  Writes one pixel of the blit when the controller has no window
+  *         support here, the rectangle wraps like the GRAM window does.
+  * @param  Color: the pixel color in RGB 5-6-5.
+  * @retval None
+  */
+static void LCD_BlitPoint(uint16_t Color)
+{
+  LCD_SetPoint(Blit.Xpos + Blit.Row, Blit.Ypos + Blit.Col, Color);
+  if(Blit.Direction == LCD_DIR_HORIZONTAL)
+  {
+    if(++Blit.Col >= Blit.Width)
+    {
+      Blit.Col = 0;
+      if(++Blit.Row >= Blit.Height)
+      {
+        Blit.Row = 0;
+      }
+    }
+  }
+  else
+  {
+    if(++Blit.Row >= Blit.Height)
+    {
+      Blit.Row = 0;
+      if(++Blit.Col >= Blit.Width)
+      {
+        Blit.Col = 0;
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Waits for the end of the blit DMA transfer.
+  * @param  None
+  * @retval None
+  */
+static void LCD_BlitWait(void)
+{
+#if LCD_BLIT_DMA
+  if(BlitDMABusy)
+  {
+    while((DMA_GetFlagStatus(LCD_BLIT_DMA_STREAM, LCD_BLIT_DMA_FLAG_TCIF) == RESET) &&
+          (DMA_GetFlagStatus(LCD_BLIT_DMA_STREAM, LCD_BLIT_DMA_FLAG_TEIF) == RESET))
+    {
+    }
+    BlitDMABusy = 0;
+  }
+#endif
+}
+
+#if LCD_BLIT_DMA
+/**
+  * @brief  Starts the DMA2 transfer of pixels to the FSMC data port, memory to
+  *         memory mode: the peripheral side is the source, the memory side is
+  *         LCD_RAM. Only the last chunk (65535 pixels max) may run on return.
+  * @param  pSrc: pixels in RGB 5-6-5.
+  * @param  Num: number of pixels.
+  * @param  SrcInc: DMA_PeripheralInc_Enable, or DMA_PeripheralInc_Disable
+  *         to repeat *pSrc.
+  * @retval None
+  */
+static void LCD_BlitDMA(const uint16_t *pSrc, uint32_t Num, uint32_t SrcInc)
+{
+  DMA_InitTypeDef DMA_InitStructure;
+  uint32_t n;
+
+  RCC_AHB1PeriphClockCmd(LCD_BLIT_DMA_CLK, ENABLE);
+
+  DMA_InitStructure.DMA_Channel = LCD_BLIT_DMA_CHANNEL;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)&LCD->LCD_RAM;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToMemory;
+  DMA_InitStructure.DMA_PeripheralInc = SrcInc;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Disable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+  DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Enable; /* 内存到内存不能用直接方式 */
+  DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+  DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+  DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+
+  while(Num)
+  {
+    n = (Num > 0xFFFF) ? 0xFFFF : Num;
+    LCD_BlitWait();
+
+    DMA_DeInit(LCD_BLIT_DMA_STREAM);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)pSrc;
+    DMA_InitStructure.DMA_BufferSize = n;
+    DMA_Init(LCD_BLIT_DMA_STREAM, &DMA_InitStructure);
+    DMA_ClearFlag(LCD_BLIT_DMA_STREAM, LCD_BLIT_DMA_FLAG_ALL);
+    DMA_Cmd(LCD_BLIT_DMA_STREAM, ENABLE);
+    BlitDMABusy = 1;
+
+    Num -= n;
+    if(SrcInc == DMA_PeripheralInc_Enable)
+    {
+      pSrc += n;
+    }
+  }
+}
+#endif /* LCD_BLIT_DMA */
+
 
 #ifndef USE_Delay
 /**
@@ -287,6 +287,22 @@ typedef struct
 #define LCD_PIXEL_WIDTH          320
 #define LCD_PIXEL_HEIGHT         240
 
+/** 
+  * @brief  LCD blit: GRAM window + burst write, optionally by DMA2 (memory
+  *         to memory mode, destination the FSMC data port)
+  */
+#ifndef LCD_BLIT_DMA
+ #define LCD_BLIT_DMA            0      /* 1: 块写GRAM用DMA2 */
+#endif
+#define LCD_BLIT_DMA_MIN         32     /* 少于此点数用CPU写 */
+#define LCD_BLIT_DMA_CLK         RCC_AHB1Periph_DMA2
+#define LCD_BLIT_DMA_STREAM      DMA2_Stream0
+#define LCD_BLIT_DMA_CHANNEL     DMA_Channel_0
+#define LCD_BLIT_DMA_FLAG_TCIF   DMA_FLAG_TCIF0
+#define LCD_BLIT_DMA_FLAG_TEIF   DMA_FLAG_TEIF0
+#define LCD_BLIT_DMA_FLAG_ALL    (DMA_FLAG_FEIF0 | DMA_FLAG_DMEIF0 | DMA_FLAG_TEIF0 | \
+                                  DMA_FLAG_HTIF0 | DMA_FLAG_TCIF0)
+
 /**
   * @}
   */ 
@@ -322,6 +338,12 @@ sFONT *LCD_GetFont(void);
 void LCD_DisplayStringLine(uint16_t Line, uint8_t *ptr);
 void LCD_SetDisplayWindow(uint16_t Xpos, uint16_t Ypos, uint8_t Height, uint16_t Width);
 void LCD_WindowModeDisable(void);
+void LCD_BlitBegin(uint16_t Xpos, uint16_t Ypos, uint16_t Height, uint16_t Width, uint8_t Direction);
+void LCD_BlitWrite(const uint16_t *pPixel, uint32_t Num);
+void LCD_BlitFill(uint16_t Color, uint32_t Num);
+void LCD_BlitEnd(void);
+uint8_t LCD_BlitWindowed(void);
+void LCD_BlitRect(uint16_t Xpos, uint16_t Ypos, uint16_t Height, uint16_t Width, uint8_t Direction, const uint16_t *pPixel);
 void LCD_DrawLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length, uint8_t Direction);
 void LCD_DrawRect(uint16_t Xpos, uint16_t Ypos, uint8_t Height, uint16_t Width);
 void LCD_DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
@@ -35,6 +35,30 @@ DRESULT disk_write (BYTE, const BYTE*, DWORD, BYTE);
 DRESULT disk_ioctl (BYTE, BYTE, void*);
 
 
+/*---------------------------------------*/
+/* Storage backend of a physical drive   */
+/* (USB stick, SD card, image file)      */
+
+typedef struct {
+	DSTATUS (*initialize) (void);
+	DSTATUS (*status) (void);
+	DRESULT (*read) (BYTE*, DWORD, BYTE);
+#if	_READONLY == 0
+	DRESULT (*write) (const BYTE*, DWORD, BYTE);
+#endif
+#if	_USE_IOCTL != 0
+	DRESULT (*ioctl) (BYTE, void*);
+#endif
+} DISKIO_DRV;
+
+BOOL disk_attach (BYTE, const DISKIO_DRV*);
+
+/* Image file as a drive, option/diskimg.c (PC builds only) */
+BOOL diskimg_open (const char*);
+void diskimg_close (void);
+extern const DISKIO_DRV DiskImg_Drv;
+
+
 
 /* Disk Status Bits (DSTATUS) */
 
@@ -295,6 +295,42 @@ typedef char XCHAR;		/* SBCS, DBCS */
 
 
 
+/* Directory name index structure */
+
+#if _USE_DIRIDX
+typedef struct _DIRIDX_ {
+	DWORD	sclust;		/* Directory start cluster */
+	WORD	id;			/* File system mount ID when built (0:unused) */
+	WORD	num;		/* Number of indexed objects */
+	WORD	end;		/* Entry index after the indexed objects (0xFFFF:all indexed) */
+	WORD	nclst;		/* Number of clusters in clst[] */
+	DWORD	clst[_DIRIDX_CLST];	/* Cluster chain of the table (dynamic table only) */
+	struct {
+		WORD	idx;	/* Index of the first entry of the object (LFN or SFN) */
+		WORD	hs;		/* Hash of the SFN */
+		WORD	hl;		/* Hash of the up-cased LFN (hs if no LFN) */
+	} item[_DIRIDX_SIZE];
+} DIRIDX;
+#endif
+
+
+#if _USE_MNTCACHE
+typedef struct _MNTCACHE_ {
+	BYTE	fs_type;	/* FAT sub type of the volume (0:fill on next mount, 0xFF:volume changed, not used) */
+	DWORD	bsect;		/* Boot record sector (lba) */
+	DWORD	sum;		/* Check sum of the boot record (BPB and volume ID) */
+#if !_FS_READONLY
+	DWORD	last_clust;	/* FSInfo of the last sync */
+	DWORD	free_clust;
+#if _USE_FREEMAP
+	BYTE	fmap[_USE_FREEMAP];	/* Free cluster map of the last sync */
+#endif
+#endif
+} MNTCACHE;
+#endif
+
+
+
 /* File system object structure */
 
 typedef struct _FATFS_ {
@@ -316,6 +352,10 @@ typedef struct _FATFS_ {
 	DWORD	last_clust;	/* Last allocated cluster */
 	DWORD	free_clust;	/* Number of free clusters */
 	DWORD	fsi_sector;	/* fsinfo sector */
+#if _USE_FREEMAP
+	BYTE	fmap_shift;	/* Clusters in a group of the free cluster map (power of 2) */
+	BYTE	fmap[_USE_FREEMAP];	/* Free cluster map (1:no free cluster in the group) */
+#endif
 #endif
 #if _FS_RPATH
 	DWORD	cdir;		/* Current directory (0:root)*/
@@ -326,6 +366,13 @@ typedef struct _FATFS_ {
 	DWORD	dirbase;	/* Root directory start sector (Cluster# on FAT32) */
 	DWORD	database;	/* Data start sector */
 	DWORD	winsect;	/* Current sector appearing in the win[] */
+#if _USE_MNTCACHE
+	MNTCACHE*	mnt;	/* Pointer to the mount cache of the medium (null:none), set after f_mount */
+#endif
+#if _USE_DIRIDX
+	DIRIDX*	didx;		/* Pointer to _USE_DIRIDX name indexes of the last used directories (null:none), set after f_mount */
+	BYTE	didx_next;	/* didx[] to be replaced next */
+#endif
 	BYTE	win[_MAX_SS];/* Disk access window for Directory/FAT */
 } FATFS;
 
@@ -366,6 +413,12 @@ typedef struct _FIL_ {
 	DWORD	dir_sect;	/* Sector containing the directory entry */
 	BYTE*	dir_ptr;	/* Pointer to the directory entry in the window */
 #endif
+#if _USE_FASTSEEK
+	DWORD*	cltbl;		/* Pointer to the cluster link map table (null on file open) */
+#endif
+#if _USE_PREALLOC
+	DWORD	pre_clust;	/* Last cluster of the preallocated run, org_clust is the first (0:none) */
+#endif
 #if !_FS_TINY
 	BYTE	buf[_MAX_SS];/* File R/W buffer */
 #endif
@@ -407,7 +460,8 @@ typedef enum {
 	FR_NOT_ENABLED,		/* 12 */
 	FR_NO_FILESYSTEM,	/* 13 */
 	FR_MKFS_ABORTED,	/* 14 */
-	FR_TIMEOUT			/* 15 */
+	FR_TIMEOUT,			/* 15 */
+	FR_NOT_ENOUGH_CORE	/* 16 */
 } FRESULT;
 
 
@@ -426,6 +480,7 @@ FRESULT f_readdir (DIR*, FILINFO*);					/* Read a directory item */
 FRESULT f_stat (const XCHAR*, FILINFO*);			/* Get file status */
 FRESULT f_getfree (const XCHAR*, DWORD*, FATFS**);	/* Get number of free clusters on the drive */
 FRESULT f_truncate (FIL*);							/* Truncate file */
+FRESULT f_prealloc (FIL*, DWORD);					/* Preallocate contiguous clusters to an empty file */
 FRESULT f_sync (FIL*);								/* Flush cached data of a writing file */
 FRESULT f_unlink (const XCHAR*);					/* Delete an existing file or directory */
 FRESULT	f_mkdir (const XCHAR*);						/* Create a new directory */
@@ -472,6 +527,7 @@ BOOL ff_cre_syncobj(BYTE, _SYNC_t*);
 BOOL ff_del_syncobj(_SYNC_t);
 BOOL ff_req_grant(_SYNC_t);
 void ff_rel_grant(_SYNC_t);
+extern BOOL (*ff_grant_hook)(void);	/* Called while waiting for a grant, see option/syncobj.c */
 #endif
 
 
@@ -495,6 +551,11 @@ void ff_rel_grant(_SYNC_t);
 #define FA__ERROR			0x80
 
 
+/* Fast seek: f_lseek offset to build the cluster link map table (FIL.cltbl) */
+
+#define CREATE_LINKMAP		0xFFFFFFFF
+
+
 /* FAT sub type (FATFS.fs_type) */
 
 #define FS_FAT12	1
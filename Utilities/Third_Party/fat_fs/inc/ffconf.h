@@ -48,6 +48,41 @@
 /* To enable f_forward function, set _USE_FORWARD to 1 and set _FS_TINY to 1. */
 
 
+#define	_USE_FASTSEEK	1	/* 0 or 1 */
+/* To enable fast seek feature, set _USE_FASTSEEK to 1. When FIL.cltbl points
+/  a cluster link map table, f_lseek(fp, CREATE_LINKMAP) fills it and later
+/  seeks and cluster changes of f_read/f_write use it without FAT access. */
+
+
+#define	_USE_PREALLOC	1	/* 0 or 1 */
+/* To enable f_prealloc function, set _USE_PREALLOC to 1. It reserves a
+/  contiguous cluster run for an empty file, f_write then streams into the run
+/  with multi-sector writes across cluster boundaries and no FAT access.
+/  The unused part of the run is released by f_close. */
+
+
+#ifndef _USE_FREEMAP	/* PC benches build it both ways */
+#define	_USE_FREEMAP	512	/* 0:Disable or size of the free cluster map in bytes */
+#endif
+/* The _USE_FREEMAP option keeps a map in the file system object with one bit
+/  for each group of clusters, set when no cluster of the group is free. The
+/  map is learned from the FAT scans of the cluster allocation and f_getfree,
+/  later allocations skip the groups known to be full without reading their
+/  FAT sectors. A freed cluster clears the bit of its group. The group size is
+/  chosen on mount, 512 bytes cover a 32GB volume of 32KB clusters at 256
+/  clusters (two FAT32 sectors) a bit. */
+
+
+#define	_USE_MNTCACHE	1	/* 0 or 1 */
+/* To enable the mount cache, set _USE_MNTCACHE to 1. When FATFS.mnt points a
+/  MNTCACHE kept by the disk layer for the medium, the mount compares the boot
+/  record with the one of the last mount (sector and check sum). On the same
+/  FAT32 volume the free cluster map of the last sync is restored when the
+/  FSInfo on the disk still holds what was written then, so no other host has
+/  changed the FAT meanwhile. A changed volume is mounted as usual and the
+/  cache is not used for it any more. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Locale and Namespace Configurations
@@ -86,8 +121,8 @@
 */
 
 
-#define	_USE_LFN	0	/* 0, 1 or 2 */
-#define	_MAX_LFN	255		/* Maximum LFN length to handle (12 to 255) */
+#define	_USE_LFN	2	/* 0, 1 or 2 */
+#define	_MAX_LFN	128		/* Maximum LFN length to handle (12 to 255) */
 /* The _USE_LFN option switches the LFN support.
 /
 /   0: Disable LFN. _MAX_LFN and _LFN_UNICODE have no effect.
@@ -111,6 +146,26 @@
 /  Note that output of the f_readdir function is affected by this option. */
 
 
+#ifndef _USE_DIRIDX	/* PC benches build it both ways */
+#define	_USE_DIRIDX		2	/* 0:Disable or number of directories indexed per volume */
+#endif
+#define	_DIRIDX_SIZE	512	/* Number of objects in the index of a directory */
+#define	_DIRIDX_CLST	16	/* Number of clusters of a directory kept with its index */
+/* The _USE_DIRIDX option keeps a name index of the last used directories of a
+/  volume. The indexes are given by the application: point FATFS.didx at an
+/  array of _USE_DIRIDX DIRIDX after f_mount. A volume without it (null) is
+/  searched as before and takes no memory for the index.
+/  The index holds the hashes of the SFN and LFN of each object and is built by
+/  one scan of the directory on its first look up, then a look up reads only
+/  the entries of the objects with the same hash. The first clusters of the
+/  table are kept with the index so that the entry is reached without
+/  following the FAT chain.
+/  The index of a directory is dropped when an object is created or removed
+/  in it. An index holds up to _DIRIDX_SIZE objects, the objects after them in
+/  a larger directory are searched as before, from the end of the index. Each
+/  index takes _DIRIDX_SIZE * 6 + _DIRIDX_CLST * 4 + 12 bytes. */
+
+
 
 /*---------------------------------------------------------------------------/
 / Physical Drive Configurations
@@ -152,9 +207,13 @@
 /  performance and code size. */
 
 
-#define _FS_REENTRANT	0		/* 0 or 1 */
+#ifdef FATFS_HOST
+#define _FS_REENTRANT	0		/* No RTOS when built on a PC (option/diskimg.c) */
+#else
+#define _FS_REENTRANT	1		/* 0 or 1 */
+#endif
 #define _FS_TIMEOUT		1000	/* Timeout period in unit of time ticks */
-#define	_SYNC_t			HANDLE	/* O/S dependent type of sync object. e.g. HANDLE, OS_EVENT*, ID and etc.. */
+#define	_SYNC_t			OS_EVENT*	/* O/S dependent type of sync object. e.g. HANDLE, OS_EVENT*, ID and etc.. */
 /* The _FS_REENTRANT option switches the reentrancy of the FatFs module.
 /
 /   0: Disable reentrancy. _SYNC_t and _FS_TIMEOUT have no effect.
@@ -162,5 +221,9 @@
 /      ff_req_grant, ff_rel_grant, ff_del_syncobj and ff_cre_syncobj
 /      function must be added to the project. */
 
+#if _FS_REENTRANT
+#include "ucos_ii.h"	/* uC/OS-II semaphores, option/syncobj.c */
+#endif
+
 
 #endif /* _FFCONFIG */
@@ -8,7 +8,9 @@
 #include <windows.h>
 #else
 
+#ifndef FATFS_HOST		/* FatFs built on a PC with option/diskimg.c */
 #include "usb_conf.h"
+#endif
 
 /* These types must be 16-bit, 32-bit or larger integer */
 typedef int				INT;
@@ -4,32 +4,42 @@
 /* This is a stub disk I/O module that acts as front end of the existing */
 /* disk I/O modules and attach it to FatFs module with common interface. */
 /*-----------------------------------------------------------------------*/
+/* Each physical drive is served by the backend attached with            */
+/* disk_attach: drive 0 the USB stick (usbh_msc_fatfs.c), drive 1 the SD */
+/* card (sd_diskio.c), an image file on the PC (option/diskimg.c).       */
+/*-----------------------------------------------------------------------*/
 
+#include "ff.h"
 #include "diskio.h"
 
+static const DISKIO_DRV *Drv[_DRIVES];	/* Backend of each physical drive */
+
+
+
 /*-----------------------------------------------------------------------*/
-/* Correspondence between physical drive number and physical drive.      */
+/* Attach a Backend to a Drive (0: detach)                               */
 
-#define ATA		0
-#define MMC		1
-#define USB		2
+BOOL disk_attach (
+	BYTE drv,				/* Physical drive nmuber (0..) */
+	const DISKIO_DRV *dev	/* Backend of the drive */
+)
+{
+	if (drv >= _DRIVES) return FALSE;
+	Drv[drv] = dev;
+	return TRUE;
+}
 
 
 
 /*-----------------------------------------------------------------------*/
 /* Inicializes a Drive                                                    */
 
-DSTATUS disk_initialize (BYTE drv)    /* Physical drive nmuber (0..) */
+DSTATUS disk_initialize (
+	BYTE drv		/* Physical drive nmuber (0..) */
+)
 {
-  DSTATUS stat = STA_NOINIT;
-  
-  if(HCD_IsDeviceConnected(&USB_OTG_Core_dev))
-  {  
-    stat &= ~STA_NOINIT;
-  }
-  
-  return stat;
-  
+	if (drv >= _DRIVES || !Drv[drv]) return STA_NOINIT | STA_NODISK;
+	return Drv[drv]->initialize();
 }
 
 
@@ -41,29 +51,8 @@ DSTATUS disk_status (
 	BYTE drv		/* Physical drive nmuber (0..) */
 )
 {
-	DSTATUS stat;
-	int result;
-
-	switch (drv) {
-	case ATA :
-		result = ATA_disk_status();
-		// translate the reslut code here
-
-		return stat;
-
-	case MMC :
-		result = MMC_disk_status();
-		// translate the reslut code here
-
-		return stat;
-
-	case USB :
-		result = USB_disk_status();
-		// translate the reslut code here
-
-		return stat;
-	}
-	return STA_NOINIT;
+	if (drv >= _DRIVES || !Drv[drv]) return STA_NOINIT | STA_NODISK;
+	return Drv[drv]->status();
 }
 
 
@@ -78,29 +67,9 @@ DRESULT disk_read (
 	BYTE count		/* Number of sectors to read (1..255) */
 )
 {
-	DRESULT res;
-	int result;
-
-	switch (drv) {
-	case ATA :
-		result = ATA_disk_read(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-
-	case MMC :
-		result = MMC_disk_read(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-
-	case USB :
-		result = USB_disk_read(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-	}
-	return RES_PARERR;
+	if (drv >= _DRIVES || !count) return RES_PARERR;
+	if (!Drv[drv]) return RES_NOTRDY;
+	return Drv[drv]->read(buff, sector, count);
 }
 
 
@@ -116,29 +85,9 @@ DRESULT disk_write (
 	BYTE count			/* Number of sectors to write (1..255) */
 )
 {
-	DRESULT res;
-	int result;
-
-	switch (drv) {
-	case ATA :
-		result = ATA_disk_write(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-
-	case MMC :
-		result = MMC_disk_write(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-
-	case USB :
-		result = USB_disk_write(buff, sector, count);
-		// translate the reslut code here
-
-		return res;
-	}
-	return RES_PARERR;
+	if (drv >= _DRIVES || !count) return RES_PARERR;
+	if (!Drv[drv]) return RES_NOTRDY;
+	return Drv[drv]->write(buff, sector, count);
 }
 #endif /* _READONLY */
 
@@ -147,40 +96,15 @@ DRESULT disk_write (
 /*-----------------------------------------------------------------------*/
 /* Miscellaneous Functions                                               */
 
+#if _USE_IOCTL != 0
 DRESULT disk_ioctl (
 	BYTE drv,		/* Physical drive nmuber (0..) */
 	BYTE ctrl,		/* Control code */
 	void *buff		/* Buffer to send/receive control data */
 )
 {
-	DRESULT res;
-	int result;
-
-	switch (drv) {
-	case ATA :
-		// pre-process here
-
-		result = ATA_disk_ioctl(ctrl, buff);
-		// post-process here
-
-		return res;
-
-	case MMC :
-		// pre-process here
-
-		result = MMC_disk_ioctl(ctrl, buff);
-		// post-process here
-
-		return res;
-
-	case USB :
-		// pre-process here
-
-		result = USB_disk_ioctl(ctrl, buff);
-		// post-process here
-
-		return res;
-	}
-	return RES_PARERR;
+	if (drv >= _DRIVES) return RES_PARERR;
+	if (!Drv[drv]) return RES_NOTRDY;
+	return Drv[drv]->ioctl(ctrl, buff);
 }
-
+#endif /* _USE_IOCTL */
@@ -303,6 +303,15 @@ FRESULT sync (	/* FR_OK: successful, FR_DISK_ERR: failed */
 			ST_DWORD(fs->win+FSI_Nxt_Free, fs->last_clust);
 			disk_write(fs->drive, fs->win, fs->fsi_sector, 1);
 			fs->fsi_flag = 0;
+#if _USE_MNTCACHE
+			if (fs->mnt && fs->mnt->fs_type == fs->fs_type) {	/* Keep what the FSInfo says now */
+				fs->mnt->last_clust = fs->last_clust;
+				fs->mnt->free_clust = fs->free_clust;
+#if _USE_FREEMAP
+				mem_cpy(fs->mnt->fmap, fs->fmap, _USE_FREEMAP);
+#endif
+			}
+#endif
 		}
 		/* Make sure that no pending write process in the physical drive */
 		if (disk_ioctl(fs->drive, CTRL_SYNC, (void*)NULL) != RES_OK)
@@ -358,6 +367,41 @@ DWORD get_fat (	/* 0xFFFFFFFF:Disk error, 1:Internal error, Else:Cluster status
 
 
 
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Free cluster map                                       */
+/*-----------------------------------------------------------------------*/
+#if !_FS_READONLY && _USE_FREEMAP
+#define FMAP_MASK(fs)	(((DWORD)1 << (fs)->fmap_shift) - 1)	/* Cluster# offset in a group */
+
+static
+BOOL fmap_full (	/* TRUE: No free cluster in the group */
+	FATFS *fs,		/* File system object */
+	DWORD clst		/* A cluster# in the group */
+)
+{
+	clst >>= fs->fmap_shift;
+	return (fs->fmap[clst / 8] & (1 << (clst % 8))) ? TRUE : FALSE;
+}
+
+
+static
+void fmap_mark (
+	FATFS *fs,		/* File system object */
+	DWORD clst,		/* A cluster# in the group */
+	BOOL full		/* TRUE: No free cluster in the group, FALSE: May have */
+)
+{
+	clst >>= fs->fmap_shift;
+	if (full)
+		fs->fmap[clst / 8] |= 1 << (clst % 8);
+	else
+		fs->fmap[clst / 8] &= ~(1 << (clst % 8));
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* FAT access - Change value of a FAT entry                              */
 /*-----------------------------------------------------------------------*/
@@ -411,6 +455,9 @@ FRESULT put_fat (
 			res = FR_INT_ERR;
 		}
 		fs->wflag = 1;
+#if _USE_FREEMAP
+		if (val == 0) fmap_mark(fs, clst, 0);	/* The group has a free cluster now */
+#endif
 	}
 
 	return res;
@@ -472,6 +519,9 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 )
 {
 	DWORD cs, ncl, scl, mcl;
+#if _USE_FREEMAP
+	BOOL whole;
+#endif
 
 
 	mcl = fs->max_clust;
@@ -487,17 +537,35 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 	}
 
 	ncl = scl;				/* Start cluster */
+#if _USE_FREEMAP
+	whole = FALSE;
+#endif
 	for (;;) {
 		ncl++;							/* Next cluster */
 		if (ncl >= mcl) {				/* Wrap around */
 			ncl = 2;
 			if (ncl > scl) return 0;	/* No free cluster */
 		}
+#if _USE_FREEMAP
+		if (ncl == 2 || !(ncl & FMAP_MASK(fs)))	/* Entering a group from its top */
+			whole = TRUE;
+		if (fmap_full(fs, ncl)) {		/* Skip the rest of a group known to be full */
+			cs = ncl | FMAP_MASK(fs);		/* Last cluster of the group */
+			if (cs >= mcl) cs = mcl - 1;
+			if (scl >= ncl && scl <= cs) return 0;	/* No free cluster */
+			ncl = cs; whole = FALSE;
+			continue;
+		}
+#endif
 		cs = get_fat(fs, ncl);			/* Get the cluster status */
 		if (cs == 0) break;				/* Found a free cluster */
 		if (cs == 0xFFFFFFFF || cs == 1)/* An error occurred */
 			return cs;
 		if (ncl == scl) return 0;		/* No free cluster */
+#if _USE_FREEMAP
+		if (whole && ((ncl & FMAP_MASK(fs)) == FMAP_MASK(fs) || ncl == mcl - 1))
+			fmap_mark(fs, ncl, TRUE);	/* Scanned a whole group without a free cluster */
+#endif
 	}
 
 	if (put_fat(fs, ncl, 0x0FFFFFFF))	/* Mark the new cluster "in use" */
@@ -507,11 +575,10 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 			return 0xFFFFFFFF;
 	}
 
-	fs->last_clust = ncl;				/* Update FSINFO */
-	if (fs->free_clust != 0xFFFFFFFF) {
+	fs->last_clust = ncl;				/* Update FSINFO, the start point is kept */
+	if (fs->free_clust != 0xFFFFFFFF)	/* even when the free count is unknown */
 		fs->free_clust--;
-		fs->fsi_flag = 1;
-	}
+	fs->fsi_flag = 1;
 
 	return ncl;		/* Return new cluster number */
 }
@@ -538,6 +605,35 @@ DWORD clust2sect (	/* !=0: Sector number, 0: Failed - invalid cluster# */
 
 
 
+#if _USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Fast seek - Get cluster# of the file offset from the link map table   */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD clmt_clust (	/* 0: Offset is out of the table, Else: Cluster# */
+	FIL *fp,		/* Pointer to the file object */
+	DWORD ofs		/* File offset in unit of byte */
+)
+{
+	DWORD cl, ncl, *tbl;
+
+
+	tbl = fp->cltbl + 1;	/* Top of the fragment runs {length, start cluster} */
+	cl = ofs / SS(fp->fs) / fp->fs->csize;	/* Cluster order from top of the file */
+	for (;;) {
+		ncl = *tbl++;		/* Number of clusters in the fragment */
+		if (!ncl) return 0;	/* End of table? (error) */
+		if (cl < ncl) break;	/* In this fragment? */
+		cl -= ncl; tbl++;	/* Next fragment */
+	}
+	return cl + *tbl;
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Seek directory index                             */
 /*-----------------------------------------------------------------------*/
@@ -823,13 +919,202 @@ BYTE sum_sfn (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Directory name index - Hash of a name, drop/get the index of a dir    */
+/*-----------------------------------------------------------------------*/
+#if _USE_DIRIDX
+static
+WORD hash_sfn (
+	const BYTE *dir		/* Ptr to the SFN {file[8],ext[3]} */
+)
+{
+	WORD h = 0;
+	int n = 11;
+
+	do h = h * 31 + *dir++; while (--n);
+	return h;
+}
+
+
+#if _USE_LFN
+static
+WORD hash_lfn_chr (		/* Share of a character, the LFN is hashed in any entry order */
+	WORD pos,			/* Position of the character in the LFN */
+	WCHAR wc			/* Character */
+)
+{
+	DWORD x;
+
+
+	x = ((DWORD)ff_wtoupper(wc) << 8 | pos) * 0x9E3779B1;
+	x ^= x >> 15;
+	x *= 0x2C1B3C6D;
+	return (WORD)((x ^ (x >> 12)) >> 8);
+}
+#endif
+
+
+static
+DWORD diridx_key (		/* Start cluster of the directory, root of FAT32 as its cluster */
+	FATFS *fs,
+	DWORD sclust
+)
+{
+	if (!sclust && fs->fs_type == FS_FAT32) sclust = fs->dirbase;
+	return sclust;
+}
+
+
+#if !_FS_READONLY
+static
+void diridx_drop (		/* The entries of the directory have been changed */
+	FATFS *fs,
+	DWORD sclust		/* Start cluster of the directory */
+)
+{
+	int i;
+
+
+	if (!fs->didx) return;
+	sclust = diridx_key(fs, sclust);
+	for (i = 0; i < _USE_DIRIDX; i++) {
+		if (fs->didx[i].sclust == sclust) fs->didx[i].id = 0;
+	}
+}
+#endif
+
+
+static
+DIRIDX* diridx_get (	/* Index of the directory, built on its first access (NULL: disk error) */
+	DIR *dj
+)
+{
+	FRESULT res;
+	FATFS *fs = dj->fs;
+	DIRIDX *ix;
+	DWORD key;
+	BYTE c, *dir;
+	WORD start;
+	int i;
+#if _USE_LFN
+	BYTE a, ord = 0xFF, sum = 0xFF;
+	WORD hl = 0;
+#endif
+
+
+	key = diridx_key(fs, dj->sclust);
+	for (i = 0; i < _USE_DIRIDX; i++) {
+		ix = &fs->didx[i];
+		if (ix->id == fs->id && ix->sclust == key) {
+			fs->didx_next = (BYTE)((i + 1) % _USE_DIRIDX);	/* Replace the other one next time */
+			return ix;
+		}
+	}
+
+	ix = &fs->didx[fs->didx_next];		/* Build the index in place of the oldest one */
+	fs->didx_next = (BYTE)((fs->didx_next + 1) % _USE_DIRIDX);
+	ix->id = 0;
+	ix->sclust = key;
+	ix->num = 0;
+	ix->end = 0xFFFF;
+	ix->nclst = 0;
+
+	res = dir_seek(dj, 0);
+	start = 0;
+	while (res == FR_OK) {
+		if (dj->clust && (!ix->nclst || ix->clst[ix->nclst - 1] != dj->clust)
+			&& ix->nclst < _DIRIDX_CLST)
+			ix->clst[ix->nclst++] = dj->clust;	/* Cluster chain of the table */
+		res = move_window(fs, dj->sect);
+		if (res != FR_OK) break;
+		dir = dj->dir;
+		c = dir[DIR_Name];
+		if (c == 0) { res = FR_NO_FILE; break; }	/* Reached to end of table */
+#if _USE_LFN
+		a = dir[DIR_Attr] & AM_MASK;
+		if (c == 0xE5 || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+			ord = 0xFF;
+		} else if (a == AM_LFN) {		/* Hash the LFN sequence */
+			if (c & 0x40) {
+				sum = dir[LDIR_Chksum];
+				c &= 0xBF; ord = c;
+				start = dj->index; hl = 0;
+			}
+			if (c == ord && sum == dir[LDIR_Chksum]) {
+				WORD pos = (WORD)((c & 0x3F) - 1) * 13;
+				WCHAR wc;
+				for (i = 0; i < 13; i++, pos++) {
+					wc = LD_WORD(dir+LfnOfs[i]);
+					if (!wc) break;
+					hl += hash_lfn_chr(pos, wc);
+				}
+				ord--;
+			} else {
+				ord = 0xFF;
+			}
+		} else {						/* An SFN entry ends the object */
+			if (ord || sum != sum_sfn(dir)) {	/* No valid LFN */
+				start = dj->index;
+				hl = hash_sfn(dir);
+			}
+			if (ix->num == _DIRIDX_SIZE) { ix->end = start; res = FR_NO_FILE; break; }
+			ix->item[ix->num].idx = start;
+			ix->item[ix->num].hs = hash_sfn(dir);
+			ix->item[ix->num].hl = hl;
+			ix->num++;
+			ord = 0xFF;
+		}
+#else
+		if (c != 0xE5 && !(dir[DIR_Attr] & AM_VOL)) {
+			if (ix->num == _DIRIDX_SIZE) { ix->end = dj->index; res = FR_NO_FILE; break; }
+			ix->item[ix->num].idx = dj->index;
+			ix->item[ix->num].hs = hash_sfn(dir);
+			ix->num++;
+		}
+#endif
+		res = dir_next(dj, FALSE);
+	}
+	if (res != FR_NO_FILE) return NULL;
+
+	ix->id = fs->id;
+	return ix;
+}
+
+
+static
+FRESULT diridx_seek (	/* dir_seek without following the cluster chain */
+	DIR *dj,
+	DIRIDX *ix,
+	WORD idx			/* Directory index number */
+)
+{
+	WORD ic, n;
+
+
+	ic = SS(dj->fs) / 32 * dj->fs->csize;	/* Entries per cluster */
+	n = idx / ic;
+	if (!ix->sclust || n >= ix->nclst)		/* Static table or beyond the cluster table */
+		return dir_seek(dj, idx);
+
+	dj->index = idx;
+	dj->clust = ix->clst[n];
+	dj->sect = clust2sect(dj->fs, dj->clust) + (idx % ic) / (SS(dj->fs) / 32);
+	dj->dir = dj->fs->win + (idx % (SS(dj->fs) / 32)) * 32;
+	return FR_OK;
+}
+#endif /* _USE_DIRIDX */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Directory handling - Find an object in the directory                  */
 /*-----------------------------------------------------------------------*/
 
 static
-FRESULT dir_find (
-	DIR *dj			/* Pointer to the directory object linked to the file name */
+FRESULT dir_match (
+	DIR *dj,		/* Pointer to the directory object linked to the file name, at the entry to start with */
+	BOOL one		/* TRUE: Check only the object starting at the entry */
 )
 {
 	FRESULT res;
@@ -838,9 +1123,6 @@ FRESULT dir_find (
 	BYTE a, ord, sum;
 #endif
 
-	res = dir_seek(dj, 0);			/* Rewind directory object */
-	if (res != FR_OK) return res;
-
 #if _USE_LFN
 	ord = sum = 0xFF;
 #endif
@@ -854,6 +1136,7 @@ FRESULT dir_find (
 		a = dir[DIR_Attr] & AM_MASK;
 		if (c == 0xE5 || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
 			ord = 0xFF;
+			if (one) { res = FR_NO_FILE; break; }
 		} else {
 			if (a == AM_LFN) {			/* An LFN entry is found */
 				if (dj->lfn) {
@@ -869,11 +1152,13 @@ FRESULT dir_find (
 				if (!ord && sum == sum_sfn(dir)) break;	/* LFN matched? */
 				ord = 0xFF; dj->lfn_idx = 0xFFFF;	/* Reset LFN sequence */
 				if (!(dj->fn[NS] & NS_LOSS) && !mem_cmp(dir, dj->fn, 11)) break;	/* SFN matched? */
+				if (one) { res = FR_NO_FILE; break; }
 			}
 		}
 #else		/* Non LFN configuration */
 		if (!(dir[DIR_Attr] & AM_VOL) && !mem_cmp(dir, dj->fn, 11)) /* Is it a valid entry? */
 			break;
+		if (one) { res = FR_NO_FILE; break; }
 #endif
 		res = dir_next(dj, FALSE);		/* Next entry */
 	} while (res == FR_OK);
@@ -882,6 +1167,52 @@ FRESULT dir_find (
 }
 
 
+static
+FRESULT dir_find (
+	DIR *dj			/* Pointer to the directory object linked to the file name */
+)
+{
+#if _USE_DIRIDX
+	FRESULT res;
+	DIRIDX *ix;
+	WORD i, hs = 0, hl = 0;
+	BOOL bs, bl = FALSE;
+
+
+	if (!dj->fs->didx) {
+		res = dir_seek(dj, 0);			/* No index on this volume */
+	} else {
+		ix = diridx_get(dj);
+		if (!ix) return FR_DISK_ERR;
+
+		bs = !(dj->fn[NS] & NS_LOSS);		/* Can match by the SFN */
+		if (bs) hs = hash_sfn(dj->fn);
+#if _USE_LFN
+		if (dj->lfn) {						/* Can match by the LFN */
+			bl = TRUE;
+			for (i = 0; dj->lfn[i]; i++) hl += hash_lfn_chr(i, dj->lfn[i]);
+		}
+#endif
+		for (i = 0; i < ix->num; i++) {		/* Check the objects with the same hash */
+			if ((bs && ix->item[i].hs == hs) || (bl && ix->item[i].hl == hl)) {
+				res = diridx_seek(dj, ix, ix->item[i].idx);
+				if (res == FR_OK) res = dir_match(dj, TRUE);
+				if (res != FR_NO_FILE) return res;
+			}
+		}
+		if (ix->end == 0xFFFF) return FR_NO_FILE;
+		res = diridx_seek(dj, ix, ix->end);		/* Objects beyond the index */
+	}
+#else
+	FRESULT res;
+
+	res = dir_seek(dj, 0);			/* Rewind directory object */
+#endif
+	if (res != FR_OK) return res;
+	return dir_match(dj, FALSE);
+}
+
+
 
 
 /*-----------------------------------------------------------------------*/
@@ -1037,6 +1368,9 @@ FRESULT dir_register (	/* FR_OK:Successful, FR_DENIED:No free entry or too many
 			dj->fs->wflag = 1;
 		}
 	}
+#if _USE_DIRIDX
+	diridx_drop(dj->fs, dj->sclust);
+#endif
 
 	return res;
 }
@@ -1082,6 +1416,9 @@ FRESULT dir_remove (	/* FR_OK: Successful, FR_DISK_ERR: A disk error */
 		}
 	}
 #endif
+#if _USE_DIRIDX
+	diridx_drop(dj->fs, dj->sclust);
+#endif
 
 	return res;
 }
@@ -1455,6 +1792,28 @@ BYTE check_fs (	/* 0:The FAT boot record, 1:Valid boot record but not an FAT, 2:
 
 
 
+#if _USE_MNTCACHE
+/*-----------------------------------------------------------------------*/
+/* Check sum of the boot record to recognize the volume on next mount    */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD mnt_sum (
+	const BYTE *bs		/* Boot record in the window */
+)
+{
+	DWORD sum = 0;
+	UINT i;
+
+
+	for (i = BPB_BytsPerSec; i < BS_FilSysType32 + 8; i++)	/* BPB, volume ID and label of FAT12/16/32 */
+		sum = ((sum & 1) ? 0x80000000 : 0) + (sum >> 1) + bs[i];
+	return sum;
+}
+#endif
+
+
+
 
 /*-----------------------------------------------------------------------*/
 /* Make sure that the file system is valid                               */
@@ -1473,6 +1832,10 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	DWORD bsect, fsize, tsect, mclst;
 	const XCHAR *p = *path;
 	FATFS *fs;
+#if _USE_MNTCACHE
+	MNTCACHE *mc;
+	DWORD sum = 0;
+#endif
 
 	/* Get logical drive number from the path name */
 	vol = p[0] - '0';				/* Is there a drive number? */
@@ -1533,6 +1896,14 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	if (fmt == 3) return FR_DISK_ERR;
 	if (fmt || LD_WORD(fs->win+BPB_BytsPerSec) != SS(fs))	/* No valid FAT partition is found */
 		return FR_NO_FILESYSTEM;
+#if _USE_MNTCACHE
+	mc = fs->mnt;
+	if (mc) {
+		sum = mnt_sum(fs->win);
+		if (mc->fs_type && (mc->bsect != bsect || mc->sum != sum))
+			mc->fs_type = 0xFF;			/* Not the volume of the last mount */
+	}
+#endif
 
 	/* Initialize the file system object */
 	fsize = LD_WORD(fs->win+BPB_FATSz16);				/* Number of sectors per FAT */
@@ -1563,6 +1934,11 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Initialize allocation information */
 	fs->free_clust = 0xFFFFFFFF;
 	fs->wflag = 0;
+#if _USE_FREEMAP
+	/* Group the clusters so that the map covers the volume, nothing is known full yet */
+	for (fs->fmap_shift = 0; ((mclst - 1) >> fs->fmap_shift) >= _USE_FREEMAP * 8; fs->fmap_shift++) ;
+	mem_set(fs->fmap, 0, _USE_FREEMAP);
+#endif
 	/* Get fsinfo if needed */
 	if (fmt == FS_FAT32) {
 	 	fs->fsi_flag = 0;
@@ -1582,6 +1958,32 @@ FRESULT chk_mounted (	/* FR_OK(0): successful, !=0: any error occurred */
 	fs->cdir = 0;			/* Current directory (root dir) */
 #endif
 	fs->id = ++Fsid;		/* File system mount ID */
+#if _USE_MNTCACHE
+	if (mc && mc->fs_type == fmt) {		/* Same boot record as the last mount */
+#if !_FS_READONLY && _USE_FREEMAP
+		/* FSInfo is as the last sync left it, nobody else has allocated or freed clusters */
+		if (fmt == FS_FAT32 && fs->free_clust == mc->free_clust && fs->last_clust == mc->last_clust)
+			mem_cpy(fs->fmap, mc->fmap, _USE_FREEMAP);
+#endif
+	}
+	if (mc && !mc->fs_type) {			/* Keep the volume for the next mount */
+		mc->fs_type = fmt;
+		mc->bsect = bsect;
+		mc->sum = sum;
+#if !_FS_READONLY
+		mc->last_clust = fs->last_clust;
+		mc->free_clust = fs->free_clust;
+#if _USE_FREEMAP
+		mem_set(mc->fmap, 0, _USE_FREEMAP);
+#endif
+#endif
+	}
+#endif
+#if _USE_DIRIDX
+	if (fs->didx)
+		for (vol = 0; vol < _USE_DIRIDX; vol++) fs->didx[vol].id = 0;	/* Forget the indexes of the old volume */
+	fs->didx_next = 0;
+#endif
 
 	return FR_OK;
 }
@@ -1748,6 +2150,12 @@ FRESULT f_open (
 	fp->fsize = LD_DWORD(dir+DIR_FileSize);	/* File size */
 	fp->fptr = 0; fp->csect = 255;		/* File pointer */
 	fp->dsect = 0;
+#if _USE_FASTSEEK
+	fp->cltbl = 0;						/* Normal seek mode */
+#endif
+#if _USE_PREALLOC
+	fp->pre_clust = 0;					/* No preallocated run */
+#endif
 	fp->fs = dj.fs; fp->id = dj.fs->id;	/* Owner file system object of the file */
 
 	LEAVE_FF(dj.fs, FR_OK);
@@ -1788,8 +2196,16 @@ FRESULT f_read (
 		rbuff += rcnt, fp->fptr += rcnt, *br += rcnt, btr -= rcnt) {
 		if ((fp->fptr % SS(fp->fs)) == 0) {			/* On the sector boundary? */
 			if (fp->csect >= fp->fs->csize) {		/* On the cluster boundary? */
-				clst = (fp->fptr == 0) ?			/* On the top of the file? */
-					fp->org_clust : get_fat(fp->fs, fp->curr_clust);
+				if (fp->fptr == 0) {				/* On the top of the file? */
+					clst = fp->org_clust;
+				} else {
+#if _USE_FASTSEEK
+					if (fp->cltbl)
+						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the link map table */
+					else
+#endif
+					clst = get_fat(fp->fs, fp->curr_clust);
+				}
 				if (clst <= 1) ABORT(fp->fs, FR_INT_ERR);
 				if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
 				fp->curr_clust = clst;				/* Update current cluster */
@@ -1887,6 +2303,16 @@ FRESULT f_write (
 					if (clst == 0)					/* When there is no cluster chain, */
 						fp->org_clust = clst = create_chain(fp->fs, 0);	/* Create a new cluster chain */
 				} else {							/* Middle or end of the file */
+#if _USE_PREALLOC
+					if (fp->curr_clust >= fp->org_clust && fp->curr_clust < fp->pre_clust)
+						clst = fp->curr_clust + 1;	/* Next cluster of the preallocated run */
+					else
+#endif
+#if _USE_FASTSEEK
+					if (fp->cltbl)
+						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the link map table (no stretch) */
+					else
+#endif
 					clst = create_chain(fp->fs, fp->curr_clust);			/* Follow or stretch cluster chain */
 				}
 				if (clst == 0) break;				/* Could not allocate a new cluster (disk full) */
@@ -1910,6 +2336,13 @@ FRESULT f_write (
 			sect += fp->csect;
 			cc = btw / SS(fp->fs);					/* When remaining bytes >= sector size, */
 			if (cc) {								/* Write maximum contiguous sectors directly */
+#if _USE_PREALLOC
+				if (fp->curr_clust >= fp->org_clust && fp->curr_clust <= fp->pre_clust) {
+					clst = (fp->pre_clust - fp->curr_clust + 1) * fp->fs->csize - fp->csect;
+					if (cc > clst) cc = clst;			/* Clip at the end of the preallocated run */
+					if (cc > 255) cc = 255;
+				} else
+#endif
 				if (fp->csect + cc > fp->fs->csize)	/* Clip at cluster boundary */
 					cc = fp->fs->csize - fp->csect;
 				if (disk_write(fp->fs->drive, wbuff, sect, (BYTE)cc) != RES_OK)
@@ -1924,6 +2357,13 @@ FRESULT f_write (
 					mem_cpy(fp->buf, wbuff + ((fp->dsect - sect) * SS(fp->fs)), SS(fp->fs));
 					fp->flag &= ~FA__DIRTY;
 				}
+#endif
+#if _USE_PREALLOC
+				if (fp->csect + cc > fp->fs->csize) {	/* Crossed clusters of the preallocated run */
+					clst = fp->csect + cc - 1;
+					fp->curr_clust += clst / fp->fs->csize;
+					fp->csect = (BYTE)(clst % fp->fs->csize + 1);
+				} else
 #endif
 				fp->csect += (BYTE)cc;				/* Next sector address in the cluster */
 				wcnt = SS(fp->fs) * cc;				/* Number of bytes transferred */
@@ -2030,6 +2470,14 @@ FRESULT f_close (
 	if (res == FR_OK) fp->fs = NULL;
 	LEAVE_FF(fp->fs, res);
 #else
+#if _USE_PREALLOC && _FS_MINIMIZE == 0
+	res = FR_OK;
+	if (fp->pre_clust && !(fp->flag & FA__ERROR)) {	/* Release the unused part of the preallocated run */
+		res = f_lseek(fp, fp->fsize);
+		if (res == FR_OK) res = f_truncate(fp);
+	}
+	if (res == FR_OK)
+#endif
 	res = f_sync(fp);
 	if (res == FR_OK) fp->fs = NULL;
 	return res;
@@ -2112,51 +2560,48 @@ FRESULT f_lseek (
 	if (res != FR_OK) LEAVE_FF(fp->fs, res);
 	if (fp->flag & FA__ERROR)			/* Check abort flag */
 		LEAVE_FF(fp->fs, FR_INT_ERR);
-	if (ofs > fp->fsize					/* In read-only mode, clip offset with the file size */
-#if !_FS_READONLY
-		 && !(fp->flag & FA_WRITE)
-#endif
-		) ofs = fp->fsize;
-
-	ifptr = fp->fptr;
-	fp->fptr = nsect = 0; fp->csect = 255;
-	if (ofs > 0) {
-		bcs = (DWORD)fp->fs->csize * SS(fp->fs);	/* Cluster size (byte) */
-		if (ifptr > 0 &&
-			(ofs - 1) / bcs >= (ifptr - 1) / bcs) {	/* When seek to same or following cluster, */
-			fp->fptr = (ifptr - 1) & ~(bcs - 1);	/* start from the current cluster */
-			ofs -= fp->fptr;
-			clst = fp->curr_clust;
-		} else {									/* When seek to back cluster, */
-			clst = fp->org_clust;					/* start from the first cluster */
-#if !_FS_READONLY
-			if (clst == 0) {						/* If no cluster chain, create a new chain */
-				clst = create_chain(fp->fs, 0);
-				if (clst == 1) ABORT(fp->fs, FR_INT_ERR);
-				if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
-				fp->org_clust = clst;
-			}
-#endif
-			fp->curr_clust = clst;
-		}
-		if (clst != 0) {
-			while (ofs > bcs) {						/* Cluster following loop */
-#if !_FS_READONLY
-				if (fp->flag & FA_WRITE) {			/* Check if in write mode or not */
-					clst = create_chain(fp->fs, clst);	/* Force stretch if in write mode */
-					if (clst == 0) {				/* When disk gets full, clip file size */
-						ofs = bcs; break;
+
+#if _USE_FASTSEEK
+	if (fp->cltbl) {	/* Fast seek */
+		DWORD pcl, ncl, tcl, tlen, ulen, *tbl;
+
+		if (ofs == CREATE_LINKMAP) {	/* Create link map table */
+			tbl = fp->cltbl;
+			tlen = *tbl++; ulen = 2;	/* Given table size and required table size */
+			clst = fp->org_clust;		/* Top of the chain */
+			if (clst) {
+				do {
+					/* Get a fragment */
+					tcl = clst; ncl = 0; ulen += 2;	/* Top, length and used items */
+					do {
+						pcl = clst; ncl++;
+						clst = get_fat(fp->fs, clst);
+						if (clst <= 1) ABORT(fp->fs, FR_INT_ERR);
+						if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
+					} while (clst == pcl + 1);
+					if (ulen <= tlen) {		/* Store the length and top of the fragment */
+						*tbl++ = ncl; *tbl++ = tcl;
 					}
-				} else
-#endif
-					clst = get_fat(fp->fs, clst);	/* Follow cluster chain if not in write mode */
-				if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
-				if (clst <= 1 || clst >= fp->fs->max_clust) ABORT(fp->fs, FR_INT_ERR);
-				fp->curr_clust = clst;
-				fp->fptr += bcs;
-				ofs -= bcs;
+				} while (clst < fp->fs->max_clust);	/* Repeat until end of chain */
 			}
-			fp->fptr += ofs;
+			*fp->cltbl = ulen;	/* Number of items used */
+			if (ulen <= tlen)
+				*tbl = 0;		/* Terminate table */
+			else
+				res = FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+			LEAVE_FF(fp->fs, res);
+		}
+
+		if (ofs > fp->fsize)		/* Clip offset at the file size */
+			ofs = fp->fsize;
+		fp->fptr = nsect = 0; fp->csect = 255;
+		if (ofs > 0) {
+			bcs = (DWORD)fp->fs->csize * SS(fp->fs);	/* Cluster size (byte) */
+			clst = clmt_clust(fp, ofs - 1);	/* Cluster of the last byte prior to the offset */
+			if (!clst) ABORT(fp->fs, FR_INT_ERR);
+			fp->curr_clust = clst;
+			fp->fptr = ofs;
+			ofs -= (ofs - 1) / bcs * bcs;	/* Offset in the cluster (1..bcs) */
 			fp->csect = (BYTE)(ofs / SS(fp->fs));	/* Sector offset in the cluster */
 			if (ofs % SS(fp->fs)) {
 				nsect = clust2sect(fp->fs, clst);	/* Current sector */
@@ -2165,6 +2610,63 @@ FRESULT f_lseek (
 				fp->csect++;
 			}
 		}
+	} else
+#endif
+	{
+		if (ofs > fp->fsize					/* In read-only mode, clip offset with the file size */
+#if !_FS_READONLY
+			 && !(fp->flag & FA_WRITE)
+#endif
+			) ofs = fp->fsize;
+
+		ifptr = fp->fptr;
+		fp->fptr = nsect = 0; fp->csect = 255;
+		if (ofs > 0) {
+			bcs = (DWORD)fp->fs->csize * SS(fp->fs);	/* Cluster size (byte) */
+			if (ifptr > 0 &&
+				(ofs - 1) / bcs >= (ifptr - 1) / bcs) {	/* When seek to same or following cluster, */
+				fp->fptr = (ifptr - 1) & ~(bcs - 1);	/* start from the current cluster */
+				ofs -= fp->fptr;
+				clst = fp->curr_clust;
+			} else {									/* When seek to back cluster, */
+				clst = fp->org_clust;					/* start from the first cluster */
+#if !_FS_READONLY
+				if (clst == 0) {						/* If no cluster chain, create a new chain */
+					clst = create_chain(fp->fs, 0);
+					if (clst == 1) ABORT(fp->fs, FR_INT_ERR);
+					if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
+					fp->org_clust = clst;
+				}
+#endif
+				fp->curr_clust = clst;
+			}
+			if (clst != 0) {
+				while (ofs > bcs) {						/* Cluster following loop */
+#if !_FS_READONLY
+					if (fp->flag & FA_WRITE) {			/* Check if in write mode or not */
+						clst = create_chain(fp->fs, clst);	/* Force stretch if in write mode */
+						if (clst == 0) {				/* When disk gets full, clip file size */
+							ofs = bcs; break;
+						}
+					} else
+#endif
+						clst = get_fat(fp->fs, clst);	/* Follow cluster chain if not in write mode */
+					if (clst == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
+					if (clst <= 1 || clst >= fp->fs->max_clust) ABORT(fp->fs, FR_INT_ERR);
+					fp->curr_clust = clst;
+					fp->fptr += bcs;
+					ofs -= bcs;
+				}
+				fp->fptr += ofs;
+				fp->csect = (BYTE)(ofs / SS(fp->fs));	/* Sector offset in the cluster */
+				if (ofs % SS(fp->fs)) {
+					nsect = clust2sect(fp->fs, clst);	/* Current sector */
+					if (!nsect) ABORT(fp->fs, FR_INT_ERR);
+					nsect += fp->csect;
+					fp->csect++;
+				}
+			}
+		}
 	}
 	if (fp->fptr % SS(fp->fs) && nsect != fp->dsect) {
 #if !_FS_TINY
@@ -2321,6 +2823,9 @@ FRESULT f_getfree (
 	DWORD n, clst, sect, stat;
 	UINT i;
 	BYTE fat, *p;
+#if _USE_FREEMAP
+	BOOL full;
+#endif
 
 
 	/* Get drive number */
@@ -2333,22 +2838,22 @@ FRESULT f_getfree (
 		LEAVE_FF(*fatfs, FR_OK);
 	}
 
-	/* Get number of free clusters */
+	/* Get number of free clusters, the free cluster map and the allocation
+	   start point are filled in by the same scan */
 	fat = (*fatfs)->fs_type;
 	n = 0;
-	if (fat == FS_FAT12) {
-		clst = 2;
-		do {
+#if _USE_FREEMAP
+	full = TRUE;
+#endif
+	clst = (fat == FS_FAT12) ? 2 : 0;
+	sect = (*fatfs)->fatbase;
+	i = 0; p = 0;
+	do {
+		if (fat == FS_FAT12) {
 			stat = get_fat(*fatfs, clst);
 			if (stat == 0xFFFFFFFF) LEAVE_FF(*fatfs, FR_DISK_ERR);
 			if (stat == 1) LEAVE_FF(*fatfs, FR_INT_ERR);
-			if (stat == 0) n++;
-		} while (++clst < (*fatfs)->max_clust);
-	} else {
-		clst = (*fatfs)->max_clust;
-		sect = (*fatfs)->fatbase;
-		i = 0; p = 0;
-		do {
+		} else {
 			if (!i) {
 				res = move_window(*fatfs, sect++);
 				if (res != FR_OK)
@@ -2357,14 +2862,26 @@ FRESULT f_getfree (
 				i = SS(*fatfs);
 			}
 			if (fat == FS_FAT16) {
-				if (LD_WORD(p) == 0) n++;
+				stat = LD_WORD(p);
 				p += 2; i -= 2;
 			} else {
-				if ((LD_DWORD(p) & 0x0FFFFFFF) == 0) n++;
+				stat = LD_DWORD(p) & 0x0FFFFFFF;
 				p += 4; i -= 4;
 			}
-		} while (--clst);
-	}
+		}
+		if (stat == 0) {
+			if (!n && ((*fatfs)->last_clust < 2 || (*fatfs)->last_clust >= (*fatfs)->max_clust))
+				(*fatfs)->last_clust = clst - 1;	/* No valid start point, allocate from the first free cluster */
+			n++;
+		}
+#if _USE_FREEMAP
+		if (stat == 0) full = FALSE;
+		if ((clst & FMAP_MASK(*fatfs)) == FMAP_MASK(*fatfs) || clst == (*fatfs)->max_clust - 1) {
+			fmap_mark(*fatfs, clst, full);
+			full = TRUE;
+		}
+#endif
+	} while (++clst < (*fatfs)->max_clust);
 	(*fatfs)->free_clust = n;
 	if (fat == FS_FAT32) (*fatfs)->fsi_flag = 1;
 	*nclst = n;
@@ -2394,9 +2911,16 @@ FRESULT f_truncate (
 	if (!(fp->flag & FA_WRITE))			/* Check access mode */
 		LEAVE_FF(fp->fs, FR_DENIED);
 
-	if (fp->fsize > fp->fptr) {
+	if (fp->fsize > fp->fptr
+#if _USE_PREALLOC
+		|| fp->pre_clust		/* Release the unused part of a preallocated run */
+#endif
+		) {
 		fp->fsize = fp->fptr;	/* Set file size to current R/W point */
 		fp->flag |= FA__WRITTEN;
+#if _USE_PREALLOC
+		fp->pre_clust = 0;
+#endif
 		if (fp->fptr == 0) {	/* When set file size to zero, remove entire cluster chain */
 			res = remove_chain(fp->fs, fp->org_clust);
 			fp->org_clust = 0;
@@ -2419,6 +2943,81 @@ FRESULT f_truncate (
 
 
 
+#if _USE_PREALLOC
+/*-----------------------------------------------------------------------*/
+/* Preallocate Contiguous Clusters to an Empty File                      */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_prealloc (
+	FIL *fp,		/* Pointer to the file object */
+	DWORD fsz		/* Number of bytes to reserve */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD bcs, tcl, scl, clst, stcl, ncl, cs;
+
+
+	res = validate(fp->fs, fp->id);		/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->flag & FA__ERROR)			/* Check abort flag */
+		LEAVE_FF(fp->fs, FR_INT_ERR);
+	if (!(fp->flag & FA_WRITE) || fp->org_clust || fp->fsize)	/* Check access mode and empty file */
+		LEAVE_FF(fp->fs, FR_DENIED);
+	fs = fp->fs;
+	bcs = (DWORD)fs->csize * SS(fs);	/* Cluster size (byte) */
+	tcl = (fsz + bcs - 1) / bcs;		/* Number of clusters to reserve */
+	if (!tcl) LEAVE_FF(fs, FR_OK);
+
+	/* Find a contiguous free run in one pass of the FAT */
+	stcl = fs->last_clust + 1;			/* Start at the suggested point */
+	if (stcl < 2 || stcl >= fs->max_clust) stcl = 2;
+	scl = clst = stcl; ncl = 0;
+	for (;;) {
+#if _USE_FREEMAP
+		if (fmap_full(fs, clst)) {		/* Skip a group known to be full */
+			cs = clst | FMAP_MASK(fs);
+			if (cs >= fs->max_clust) cs = fs->max_clust - 1;
+			if (stcl > clst && stcl <= cs) LEAVE_FF(fs, FR_DENIED);	/* No contiguous space */
+			clst = cs; cs = 0x0FFFFFFF;	/* Take the group as one cluster in use */
+		} else
+#endif
+		cs = get_fat(fs, clst);
+		if (cs == 0xFFFFFFFF) LEAVE_FF(fs, FR_DISK_ERR);
+		if (cs == 1) LEAVE_FF(fs, FR_INT_ERR);
+		if (cs == 0) {					/* Free cluster */
+			if (!ncl) scl = clst;
+			if (++ncl == tcl) break;	/* Found the run */
+		} else {
+			ncl = 0;
+		}
+		if (++clst >= fs->max_clust) {	/* A run cannot wrap around */
+			clst = 2; ncl = 0;
+		}
+		if (clst == stcl) LEAVE_FF(fs, FR_DENIED);	/* No contiguous space */
+	}
+
+	/* Link the run into a chain */
+	for (clst = scl; clst < scl + tcl - 1 && res == FR_OK; clst++)
+		res = put_fat(fs, clst, clst + 1);
+	if (res == FR_OK) res = put_fat(fs, clst, 0x0FFFFFFF);
+	if (res != FR_OK) ABORT(fs, res);
+
+	fp->org_clust = scl;				/* The file gets the run, size stays 0 */
+	fp->pre_clust = scl + tcl - 1;
+	fp->flag |= FA__WRITTEN;			/* Start cluster goes to the directory entry on f_sync */
+	fs->last_clust = fp->pre_clust;		/* Update FSINFO */
+	if (fs->free_clust != 0xFFFFFFFF)
+		fs->free_clust -= tcl;
+	fs->fsi_flag = 1;
+
+	LEAVE_FF(fs, FR_OK);
+}
+#endif
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Delete a File or Directory                                            */
 /*-----------------------------------------------------------------------*/
@@ -2462,6 +3061,9 @@ FRESULT f_unlink (
 	}
 
 	res = dir_remove(&dj);					/* Remove directory entry */
+#if _USE_DIRIDX
+	if (dir[DIR_Attr] & AM_DIR) diridx_drop(dj.fs, dclst);	/* Its cluster may hold another directory */
+#endif
 	if (res == FR_OK) {
 		if (dclst)
 			res = remove_chain(dj.fs, dclst);	/* Remove the cluster chain */
@@ -2509,6 +3111,9 @@ FRESULT f_mkdir (
 		res = move_window(dj.fs, 0);
 	if (res != FR_OK) LEAVE_FF(dj.fs, res);
 	dsect = clust2sect(dj.fs, dclst);
+#if _USE_DIRIDX
+	diridx_drop(dj.fs, dclst);				/* Index of a removed directory in the cluster */
+#endif
 
 	dir = dj.fs->win;						/* Initialize the new directory table */
 	mem_set(dir, 0, SS(dj.fs));
@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------*/
+/* Image file backend of a physical drive (stdio)                         */
+/*------------------------------------------------------------------------*/
+/* Stands in for the USB stick or the SD card when FatFs and the disk     */
+/* layer are built on a PC: diskimg_open("card.img") then                 */
+/* disk_attach(drv, &DiskImg_Drv). Not part of the firmware project.      */
+/* Build FatFs with -DFATFS_HOST: no firmware headers, no reentrancy.     */
+/*------------------------------------------------------------------------*/
+
+#define _FILE_OFFSET_BITS	64	/* off_t of fseeko/ftello, images over 2GB */
+#include <stdio.h>
+#include "diskio.h"
+
+#define SS	512		/* Sector size */
+
+#ifdef _WIN32
+typedef __int64	IMG_OFF;
+#define img_seek(f, o)	_fseeki64(f, o, SEEK_SET)
+#define img_size(f)		(_fseeki64(f, 0, SEEK_END) ? -1 : _ftelli64(f))
+#else
+#include <sys/types.h>
+typedef off_t	IMG_OFF;
+#define img_seek(f, o)	fseeko(f, o, SEEK_SET)
+#define img_size(f)		(fseeko(f, 0, SEEK_END) ? -1 : ftello(f))
+#endif
+
+static FILE *Img;				/* Opened image file */
+static DWORD ImgSectors;		/* Size of the image in sectors */
+static DSTATUS Stat = STA_NOINIT | STA_NODISK;
+
+
+
+/*------------------------------------------------------------------------*/
+/* Open / Close the Image File                                            */
+
+BOOL diskimg_open (
+	const char *path	/* Image file, its size is the size of the drive */
+)
+{
+	IMG_OFF size;
+
+	diskimg_close();
+	Img = fopen(path, "r+b");
+	if (!Img) return FALSE;
+	size = img_size(Img);
+	if (size < SS) {
+		diskimg_close();
+		return FALSE;
+	}
+	ImgSectors = (DWORD)(size / SS);
+	Stat = STA_NOINIT;
+	return TRUE;
+}
+
+
+void diskimg_close (void)
+{
+	if (Img) fclose(Img);
+	Img = 0;
+	ImgSectors = 0;
+	Stat = STA_NOINIT | STA_NODISK;
+}
+
+
+
+/*------------------------------------------------------------------------*/
+/* Backend Functions                                                      */
+
+static DSTATUS img_initialize (void)
+{
+	if (Img) Stat &= ~STA_NOINIT;
+	return Stat;
+}
+
+
+static DSTATUS img_status (void)
+{
+	return Stat;
+}
+
+
+static DRESULT img_read (BYTE *buff, DWORD sector, BYTE count)
+{
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > ImgSectors) return RES_PARERR;
+	if (img_seek(Img, (IMG_OFF)sector * SS)) return RES_ERROR;
+	return (fread(buff, SS, count, Img) == count) ? RES_OK : RES_ERROR;
+}
+
+
+#if _READONLY == 0
+static DRESULT img_write (const BYTE *buff, DWORD sector, BYTE count)
+{
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+	if (sector + count > ImgSectors) return RES_PARERR;
+	if (img_seek(Img, (IMG_OFF)sector * SS)) return RES_ERROR;
+	return (fwrite(buff, SS, count, Img) == count) ? RES_OK : RES_ERROR;
+}
+#endif
+
+
+#if _USE_IOCTL != 0
+static DRESULT img_ioctl (BYTE ctrl, void *buff)
+{
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+	switch (ctrl) {
+	case CTRL_SYNC :
+		return fflush(Img) ? RES_ERROR : RES_OK;
+
+	case GET_SECTOR_COUNT :
+		*(DWORD*)buff = ImgSectors;
+		return RES_OK;
+
+	case GET_SECTOR_SIZE :
+		*(WORD*)buff = SS;
+		return RES_OK;
+
+	case GET_BLOCK_SIZE :
+		*(DWORD*)buff = 1;
+		return RES_OK;
+	}
+	return RES_PARERR;
+}
+#endif
+
+
+const DISKIO_DRV DiskImg_Drv = {
+	img_initialize,
+	img_status,
+	img_read,
+#if _READONLY == 0
+	img_write,
+#endif
+#if _USE_IOCTL != 0
+	img_ioctl,
+#endif
+};
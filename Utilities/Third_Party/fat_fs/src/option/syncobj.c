@@ -2,14 +2,24 @@
 /* Sample code of OS dependent synchronization object controls            */
 /* for FatFs R0.07d  (C)ChaN, 2009                                        */
 /*------------------------------------------------------------------------*/
+/* uC/OS-II: OS_MUTEX_EN and OS_SEM_DEL_EN are 0 in os_cfg.h, so each     */
+/* volume uses a binary semaphore that is created once and kept over      */
+/* f_mount calls.                                                         */
+/*------------------------------------------------------------------------*/
 
-#include <windows.h>	// Win32
-//#include <ucos_ii.h>	// uC/OS-II
-
-#include "../ff.h"
+#include "ff.h"
 
 #if _FS_REENTRANT
 
+static OS_EVENT *VolSem[_DRIVES];		/* Semaphore of each logical drive, never deleted */
+
+/* Set by the disk layer whose requests are served by another task (the USB
+/  host task, usbh_msc_fatfs.c). When it returns TRUE the calling task is that
+/  task: it has served the pending requests and is called again each tick
+/  while it waits for the grant, because the owner of the volume may be
+/  waiting for it. */
+BOOL (*ff_grant_hook)(void);
+
 /*------------------------------------------------------------------------*/
 /* Create a Synchronization Object for a Volume
 /*------------------------------------------------------------------------*/
@@ -23,18 +33,12 @@ BOOL ff_cre_syncobj (	/* TRUE:Function succeeded, FALSE:Could not create due to
 	_SYNC_t *sobj		/* Pointer to return the created sync object */
 )
 {
-	BOOL ret;
-
-	*sobj = CreateMutex(NULL, FALSE, NULL);					// Win32
-	ret = (*sobj != INVALID_HANDLE_VALUE) ? TRUE : FALSE;	//
-
-//	*sobj = VolumeSemId[vol];	// uITRON (give a static created sync object)
-//	ret = TRUE;					// The initial value of the semaphore must be 1.
-
-//	*sobj = OSMutexCreate(0, &err);				// uC/OS-II
-//	ret = (err == OS_NO_ERR) ? TRUE : FALSE;	//
+	if (VolSem[vol] == (OS_EVENT *)0) {
+		VolSem[vol] = OSSemCreate(1);	/* The initial value of the semaphore must be 1. */
+	}
+	*sobj = VolSem[vol];
 
-	return ret;
+	return (*sobj != (OS_EVENT *)0) ? TRUE : FALSE;
 }
 
 
@@ -51,16 +55,9 @@ BOOL ff_del_syncobj (	/* TRUE:Function succeeded, FALSE:Could not delete due to
 	_SYNC_t sobj		/* Sync object tied to the logical drive to be deleted */
 )
 {
-	BOOL ret;
+	sobj = sobj;		/* kept in VolSem[] for the next f_mount */
 
-	ret = CloseHandle(sobj);	// Win32
-
-//	ret = TRUE;					// uITRON (nothing to do)
-
-//	OSMutexDel(sobj, OS_DEL_ALWAYS, &err);		// uC/OS-II
-//	ret = (err == OS_NO_ERR) ? TRUE : FALSE;	//
-
-	return ret;
+	return TRUE;
 }
 
 
@@ -76,16 +73,21 @@ BOOL ff_req_grant (	/* TRUE:Got a grant to access the volume, FALSE:Could not ge
 	_SYNC_t sobj	/* Sync object to wait */
 )
 {
-	BOOL ret;
+	INT8U err;
+	WORD tmr;
 
-	ret = (WaitForSingleObject(sobj, _FS_TIMEOUT) == WAIT_OBJECT_0) ? TRUE : FALSE;	// Win32
+	if (ff_grant_hook && ff_grant_hook()) {
+		for (tmr = 0; tmr < _FS_TIMEOUT; tmr++) {
+			OSSemPend(sobj, 1, &err);
+			if (err == OS_ERR_NONE) return TRUE;
+			ff_grant_hook();
+		}
+		return FALSE;
+	}
 
-//	ret = (wai_sem(sobj) == E_OK) ? TRUE : FALSE;	// uITRON
+	OSSemPend(sobj, _FS_TIMEOUT, &err);
 
-//	OSMutexPend(sobj, _FS_TIMEOUT, &err));				// uC/OS-II
-//	ret = (err == OS_NO_ERR) ? TRUE : FALSE;		//
-
-	return ret;
+	return (err == OS_ERR_NONE) ? TRUE : FALSE;
 }
 
 
@@ -100,11 +102,7 @@ void ff_rel_grant (
 	_SYNC_t sobj	/* Sync object to be signaled */
 )
 {
-	ReleaseMutex(sobj);	// Win32
-
-//	sig_sem(sobj);		// uITRON
-
-//	OSMutexPost(sobj);	// uC/OS-II
+	OSSemPost(sobj);
 }
 
 
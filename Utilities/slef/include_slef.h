@@ -6,6 +6,8 @@
 #define     PRINTF_DFU_CORE		1
 #define     PRINTF_IO_REQ		1
 #define     PRINTF_DBG_SHELL	1
+#define     PRINTF_USBH_HUB		1
+#define     PRINTF_USBH_MSC		1
 
 #include	<string.h>
 #include 	"stm32f2xx.h"
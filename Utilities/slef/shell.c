@@ -4,6 +4,10 @@
 #define SHELL_GLOBALS 
 #include "include_slef.H"
 #include "ucos_ii.H"
+#include "usb_hcd.h"
+#include "usbh_usr.h"
+#include "usbh_msc_cache.h"
+#include "ff.h"
 #pragma  diag_suppress 870
 
 #define  MAX_PARAM                 4
@@ -13,6 +17,15 @@ static void cmd_Reset(void);
 static void cmd_Test(void);
 static void cmd_Test2(void);
 static void cmd_CLS(void);
+#ifdef USB_OTG_HCD_STATS
+static void cmd_UsbStat(void);
+#endif
+#ifdef USB_OTG_HCD_FAULT
+static void cmd_UsbFault(void);
+#endif
+static void cmd_MscBench(void);
+static void cmd_MscCache(void);
+static void cmd_FRead(void);
 
 static INT32U cmd_ChgPara2DEC(INT8U* para,INT8U paralen);
 
@@ -48,6 +61,15 @@ static const SHELLMAP  shellmap[] =
     {"TEST",cmd_Test,1},
     {"TEST2",cmd_Test2,3,"可接收三个参数"},
     {"CLS",cmd_CLS,0,"会输出一些空行，和之前的显示内容分开\n"},
+#ifdef USB_OTG_HCD_STATS
+    {"USBSTAT",cmd_UsbStat,0,"USB主机各通道的URB次数、字节数和提交到完成的耗时(us),显示后清零"},
+#endif
+#ifdef USB_OTG_HCD_FAULT
+    {"USBFAULT",cmd_UsbFault,3,"通道 类型(1:NAK 2:STALL 3:ERROR) 次数, 例如: 'usbfault 1 1 10'"},
+#endif
+    {"MSCBENCH",cmd_MscBench,1,"U盘读写速度(KB/s),参数为测试文件大小(KB),U盘空闲时由USB任务执行, 例如: 'mscbench 1024'"},
+    {"MSCCACHE",cmd_MscCache,0,"U盘扇区缓存的命中率、预读/合并写的扇区数和READ10/WRITE10命令数,显示后清零"},
+    {"FREAD",cmd_FRead,1,"在本任务中读取U盘文件,读写请求由USB任务执行, 例如: 'fread image.bin'"},
 };
 
 
@@ -117,6 +139,103 @@ void cmd_StackFlow(void)
 		a[i]=1;
 	}
 }
+#ifdef USB_OTG_HCD_STATS
+static void cmd_UsbStat(void)
+{
+	INT8U i;
+	INT32U us = SystemCoreClock / 1000000;
+	HCD_STATS_TypeDef *pStats;
+
+	SHELL_DEBUG((":>ch submit done nak stall err bytes avg(us) max(us)\n"));
+	for(i=0; i<USB_OTG_MAX_TX_FIFOS; i++)
+	{
+		pStats = HCD_GetStats(i);
+		if(pStats->Submit == 0) continue;
+		SHELL_DEBUG(("  %l %l %l %l %l %l %l %l %l\n",i,pStats->Submit,pStats->Done,pStats->NotReady,
+			pStats->Stall,pStats->Error,pStats->Bytes,
+			pStats->Done ? (pStats->CycSum / pStats->Done / us) : 0,pStats->CycMax / us));
+	}
+	HCD_ClearStats();
+}
+#endif
+
+#ifdef USB_OTG_HCD_FAULT
+static void cmd_UsbFault(void)
+{
+	INT32U ch,type,cnt;
+	static const URB_STATE urb[] = {URB_IDLE,URB_NOTREADY,URB_STALL,URB_ERROR};
+
+	ch   = cmd_ChgPara2DEC(incmd.param[0],incmd.paramlen[0]);
+	type = cmd_ChgPara2DEC(incmd.param[1],incmd.paramlen[1]);
+	cnt  = cmd_ChgPara2DEC(incmd.param[2],incmd.paramlen[2]);
+	if((ch >= USB_OTG_MAX_TX_FIFOS)||(type == 0)||(type > 3)){
+		SHELL_DEBUG((":> 参数错误\n"));
+		return;
+	}
+	HCD_InjectFault(ch,urb[type],cnt);
+	SHELL_DEBUG((":> 通道%l 之后%l次URB返回%l\n",ch,cnt,type));
+}
+#endif
+
+static void cmd_MscBench(void)
+{
+	INT32U kb;
+
+	kb = cmd_ChgPara2DEC(incmd.param[0],incmd.paramlen[0]);
+	if(kb == 0){
+		SHELL_DEBUG((":> 参数错误\n"));
+		return;
+	}
+	USBH_USR_MSC_BenchRequest(kb);
+	SHELL_DEBUG((":> 已请求%l KB的读写测试\n",kb));
+}
+
+static void cmd_MscCache(void)
+{
+	MSC_CACHE_STATS_ST *pStats = USBH_MSC_Cache_GetStats();
+	INT32U total = pStats->Hit + pStats->Miss;
+
+	SHELL_DEBUG((":> disk_read %l disk_write %l 多扇区 %l\n",pStats->Read,pStats->Write,pStats->Direct));
+	SHELL_DEBUG((":> 命中 %l 未命中 %l 命中率(百分比) %l\n",pStats->Hit,pStats->Miss,total ? (pStats->Hit * 100 / total) : 0));
+	SHELL_DEBUG((":> READ10 %l WRITE10 %l 写回 %l 丢失 %l\n",pStats->BotRead,pStats->BotWrite,pStats->WriteBack,pStats->Lost));
+	SHELL_DEBUG((":> 预读提供 %l 合并写 %l 扇区\n",pStats->RaHit,pStats->Merged));
+	USBH_MSC_Cache_ClearStats();
+}
+
+static void cmd_FRead(void)
+{
+	static FIL file;
+	static INT8U buf[512];
+	char path[32];
+	UINT br;
+	INT32U total = 0,tick;
+	INT8U len = incmd.paramlen[0];
+	FRESULT res;
+
+	if(len > sizeof(path) - 3){
+		len = sizeof(path) - 3;
+	}
+	path[0] = '0';
+	path[1] = ':';
+	memcpy(&path[2],incmd.param[0],len);
+	path[2 + len] = 0;
+
+	tick = OSTimeGet();
+	res = f_open(&file,path,FA_OPEN_EXISTING | FA_READ);
+	if(res != FR_OK){
+		SHELL_DEBUG((":> 打开失败 %d\n",res));
+		return;
+	}
+	do{
+		res = f_read(&file,buf,sizeof(buf),&br);
+		total += br;
+	}while((res == FR_OK) && (br == sizeof(buf)));
+	f_close(&file);
+	tick = OSTimeGet() - tick;
+
+	SHELL_DEBUG((":> 读出 %l 字节,耗时 %l ms,结果 %d\n",total,tick * 1000 / OS_TICKS_PER_SEC,res));
+}
+
 static void cmd_Reset(void)
 {	
 	//((void (*)())0)();
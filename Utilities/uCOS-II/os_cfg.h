@@ -39,7 +39,7 @@
 #define OS_LOWEST_PRIO            16u  /* Ϳɷȼ ...                                   */
                                        /* ... С254                                              */
 
-#define OS_MAX_EVENTS             6u   /* ӦóУ¼ƿ                         */
+#define OS_MAX_EVENTS            10u   /* ӦóУ¼ƿ                         */
 #define OS_MAX_FLAGS              6u   /* ӦóУ¼־                         */
 #define OS_MAX_MEM_PART           6u   /* ڴ                                               */
 #define OS_MAX_QS                 8u   /* ӦóУпƿ                         */
@@ -123,7 +123,7 @@
 
                                        /* -------------------------- ź -------------------------- */
 #define OS_SEM_EN                 1u   /* Enable (1) or Disable (0) code generation for SEMAPHORES     */
-#define OS_SEM_ACCEPT_EN          0u   /*    Include code for OSSemAccept()                            */
+#define OS_SEM_ACCEPT_EN          1u   /*    Include code for OSSemAccept()                            */
 #define OS_SEM_DEL_EN             0u   /*    Include code for OSSemDel()                               */
 #define OS_SEM_PEND_ABORT_EN      0u   /*    Include code for OSSemPendAbort()                         */
 #define OS_SEM_QUERY_EN           0u   /*    Include code for OSSemQuery()                             */